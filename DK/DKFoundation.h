@@ -47,6 +47,9 @@ namespace DKFoundation {}
 #include "DKFoundation/DKLinkedList.h"
 #include "DKFoundation/DKMap.h"
 #include "DKFoundation/DKSet.h"
+#include "DKFoundation/DKHashTable.h"
+#include "DKFoundation/DKHashMap.h"
+#include "DKFoundation/DKHashSet.h"
 #include "DKFoundation/DKStack.h"
 #include "DKFoundation/DKStaticArray.h"
 #include "DKFoundation/DKTuple.h"
@@ -86,9 +86,8 @@ DKAllocator& DKAllocator::DefaultAllocator(DKMemoryLocation loc)
 
 DKGL_API void* operator new (size_t s, DKAllocator& a)
 {
-	void* p = a.Alloc(s);
-	bool b = DKObjectRefCounter::SetRefCounter(p, &a, 0, NULL);
-	DKASSERT_STD_DESC_DEBUG(b, "DKObjectRefCounter failed.");
+	void* p = DKObjectRefCounter::Alloc(&a, s, 0, NULL);
+	DKASSERT_STD_DESC_DEBUG(p, "DKObjectRefCounter failed.");
 	return p;
 }
 
@@ -97,5 +96,5 @@ DKGL_API void operator delete (void* p, DKAllocator& a)
 	DKAllocator* alloc = NULL;
 	DKObjectRefCounter::UnsetRefCounter(p, 0, &alloc);
 	DKASSERT_STD_DESC_DEBUG(alloc == &a, "Wrong allocator object.");
-	a.Dealloc(p);
+	DKObjectRefCounter::Dealloc(&a, p);
 }
@@ -33,6 +33,9 @@ namespace DKFoundation
 
 /// allocate memory and tracking reference count by DKAllocator object.
 /// You have to provide your allocator (DKAllocator subclass) object.
+/// The memory should be released with DKObjectRefCounter::Dealloc,
+/// because ref-counter can be placed in front of the object.
+/// (see DKGL_INLINE_REFCOUNT in DKObjectRefCounter.h)
 DKGL_API void* operator new (size_t, DKFoundation::DKAllocator&);
 /// Invoked when allocation failed.
 DKGL_API void operator delete (void*, DKFoundation::DKAllocator&);
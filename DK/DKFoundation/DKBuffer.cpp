@@ -399,14 +399,24 @@ DKObject<DKBuffer> DKBuffer::Compress(const DKCompressor& compressor, const void
 
 
 DKObject<DKBuffer> DKBuffer::Decompress(DKAllocator& alloc) const
+{
+	return Decompress(DKCompressor(), alloc);
+}
+
+DKObject<DKBuffer> DKBuffer::Decompress(const DKCompressor& compressor, DKAllocator& alloc) const
 {
 	const void* p = this->Contents();
 	size_t len = this->Length();
-	DKObject<DKBuffer> result = Decompress(p, len, alloc);
+	DKObject<DKBuffer> result = Decompress(compressor, p, len, alloc);
 	return result;
 }
 
 DKObject<DKBuffer> DKBuffer::Decompress(const void* p, size_t len, DKAllocator& alloc)
+{
+	return Decompress(DKCompressor(), p, len, alloc);
+}
+
+DKObject<DKBuffer> DKBuffer::Decompress(const DKCompressor& compressor, const void* p, size_t len, DKAllocator& alloc)
 {
 	if (p && len > 4)
 	{
@@ -414,7 +424,7 @@ DKObject<DKBuffer> DKBuffer::Decompress(const void* p, size_t len, DKAllocator&
 		DKBufferStream outputStream(output);
 		DKDataStream inputStream(DKData::StaticData(p, len));
 
-		if (DKCompressor().Decompress(&inputStream, &outputStream))
+		if (compressor.Decompress(&inputStream, &outputStream))
 			return outputStream.Buffer();
 	}
 	return NULL;
@@ -44,6 +44,9 @@ namespace DKFoundation
 		DKObject<DKBuffer> Decompress(DKAllocator& alloc = DKAllocator::DefaultAllocator()) const;
 		static DKObject<DKBuffer> Compress(const DKCompressor&, const void* p, size_t len, DKAllocator& alloc = DKAllocator::DefaultAllocator());
 		static DKObject<DKBuffer> Decompress(const void* p, size_t len, DKAllocator& alloc = DKAllocator::DefaultAllocator());
+		/// decompress with compressor which has dictionary.
+		DKObject<DKBuffer> Decompress(const DKCompressor&, DKAllocator& alloc = DKAllocator::DefaultAllocator()) const;
+		static DKObject<DKBuffer> Decompress(const DKCompressor&, const void* p, size_t len, DKAllocator& alloc = DKAllocator::DefaultAllocator());
 
 		/// base64 encode / decode
 		bool Base64Encode(DKStringU8& strOut) const;
@@ -10,7 +10,9 @@
 
 #include "../Libs/zlib/zlib.h"
 
+#define ZSTD_STATIC_LINKING_ONLY	// ZSTD_initCStream_usingCDict, ZSTD_initDStream_usingDDict
 #include "../Libs/zstd/lib/zstd.h"
+#include "../Libs/zstd/lib/dictBuilder/zdict.h"
 
 #include "../Libs/lz4/lib/lz4.h"
 #include "../Libs/lz4/lib/lz4hc.h"
@@ -23,6 +25,10 @@
 #include "DKCompressor.h"
 #include "DKEndianness.h"
 #include "DKLog.h"
+#include "DKBuffer.h"
+#include "DKCriticalSection.h"
+#include "DKOperationQueue.h"
+#include "Private/OrderedJobs.h"
 
 #define COMPRESSION_CHUNK_SIZE 0x40000
 
@@ -46,28 +52,140 @@ namespace DKFoundation::Private
         }
     };
 
+    // Reusable zlib, zstd contexts and buffers.
+    // Each thread has its own context, a temporary context is used
+    // if the thread context is in use. (nested by stream callback)
+    struct CompressorContext
+    {
+        CompressorBuffer inputBuffer;
+        CompressorBuffer outputBuffer;
+        ZSTD_CStream* cstream;
+        ZSTD_DStream* dstream;
+        z_stream deflateStream;
+        z_stream inflateStream;
+        int deflateLevel;       // -1 if deflateStream is not initialized
+        bool inflateInitialized;
+        bool inUse;
+
+        CompressorContext()
+            : inputBuffer(COMPRESSION_CHUNK_SIZE)
+            , outputBuffer(COMPRESSION_CHUNK_SIZE)
+            , cstream(nullptr)
+            , dstream(nullptr)
+            , deflateStream{}
+            , inflateStream{}
+            , deflateLevel(-1)
+            , inflateInitialized(false)
+            , inUse(false)
+        {
+            DKASSERT_DEBUG(COMPRESSION_CHUNK_SIZE >= ZSTD_CStreamInSize());
+            DKASSERT_DEBUG(COMPRESSION_CHUNK_SIZE >= ZSTD_CStreamOutSize());
+            DKASSERT_DEBUG(COMPRESSION_CHUNK_SIZE >= ZSTD_DStreamInSize());
+            DKASSERT_DEBUG(COMPRESSION_CHUNK_SIZE >= ZSTD_DStreamOutSize());
+        }
+        ~CompressorContext()
+        {
+            if (cstream)
+                ZSTD_freeCStream(cstream);
+            if (dstream)
+                ZSTD_freeDStream(dstream);
+            if (deflateLevel >= 0)
+                deflateEnd(&deflateStream);
+            if (inflateInitialized)
+                inflateEnd(&inflateStream);
+        }
+        bool IsValid() const
+        {
+            return inputBuffer.buffer && outputBuffer.buffer;
+        }
+        /// initialize deflate stream with level, reuse previous state if possible.
+        int DeflateInit(int level)
+        {
+            if (deflateLevel == level)
+                return deflateReset(&deflateStream);
+            if (deflateLevel >= 0)
+                deflateEnd(&deflateStream);
+            deflateLevel = -1;
+            deflateStream = {};
+            int err = deflateInit(&deflateStream, level);
+            if (err == Z_OK)
+                deflateLevel = level;
+            return err;
+        }
+        int InflateInit()
+        {
+            if (inflateInitialized)
+                return inflateReset(&inflateStream);
+            inflateStream = {};
+            int err = inflateInit(&inflateStream);
+            inflateInitialized = err == Z_OK;
+            return err;
+        }
+        /*
+         Zstd requests a large amount of memory allocation.
+         So we do not need to use DKMalloc.
+         */
+        ZSTD_CStream* CStream()
+        {
+            if (cstream == nullptr)
+                cstream = ZSTD_createCStream();
+            return cstream;
+        }
+        ZSTD_DStream* DStream()
+        {
+            if (dstream == nullptr)
+                dstream = ZSTD_createDStream();
+            return dstream;
+        }
+    };
+
+    struct CompressorContextRef
+    {
+        CompressorContext* context;
+        CompressorContext* temporary;
+
+        CompressorContextRef() : temporary(nullptr)
+        {
+            static thread_local CompressorContext threadContext;
+            if (threadContext.inUse || !threadContext.IsValid())
+            {
+                temporary = new CompressorContext();
+                context = temporary;
+            }
+            else
+            {
+                context = &threadContext;
+            }
+            context->inUse = true;
+        }
+        ~CompressorContextRef()
+        {
+            context->inUse = false;
+            if (temporary)
+                delete temporary;
+        }
+        CompressorContext* operator -> () { return context; }
+    };
+
     static bool CompressDeflate(DKStream* input, DKStream* output, int level)
     {
-        CompressorBuffer inputBuffer(COMPRESSION_CHUNK_SIZE);
-        CompressorBuffer outputBuffer(COMPRESSION_CHUNK_SIZE);
+        CompressorContextRef context;
+        CompressorBuffer& inputBuffer = context->inputBuffer;
+        CompressorBuffer& outputBuffer = context->outputBuffer;
 
-        if (inputBuffer.buffer == nullptr || outputBuffer.buffer == nullptr)
+        if (!context->IsValid())
         {
             DKLogE("DKCompressor Error: Out of memory!");
             return false;
         }
 
-        int err = Z_OK;
-        z_stream stream = {};
-        stream.zalloc = Z_NULL;
-        stream.zfree = Z_NULL;
-        stream.opaque = Z_NULL;
-
+        z_stream& stream = context->deflateStream;
         int compressLevel = level;	// Z_DEFAULT_COMPRESSION is 6
-        err = deflateInit(&stream, compressLevel);
+        int err = context->DeflateInit(compressLevel);
         if (err == Z_OK)
         {
             int flush = Z_NO_FLUSH;
+            stream.avail_in = 0;
             while (err == Z_OK)
             {
                 if (stream.avail_in == 0)
@@ -102,32 +220,28 @@ namespace DKFoundation::Private
                     break;
                 }
             }
-            deflateEnd(&stream);
         }
         return err == Z_STREAM_END;
     }
 
     static bool DecompressDeflate(DKStream* input, DKStream* output)
     {
-        CompressorBuffer inputBuffer(COMPRESSION_CHUNK_SIZE);
-        CompressorBuffer outputBuffer(COMPRESSION_CHUNK_SIZE);
+        CompressorContextRef context;
+        CompressorBuffer& inputBuffer = context->inputBuffer;
+        CompressorBuffer& outputBuffer = context->outputBuffer;
 
-        if (inputBuffer.buffer == nullptr || outputBuffer.buffer == nullptr)
+        if (!context->IsValid())
         {
             DKLogE("DKCompressor Error: Out of memory!");
             return false;
         }
 
-        int err = Z_OK;
-        z_stream stream = {};
-        stream.zalloc = Z_NULL;
-        stream.zfree = Z_NULL;
-        stream.opaque = Z_NULL;
-        stream.avail_in = 0;
-        stream.next_in = Z_NULL;
-        err = inflateInit(&stream);
+        z_stream& stream = context->inflateStream;
+        int err = context->InflateInit();
         if (err == Z_OK)
         {
+            stream.avail_in = 0;
+            stream.next_in = Z_NULL;
             while (err == Z_OK)
             {
                 if (stream.avail_in == 0)
@@ -166,8 +280,6 @@ namespace DKFoundation::Private
                     }
                 }
             }
-            inflateEnd(&stream);
-
             return err == Z_STREAM_END;
         }
         else
@@ -177,35 +289,23 @@ namespace DKFoundation::Private
         return false;
     }
 
-    static bool CompressZstd(DKStream* input, DKStream* output, int level)
+    static bool CompressZstd(DKStream* input, DKStream* output, int level, const ZSTD_CDict* cdict)
     {
-        CompressorBuffer inputBuffer(ZSTD_CStreamInSize());
-        CompressorBuffer outputBuffer(ZSTD_CStreamOutSize());
+        CompressorContextRef context;
+        CompressorBuffer& inputBuffer = context->inputBuffer;
+        CompressorBuffer& outputBuffer = context->outputBuffer;
 
-        if (inputBuffer.buffer == nullptr || outputBuffer.buffer == nullptr)
+        if (!context->IsValid())
         {
             DKLogE("DKCompressor Error: Out of memory!");
             return false;
         }
 
-        /*
-        Zstd requests a large amount of memory allocation.
-        So we do not need to use DKMalloc.
-        */
-#if 0   
-        ZSTD_customMem customMem = {
-            [](void* opaque, size_t size)->void* {return DKMalloc(size); }, //ZSTD_allocFunction
-            [](void* opaque, void* address) { DKFree(address); }, //ZSTD_freeFunction
-            nullptr //opaque
-        };
-        ZSTD_CStream* const cstream = ZSTD_createCStream_advanced(customMem);
-#else
-        ZSTD_CStream* const cstream = ZSTD_createCStream();
-#endif
+        ZSTD_CStream* const cstream = context->CStream();
         if (cstream)
         {
             bool result = false;
-            size_t const initResult = ZSTD_initCStream(cstream, level);
+            size_t const initResult = cdict ? ZSTD_initCStream_usingCDict(cstream, cdict) : ZSTD_initCStream(cstream, level);
             if (ZSTD_isError(initResult))
             {
                 DKLogE("DKCompressor::Compress error: ZSTD_initCStream failed: %s",
@@ -272,7 +372,6 @@ namespace DKFoundation::Private
                     }
                 }
             }
-            ZSTD_freeCStream(cstream);
             return result;
         }
         else
@@ -282,35 +381,23 @@ namespace DKFoundation::Private
         return false;
     }
 
-    static bool DecompressZstd(DKStream* input, DKStream* output)
+    static bool DecompressZstd(DKStream* input, DKStream* output, const ZSTD_DDict* ddict)
     {
-        CompressorBuffer inputBuffer(ZSTD_DStreamInSize());
-        CompressorBuffer outputBuffer(ZSTD_DStreamOutSize());
+        CompressorContextRef context;
+        CompressorBuffer& inputBuffer = context->inputBuffer;
+        CompressorBuffer& outputBuffer = context->outputBuffer;
 
-        if (inputBuffer.buffer == nullptr || outputBuffer.buffer == nullptr)
+        if (!context->IsValid())
         {
             DKLogE("DKCompressor Error: Out of memory!");
             return false;
         }
 
-        /*
-        Zstd requests a large amount of memory allocation.
-        So we do not need to use DKMalloc.
-        */
-#if 0   
-        ZSTD_customMem customMem = {
-            [](void* opaque, size_t size)->void* { return DKMalloc(size); }, //ZSTD_allocFunction
-            [](void* opaque, void* address) { DKFree(address); }, //ZSTD_freeFunction
-            nullptr //opaque
-        };
-        ZSTD_DStream* const dstream = ZSTD_createDStream_advanced(customMem);
-#else
-        ZSTD_DStream* const dstream = ZSTD_createDStream();
-#endif
+        ZSTD_DStream* const dstream = context->DStream();
         if (dstream)
         {
             bool result = false;
-            size_t const initResult = ZSTD_initDStream(dstream);
+            size_t const initResult = ddict ? ZSTD_initDStream_usingDDict(dstream, ddict) : ZSTD_initDStream(dstream);
             if (ZSTD_isError(initResult))
             {
                 DKLogE("DKCompressor::Compress error: ZSTD_initDStream failed: %s",
@@ -322,7 +409,7 @@ namespace DKFoundation::Private
                 size_t toRead = initResult;
                 while (toRead > 0)
                 {
-                    DKASSERT_DEBUG(inputBuffer.bufferSize >= toRead);
+                    toRead = Min(toRead, inputBuffer.bufferSize);
                     size_t read = input->Read(inputBuffer.buffer, toRead);
                     if (read > 0)
                     {
@@ -345,6 +432,8 @@ namespace DKFoundation::Private
                                 break;
                             }
                         }
+                        if (!result)
+                            break;
                     }
                     else
                     {
@@ -357,8 +446,6 @@ namespace DKFoundation::Private
                     }
                 }
             }
-
-            ZSTD_freeDStream(dstream);
             return result;
         }
         else
@@ -848,12 +935,360 @@ namespace DKFoundation::Private
         return false;
     }
 
+    static bool CompressStream(DKCompressor::Method m, DKStream* input, DKStream* output, const ZSTD_CDict* cdict)
+    {
+        switch (m)
+        {
+        case DKCompressor::Zlib:
+            return CompressDeflate(input, output, 5); // Z_DEFAULT_COMPRESSION is 6
+        case DKCompressor::Zstd:
+            return CompressZstd(input, output, ZSTD_CLEVEL_DEFAULT, cdict);
+        case DKCompressor::ZstdMax:
+            return CompressZstd(input, output, 19, cdict);// Clamp(19, int(ZSTD_CLEVEL_DEFAULT), ZSTD_maxCLevel()));
+        case DKCompressor::LZ4:
+            return CompressLZ4(input, output, 0);
+        case DKCompressor::LZ4HC:
+            return CompressLZ4(input, output, 9); // 0 for LZ4 fast, 9 for LZ4HC
+        case DKCompressor::Lzma:
+            return CompressLzma(input, output, 5);
+        case DKCompressor::LzmaFast:
+            return CompressLzma(input, output, 0);
+        case DKCompressor::LzmaUltra:
+            return CompressLzma(input, output, 9);
+        }
+        DKLogE("DKCompressor::Compress error: Unknown format.");
+        return false;
+    }
+
+    static bool DecompressStream(DKCompressor::Method m, DKStream* input, DKStream* output, const ZSTD_DDict* ddict)
+    {
+        switch (m)
+        {
+        case DKCompressor::Zlib:
+            return DecompressDeflate(input, output);
+        case DKCompressor::Zstd:
+        case DKCompressor::ZstdMax:
+            return DecompressZstd(input, output, ddict);
+        case DKCompressor::LZ4:
+        case DKCompressor::LZ4HC:
+            return DecompressLZ4(input, output);
+        case DKCompressor::Lzma:
+        case DKCompressor::LzmaFast:
+        case DKCompressor::LzmaUltra:
+            return DecompressLzma(input, output);
+        }
+        DKLogE("DKCompressor Error: Unknown format!");
+        return false;
+    }
+
+    /*
+     Block-compressed format (little-endian)
+       header:  uint32 magic('DKCB'), uint8 version, uint8 method, uint16 reserved,
+                uint32 blockSize, uint32 reserved
+       blocks:  uint32 compressedSize, uint32 originalSize, compressed data
+                (each block is complete compressed stream of method)
+       end:     uint32 0, uint32 numBlocks
+       index:   numBlocks * { uint64 offset, uint32 compressedSize, uint32 originalSize }
+       trailer: uint64 indexOffset, uint32 numBlocks, uint32 magic('DKCI')
+     all offsets are relative to beginning of header.
+     */
+    enum : uint32_t
+    {
+        BlockHeaderMagic = 0x42434B44U,     // 'DKCB'
+        BlockTrailerMagic = 0x49434B44U,    // 'DKCI'
+        BlockFormatVersion = 1,
+        BlockMaxSize = 0x40000000U,         // 1GB
+    };
+#pragma pack(push, 1)
+    struct BlockFileHeader
+    {
+        uint32_t magic;
+        uint8_t version;
+        uint8_t method;
+        uint16_t reserved1;
+        uint32_t blockSize;
+        uint32_t reserved2;
+    };
+    struct BlockHeader
+    {
+        uint32_t compressedSize;
+        uint32_t originalSize;
+    };
+    struct BlockIndexEntry
+    {
+        uint64_t offset;
+        uint32_t compressedSize;
+        uint32_t originalSize;
+    };
+    struct BlockFileTrailer
+    {
+        uint64_t indexOffset;
+        uint32_t numBlocks;
+        uint32_t magic;
+    };
+#pragma pack(pop)
+    static_assert(sizeof(BlockFileHeader) == 16, "Invalid header size");
+    static_assert(sizeof(BlockIndexEntry) == 16, "Invalid index size");
+    static_assert(sizeof(BlockFileTrailer) == 16, "Invalid trailer size");
+
+    static bool IsBlockCompressed(const void* p, size_t n)
+    {
+        if (p && n >= sizeof(BlockFileHeader))
+        {
+            const BlockFileHeader* header = reinterpret_cast<const BlockFileHeader*>(p);
+            return DKLittleEndianToSystem(header->magic) == BlockHeaderMagic &&
+                header->version == BlockFormatVersion &&
+                header->method <= DKCompressor::LzmaUltra;
+        }
+        return false;
+    }
+
+    // memory stream for single block.
+    struct BlockStream : public DKStream
+    {
+        uint8_t* data = nullptr;
+        size_t length = 0;
+        size_t capacity = 0;
+        size_t position = 0;
+        size_t maxLength = ~size_t(0);  // writing beyond this fails.
+
+        ~BlockStream()
+        {
+            if (data)
+                DKFree(data);
+        }
+        bool Reserve(size_t s)
+        {
+            if (s > capacity)
+            {
+                void* p = DKRealloc(data, s);
+                if (p == nullptr)
+                    return false;
+                data = reinterpret_cast<uint8_t*>(p);
+                capacity = s;
+            }
+            return true;
+        }
+        void Reset()
+        {
+            length = 0;
+            position = 0;
+        }
+        /// fill buffer with s bytes from input
+        size_t ReadFrom(DKStream* input, size_t s)
+        {
+            Reset();
+            if (!Reserve(s))
+                return PositionError;
+            while (length < s)
+            {
+                size_t n = input->Read(&data[length], s - length);
+                if (n == PositionError)
+                    return PositionError;
+                if (n == 0)
+                    break;
+                length += n;
+            }
+            return length;
+        }
+        Position SetCurrentPosition(Position p) override
+        {
+            position = static_cast<size_t>(Min(p, Position(length)));
+            return position;
+        }
+        Position CurrentPosition() const override { return position; }
+        Position RemainLength() const override { return length - position; }
+        Position TotalLength() const override { return length; }
+        size_t Read(void* p, size_t s) override
+        {
+            s = Min(s, length - position);
+            memcpy(p, &data[position], s);
+            position += s;
+            return s;
+        }
+        size_t Write(const void* p, size_t s) override
+        {
+            if (position + s > maxLength)
+                return PositionError;
+            if (position + s > capacity)
+            {
+                if (!Reserve(Min(Max(position + s, capacity * 2), maxLength)))
+                    return PositionError;
+            }
+            memcpy(&data[position], p, s);
+            position += s;
+            length = Max(length, position);
+            return s;
+        }
+        bool IsReadable() const override { return true; }
+        bool IsWritable() const override { return true; }
+        bool IsSeekable() const override { return true; }
+    };
+
+    struct BlockJob
+    {
+        BlockStream input;
+        BlockStream output;
+        uint32_t originalSize = 0;
+    };
+
+    // prepare output of block with original size from header, which is not
+    // trusted. buffer is reserved up to the maximum compression ratio of
+    // formats (deflate ~1032:1), and grows up to original size if needed.
+    static bool PrepareBlockOutput(BlockStream& output, size_t compressedSize, size_t originalSize)
+    {
+        output.Reset();
+        output.maxLength = originalSize;
+        return output.Reserve(Min(originalSize, compressedSize * 1032));
+    }
+
+    static bool CompressBlocks(DKCompressor::Method method, DKStream* input, DKStream* output, DKOperationQueue* queue, size_t blockSize, const ZSTD_CDict* cdict)
+    {
+        BlockFileHeader header = {};
+        header.magic = DKSystemToLittleEndian(uint32_t(BlockHeaderMagic));
+        header.version = BlockFormatVersion;
+        header.method = static_cast<uint8_t>(method);
+        header.blockSize = DKSystemToLittleEndian(static_cast<uint32_t>(blockSize));
+        if (output->Write(&header, sizeof(header)) != sizeof(header))
+        {
+            DKLogE("DKCompressor Error: Output stream error!");
+            return false;
+        }
+
+        DKArray<BlockIndexEntry> index;
+        uint64_t offset = sizeof(header);
+        bool result = ProcessOrderedJobs<BlockJob>(queue, [&](BlockJob* job, bool& next)->bool
+        {
+            size_t s = job->input.ReadFrom(input, blockSize);
+            if (s == DKStream::PositionError)
+            {
+                DKLogE("DKCompressor Error: Input stream error!");
+                return false;
+            }
+            next = s > 0;
+            return true;
+        }, [method, cdict](BlockJob* job)->bool
+        {
+            job->output.Reset();
+            job->output.Reserve(job->input.length);
+            return CompressStream(method, &job->input, &job->output, cdict);
+        }, [&](BlockJob* job)->bool
+        {
+            if (job->output.length >= BlockMaxSize)
+            {
+                DKLogE("DKCompressor Error: Block is too large!");
+                return false;
+            }
+            BlockHeader bh = {
+                DKSystemToLittleEndian(static_cast<uint32_t>(job->output.length)),
+                DKSystemToLittleEndian(static_cast<uint32_t>(job->input.length))
+            };
+            if (output->Write(&bh, sizeof(bh)) != sizeof(bh) ||
+                output->Write(job->output.data, job->output.length) != job->output.length)
+            {
+                DKLogE("DKCompressor Error: Output stream error!");
+                return false;
+            }
+            BlockIndexEntry entry = {
+                DKSystemToLittleEndian(offset + sizeof(bh)),
+                bh.compressedSize,
+                bh.originalSize
+            };
+            index.Add(entry);
+            offset += sizeof(bh) + job->output.length;
+            return true;
+        });
+        if (result)
+        {
+            BlockHeader end = { 0, DKSystemToLittleEndian(static_cast<uint32_t>(index.Count())) };
+            BlockFileTrailer trailer = {
+                DKSystemToLittleEndian(offset + sizeof(end)),
+                end.originalSize,
+                DKSystemToLittleEndian(uint32_t(BlockTrailerMagic))
+            };
+            size_t indexSize = sizeof(BlockIndexEntry) * index.Count();
+            if (output->Write(&end, sizeof(end)) != sizeof(end) ||
+                (indexSize > 0 && output->Write((const BlockIndexEntry*)index, indexSize) != indexSize) ||
+                output->Write(&trailer, sizeof(trailer)) != sizeof(trailer))
+            {
+                DKLogE("DKCompressor Error: Output stream error!");
+                result = false;
+            }
+        }
+        return result;
+    }
+
+    static bool DecompressBlocks(DKStream* input, DKStream* output, DKOperationQueue* queue, const ZSTD_DDict* ddict)
+    {
+        BlockFileHeader header;
+        if (input->Read(&header, sizeof(header)) != sizeof(header) || !IsBlockCompressed(&header, sizeof(header)))
+        {
+            DKLogE("DKCompressor Error: Invalid block header!");
+            return false;
+        }
+        const uint32_t blockSize = DKLittleEndianToSystem(header.blockSize);
+        if (blockSize == 0 || blockSize >= BlockMaxSize)
+        {
+            DKLogE("DKCompressor Error: Invalid block header!");
+            return false;
+        }
+        DKCompressor::Method method = static_cast<DKCompressor::Method>(header.method);
+        return ProcessOrderedJobs<BlockJob>(queue, [&](BlockJob* job, bool& next)->bool
+        {
+            BlockHeader bh;
+            if (input->Read(&bh, sizeof(bh)) != sizeof(bh))
+            {
+                DKLogE("DKCompressor Error: Input stream error!");
+                return false;
+            }
+            uint32_t compressedSize = DKLittleEndianToSystem(bh.compressedSize);
+            next = compressedSize > 0;
+            if (next)
+            {
+                job->originalSize = DKLittleEndianToSystem(bh.originalSize);
+                if (compressedSize >= BlockMaxSize || job->originalSize > blockSize)
+                {
+                    DKLogE("DKCompressor Error: Invalid block size!");
+                    return false;
+                }
+                if (job->input.ReadFrom(input, compressedSize) != compressedSize)
+                {
+                    DKLogE("DKCompressor Error: Input stream error!");
+                    return false;
+                }
+            }
+            return true;
+        }, [method, ddict](BlockJob* job)->bool
+        {
+            if (!PrepareBlockOutput(job->output, job->input.length, job->originalSize))
+            {
+                DKLogE("DKCompressor Error: Out of memory!");
+                return false;
+            }
+            if (DecompressStream(method, &job->input, &job->output, ddict))
+            {
+                if (job->output.length == job->originalSize)
+                    return true;
+                DKLogE("DKCompressor Error: Block size mismatch!");
+            }
+            return false;
+        }, [&](BlockJob* job)->bool
+        {
+            if (output->Write(job->output.data, job->output.length) != job->output.length)
+            {
+                DKLogE("DKCompressor Error: Output stream error!");
+                return false;
+            }
+            return true;
+        });
+    }
 }
 using namespace DKFoundation;
 using namespace DKFoundation::Private;
 
-DKCompressor::DKCompressor(Method m)
+DKCompressor::DKCompressor(Method m, Dictionary* dict)
 	: method(m)
+	, dictionary(dict)
 {
 }
 
@@ -872,38 +1307,39 @@ bool DKCompressor::Compress(DKStream* input, DKStream* output) const
     if (m == Automatic)
         m = Default;
 
-    switch (m)
-    {
-    case Zlib:
-        return CompressDeflate(input, output, 5); // Z_DEFAULT_COMPRESSION is 6
-        break;
-    case Zstd:
-        return CompressZstd(input, output, ZSTD_CLEVEL_DEFAULT);
-        break;
-    case ZstdMax:
-        return CompressZstd(input, output, 19);// Clamp(19, int(ZSTD_CLEVEL_DEFAULT), ZSTD_maxCLevel()));
-        break;
-    case LZ4:
-        return CompressLZ4(input, output, 0);
-        break;
-	case LZ4HC:
-		return CompressLZ4(input, output, 9); // 0 for LZ4 fast, 9 for LZ4HC
-		break;
-	case Lzma:
-		return CompressLzma(input, output, 5);
-		break;
-	case LzmaFast:
-		return CompressLzma(input, output, 0);
-		break;
-	case LzmaUltra:
-		return CompressLzma(input, output, 9);
-		break;
-    }
-    DKLogE("DKCompressor::Compress error: Unknown format.");
-    return false;
+    const ZSTD_CDict* cdict = nullptr;
+    if (dictionary)
+        cdict = reinterpret_cast<const ZSTD_CDict*>(dictionary->CompressionDictionary(m));
+    return CompressStream(m, input, output, cdict);
 }
 
-bool DKCompressor::Decompress(DKStream* input, DKStream* output) const
+bool DKCompressor::CompressBlocks(DKStream* input, DKStream* output, DKOperationQueue* queue, size_t blockSize) const
+{
+	if (input == NULL || input->IsReadable() == false)
+		return false;
+	if (output == NULL || output->IsWritable() == false)
+		return false;
+	if (blockSize == 0 || blockSize >= BlockMaxSize)
+	{
+		DKLogE("DKCompressor::CompressBlocks error: Invalid block size.");
+		return false;
+	}
+
+	Method m = method;
+	if (m == Automatic)
+		m = Default;
+	if (m < Zlib || m > LzmaUltra)
+	{
+		DKLogE("DKCompressor::CompressBlocks error: Unknown format.");
+		return false;
+	}
+	const ZSTD_CDict* cdict = nullptr;
+	if (dictionary)
+		cdict = reinterpret_cast<const ZSTD_CDict*>(dictionary->CompressionDictionary(m));
+	return Private::CompressBlocks(m, input, output, queue, blockSize, cdict);
+}
+
+bool DKCompressor::Decompress(DKStream* input, DKStream* output, DKOperationQueue* queue) const
 {
 	if (input == NULL || input->IsReadable() == false)
 		return false;
@@ -990,33 +1426,262 @@ bool DKCompressor::Decompress(DKStream* input, DKStream* output) const
         return false;
     }
 
+	const ZSTD_DDict* ddict = nullptr;
+	if (dictionary)
+		ddict = reinterpret_cast<const ZSTD_DDict*>(dictionary->DecompressionDictionary());
+
+	// block-compressed data has its own method in header.
+	if (IsBlockCompressed(bufferedInputStream.preloadedData, bufferedInputStream.preloadedLength))
+		return DecompressBlocks(&bufferedInputStream, output, queue, ddict);
+
 	Method m = method;
 	if (m == Automatic && !DetectMethod(bufferedInputStream.preloadedData, bufferedInputStream.preloadedLength, m))
 	{
 		DKLogE("DKCompressor Error: Unable to identify format.");
 		return false;
 	}
+	return DecompressStream(m, &bufferedInputStream, output, ddict);
+}
+
+bool DKCompressor::ReadBlockIndex(DKStream* input, Method& method, DKArray<Block>& blocks)
+{
+	if (input == NULL || input->IsReadable() == false || input->IsSeekable() == false)
+		return false;
 
-    switch (m)
+	const DKStream::Position base = input->CurrentPosition();
+	const DKStream::Position total = input->TotalLength();
+	if (base == DKStream::PositionError || total == DKStream::PositionError ||
+		total < base + sizeof(BlockFileHeader) + sizeof(BlockFileTrailer))
+		return false;
+
+	BlockFileHeader header;
+	if (input->Read(&header, sizeof(header)) != sizeof(header) || !IsBlockCompressed(&header, sizeof(header)))
+	{
+		DKLogE("DKCompressor::ReadBlockIndex error: Invalid block header!");
+		return false;
+	}
+
+	BlockFileTrailer trailer;
+	if (input->SetCurrentPosition(total - sizeof(trailer)) == DKStream::PositionError ||
+		input->Read(&trailer, sizeof(trailer)) != sizeof(trailer) ||
+		DKLittleEndianToSystem(trailer.magic) != BlockTrailerMagic)
+	{
+		DKLogE("DKCompressor::ReadBlockIndex error: Invalid block trailer!");
+		return false;
+	}
+	const uint64_t indexOffset = DKLittleEndianToSystem(trailer.indexOffset);
+	const uint32_t numBlocks = DKLittleEndianToSystem(trailer.numBlocks);
+	if (base + indexOffset + uint64_t(numBlocks) * sizeof(BlockIndexEntry) + sizeof(trailer) != total)
+	{
+		DKLogE("DKCompressor::ReadBlockIndex error: Invalid block index!");
+		return false;
+	}
+
+	DKArray<BlockIndexEntry> index;
+	index.Resize(numBlocks);
+	size_t indexSize = sizeof(BlockIndexEntry) * numBlocks;
+	if (input->SetCurrentPosition(base + indexOffset) == DKStream::PositionError ||
+		input->Read((BlockIndexEntry*)index, indexSize) != indexSize)
+	{
+		DKLogE("DKCompressor::ReadBlockIndex error: Input stream error!");
+		return false;
+	}
+
+	const uint32_t blockSize = DKLittleEndianToSystem(header.blockSize);
+	if (blockSize == 0 || blockSize >= BlockMaxSize)
+	{
+		DKLogE("DKCompressor::ReadBlockIndex error: Invalid block header!");
+		return false;
+	}
+
+	blocks.Clear();
+	blocks.Reserve(numBlocks);
+	uint64_t originalOffset = 0;
+	for (const BlockIndexEntry& entry : index)
+	{
+		Block block;
+		block.offset = base + DKLittleEndianToSystem(entry.offset);
+		block.originalOffset = originalOffset;
+		block.compressedSize = DKLittleEndianToSystem(entry.compressedSize);
+		block.originalSize = DKLittleEndianToSystem(entry.originalSize);
+		if (block.offset + block.compressedSize > base + indexOffset ||
+			block.compressedSize >= BlockMaxSize || block.originalSize > blockSize)
+		{
+			DKLogE("DKCompressor::ReadBlockIndex error: Invalid block index!");
+			return false;
+		}
+		blocks.Add(block);
+		originalOffset += block.originalSize;
+	}
+	method = static_cast<Method>(header.method);
+	input->SetCurrentPosition(base);
+	return true;
+}
+
+bool DKCompressor::DecompressBlock(DKStream* input, Method method, const Block& block, DKStream* output) const
+{
+	if (input == NULL || input->IsReadable() == false || input->IsSeekable() == false)
+		return false;
+	if (output == NULL || output->IsWritable() == false)
+		return false;
+
+	if (block.compressedSize >= BlockMaxSize || block.originalSize >= BlockMaxSize)
+	{
+		DKLogE("DKCompressor::DecompressBlock error: Invalid block size!");
+		return false;
+	}
+	if (input->SetCurrentPosition(block.offset) != block.offset)
+	{
+		DKLogE("DKCompressor::DecompressBlock error: Input stream error!");
+		return false;
+	}
+	BlockStream compressed;
+	if (compressed.ReadFrom(input, block.compressedSize) != block.compressedSize)
+	{
+		DKLogE("DKCompressor::DecompressBlock error: Input stream error!");
+		return false;
+	}
+	BlockStream decompressed;
+	if (!PrepareBlockOutput(decompressed, block.compressedSize, block.originalSize))
+	{
+		DKLogE("DKCompressor::DecompressBlock error: Out of memory!");
+		return false;
+	}
+	const ZSTD_DDict* ddict = nullptr;
+	if (dictionary)
+		ddict = reinterpret_cast<const ZSTD_DDict*>(dictionary->DecompressionDictionary());
+	if (!DecompressStream(method, &compressed, &decompressed, ddict))
+		return false;
+	if (decompressed.length != block.originalSize)
+	{
+		DKLogE("DKCompressor::DecompressBlock error: Block size mismatch!");
+		return false;
+	}
+	if (output->Write(decompressed.data, decompressed.length) != decompressed.length)
+	{
+		DKLogE("DKCompressor::DecompressBlock error: Output stream error!");
+		return false;
+	}
+	return true;
+}
+
+DKCompressor::Dictionary::Dictionary()
+	: dictID(0)
+	, cdict{ nullptr, nullptr }
+	, ddict(nullptr)
+{
+}
+
+DKCompressor::Dictionary::~Dictionary()
+{
+	for (void* p : cdict)
+	{
+		if (p)
+			ZSTD_freeCDict(reinterpret_cast<ZSTD_CDict*>(p));
+	}
+	if (ddict)
+		ZSTD_freeDDict(reinterpret_cast<ZSTD_DDict*>(ddict));
+}
+
+DKObject<DKCompressor::Dictionary> DKCompressor::Dictionary::Train(const DKData* const* samples, size_t numSamples, size_t maxSize)
+{
+	if (samples == NULL || numSamples == 0 || maxSize == 0)
+		return NULL;
+
+	DKArray<size_t> sampleSizes;
+	sampleSizes.Reserve(numSamples);
+	size_t totalSize = 0;
+	for (size_t i = 0; i < numSamples; ++i)
+	{
+		size_t s = samples[i] ? samples[i]->Length() : 0;
+		sampleSizes.Add(s);
+		totalSize += s;
+	}
+	CompressorBuffer samplesBuffer(totalSize);
+	CompressorBuffer dictBuffer(maxSize);
+	if (samplesBuffer.buffer == nullptr || dictBuffer.buffer == nullptr)
+	{
+		DKLogE("DKCompressor::Dictionary::Train error: Out of memory!");
+		return NULL;
+	}
+	uint8_t* p = reinterpret_cast<uint8_t*>(samplesBuffer.buffer);
+	for (size_t i = 0; i < numSamples; ++i)
+	{
+		if (sampleSizes.Value(i) > 0)
+		{
+			memcpy(p, samples[i]->Contents(), sampleSizes.Value(i));
+			p += sampleSizes.Value(i);
+		}
+	}
+	size_t dictSize = ZDICT_trainFromBuffer(dictBuffer.buffer, dictBuffer.bufferSize,
+											samplesBuffer.buffer, sampleSizes, (unsigned)numSamples);
+	if (ZDICT_isError(dictSize))
+	{
+		DKLogE("DKCompressor::Dictionary::Train error: %s", ZDICT_getErrorName(dictSize));
+		return NULL;
+	}
+	return Create(DKData::StaticData(dictBuffer.buffer, dictSize));
+}
+
+DKObject<DKCompressor::Dictionary> DKCompressor::Dictionary::Train(const DKArray<DKObject<DKData>>& samples, size_t maxSize)
+{
+	DKArray<const DKData*> sampleData;
+	sampleData.Reserve(samples.Count());
+	for (const DKData* data : samples)
+		sampleData.Add(data);
+	return Train(sampleData, sampleData.Count(), maxSize);
+}
+
+DKObject<DKCompressor::Dictionary> DKCompressor::Dictionary::Create(const DKData* data)
+{
+	if (data == NULL || data->Length() == 0)
+		return NULL;
+
+	DKObject<DKBuffer> buffer = DKBuffer::Create(data);
+	if (buffer == NULL)
+		return NULL;
+
+	DKObject<Dictionary> dict = DKOBJECT_NEW Dictionary();
+	dict->dictID = ZDICT_getDictID(buffer->Contents(), buffer->Length()); // zero for raw content
+	dict->data = buffer.SafeCast<DKData>();
+	return dict;
+}
+
+void* DKCompressor::Dictionary::CompressionDictionary(Method m) const
+{
+	int index;
+	int level;
+	switch (m)
 	{
-	case Zlib:
-		return DecompressDeflate(&bufferedInputStream, output);
-		break;
 	case Zstd:
-	case ZstdMax:
-		return DecompressZstd(&bufferedInputStream, output);
+		index = 0;
+		level = ZSTD_CLEVEL_DEFAULT;
 		break;
-	case LZ4:
-	case LZ4HC:
-		return DecompressLZ4(&bufferedInputStream, output);
-		break;
-	case Lzma:
-	case LzmaFast:
-	case LzmaUltra:
-		return DecompressLzma(&bufferedInputStream, output);
+	case ZstdMax:
+		index = 1;
+		level = 19;
 		break;
+	default:
+		return nullptr;
+	}
+	DKCriticalSection<DKSpinLock> guard(lock);
+	if (cdict[index] == nullptr)
+	{
+		cdict[index] = ZSTD_createCDict(data->Contents(), data->Length(), level);
+		if (cdict[index] == nullptr)
+			DKLogE("DKCompressor::Dictionary error: ZSTD_createCDict failed");
 	}
+	return cdict[index];
+}
 
-	DKLogE("DKCompressor Error: Unknown format!");
-	return false;
+void* DKCompressor::Dictionary::DecompressionDictionary() const
+{
+	DKCriticalSection<DKSpinLock> guard(lock);
+	if (ddict == nullptr)
+	{
+		ddict = ZSTD_createDDict(data->Contents(), data->Length());
+		if (ddict == nullptr)
+			DKLogE("DKCompressor::Dictionary error: ZSTD_createDDict failed");
+	}
+	return ddict;
 }
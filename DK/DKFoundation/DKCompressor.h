@@ -9,11 +9,23 @@
 #include "../DKInclude.h"
 #include "DKStream.h"
 #include "DKFunction.h"
+#include "DKArray.h"
+#include "DKData.h"
+#include "DKSpinLock.h"
 
 namespace DKFoundation
 {
+	class DKOperationQueue;
 	/** @brief
 	 A compression utility class, supports ZLib, Zstd, LZ4 compression.
+
+	 CompressBlocks splits input into blocks and compresses each block
+	 independently with block index (block-compressed format), blocks can be
+	 compressed or decompressed in parallel and decompressed individually.
+	 Decompress detects block-compressed format automatically.
+
+	 Zlib and Zstd reuse per-thread contexts and buffers, repeated
+	 compression of small data does not allocate for each call.
 	 */
 	class DKCompressor
 	{
@@ -35,12 +47,74 @@ namespace DKFoundation
 
             Automatic,	///< Default method for compression, Auto-detected method for decompression.
         };
-		DKCompressor(Method m = Automatic);
+		/**
+		 @brief
+		 Zstd dictionary, improves compression ratio and speed of small data.
+		 Dictionary can be trained from samples, and can be persisted with Data()
+		 and restored with Create().
+		 Data compressed with dictionary should be decompressed with same dictionary.
+		 @note
+		  Dictionary is used by Zstd and ZstdMax only, other methods ignore it.
+		 */
+		class Dictionary
+		{
+		public:
+			enum { DefaultMaxSize = 0x10000 };	///< 64KB
+
+			Dictionary();
+			~Dictionary();
+
+			/// train dictionary from samples.
+			/// samples should be typical data to be compressed with dictionary.
+			/// zstd recommends total size of samples about 100 times of maxSize.
+			static DKObject<Dictionary> Train(const DKData* const* samples, size_t numSamples, size_t maxSize = DefaultMaxSize);
+			static DKObject<Dictionary> Train(const DKArray<DKObject<DKData>>& samples, size_t maxSize = DefaultMaxSize);
+			/// create dictionary from data which was trained previously.
+			static DKObject<Dictionary> Create(const DKData* data);
+
+			const DKData* Data() const		{ return data; }
+			uint32_t ID() const				{ return dictID; }
+
+		private:
+			friend class DKCompressor;
+			void* CompressionDictionary(Method) const;	///< ZSTD_CDict
+			void* DecompressionDictionary() const;			///< ZSTD_DDict
+
+			DKObject<DKData> data;
+			uint32_t dictID;
+			mutable DKSpinLock lock;
+			mutable void* cdict[2];	///< Zstd, ZstdMax
+			mutable void* ddict;
+		};
+
+		DKCompressor(Method m = Automatic, Dictionary* dict = NULL);
 		~DKCompressor();
 
+		enum { DefaultBlockSize = 0x400000 };	///< 4MB
+
 		bool Compress(DKStream* input, DKStream* output) const;
-		bool Decompress(DKStream* input, DKStream* output) const;
+		/// compress input with block-compressed format.
+		/// blocks are compressed in parallel if queue is not NULL.
+		bool CompressBlocks(DKStream* input, DKStream* output, DKOperationQueue* queue, size_t blockSize = DefaultBlockSize) const;
+		/// decompress input, block-compressed data will be decompressed in
+		/// parallel if queue is not NULL.
+		bool Decompress(DKStream* input, DKStream* output, DKOperationQueue* queue = NULL) const;
+
+		/// a compressed block of block-compressed data.
+		struct Block
+		{
+			uint64_t offset;			///< position of compressed block in stream
+			uint64_t originalOffset;	///< position of block in decompressed data
+			uint32_t compressedSize;
+			uint32_t originalSize;
+		};
+		/// read block index of block-compressed data for random access.
+		/// input should be seekable and data should be placed at the end of stream.
+		static bool ReadBlockIndex(DKStream* input, Method& method, DKArray<Block>& blocks);
+		/// decompress single block. (input should be seekable)
+		bool DecompressBlock(DKStream* input, Method method, const Block& block, DKStream* output) const;
 
 		const Method method;
+		const DKObject<Dictionary> dictionary;
 	};
 }
@@ -10,6 +10,9 @@
 #include "DKTimer.h"
 #include "DKCondition.h"
 #include "DKArray.h"
+#include "DKSet.h"
+#include "DKSpinLock.h"
+#include <algorithm>
 
 namespace DKFoundation::Private
 {
@@ -21,9 +24,11 @@ namespace DKFoundation::Private
 
     struct DispatchQueueItemState : public DKDispatchQueue::ExecutionState
     {
-        DispatchQueueItemState(DKDispatchQueue* q, DKCondition& c) : queue(q), cond(c), state(StatePending) {}
+        DispatchQueueItemState(DKDispatchQueue* q, DKCondition& c, DKObject<DKCondition>& r)
+            : queue(q), cond(c), condRef(r), state(StatePending) {}
         DKDispatchQueue* queue;
         DKCondition& cond;
+        DKObject<DKCondition> condRef; // keep condition alive after queue destroyed.
         mutable enum State state;
 
         enum State State() const override
@@ -79,32 +84,76 @@ namespace DKFoundation::Private
     struct DispatchQueueItem
     {
         DKTimer::Tick tick;
+        uint64_t seq;       // submission order of items with same tick.
         DKObject<DKOperation> op;
         DKObject<DispatchQueueItemState> state;
         bool IsReady() const { return DKTimer::SystemTick() >= tick; }
+
+        // heap order, earliest item at front.
+        static bool Later(const DispatchQueueItem& lhs, const DispatchQueueItem& rhs)
+        {
+            if (lhs.tick == rhs.tick)
+                return lhs.seq > rhs.seq;
+            return lhs.tick > rhs.tick;
+        }
+    };
+    // conditions of all queues, for DKDispatchQueue::NotyfyThreads()
+    struct DispatchQueueConditions
+    {
+        DKSpinLock lock;
+        DKSet<DKCondition*> conditions;
     };
-    DKCondition& DispatchQueueCondition()
+    DispatchQueueConditions& AllDispatchQueueConditions()
     {
-        static DKCondition cond;
-        return cond;
+        static DispatchQueueConditions conds;
+        return conds;
     }
 }
 using namespace DKFoundation;
 using namespace DKFoundation::Private;
 
+/// Each queue has its own condition, submitting an item wakes threads
+/// waiting for this queue only.
+/// Items are stored in binary heap, ordered by (tick, seq).
 struct DKDispatchQueue::Context
 {
+    DKObject<DKCondition> condRef;
     DKCondition& cond;
     DKArray<DispatchQueueItem> queue;
+    uint64_t seq;
+
+    Context(DKObject<DKCondition> c) : condRef(c), cond(*c), seq(0) {}
+
+    void Push(const DispatchQueueItem& item)
+    {
+        queue.Add(item);
+        DispatchQueueItem* items = queue;
+        std::push_heap(items, items + queue.Count(), DispatchQueueItem::Later);
+    }
+    void PopFront()
+    {
+        DispatchQueueItem* items = queue;
+        std::pop_heap(items, items + queue.Count(), DispatchQueueItem::Later);
+        queue.Remove(queue.Count() - 1);
+    }
 };
 
 DKDispatchQueue::DKDispatchQueue()
-    : context(new Context{ DispatchQueueCondition() })
+    : context(new Context(DKObject<DKCondition>::New()))
 {
+    DispatchQueueConditions& conds = AllDispatchQueueConditions();
+    DKCriticalSection guard(conds.lock);
+    conds.conditions.Insert(&context->cond);
 }
 
 DKDispatchQueue::~DKDispatchQueue()
 {
+    if (true)
+    {
+        DispatchQueueConditions& conds = AllDispatchQueueConditions();
+        DKCriticalSection guard(conds.lock);
+        conds.conditions.Remove(&context->cond);
+    }
     RevokeAll();
     delete context;
 }
@@ -114,17 +163,14 @@ DKObject<DKDispatchQueue::ExecutionState> DKDispatchQueue::Submit(DKOperation* o
     delay = Max(delay, 0.0);
     DKTimer::Tick fire = DKTimer::SystemTick() + static_cast<DKTimer::Tick>(DKTimer::SystemTickFrequency() * delay);
 
-    DispatchQueueItem item = { fire };
-    item.op = op;
-    item.state = DKOBJECT_NEW DispatchQueueItemState(this, context->cond);
+    DKObject<DispatchQueueItemState> state = DKOBJECT_NEW DispatchQueueItemState(this, context->cond, context->condRef);
 
     DKCriticalSection guard(context->cond);
-    auto pos = context->queue.UpperBound(fire, [](DKTimer::Tick tick, const DispatchQueueItem& rhs)
-    {
-        return tick < rhs.tick;
-    });
-    context->queue.Insert(item, pos);
-    context->cond.Broadcast();
+    DispatchQueueItem item = { fire, context->seq++, op, state };
+    context->Push(item);
+    // waiting threads need to be woken only if the earliest item has changed.
+    if (context->queue.Value(0).seq == item.seq)
+        context->cond.Broadcast();
     return item.state.SafeCast<ExecutionState>();
 }
 
@@ -248,7 +294,7 @@ bool DKDispatchQueue::Execute()
                 item = context->queue.Value(0);
                 item.state->state = DispatchQueueItemState::StateProcessing;
             }
-            context->queue.Remove(0);
+            context->PopFront();
         }
     }
     if (item.state)
@@ -354,7 +400,12 @@ void DKDispatchQueue::WaitQueue() const
 
 void DKDispatchQueue::NotyfyThreads()
 {
-    DispatchQueueCondition().Broadcast();
+    DispatchQueueConditions& conds = AllDispatchQueueConditions();
+    DKCriticalSection guard(conds.lock);
+    conds.conditions.EnumerateForward([](DKCondition* cond)
+    {
+        cond->Broadcast();
+    });
 }
 
 double DKDispatchQueue::NextDispatchInterval() const
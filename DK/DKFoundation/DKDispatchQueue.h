@@ -80,6 +80,7 @@ namespace DKFoundation
 
         bool WaitQueue(double timeout) const;
         void WaitQueue() const;
+        /// wake up threads waiting on any dispatch queue.
         static void NotyfyThreads();
 
         double NextDispatchInterval() const;
@@ -24,6 +24,7 @@
 #include "DKString.h"
 #include "DKUtils.h"
 #include "DKUuid.h"
+#include "DKCriticalSection.h"
 
 namespace DKFoundation::Private
 {
@@ -459,6 +460,56 @@ size_t DKFile::Read(void* p, size_t s)
 	return static_cast<const DKFile*>(this)->Read(p, s);
 }
 
+size_t DKFile::ReadAt(Position offset, void* p, size_t s) const
+{
+	if (this->file == DKFILE_INVALID_FILE_HANDLE)
+		return (size_t)-1;
+
+	if (s == 0)
+		return 0;
+	if (p == NULL)
+		return 0;
+
+	char* cp = reinterpret_cast<char*>(p);
+
+#ifdef _WIN32
+	// ReadFile with OVERLAPPED moves file pointer of synchronous handle,
+	// save and restore it while holding lock of this file.
+	// (I/O requests of synchronous handle are serialized by system anyway)
+	DKCriticalSection<DKMutex> guard(readAtLock);
+	LARGE_INTEGER zero, currentPos;
+	zero.QuadPart = 0;
+	if (!::SetFilePointerEx((HANDLE)this->file, zero, &currentPos, FILE_CURRENT))
+		return (size_t)-1;
+#endif
+
+	size_t bytesRead = 0;
+	while (bytesRead < s)
+	{
+		size_t bytesToRead = Min(s - bytesRead, size_t(0x40000000));
+		Position pos = offset + bytesRead;
+#ifdef _WIN32
+		OVERLAPPED ov = {};
+		ov.Offset = static_cast<DWORD>(pos);
+		ov.OffsetHigh = static_cast<DWORD>(static_cast<uint64_t>(pos) >> 32);
+		DWORD numRead = 0;
+		if (::ReadFile((HANDLE)this->file, &cp[bytesRead], (DWORD)bytesToRead, &numRead, &ov) == 0)
+			break;
+		if (numRead == 0)
+			break;
+#else
+		ssize_t numRead = ::pread((int)this->file, &cp[bytesRead], bytesToRead, (off_t)pos);
+		if (numRead <= 0)
+			break;
+#endif
+		bytesRead += numRead;
+	}
+#ifdef _WIN32
+	::SetFilePointerEx((HANDLE)this->file, currentPos, NULL, FILE_BEGIN);
+#endif
+	return bytesRead;
+}
+
 size_t DKFile::Read(DKStream* p, size_t s) const
 {
 	if (this->file == DKFILE_INVALID_FILE_HANDLE)
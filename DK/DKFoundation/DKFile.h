@@ -11,6 +11,7 @@
 #include "DKString.h"
 #include "DKBuffer.h"
 #include "DKDateTime.h"
+#include "DKMutex.h"
 
 namespace DKFoundation
 {
@@ -66,6 +67,12 @@ namespace DKFoundation
 		size_t Read(void* p, size_t s) override;
 		/// read file contents and write to other stream
 		size_t Read(DKStream* p, size_t s) const;
+		/// read from given offset, current position is not used nor changed.
+		/// can be called from multiple threads simultaneously.
+		/// @note On Windows, file pointer is moved while reading and restored
+		/// after, do not call Read/Write/SetCurrentPosition at the same time.
+		/// ReadAt calls of same file are serialized, other files are not.
+		size_t ReadAt(Position offset, void* p, size_t s) const;
 
 		size_t Write(const void* p, size_t s) override;
 		size_t Write(const DKData *p);
@@ -90,6 +97,9 @@ namespace DKFoundation
 		intptr_t	file;
 		ModeOpen	modeOpen;
 		ModeShare	modeShare;
+#ifdef _WIN32
+		DKMutex		readAtLock;	///< ReadAt saves and restores file pointer.
+#endif
 
 		DKFile(const DKFile&) = delete;
 		DKFile& operator = (const DKFile&) = delete;
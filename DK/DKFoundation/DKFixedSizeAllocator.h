@@ -15,6 +15,18 @@
 
 namespace DKFoundation
 {
+	namespace Private
+	{
+		template <size_t N> struct FixedSizeAllocatorLog2
+		{
+			enum : unsigned int { Value = 1 + FixedSizeAllocatorLog2<(N >> 1)>::Value };
+		};
+		template <> struct FixedSizeAllocatorLog2<1>
+		{
+			enum : unsigned int { Value = 0 };
+		};
+	}
+
 	/// @brief An allocator which can allocate memory of fixed length.
 	/// it is useful to template collection classes like DKMap, DKSet.
 	///
@@ -24,6 +36,13 @@ namespace DKFoundation
 	/// @tparam Lock           locking class
 	/// @tparam BaseAllocator  internal allocator (for internal-table, small size)
 	/// @tparam UnitAllocator  unit chunk allocator. (large size)
+	///
+	/// @note
+	///  Partially occupied chunks and unoccupied chunks are linked in lists,
+	///  allocation takes a unit from the head of list in constant time.
+	///  Address of unit is mapped to its chunk with hash table of address
+	///  granules (power of two, not larger than chunk), deallocation does not
+	///  search chunk table.
 	template <
 		unsigned int UnitSize,				// allocation size (fixed size)
 		unsigned int Alignment = 1,			// byte alignment
@@ -38,6 +57,7 @@ namespace DKFoundation
 			friend class DKFixedSizeAllocator;
 		static_assert(UnitSize > 0, "Size must be greater than zero.");
 		static_assert(MaxUnits > 1, "MaxUnits must be greater than one.");
+		static_assert(MaxUnits <= 0xffff, "MaxUnits must be less than 65536.");
 		static_assert(Alignment > 0, "Alignment must be greater than zero.");
 		static_assert((Alignment & (Alignment - 1)) == 0, "Alignment must be power of two.");
 
@@ -53,11 +73,14 @@ namespace DKFoundation
 
 		using Index = unsigned int;
 		enum : Index { EndOfUnits = ~Index(0) };
+		enum : Index { EndOfChunks = ~Index(0) };
 
 		struct ChunkInfo
 		{
 			uintptr_t address;
 			Index freeUnitIndex;
+			Index prev;			// link of partial or empty chunk list
+			Index next;
 			uint16_t offset;
 			uint16_t occupied;
 		};
@@ -65,6 +88,16 @@ namespace DKFoundation
 		// size of all units per chunk. (in bytes)
 		enum : size_t { MaxUnitsPerChunkSize = sizeof(Unit) * MaxUnitsPerChunk };
 
+		// Granule: address range of power of two, not larger than chunk.
+		// A chunk spans at most three granules, and a granule can be shared
+		// by at most two chunks.
+		enum : unsigned int { GranuleShift = Private::FixedSizeAllocatorLog2<MaxUnitsPerChunkSize>::Value };
+		struct GranuleEntry
+		{
+			uintptr_t key;		// granule + 1, zero for empty slot.
+			Index chunks[2];
+		};
+
 		using CriticalSection = DKCriticalSection < Lock > ;
 
 		template <unsigned int BaseAlignment> struct _RebindAlignment
@@ -101,78 +134,23 @@ namespace DKFoundation
 				return NULL;
 
 			CriticalSection guard(lock);
+			return AllocInternal();
+		}
 
-			if (cachedChunk && cachedChunk->occupied < MaxUnitsPerChunk)
-			{
-				uintptr_t ptr = AllocUnit(cachedChunk);
-				DKASSERT_MEM_DEBUG(ptr);
-				return reinterpret_cast<void*>(ptr);
-			}
-			// find unoccupied unit from each chunks.
-			for (size_t i = 0; i < numChunks; ++i)
-			{
-				if (chunkTable[i].occupied < MaxUnitsPerChunk)
-				{
-					cachedChunk = &chunkTable[i];
-					uintptr_t ptr = AllocUnit(cachedChunk);
-					DKASSERT_MEM_DEBUG(ptr);
-					return reinterpret_cast<void*>(ptr);
-				}
-			}
-			// no space, create new chunk.
-			cachedChunk = NULL;
-			if (numChunks > 0)
-			{
-				ChunkInfo* table = (ChunkInfo*)BaseAllocator::Realloc(chunkTable, sizeof(ChunkInfo) * (numChunks + 1));
-				if (table == NULL) // out of memory!
-					return NULL;
-				chunkTable = table;
-
-				ChunkInfo chunk;
-				if (!AllocChunk(&chunk))
-					return NULL;	// out of memory!
-
-				uintptr_t pos = reinterpret_cast<uintptr_t>(
-															std::upper_bound(&chunkTable[0], &chunkTable[numChunks], chunk.address,
-																			 [](uintptr_t lhs, const ChunkInfo& rhs)
-																			 {
-																				 return lhs < rhs.address;
-																			 }));
-				size_t chunkIndex = (pos - reinterpret_cast<uintptr_t>(&chunkTable[0])) / sizeof(ChunkInfo);
-
-				if (chunkIndex < numChunks)
-				{
-#if 1
-					memmove(&chunkTable[chunkIndex + 1], &chunkTable[chunkIndex], sizeof(ChunkInfo) * (numChunks - chunkIndex));
-#else
-					for (size_t i = numChunks; i > chunkIndex; --i)
-						chunkTable[i] = chunkTable[i-1];
-#endif
-				}
-				chunkTable[chunkIndex] = chunk;
-				cachedChunk = &chunkTable[chunkIndex];
-			}
-			else
+		/// allocate multiple units with single lock.
+		/// returns number of units allocated.
+		size_t AllocBatch(void** ptrs, size_t count)
+		{
+			size_t n = 0;
+			CriticalSection guard(lock);
+			while (n < count)
 			{
-				chunkTable = (ChunkInfo*)BaseAllocator::Alloc(sizeof(ChunkInfo) * (numChunks + 1));
-				if (chunkTable == NULL)
-					return NULL; // out of memory!
-
-				cachedChunk = &chunkTable[numChunks];
-				if (!AllocChunk(cachedChunk)) // out of memory!
-				{
-					BaseAllocator::Free(chunkTable);
-					chunkTable = NULL;
-					cachedChunk = NULL;
-					return NULL;
-				}
+				void* p = AllocInternal();
+				if (p == NULL)
+					break;
+				ptrs[n++] = p;
 			}
-			DKASSERT_MEM_DEBUG(cachedChunk);
-			numChunks++;
-
-			uintptr_t ptr = AllocUnit(cachedChunk);
-			DKASSERT_MEM_DEBUG(ptr);
-			return reinterpret_cast<void*>(ptr);
+			return n;
 		}
 
 		void Dealloc(void* ptr)
@@ -210,16 +188,9 @@ namespace DKFoundation
 				{
 					if (FindChunkAndDealloc(reinterpret_cast<uintptr_t>(ptr)))
 					{
-						if (this->emptyChunks > 0)
-						{
-							if ((this->numChunks * MaxUnitsPerChunk) >=
-								(this->numAllocated + threshold + MaxUnitsPerChunk))
-							{
-								size_t purged = PurgeInternal();
-								if (bytesPurged)
-									*bytesPurged = purged;
-							}
-						}
+						size_t purged = ConditionalPurgeInternal(threshold);
+						if (bytesPurged)
+							*bytesPurged = purged;
 						return true;
 					}
 				}
@@ -227,6 +198,29 @@ namespace DKFoundation
 			return false;
 		}
 
+		/// deallocate multiple units with single lock, and purge if necessary.
+		/// returns number of units deallocated.
+		size_t ConditionalDeallocBatchAndPurge(void** ptrs, size_t count, size_t threshold, size_t* bytesPurged)
+		{
+			size_t n = 0;
+			CriticalSection guard(lock);
+			if (numChunks > 0)
+			{
+				for (size_t i = 0; i < count; ++i)
+				{
+					if (ptrs[i] && FindChunkAndDealloc(reinterpret_cast<uintptr_t>(ptrs[i])))
+						n++;
+				}
+				if (n > 0)
+				{
+					size_t purged = ConditionalPurgeInternal(threshold);
+					if (bytesPurged)
+						*bytesPurged = purged;
+				}
+			}
+			return n;
+		}
+
 		/// returns Chunk starting address if ptr was allocated from this object.
 		void* AlignedChunkAddress(void* ptr) const
 		{
@@ -235,7 +229,7 @@ namespace DKFoundation
 				CriticalSection guard(lock);
 				if (numChunks > 0)
 				{
-					ChunkInfo* info = FindChunkInfo(reinterpret_cast<uintptr_t>(ptr));
+					const ChunkInfo* info = FindChunkInfo(reinterpret_cast<uintptr_t>(ptr));
 					if (info)
 						return reinterpret_cast<void*>(info->address);
 				}
@@ -252,48 +246,18 @@ namespace DKFoundation
 					numChunksRequired++;
 
 				CriticalSection guard(lock);
-				if (numChunksRequired > numChunks)
+				while (numChunks < numChunksRequired)
 				{
-					ChunkInfo* table = (ChunkInfo*)BaseAllocator::Realloc(chunkTable, sizeof(ChunkInfo) * numChunksRequired);
-					if (table)
-					{
-						chunkTable = table;
-						for (size_t i = numChunks; i < numChunksRequired; ++i)
-						{
-							if (!AllocChunk(&chunkTable[i]))
-							{
-								// out of memory!
-								break;
-							}
-							numChunks++;
-						}
-						if (numChunks > 0)
-						{
-							// save last chunk's address.
-							uintptr_t addr = chunkTable[numChunks-1].address;
-							SortChunkTable();
-							if (cachedChunk == NULL || cachedChunk->occupied == MaxUnitsPerChunk)
-								cachedChunk = FindChunkInfo(addr);
-							DKASSERT_MEM_DEBUG(cachedChunk != NULL);
-						}
-					}
+					if (AddChunk() == EndOfChunks)
+						break; // out of memory!
 				}
 			}
 		}
 
 		size_t ConditionalPurge(size_t threshold)
 		{
-			bool shouldPurge = false;
 			CriticalSection guard(lock);
-			if (this->emptyChunks > 0)
-			{
-				if ((this->numChunks * MaxUnitsPerChunk) >=
-					(this->numAllocated + threshold + MaxUnitsPerChunk))
-					shouldPurge = true;
-			}
-			if (shouldPurge)
-				return this->PurgeInternal();
-			return 0;
+			return ConditionalPurgeInternal(threshold);
 		}
 
 		/// delete unoccupied chunks
@@ -307,7 +271,7 @@ namespace DKFoundation
 		size_t Size() const
 		{
 			CriticalSection guard(lock);
-			return numChunks * (MaxUnitsPerChunkSize + sizeof(ChunkInfo));
+			return numChunks * (MaxUnitsPerChunkSize + sizeof(ChunkInfo)) + granuleTableCapacity * sizeof(GranuleEntry);
 		}
 
 		size_t NumberOfAllocatedUnits() const
@@ -326,7 +290,12 @@ namespace DKFoundation
 
 		DKFixedSizeAllocator()
 			: chunkTable(NULL)
-			, cachedChunk(NULL)
+			, chunkTableCapacity(0)
+			, granuleTable(NULL)
+			, granuleTableCapacity(0)
+			, numGranules(0)
+			, partialChunks(EndOfChunks)
+			, emptyChunkList(EndOfChunks)
 			, numAllocated(0)
 			, numChunks(0)
 			, emptyChunks(0)
@@ -345,14 +314,131 @@ namespace DKFoundation
 					FreeChunk(&chunkTable[i]);
 				}
 				DKASSERT_MEM_DEBUG(emptyChunks == 0);
-				BaseAllocator::Free(chunkTable);
 			}
+			if (chunkTable)
+				BaseAllocator::Free(chunkTable);
+			if (granuleTable)
+				BaseAllocator::Free(granuleTable);
 		}
 
 		DKFixedSizeAllocator(const DKFixedSizeAllocator&) = delete;
 		DKFixedSizeAllocator& operator = (const DKFixedSizeAllocator&) = delete;
 
 	private:
+		void* AllocInternal()
+		{
+			Index chunkIndex = partialChunks;
+			if (chunkIndex == EndOfChunks)
+			{
+				chunkIndex = emptyChunkList;
+				if (chunkIndex == EndOfChunks)
+				{
+					// no space, create new chunk.
+					chunkIndex = AddChunk();
+					if (chunkIndex == EndOfChunks)
+						return NULL; // out of memory!
+				}
+			}
+			uintptr_t ptr = AllocUnit(chunkIndex);
+			DKASSERT_MEM_DEBUG(ptr);
+			return reinterpret_cast<void*>(ptr);
+		}
+		// allocate new chunk, and append to table, empty list.
+		Index AddChunk()
+		{
+			if (numChunks >= chunkTableCapacity)
+			{
+				size_t capacity = chunkTableCapacity > 0 ? chunkTableCapacity * 2 : 4;
+				ChunkInfo* table = (ChunkInfo*)BaseAllocator::Realloc(chunkTable, sizeof(ChunkInfo) * capacity);
+				if (table == NULL) // out of memory!
+					return EndOfChunks;
+				chunkTable = table;
+				chunkTableCapacity = capacity;
+			}
+			// granule table can have (numChunks * 3) entries, keep load factor below 0.5
+			if ((numGranules + 3) * 2 > granuleTableCapacity)
+			{
+				if (!ResizeGranuleTable(granuleTableCapacity > 0 ? granuleTableCapacity * 2 : 16))
+					return EndOfChunks; // out of memory!
+			}
+			Index index = static_cast<Index>(numChunks);
+			ChunkInfo* info = &chunkTable[index];
+			if (!AllocChunk(info))
+				return EndOfChunks;	// out of memory!
+
+			numChunks++;
+			LinkChunk(emptyChunkList, index);
+			for (uintptr_t g = FirstGranule(info), last = LastGranule(info); g <= last; ++g)
+			{
+				GranuleEntry* entry = InsertGranule(g);
+				DKASSERT_MEM_DEBUG(entry);
+				if (entry->chunks[0] == EndOfChunks)
+					entry->chunks[0] = index;
+				else
+				{
+					DKASSERT_MEM_DEBUG(entry->chunks[1] == EndOfChunks);
+					entry->chunks[1] = index;
+				}
+			}
+			return index;
+		}
+		// remove chunk from table, last chunk will be moved to its index.
+		void RemoveChunk(Index index)
+		{
+			DKASSERT_MEM_DEBUG(index < numChunks);
+			ChunkInfo* info = &chunkTable[index];
+			DKASSERT_MEM_DEBUG(info->occupied == 0);
+
+			UnlinkChunk(emptyChunkList, index);
+			for (uintptr_t g = FirstGranule(info), last = LastGranule(info); g <= last; ++g)
+			{
+				GranuleEntry* entry = FindGranule(g);
+				DKASSERT_MEM_DEBUG(entry);
+				if (entry->chunks[0] == index)
+				{
+					entry->chunks[0] = entry->chunks[1];
+					entry->chunks[1] = EndOfChunks;
+				}
+				else
+				{
+					DKASSERT_MEM_DEBUG(entry->chunks[1] == index);
+					entry->chunks[1] = EndOfChunks;
+				}
+				if (entry->chunks[0] == EndOfChunks)
+					RemoveGranule(entry);
+			}
+			FreeChunk(info);
+
+			Index last = static_cast<Index>(numChunks - 1);
+			if (index != last)
+			{
+				// move last chunk to index.
+				ChunkInfo* moved = &chunkTable[last];
+				*info = *moved;
+				if (info->prev != EndOfChunks)
+					chunkTable[info->prev].next = index;
+				else if (info->occupied == 0)
+					emptyChunkList = index;
+				else if (info->occupied < MaxUnitsPerChunk)
+					partialChunks = index;
+				if (info->next != EndOfChunks)
+					chunkTable[info->next].prev = index;
+
+				for (uintptr_t g = FirstGranule(info), e = LastGranule(info); g <= e; ++g)
+				{
+					GranuleEntry* entry = FindGranule(g);
+					DKASSERT_MEM_DEBUG(entry);
+					if (entry->chunks[0] == last)
+						entry->chunks[0] = index;
+					else
+					{
+						DKASSERT_MEM_DEBUG(entry->chunks[1] == last);
+						entry->chunks[1] = index;
+					}
+				}
+			}
+			numChunks--;
+		}
 		FORCEINLINE bool AllocChunk(ChunkInfo* info)
 		{
 			uintptr_t ptr = reinterpret_cast<uintptr_t>(UnitAllocator::Alloc(AlignedChunkSize));
@@ -375,6 +461,8 @@ namespace DKFoundation
 				units[MaxUnitsPerChunk - 1].nextUnitIndex = EndOfUnits;
 				info->freeUnitIndex = 0;
 				info->occupied = 0;
+				info->prev = EndOfChunks;
+				info->next = EndOfChunks;
 				emptyChunks++;
 				return true;
 			}
@@ -391,8 +479,33 @@ namespace DKFoundation
 			DKASSERT_MEM_DEBUG(emptyChunks > 0);
 			emptyChunks--;
 		}
-		FORCEINLINE uintptr_t AllocUnit(ChunkInfo* info)
+		FORCEINLINE void LinkChunk(Index& head, Index index)
 		{
+			ChunkInfo* info = &chunkTable[index];
+			info->prev = EndOfChunks;
+			info->next = head;
+			if (head != EndOfChunks)
+				chunkTable[head].prev = index;
+			head = index;
+		}
+		FORCEINLINE void UnlinkChunk(Index& head, Index index)
+		{
+			ChunkInfo* info = &chunkTable[index];
+			if (info->prev != EndOfChunks)
+				chunkTable[info->prev].next = info->next;
+			else
+			{
+				DKASSERT_MEM_DEBUG(head == index);
+				head = info->next;
+			}
+			if (info->next != EndOfChunks)
+				chunkTable[info->next].prev = info->prev;
+			info->prev = EndOfChunks;
+			info->next = EndOfChunks;
+		}
+		FORCEINLINE uintptr_t AllocUnit(Index chunkIndex)
+		{
+			ChunkInfo* info = &chunkTable[chunkIndex];
 			if (info->freeUnitIndex != EndOfUnits)
 			{
 				// chunk has one or more unoccupied units.
@@ -405,10 +518,17 @@ namespace DKFoundation
 				{
 					DKASSERT_MEM_DEBUG(emptyChunks > 0);
 					emptyChunks--;
+					UnlinkChunk(emptyChunkList, chunkIndex);
+					LinkChunk(partialChunks, chunkIndex);
 				}
 				info->occupied++;
 				numAllocated++;
 
+				if (info->occupied == MaxUnitsPerChunk)
+				{
+					DKASSERT_MEM_DEBUG(info->freeUnitIndex == EndOfUnits);
+					UnlinkChunk(partialChunks, chunkIndex);
+				}
 				return reinterpret_cast<uintptr_t>(unit);
 			}
 			return NULL;
@@ -425,8 +545,9 @@ namespace DKFoundation
 			}
 			return true;
 		}
-		FORCEINLINE void FreeUnit(ChunkInfo* info, uintptr_t p)
+		FORCEINLINE void FreeUnit(Index chunkIndex, uintptr_t p)
 		{
+			ChunkInfo* info = &chunkTable[chunkIndex];
 			DKASSERT_MEM_DEBUG(p >= info->address && p < info->address + MaxUnitsPerChunkSize);
 
 			int index = (int)((p - info->address) / sizeof(Unit));
@@ -435,6 +556,9 @@ namespace DKFoundation
 			// IsUnitOccupied is slow, used only DEBUG build.
 			DKASSERT_MEM_DEBUG(IsUnitOccupied(info, index));	//debug check!
 
+			if (info->occupied == MaxUnitsPerChunk)
+				LinkChunk(partialChunks, chunkIndex);
+
 			Unit* units = reinterpret_cast<Unit*>(info->address);
 			units[index].nextUnitIndex = info->freeUnitIndex;
 			info->freeUnitIndex = index;
@@ -442,106 +566,192 @@ namespace DKFoundation
 			info->occupied--;
 
 			if (info->occupied == 0)
+			{
 				emptyChunks++;
+				UnlinkChunk(partialChunks, chunkIndex);
+				LinkChunk(emptyChunkList, chunkIndex);
+			}
 
 			DKASSERT_MEM_DEBUG(numAllocated > 0);
 			numAllocated--;
 		}
-		FORCEINLINE void SortChunkTable()
+		FORCEINLINE static uintptr_t FirstGranule(const ChunkInfo* info)
+		{
+			return info->address >> GranuleShift;
+		}
+		FORCEINLINE static uintptr_t LastGranule(const ChunkInfo* info)
+		{
+			return (info->address + MaxUnitsPerChunkSize - 1) >> GranuleShift;
+		}
+		FORCEINLINE size_t GranuleSlot(uintptr_t key) const
+		{
+			// fibonacci hashing
+#if defined(_WIN64) || defined(__LP64__)
+			uint64_t h = static_cast<uint64_t>(key) * 0x9e3779b97f4a7c15ULL;
+			return static_cast<size_t>(h >> 32) & (granuleTableCapacity - 1);
+#else
+			uint32_t h = static_cast<uint32_t>(key) * 0x9e3779b9U;
+			return static_cast<size_t>(h >> 8) & (granuleTableCapacity - 1);
+#endif
+		}
+		FORCEINLINE GranuleEntry* FindGranule(uintptr_t granule) const
+		{
+			if (granuleTableCapacity > 0)
+			{
+				uintptr_t key = granule + 1;
+				size_t mask = granuleTableCapacity - 1;
+				for (size_t i = GranuleSlot(key); granuleTable[i].key; i = (i + 1) & mask)
+				{
+					if (granuleTable[i].key == key)
+						return &granuleTable[i];
+				}
+			}
+			return NULL;
+		}
+		GranuleEntry* InsertGranule(uintptr_t granule)
+		{
+			DKASSERT_MEM_DEBUG((numGranules + 1) * 2 <= granuleTableCapacity);
+			uintptr_t key = granule + 1;
+			size_t mask = granuleTableCapacity - 1;
+			size_t i = GranuleSlot(key);
+			for (; granuleTable[i].key; i = (i + 1) & mask)
+			{
+				if (granuleTable[i].key == key)
+					return &granuleTable[i];
+			}
+			granuleTable[i].key = key;
+			granuleTable[i].chunks[0] = EndOfChunks;
+			granuleTable[i].chunks[1] = EndOfChunks;
+			numGranules++;
+			return &granuleTable[i];
+		}
+		void RemoveGranule(GranuleEntry* entry)
+		{
+			// linear probing, backward shift deletion.
+			size_t mask = granuleTableCapacity - 1;
+			size_t i = entry - granuleTable;
+			size_t j = i;
+			while (true)
+			{
+				j = (j + 1) & mask;
+				if (granuleTable[j].key == 0)
+					break;
+				size_t k = GranuleSlot(granuleTable[j].key);
+				// move entry j to i, if k is not in cyclic range (i, j]
+				if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j))
+					continue;
+				granuleTable[i] = granuleTable[j];
+				i = j;
+			}
+			granuleTable[i].key = 0;
+			numGranules--;
+		}
+		bool ResizeGranuleTable(size_t capacity)
 		{
-			if (numChunks > 1)
+			DKASSERT_MEM_DEBUG((capacity & (capacity - 1)) == 0);
+			GranuleEntry* table = (GranuleEntry*)BaseAllocator::Alloc(sizeof(GranuleEntry) * capacity);
+			if (table == NULL)
+				return false;
+			memset(table, 0, sizeof(GranuleEntry) * capacity);
+
+			GranuleEntry* oldTable = granuleTable;
+			size_t oldCapacity = granuleTableCapacity;
+			granuleTable = table;
+			granuleTableCapacity = capacity;
+			numGranules = 0;
+			for (size_t i = 0; i < oldCapacity; ++i)
 			{
-				std::sort(&chunkTable[0], &chunkTable[numChunks],
-						  [](const ChunkInfo& lhs, const ChunkInfo& rhs)
-						  {
-							  return lhs.address < rhs.address;
-						  });
+				if (oldTable[i].key)
+				{
+					GranuleEntry* entry = InsertGranule(oldTable[i].key - 1);
+					entry->chunks[0] = oldTable[i].chunks[0];
+					entry->chunks[1] = oldTable[i].chunks[1];
+				}
+			}
+			if (oldTable)
+				BaseAllocator::Free(oldTable);
+			return true;
+		}
+		FORCEINLINE Index FindChunkIndex(uintptr_t addr) const
+		{
+			const GranuleEntry* entry = FindGranule(addr >> GranuleShift);
+			if (entry)
+			{
+				for (Index index : entry->chunks)
+				{
+					if (index != EndOfChunks)
+					{
+						const ChunkInfo& info = chunkTable[index];
+						if (addr >= info.address && addr < info.address + MaxUnitsPerChunkSize)
+							return index;
+					}
+				}
 			}
+			return EndOfChunks;
 		}
-		FORCEINLINE ChunkInfo* FindChunkInfo(uintptr_t addr) const
+		FORCEINLINE const ChunkInfo* FindChunkInfo(uintptr_t addr) const
 		{
-			uintptr_t pos = reinterpret_cast<uintptr_t>(
-														std::upper_bound(&chunkTable[0], &chunkTable[numChunks], addr,
-																		 [](uintptr_t lhs, const ChunkInfo& rhs)
-																		 {
-																			 return lhs < rhs.address;
-																		 }));
-			size_t index = ((pos - reinterpret_cast<uintptr_t>(&chunkTable[0])) / sizeof(ChunkInfo)) - 1;
-			if (index < numChunks && addr < chunkTable[index].address + MaxUnitsPerChunkSize)
+			Index index = FindChunkIndex(addr);
+			if (index != EndOfChunks)
 				return &chunkTable[index];
 			return NULL;
 		}
 		FORCEINLINE bool FindChunkAndDealloc(uintptr_t addr)
 		{
-			ChunkInfo* info = FindChunkInfo(addr);
-			if (info)
+			Index index = FindChunkIndex(addr);
+			if (index != EndOfChunks)
 			{
-				FreeUnit(info, addr);
-				if (cachedChunk == NULL || cachedChunk->occupied < info->occupied)
-					cachedChunk = info;
+				FreeUnit(index, addr);
 				return true;
 			}
 			return false;
 		}
-		FORCEINLINE size_t PurgeInternal()	// delete unoccupied chunks
+		FORCEINLINE size_t ConditionalPurgeInternal(size_t threshold)
+		{
+			if (this->emptyChunks > 0)
+			{
+				if ((this->numChunks * MaxUnitsPerChunk) >=
+					(this->numAllocated + threshold + MaxUnitsPerChunk))
+					return this->PurgeInternal();
+			}
+			return 0;
+		}
+		size_t PurgeInternal()	// delete unoccupied chunks
 		{
 			if (emptyChunks > 0)
 			{
 				size_t numChunksPrev = numChunks;
-				size_t availableChunks = 0;
-				for (size_t i = 0; i < numChunks; ++i)
+				while (emptyChunkList != EndOfChunks)
+					RemoveChunk(emptyChunkList);
+
+				DKASSERT_MEM_DEBUG(emptyChunks == 0);
+				if (numChunks == 0)
 				{
-					if (chunkTable[i].occupied == 0)
-					{
-						FreeChunk(&chunkTable[i]);
-					}
-					else
-					{
-						availableChunks++;
-					}
+					DKASSERT_MEM_DEBUG(numAllocated == 0);
+					DKASSERT_MEM_DEBUG(numGranules == 0);
+					BaseAllocator::Free(chunkTable);
+					BaseAllocator::Free(granuleTable);
+					chunkTable = NULL;
+					chunkTableCapacity = 0;
+					granuleTable = NULL;
+					granuleTableCapacity = 0;
 				}
-				DKASSERT_MEM_DEBUG(numChunks >= availableChunks);
-				if (availableChunks != numChunks)
+				else if (numChunks * 4 < chunkTableCapacity)
 				{
-					if (availableChunks > 0)
+					size_t capacity = chunkTableCapacity / 2;
+					ChunkInfo* table = (ChunkInfo*)BaseAllocator::Realloc(chunkTable, sizeof(ChunkInfo) * capacity);
+					if (table)
 					{
-						ChunkInfo* table = (ChunkInfo*)BaseAllocator::Alloc(sizeof(ChunkInfo) * availableChunks);
-						if (table)
-						{
-							cachedChunk = NULL;
-							size_t index = 0;
-							for (size_t i = 0; i < numChunks; ++i)
-							{
-								if (chunkTable[i].address)
-								{
-									table[index] = chunkTable[i];
-									if (table[index].occupied < MaxUnitsPerChunk)
-									{
-										if (cachedChunk == NULL || cachedChunk->occupied < table[index].occupied)
-											cachedChunk = &table[index];
-									}
-									index++;
-								}
-							}
-							BaseAllocator::Free(chunkTable);
-							chunkTable = table;
-							numChunks = availableChunks;
-						}
-						else
-						{
-							// out of memory! nothing changed.
-						}
+						chunkTable = table;
+						chunkTableCapacity = capacity;
 					}
 					else
 					{
-						DKASSERT_MEM_DEBUG(numAllocated == 0);
-						BaseAllocator::Free(chunkTable);
-						chunkTable = NULL;
-						cachedChunk = NULL;
-						numChunks = 0;
+						// out of memory! nothing changed.
 					}
+					if (numGranules * 8 < granuleTableCapacity && granuleTableCapacity > 16)
+						ResizeGranuleTable(granuleTableCapacity / 2);
 				}
-				DKASSERT_MEM_DEBUG(emptyChunks == 0);
 				return (numChunksPrev - numChunks) * MaxUnitsPerChunkSize;
 			}
 			return 0;
@@ -580,7 +790,12 @@ namespace DKFoundation
 		}
 		
 		ChunkInfo* chunkTable;
-		ChunkInfo* cachedChunk;		// for fast-alloc
+		size_t chunkTableCapacity;
+		GranuleEntry* granuleTable;
+		size_t granuleTableCapacity;	// power of two
+		size_t numGranules;
+		Index partialChunks;		// list of partially occupied chunks
+		Index emptyChunkList;		// list of unoccupied chunks
 		size_t numAllocated;
 		size_t numChunks;
 		size_t emptyChunks;
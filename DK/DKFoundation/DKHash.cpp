@@ -10,6 +10,29 @@
 #include "DKHash.h"
 #include "DKEndianness.h"
 
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define DKHASH_X86_INTRINSICS 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DKHASH_SSE2_MULTI_BUFFER 1
+#endif
+
+// target attribute for code paths selected by run-time CPU dispatch.
+#if defined(__GNUC__) || defined(__clang__)
+#define DKHASH_TARGET(x)	__attribute__((target(x)))
+#else
+#define DKHASH_TARGET(x)
+#endif
+
 using namespace DKFoundation;
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -146,52 +169,174 @@ namespace DKFoundation
 		}
 
 		////////////////////////////////////////////////////////////////////////////////
-		// update context digest
-		static void HashUpdate32(HashContext* ctx, const void* p, size_t len)
+		// CRC32 (polynomial 0xEDB88320, same as zlib)
+		// crc functions below takes and returns non-inverted crc register.
+		struct CRC32Table
 		{
-			static const uint32_t K[] =
+			uint32_t t[16][256]; // slicing-by-16
+			CRC32Table()
 			{
-				0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3,
-				0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988, 0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91,
-				0x1DB71064, 0x6AB020F2, 0xF3B97148, 0x84BE41DE, 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
-				0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC, 0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5,
-				0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172, 0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B,
-				0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940, 0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
-				0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 0x21B4F4B5, 0x56B3C423, 0xCFBA9599, 0xB8BDA50F,
-				0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924, 0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D,
-				0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A, 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
-				0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01,
-				0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E, 0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457,
-				0x65B0D9C6, 0x12B7E950, 0x8BBEB8EA, 0xFCB9887C, 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
-				0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2, 0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB,
-				0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0, 0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9,
-				0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086, 0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
-				0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 0x59B33D17, 0x2EB40D81, 0xB7BD5C3B, 0xC0BA6CAD,
-				0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A, 0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683,
-				0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8, 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
-				0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7,
-				0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC, 0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5,
-				0xD6D6A3E8, 0xA1D1937E, 0x38D8C2C4, 0x4FDFF252, 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
-				0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60, 0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79,
-				0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236, 0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F,
-				0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04, 0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
-				0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 0x9C0906A9, 0xEB0E363F, 0x72076785, 0x05005713,
-				0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38, 0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21,
-				0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E, 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
-				0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45,
-				0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2, 0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB,
-				0xAED16A4A, 0xD9D65ADC, 0x40DF0B66, 0x37D83BF0, 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
-				0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6, 0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF,
-				0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94, 0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D,
-			};
-
-			uint32_t crc = ~(ctx->hash32[0]);
+				for (uint32_t i = 0; i < 256; i++)
+				{
+					uint32_t c = i;
+					for (int k = 0; k < 8; k++)
+						c = (c >> 1) ^ (0xEDB88320U & (0U - (c & 1)));
+					t[0][i] = c;
+				}
+				for (uint32_t i = 0; i < 256; i++)
+				{
+					for (int k = 1; k < 16; k++)
+						t[k][i] = (t[k-1][i] >> 8) ^ t[0][t[k-1][i] & 0xff];
+				}
+			}
+		};
+		static const CRC32Table& CRC32Tables()
+		{
+			static const CRC32Table table;
+			return table;
+		}
 
+		static uint32_t CRC32Slicing16(uint32_t crc, const uint8_t* p, size_t len)
+		{
+			const uint32_t (*T)[256] = CRC32Tables().t;
+			while (len >= 16)
+			{
+				uint32_t w[4];
+				memcpy(w, p, 16);
+				uint32_t w0 = DKSystemToLittleEndian(w[0]) ^ crc;
+				uint32_t w1 = DKSystemToLittleEndian(w[1]);
+				uint32_t w2 = DKSystemToLittleEndian(w[2]);
+				uint32_t w3 = DKSystemToLittleEndian(w[3]);
+				crc = T[15][w0 & 0xff] ^ T[14][(w0 >> 8) & 0xff] ^ T[13][(w0 >> 16) & 0xff] ^ T[12][w0 >> 24] ^
+					T[11][w1 & 0xff] ^ T[10][(w1 >> 8) & 0xff] ^ T[9][(w1 >> 16) & 0xff] ^ T[8][w1 >> 24] ^
+					T[7][w2 & 0xff] ^ T[6][(w2 >> 8) & 0xff] ^ T[5][(w2 >> 16) & 0xff] ^ T[4][w2 >> 24] ^
+					T[3][w3 & 0xff] ^ T[2][(w3 >> 8) & 0xff] ^ T[1][(w3 >> 16) & 0xff] ^ T[0][w3 >> 24];
+				p += 16;
+				len -= 16;
+			}
 			for (size_t i = 0; i < len; i++)
-				crc = K[ (crc ^ ((const uint8_t*)p)[i]) & 0xff] ^ (crc >> 8);
+				crc = T[0][(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+			return crc;
+		}
 
-			ctx->hash32[0] = ~crc;
+#ifdef DKHASH_X86_INTRINSICS
+		// CRC32 folding with carry-less multiplication (PCLMULQDQ).
+		// Based on Intel's paper "Fast CRC Computation for Generic Polynomials
+		// Using PCLMULQDQ Instruction", constants are for bit-reflected 0x04C11DB7.
+		DKHASH_TARGET("pclmul,sse4.1")
+		static uint32_t CRC32PCLMUL(uint32_t crc, const uint8_t* p, size_t len)
+		{
+			if (len < 64)
+				return CRC32Slicing16(crc, p, len);
+
+			const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+			const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+			const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124LL);
+			const __m128i poly = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+			const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+			size_t remains = len & 15;
+			len -= remains;
+
+			__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+			x1 = _mm_loadu_si128((const __m128i*)(p + 0x00));
+			x2 = _mm_loadu_si128((const __m128i*)(p + 0x10));
+			x3 = _mm_loadu_si128((const __m128i*)(p + 0x20));
+			x4 = _mm_loadu_si128((const __m128i*)(p + 0x30));
+			x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+			p += 64;
+			len -= 64;
+
+			// fold by 4 (512 bits per iteration)
+			x0 = k1k2;
+			while (len >= 64)
+			{
+				x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+				x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+				x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+				x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+				x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+				x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+				x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+				x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+				x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*)(p + 0x00)));
+				x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*)(p + 0x10)));
+				x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*)(p + 0x20)));
+				x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*)(p + 0x30)));
+				p += 64;
+				len -= 64;
+			}
+
+			// fold into 128 bits
+			x0 = k3k4;
+			x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+			x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+			x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+			x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+			x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+			x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+			x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+			x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+			x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+			// single fold of remaining 128 bit blocks
+			while (len >= 16)
+			{
+				x2 = _mm_loadu_si128((const __m128i*)p);
+				x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+				x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+				x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+				p += 16;
+				len -= 16;
+			}
+
+			// fold 128 bits to 64 bits
+			x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+			x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+			x0 = k5k0;
+			x2 = _mm_srli_si128(x1, 4);
+			x1 = _mm_and_si128(x1, mask32);
+			x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+			x1 = _mm_xor_si128(x1, x2);
+
+			// barrett reduction to 32 bits
+			x0 = poly;
+			x2 = _mm_and_si128(x1, mask32);
+			x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+			x2 = _mm_and_si128(x2, mask32);
+			x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+			x1 = _mm_xor_si128(x1, x2);
+			crc = (uint32_t)_mm_extract_epi32(x1, 1);
+
+			return CRC32Slicing16(crc, p, remains);
 		}
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+		// ARMv8 CRC32 instructions (not CRC32C)
+		static uint32_t CRC32ARMv8(uint32_t crc, const uint8_t* p, size_t len)
+		{
+			while (len > 0 && (reinterpret_cast<uintptr_t>(p) & 7))
+			{
+				crc = __crc32b(crc, *p++);
+				len--;
+			}
+			while (len >= 8)
+			{
+				uint64_t v;
+				memcpy(&v, p, 8);
+				crc = __crc32d(crc, v);
+				p += 8;
+				len -= 8;
+			}
+			while (len > 0)
+			{
+				crc = __crc32b(crc, *p++);
+				len--;
+			}
+			return crc;
+		}
+#endif
 
 		static void HashDigest128(HashContext* ctx, const void* p, size_t count)
 		{
@@ -265,7 +410,7 @@ namespace DKFoundation
 			}
 		}
 
-		static void HashDigest160(HashContext* ctx, const void* p, size_t count)
+		static void HashDigest160Generic(HashContext* ctx, const void* p, size_t count)
 		{
 			uint32_t A,B,C,D,E,T;
 			uint32_t W[80];
@@ -316,19 +461,20 @@ namespace DKFoundation
 			}
 		}
 
-		static void HashDigest256(HashContext* ctx, const void* p, size_t count)
+		static const uint32_t HashSHA256K[64] = {
+			0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+			0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+			0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+			0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+			0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+			0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+			0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+			0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+		};
+
+		static void HashDigest256Generic(HashContext* ctx, const void* p, size_t count)
 		{
 			uint32_t A,B,C,D,E,F,G,H;
-			static const uint32_t K[] = {
-				0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
-				0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
-				0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-				0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
-				0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-				0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
-				0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-				0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
-			};
 			uint32_t W[64];
 			for (size_t i = 0; i < count; i++)
 			{
@@ -363,7 +509,7 @@ namespace DKFoundation
 					t2 = s0 + maj;
 					s1 = HASH_RIGHT_ROTATE32(E,6) ^ HASH_RIGHT_ROTATE32(E,11) ^ HASH_RIGHT_ROTATE32(E,25);
 					ch = (E & F) ^ ((~E) & G);
-					t1 = H + s1 + ch + K[n] + W[n];
+					t1 = H + s1 + ch + HashSHA256K[n] + W[n];
 
 					H = G;
 					G = F;
@@ -468,6 +614,574 @@ namespace DKFoundation
 			}
 		}
 
+#ifdef DKHASH_X86_INTRINSICS
+		////////////////////////////////////////////////////////////////////////////////
+		// SHA1, SHA256 with Intel SHA extensions.
+		// rounds are unrolled by 4, message schedule registers are rotated.
+#define HASH_SHA1NI_ROUND4(g, cur, prev, prev2, next, e_cur, e_next)			\
+		e_cur = (g == 0) ? _mm_add_epi32(e_cur, cur) : _mm_sha1nexte_epu32(e_cur, cur);	\
+		e_next = abcd;															\
+		if (g >= 3 && g <= 18) next = _mm_sha1msg2_epu32(next, cur);			\
+		abcd = _mm_sha1rnds4_epu32(abcd, e_cur, g / 5);							\
+		if (g >= 1 && g <= 16) prev = _mm_sha1msg1_epu32(prev, cur);			\
+		if (g >= 2 && g <= 17) prev2 = _mm_xor_si128(prev2, cur);
+
+		DKHASH_TARGET("sha,sse4.1,ssse3")
+		static void HashDigest160SHANI(HashContext* ctx, const void* p, size_t count)
+		{
+			const __m128i mask = _mm_set_epi64x(0x0001020304050607LL, 0x08090a0b0c0d0e0fLL);
+			const uint8_t* data = reinterpret_cast<const uint8_t*>(p);
+
+			__m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)ctx->hash32), 0x1B);
+			__m128i e0 = _mm_set_epi32((int)ctx->hash32[4], 0, 0, 0);
+			__m128i e1;
+			__m128i m0, m1, m2, m3;
+
+			for (size_t i = 0; i < count; i++)
+			{
+				__m128i abcdSave = abcd;
+				__m128i e0Save = e0;
+
+				m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 0)), mask);
+				m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16)), mask);
+				m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 32)), mask);
+				m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 48)), mask);
+
+				HASH_SHA1NI_ROUND4(0, m0, m3, m2, m1, e0, e1);
+				HASH_SHA1NI_ROUND4(1, m1, m0, m3, m2, e1, e0);
+				HASH_SHA1NI_ROUND4(2, m2, m1, m0, m3, e0, e1);
+				HASH_SHA1NI_ROUND4(3, m3, m2, m1, m0, e1, e0);
+				HASH_SHA1NI_ROUND4(4, m0, m3, m2, m1, e0, e1);
+				HASH_SHA1NI_ROUND4(5, m1, m0, m3, m2, e1, e0);
+				HASH_SHA1NI_ROUND4(6, m2, m1, m0, m3, e0, e1);
+				HASH_SHA1NI_ROUND4(7, m3, m2, m1, m0, e1, e0);
+				HASH_SHA1NI_ROUND4(8, m0, m3, m2, m1, e0, e1);
+				HASH_SHA1NI_ROUND4(9, m1, m0, m3, m2, e1, e0);
+				HASH_SHA1NI_ROUND4(10, m2, m1, m0, m3, e0, e1);
+				HASH_SHA1NI_ROUND4(11, m3, m2, m1, m0, e1, e0);
+				HASH_SHA1NI_ROUND4(12, m0, m3, m2, m1, e0, e1);
+				HASH_SHA1NI_ROUND4(13, m1, m0, m3, m2, e1, e0);
+				HASH_SHA1NI_ROUND4(14, m2, m1, m0, m3, e0, e1);
+				HASH_SHA1NI_ROUND4(15, m3, m2, m1, m0, e1, e0);
+				HASH_SHA1NI_ROUND4(16, m0, m3, m2, m1, e0, e1);
+				HASH_SHA1NI_ROUND4(17, m1, m0, m3, m2, e1, e0);
+				HASH_SHA1NI_ROUND4(18, m2, m1, m0, m3, e0, e1);
+				HASH_SHA1NI_ROUND4(19, m3, m2, m1, m0, e1, e0);
+
+				e0 = _mm_sha1nexte_epu32(e0, e0Save);
+				abcd = _mm_add_epi32(abcd, abcdSave);
+				data += 64;
+			}
+			_mm_storeu_si128((__m128i*)ctx->hash32, _mm_shuffle_epi32(abcd, 0x1B));
+			ctx->hash32[4] = (uint32_t)_mm_extract_epi32(e0, 3);
+		}
+#undef HASH_SHA1NI_ROUND4
+
+#define HASH_SHA256NI_ROUND4(g, cur, prev, next)								\
+		msg = _mm_add_epi32(cur, _mm_loadu_si128((const __m128i*)&HashSHA256K[g * 4]));	\
+		state1 = _mm_sha256rnds2_epu32(state1, state0, msg);					\
+		if (g >= 3 && g <= 14)													\
+		{																		\
+			next = _mm_add_epi32(next, _mm_alignr_epi8(cur, prev, 4));			\
+			next = _mm_sha256msg2_epu32(next, cur);								\
+		}																		\
+		state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));	\
+		if (g >= 1 && g <= 12) prev = _mm_sha256msg1_epu32(prev, cur);
+
+		DKHASH_TARGET("sha,sse4.1,ssse3")
+		static void HashDigest256SHANI(HashContext* ctx, const void* p, size_t count)
+		{
+			const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bLL, 0x0405060700010203LL);
+			const uint8_t* data = reinterpret_cast<const uint8_t*>(p);
+
+			// state0: ABEF, state1: CDGH
+			__m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&ctx->hash32[0]), 0xB1);
+			__m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&ctx->hash32[4]), 0x1B);
+			__m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+			state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+			__m128i msg, m0, m1, m2, m3;
+			for (size_t i = 0; i < count; i++)
+			{
+				__m128i abefSave = state0;
+				__m128i cdghSave = state1;
+
+				m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 0)), mask);
+				m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16)), mask);
+				m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 32)), mask);
+				m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 48)), mask);
+
+				HASH_SHA256NI_ROUND4(0, m0, m3, m1);
+				HASH_SHA256NI_ROUND4(1, m1, m0, m2);
+				HASH_SHA256NI_ROUND4(2, m2, m1, m3);
+				HASH_SHA256NI_ROUND4(3, m3, m2, m0);
+				HASH_SHA256NI_ROUND4(4, m0, m3, m1);
+				HASH_SHA256NI_ROUND4(5, m1, m0, m2);
+				HASH_SHA256NI_ROUND4(6, m2, m1, m3);
+				HASH_SHA256NI_ROUND4(7, m3, m2, m0);
+				HASH_SHA256NI_ROUND4(8, m0, m3, m1);
+				HASH_SHA256NI_ROUND4(9, m1, m0, m2);
+				HASH_SHA256NI_ROUND4(10, m2, m1, m3);
+				HASH_SHA256NI_ROUND4(11, m3, m2, m0);
+				HASH_SHA256NI_ROUND4(12, m0, m3, m1);
+				HASH_SHA256NI_ROUND4(13, m1, m0, m2);
+				HASH_SHA256NI_ROUND4(14, m2, m1, m3);
+				HASH_SHA256NI_ROUND4(15, m3, m2, m0);
+
+				state0 = _mm_add_epi32(state0, abefSave);
+				state1 = _mm_add_epi32(state1, cdghSave);
+				data += 64;
+			}
+			tmp = _mm_shuffle_epi32(state0, 0x1B);			// FEBA
+			state1 = _mm_shuffle_epi32(state1, 0xB1);		// DCHG
+			state0 = _mm_blend_epi16(tmp, state1, 0xF0);	// DCBA
+			state1 = _mm_alignr_epi8(state1, tmp, 8);		// HGFE
+			_mm_storeu_si128((__m128i*)&ctx->hash32[0], state0);
+			_mm_storeu_si128((__m128i*)&ctx->hash32[4], state1);
+		}
+#undef HASH_SHA256NI_ROUND4
+
+		////////////////////////////////////////////////////////////////////////////////
+		// CPU features for run-time dispatch
+		struct HashCPUFeatures
+		{
+			bool ssse3;
+			bool sse41;
+			bool pclmul;
+			bool sha;
+
+			HashCPUFeatures() : ssse3(false), sse41(false), pclmul(false), sha(false)
+			{
+				uint32_t r[4] = { 0 };
+				CPUID(0, r);
+				uint32_t maxLeaf = r[0];
+				if (maxLeaf >= 1)
+				{
+					CPUID(1, r);
+					pclmul = (r[2] & (1U << 1)) != 0;
+					ssse3 = (r[2] & (1U << 9)) != 0;
+					sse41 = (r[2] & (1U << 19)) != 0;
+				}
+				if (maxLeaf >= 7)
+				{
+					CPUID(7, r);
+					sha = (r[1] & (1U << 29)) != 0;
+				}
+			}
+			static void CPUID(uint32_t leaf, uint32_t* r)
+			{
+#ifdef _MSC_VER
+				int regs[4];
+				__cpuidex(regs, (int)leaf, 0);
+				for (int i = 0; i < 4; i++)
+					r[i] = (uint32_t)regs[i];
+#else
+				__cpuid_count(leaf, 0, r[0], r[1], r[2], r[3]);
+#endif
+			}
+		};
+#endif
+
+#ifdef DKHASH_SSE2_MULTI_BUFFER
+		////////////////////////////////////////////////////////////////////////////////
+		// 4-lane SHA1, SHA256 with SSE2. (multi-buffer)
+		// state[word][lane], each lane processes one block of independent message.
+#define HASH_ROL32x4(x, c)		_mm_or_si128(_mm_slli_epi32((x), (c)), _mm_srli_epi32((x), 32 - (c)))
+#define HASH_ROR32x4(x, c)		_mm_or_si128(_mm_srli_epi32((x), (c)), _mm_slli_epi32((x), 32 - (c)))
+
+		FORCEINLINE int HashLoadBE32(const uint8_t* p)
+		{
+			uint32_t v;
+			memcpy(&v, p, 4);
+			return (int)DKSystemToBigEndian(v);
+		}
+		FORCEINLINE __m128i HashLoadBE32x4(const uint8_t* const* p, size_t offset)
+		{
+			return _mm_set_epi32(HashLoadBE32(p[3] + offset), HashLoadBE32(p[2] + offset), HashLoadBE32(p[1] + offset), HashLoadBE32(p[0] + offset));
+		}
+
+		static void HashDigest160x4(uint32_t (*state)[4], const uint8_t* const* p)
+		{
+			__m128i W[80];
+			for (int x = 0; x < 16; x++)
+				W[x] = HashLoadBE32x4(p, x * 4);
+			for (int x = 16; x < 80; x++)
+				W[x] = HASH_ROL32x4(_mm_xor_si128(_mm_xor_si128(W[x-3], W[x-8]), _mm_xor_si128(W[x-14], W[x-16])), 1);
+
+			__m128i A = _mm_loadu_si128((const __m128i*)state[0]);
+			__m128i B = _mm_loadu_si128((const __m128i*)state[1]);
+			__m128i C = _mm_loadu_si128((const __m128i*)state[2]);
+			__m128i D = _mm_loadu_si128((const __m128i*)state[3]);
+			__m128i E = _mm_loadu_si128((const __m128i*)state[4]);
+			const __m128i A0 = A, B0 = B, C0 = C, D0 = D, E0 = E;
+
+			for (int n = 0; n < 80; n++)
+			{
+				__m128i F, K;
+				if (n < 20)
+				{
+					F = _mm_or_si128(_mm_and_si128(B, C), _mm_andnot_si128(B, D));
+					K = _mm_set1_epi32(0x5A827999);
+				}
+				else if (n < 40)
+				{
+					F = _mm_xor_si128(_mm_xor_si128(B, C), D);
+					K = _mm_set1_epi32(0x6ED9EBA1);
+				}
+				else if (n < 60)
+				{
+					F = _mm_or_si128(_mm_and_si128(B, C), _mm_and_si128(D, _mm_or_si128(B, C)));
+					K = _mm_set1_epi32((int)0x8F1BBCDC);
+				}
+				else
+				{
+					F = _mm_xor_si128(_mm_xor_si128(B, C), D);
+					K = _mm_set1_epi32((int)0xCA62C1D6);
+				}
+				__m128i T = _mm_add_epi32(_mm_add_epi32(HASH_ROL32x4(A, 5), F), _mm_add_epi32(_mm_add_epi32(E, W[n]), K));
+				E = D; D = C; C = HASH_ROL32x4(B, 30); B = A; A = T;
+			}
+			_mm_storeu_si128((__m128i*)state[0], _mm_add_epi32(A, A0));
+			_mm_storeu_si128((__m128i*)state[1], _mm_add_epi32(B, B0));
+			_mm_storeu_si128((__m128i*)state[2], _mm_add_epi32(C, C0));
+			_mm_storeu_si128((__m128i*)state[3], _mm_add_epi32(D, D0));
+			_mm_storeu_si128((__m128i*)state[4], _mm_add_epi32(E, E0));
+		}
+
+		static void HashDigest256x4(uint32_t (*state)[4], const uint8_t* const* p)
+		{
+			__m128i W[64];
+			for (int x = 0; x < 16; x++)
+				W[x] = HashLoadBE32x4(p, x * 4);
+			for (int x = 16; x < 64; x++)
+			{
+				__m128i s0 = _mm_xor_si128(_mm_xor_si128(HASH_ROR32x4(W[x-15], 7), HASH_ROR32x4(W[x-15], 18)), _mm_srli_epi32(W[x-15], 3));
+				__m128i s1 = _mm_xor_si128(_mm_xor_si128(HASH_ROR32x4(W[x-2], 17), HASH_ROR32x4(W[x-2], 19)), _mm_srli_epi32(W[x-2], 10));
+				W[x] = _mm_add_epi32(_mm_add_epi32(W[x-16], s0), _mm_add_epi32(W[x-7], s1));
+			}
+
+			__m128i S[8], H[8];
+			for (int i = 0; i < 8; i++)
+				S[i] = H[i] = _mm_loadu_si128((const __m128i*)state[i]);
+
+			for (int n = 0; n < 64; n++)
+			{
+				__m128i A = H[0], B = H[1], C = H[2], E = H[4], F = H[5], G = H[6];
+				__m128i s0 = _mm_xor_si128(_mm_xor_si128(HASH_ROR32x4(A, 2), HASH_ROR32x4(A, 13)), HASH_ROR32x4(A, 22));
+				__m128i maj = _mm_xor_si128(_mm_and_si128(A, B), _mm_and_si128(C, _mm_xor_si128(A, B)));
+				__m128i t2 = _mm_add_epi32(s0, maj);
+				__m128i s1 = _mm_xor_si128(_mm_xor_si128(HASH_ROR32x4(E, 6), HASH_ROR32x4(E, 11)), HASH_ROR32x4(E, 25));
+				__m128i ch = _mm_xor_si128(_mm_and_si128(E, F), _mm_andnot_si128(E, G));
+				__m128i t1 = _mm_add_epi32(_mm_add_epi32(H[7], s1), _mm_add_epi32(_mm_add_epi32(ch, _mm_set1_epi32((int)HashSHA256K[n])), W[n]));
+
+				H[7] = G;
+				H[6] = F;
+				H[5] = E;
+				H[4] = _mm_add_epi32(H[3], t1);
+				H[3] = C;
+				H[2] = B;
+				H[1] = A;
+				H[0] = _mm_add_epi32(t1, t2);
+			}
+			for (int i = 0; i < 8; i++)
+				_mm_storeu_si128((__m128i*)state[i], _mm_add_epi32(H[i], S[i]));
+		}
+#undef HASH_ROL32x4
+#undef HASH_ROR32x4
+#endif
+
+		////////////////////////////////////////////////////////////////////////////////
+		// select functions by CPU features at run-time.
+		struct HashFunctions
+		{
+			uint32_t (*crc32)(uint32_t, const uint8_t*, size_t);
+			void (*digest160)(HashContext*, const void*, size_t);
+			void (*digest256)(HashContext*, const void*, size_t);
+			// 4-lane transforms for multi-buffer hashing, NULL if not profitable.
+			void (*digest160x4)(uint32_t (*)[4], const uint8_t* const*);
+			void (*digest256x4)(uint32_t (*)[4], const uint8_t* const*);
+
+			HashFunctions()
+				: crc32(CRC32Slicing16)
+				, digest160(HashDigest160Generic)
+				, digest256(HashDigest256Generic)
+				, digest160x4(NULL)
+				, digest256x4(NULL)
+			{
+#if defined(__ARM_FEATURE_CRC32)
+				crc32 = CRC32ARMv8;
+#endif
+#ifdef DKHASH_SSE2_MULTI_BUFFER
+				digest160x4 = HashDigest160x4;
+				digest256x4 = HashDigest256x4;
+#endif
+#ifdef DKHASH_X86_INTRINSICS
+				HashCPUFeatures cpu;
+				if (cpu.pclmul && cpu.sse41)
+					crc32 = CRC32PCLMUL;
+				if (cpu.sha && cpu.sse41 && cpu.ssse3)
+				{
+					// single stream SHA-NI is faster than 4-lane SSE2.
+					digest160 = HashDigest160SHANI;
+					digest256 = HashDigest256SHANI;
+					digest160x4 = NULL;
+					digest256x4 = NULL;
+				}
+#endif
+			}
+		};
+		static const HashFunctions& HashDispatch()
+		{
+			static const HashFunctions functions;
+			return functions;
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		// update context digest
+		static void HashUpdate32(HashContext* ctx, const void* p, size_t len)
+		{
+			ctx->hash32[0] = ~HashDispatch().crc32(~(ctx->hash32[0]), reinterpret_cast<const uint8_t*>(p), len);
+		}
+		static void HashDigest160(HashContext* ctx, const void* p, size_t count)
+		{
+			HashDispatch().digest160(ctx, p, count);
+		}
+		static void HashDigest256(HashContext* ctx, const void* p, size_t count)
+		{
+			HashDispatch().digest256(ctx, p, count);
+		}
+
+		// Multi-buffer hashing with 4-lane transform.
+		// Each lane takes whole blocks of its message and then padded tail blocks,
+		// a lane is refilled with next message when it finishes.
+		// Applicable to SHA1, SHA256 (big-endian 64 bits length)
+		template <int Words, typename Transform, typename Output>
+		static void HashMultiBuffer(const uint32_t* init, const void* const* data, const size_t* length, size_t count, Transform transform, Output output)
+		{
+			struct Lane
+			{
+				size_t input;
+				const uint8_t* ptr;
+				size_t blocks;
+				size_t padBlocks;
+				bool padding;
+				uint8_t pad[128];
+			};
+			static const uint8_t emptyBlock[64] = { 0 };
+			const size_t noInput = (size_t)-1;
+
+			Lane lanes[4];
+			uint32_t state[Words][4];
+			size_t next = 0;
+			int active = 0;
+
+			auto assign = [&](int l) -> bool
+			{
+				Lane& lane = lanes[l];
+				if (next >= count)
+				{
+					lane.input = noInput;
+					return false;
+				}
+				lane.input = next++;
+				size_t len = length[lane.input];
+				const uint8_t* msg = reinterpret_cast<const uint8_t*>(data[lane.input]);
+				size_t tail = len % 64;
+
+				memset(lane.pad, 0, sizeof(lane.pad));
+				memcpy(lane.pad, msg + (len - tail), tail);
+				lane.pad[tail] = 0x80;
+				lane.padBlocks = (tail + 9 > 64) ? 2 : 1;
+				uint64_t bits = DKSystemToBigEndian((uint64_t)len << 3);
+				memcpy(lane.pad + lane.padBlocks * 64 - 8, &bits, 8);
+
+				lane.ptr = msg;
+				lane.blocks = len / 64;
+				lane.padding = false;
+				if (lane.blocks == 0)
+				{
+					lane.ptr = lane.pad;
+					lane.blocks = lane.padBlocks;
+					lane.padding = true;
+				}
+				for (int w = 0; w < Words; w++)
+					state[w][l] = init[w];
+				return true;
+			};
+
+			for (int l = 0; l < 4; l++)
+			{
+				if (assign(l))
+					active++;
+			}
+			while (active > 0)
+			{
+				size_t n = (size_t)-1;
+				for (int l = 0; l < 4; l++)
+				{
+					if (lanes[l].input != noInput && lanes[l].blocks < n)
+						n = lanes[l].blocks;
+				}
+				const uint8_t* ptr[4];
+				for (size_t i = 0; i < n; i++)
+				{
+					for (int l = 0; l < 4; l++)
+						ptr[l] = lanes[l].input != noInput ? lanes[l].ptr + i * 64 : emptyBlock;
+					transform(state, ptr);
+				}
+				for (int l = 0; l < 4; l++)
+				{
+					Lane& lane = lanes[l];
+					if (lane.input == noInput)
+						continue;
+					lane.ptr += n * 64;
+					lane.blocks -= n;
+					if (lane.blocks == 0)
+					{
+						if (lane.padding == false)
+						{
+							lane.ptr = lane.pad;
+							lane.blocks = lane.padBlocks;
+							lane.padding = true;
+						}
+						else
+						{
+							uint32_t digest[Words];
+							for (int w = 0; w < Words; w++)
+								digest[w] = state[w][l];
+							output(lane.input, digest);
+							if (!assign(l))
+								active--;
+						}
+					}
+				}
+			}
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		// Fast64, Fast128 (non-cryptographic, see DKHashTableHash64)
+		// Context for streaming:
+		//  hash64[0..2]: stripe lanes, hash64[3]: second accumulator (Fast128)
+		//  hash64[4..5]: result, low: total length, num: pending bytes
+		//  data8[0..16): last 16 bytes of consumed stripe, data8[16..64): pending bytes
+		static inline void HashInitFast(HashContext* ctx, uint64_t seed, bool wide)
+		{
+			const uint64_t* s = DKHashTableSecret;
+			memset(ctx, 0, sizeof(HashContext));
+			ctx->hash64[0] = seed ^ DKHashTableMix128(seed ^ s[0], s[1]);
+			ctx->hash64[1] = ctx->hash64[0];
+			ctx->hash64[2] = ctx->hash64[0];
+			ctx->hash64[3] = seed ^ DKHashTableMix128(seed ^ s[2], s[3]);
+			ctx->len = wide ? 16 : 8;
+		}
+
+		// finish hash with remaining bytes. (p - 16 must be readable if total > 16)
+		static void HashFinalFast(const uint64_t* lanes, const uint8_t* p, size_t i, uint64_t total, bool wide, uint64_t* result)
+		{
+			const uint64_t* s = DKHashTableSecret;
+			uint64_t acc0 = lanes[0];
+			uint64_t acc1 = lanes[3];
+			uint64_t a, b;
+			if (total <= 16)
+			{
+				DKHashTableReadShort(p, i, a, b);
+			}
+			else
+			{
+				if (total > 48)
+				{
+					if (wide)
+					{
+						acc0 = lanes[0] ^ lanes[1];
+						acc1 = acc1 ^ lanes[0] ^ lanes[2];
+					}
+					else
+					{
+						acc0 = lanes[0] ^ lanes[1] ^ lanes[2];
+					}
+				}
+				while (i > 16)
+				{
+					uint64_t r0 = DKHashTableRead64(p);
+					uint64_t r1 = DKHashTableRead64(p + 8);
+					acc0 = DKHashTableMix128(r0 ^ s[1], r1 ^ acc0);
+					if (wide)
+						acc1 = DKHashTableMix128(r0 ^ s[2], r1 ^ acc1);
+					p += 16;
+					i -= 16;
+				}
+				a = DKHashTableRead64(p + i - 16);
+				b = DKHashTableRead64(p + i - 8);
+			}
+			uint64_t a0 = a ^ s[1];
+			uint64_t b0 = b ^ acc0;
+			DKHashTableMultiply128(a0, b0);
+			result[0] = DKHashTableMix128(a0 ^ s[0] ^ total, b0 ^ s[1]);
+			if (wide)
+			{
+				uint64_t a1 = a ^ s[2];
+				uint64_t b1 = b ^ acc1;
+				DKHashTableMultiply128(a1, b1);
+				result[1] = DKHashTableMix128(a1 ^ s[3] ^ total, b1 ^ s[2]);
+			}
+		}
+
+		static void HashFast(const void* data, size_t len, uint64_t seed, bool wide, uint64_t* result)
+		{
+			const uint64_t* s = DKHashTableSecret;
+			uint64_t lanes[4];
+			lanes[0] = seed ^ DKHashTableMix128(seed ^ s[0], s[1]);
+			lanes[1] = lanes[0];
+			lanes[2] = lanes[0];
+			lanes[3] = seed ^ DKHashTableMix128(seed ^ s[2], s[3]);
+
+			const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+			size_t i = len;
+			if (i > 48)
+			{
+				do {
+					DKHashTableStripe(lanes, p);
+					p += 48;
+					i -= 48;
+				} while (i > 48);
+			}
+			HashFinalFast(lanes, p, i, len, wide, result);
+		}
+
+		static void HashUpdateFast(HashContext* ctx, const void* p, size_t len)
+		{
+			const uint8_t* data = reinterpret_cast<const uint8_t*>(p);
+			uint8_t* pending = ctx->data8 + 16;
+			size_t n = ctx->num;
+			ctx->low += len;
+			if (n + len <= 48)
+			{
+				memcpy(pending + n, data, len);
+				ctx->num = (uint32_t)(n + len);
+				return;
+			}
+			// stripe is consumed only if more bytes follows.
+			if (n > 0)
+			{
+				memcpy(pending + n, data, 48 - n);
+				data += 48 - n;
+				len -= 48 - n;
+				DKHashTableStripe(ctx->hash64, pending);
+				memcpy(ctx->data8, pending + 32, 16);
+			}
+			if (len > 48)
+			{
+				do {
+					DKHashTableStripe(ctx->hash64, data);
+					data += 48;
+					len -= 48;
+				} while (len > 48);
+				memcpy(ctx->data8, data - 16, 16);
+			}
+			memcpy(pending, data, len);
+			ctx->num = (uint32_t)len;
+		}
+
 		// HashUpdate : updates hash digest, using all algorithms except for CRC32
 		template <typename HashDigest> static void HashUpdate(HashContext* ctx, size_t block_size, const void* p, size_t len, HashDigest hash_func)
 		{
@@ -842,12 +1556,116 @@ namespace DKFoundation
 		}
 		return false;
 	}
+	DKGL_API DKHashResultFast64 DKHashFast64(const void* p, size_t len, uint64_t seed)
+	{
+		DKHashResultFast64 res;
+		res.digest[0] = Private::DKHashTableHash64(p, len, seed);
+		return res;
+	}
+	DKGL_API bool DKHashFast64(DKStream* stream, DKHashResultFast64& result, uint64_t seed)
+	{
+		if (stream && stream->IsReadable())
+		{
+			char buff[STREAM_BUFFER_SIZE];
+			Private::HashContext ctx;
+			Private::HashInitFast(&ctx, seed, false);
+			size_t read = 0;
+			do {
+				read = stream->Read(buff, STREAM_BUFFER_SIZE);
+				if (read == DKStream::PositionError)
+					return false;
+				Private::HashUpdateFast(&ctx, buff, read);
+			} while (read);
+			Private::HashFinalFast(ctx.hash64, ctx.data8 + 16, ctx.num, ctx.low, false, result.digest);
+			return true;
+		}
+		return false;
+	}
+	DKGL_API DKHashResultFast128 DKHashFast128(const void* p, size_t len, uint64_t seed)
+	{
+		uint64_t r[2];
+		Private::HashFast(p, len, seed, true, r);
+
+		DKHashResultFast128 res;
+		res.digest[0] = r[1];
+		res.digest[1] = r[0];
+		return res;
+	}
+	DKGL_API bool DKHashFast128(DKStream* stream, DKHashResultFast128& result, uint64_t seed)
+	{
+		if (stream && stream->IsReadable())
+		{
+			char buff[STREAM_BUFFER_SIZE];
+			Private::HashContext ctx;
+			Private::HashInitFast(&ctx, seed, true);
+			size_t read = 0;
+			do {
+				read = stream->Read(buff, STREAM_BUFFER_SIZE);
+				if (read == DKStream::PositionError)
+					return false;
+				Private::HashUpdateFast(&ctx, buff, read);
+			} while (read);
+			uint64_t r[2];
+			Private::HashFinalFast(ctx.hash64, ctx.data8 + 16, ctx.num, ctx.low, true, r);
+			result.digest[0] = r[1];
+			result.digest[1] = r[0];
+			return true;
+		}
+		return false;
+	}
+	DKGL_API void DKHashCRC32(const void* const* data, const size_t* length, size_t count, DKHashResultCRC32* results)
+	{
+		DEBUG_CHECK_RUNTIME_ENDIANNESS;
+		for (size_t i = 0; i < count; i++)
+			results[i] = DKHashCRC32(data[i], length[i]);
+	}
+	DKGL_API void DKHashSHA1(const void* const* data, const size_t* length, size_t count, DKHashResultSHA1* results)
+	{
+		DEBUG_CHECK_RUNTIME_ENDIANNESS;
+		auto transform = Private::HashDispatch().digest160x4;
+		if (transform && count > 1)
+		{
+			Private::HashContext ctx;
+			Private::HashInit160(&ctx);
+			Private::HashMultiBuffer<5>(ctx.hash32, data, length, count, transform, [results](size_t i, const uint32_t* digest)
+			{
+				for (int k = 0; k < 5; k++)
+					results[i].digest[k] = digest[k];
+			});
+		}
+		else
+		{
+			for (size_t i = 0; i < count; i++)
+				results[i] = DKHashSHA1(data[i], length[i]);
+		}
+	}
+	DKGL_API void DKHashSHA256(const void* const* data, const size_t* length, size_t count, DKHashResultSHA256* results)
+	{
+		DEBUG_CHECK_RUNTIME_ENDIANNESS;
+		auto transform = Private::HashDispatch().digest256x4;
+		if (transform && count > 1)
+		{
+			Private::HashContext ctx;
+			Private::HashInit256(&ctx);
+			Private::HashMultiBuffer<8>(ctx.hash32, data, length, count, transform, [results](size_t i, const uint32_t* digest)
+			{
+				for (int k = 0; k < 8; k++)
+					results[i].digest[k] = digest[k];
+			});
+		}
+		else
+		{
+			for (size_t i = 0; i < count; i++)
+				results[i] = DKHashSHA256(data[i], length[i]);
+		}
+	}
 }
 
 using namespace DKFoundation;
 
-DKHash::DKHash(Type t)
+DKHash::DKHash(Type t, uint64_t s)
 	: type(t)
+	, seed(s)
 	, finalized(true)
 	, ctxt(NULL)
 {
@@ -887,6 +1705,12 @@ void DKHash::Initialize()
 	case Type512:
 		Private::HashInit512(ctxt);
 		break;
+	case TypeFast64:
+		Private::HashInitFast(ctxt, seed, false);
+		break;
+	case TypeFast128:
+		Private::HashInitFast(ctxt, seed, true);
+		break;
 	default:
 		DKERROR_THROW_DEBUG("Uknown type");
 		break;
@@ -921,6 +1745,10 @@ void DKHash::Update(const void* p, size_t len)
 	case Type512:
 		Private::HashUpdate(ctxt, 128, p, len, Private::HashDigest512);
 		break;
+	case TypeFast64:
+	case TypeFast128:
+		Private::HashUpdateFast(ctxt, p, len);
+		break;
 	default:
 		DKERROR_THROW_DEBUG("Uknown type");
 		break;
@@ -953,6 +1781,10 @@ void DKHash::Finalize()
 		case Type512:
 			Private::HashFinal(ctxt, 128, Private::HashDigest512, false);
 			break;
+		case TypeFast64:
+		case TypeFast128:
+			Private::HashFinalFast(ctxt->hash64, ctxt->data8 + 16, ctxt->num, ctxt->low, type == TypeFast128, &ctxt->hash64[4]);
+			break;
 		default:
 			DKERROR_THROW_DEBUG("Uknown type");
 			break;
@@ -1042,3 +1874,26 @@ DKHashResult512 DKHash512::Result() const
 		res.digest[i] = ctxt->hash32[i];
 	return res;
 }
+
+DKHashResultFast64 DKFastHash64::Result() const
+{
+	DKASSERT_DESC_DEBUG(type == TypeFast64, "Invalid Hash Type");
+	DKASSERT_DESC_DEBUG(ctxt != NULL, "Object not initialized.");
+	DKASSERT_DESC_DEBUG(finalized, "Object not finalized.");
+
+	DKHashResultFast64 res;
+	res.digest[0] = ctxt->hash64[4];
+	return res;
+}
+
+DKHashResultFast128 DKFastHash128::Result() const
+{
+	DKASSERT_DESC_DEBUG(type == TypeFast128, "Invalid Hash Type");
+	DKASSERT_DESC_DEBUG(ctxt != NULL, "Object not initialized.");
+	DKASSERT_DESC_DEBUG(finalized, "Object not finalized.");
+
+	DKHashResultFast128 res;
+	res.digest[0] = ctxt->hash64[5];
+	res.digest[1] = ctxt->hash64[4];
+	return res;
+}
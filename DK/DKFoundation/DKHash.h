@@ -26,12 +26,12 @@ namespace DKFoundation
 		BASE digest[Length]; ///< hash digest in unit size (usually uint32_t)
 		int Compare(const DKHashResult& r) const
 		{
-			int d = 0;
-			for (int i = 0; d == 0 && i < Length; ++i)
+			for (int i = 0; i < Length; ++i)
 			{
-				d = static_cast<int>(this->digest[i] - r.digest[i]);
+				if (this->digest[i] != r.digest[i])
+					return this->digest[i] > r.digest[i] ? 1 : -1;
 			}
-			return d;
+			return 0;
 		}
 
 		bool operator == (const DKHashResult& r) const		{return Compare(r) == 0;}
@@ -43,7 +43,7 @@ namespace DKFoundation
 
 		DKString String() const ///< represent hash digest as a string
 		{
-			char buff[Length * 8];
+			char buff[Length * UnitSize * 2];
 			char* tmp = buff;
 			for (size_t i = 0; i < Length; ++i)
 			{
@@ -58,7 +58,7 @@ namespace DKFoundation
 					*(tmp++) = v2 <= 9 ? v2 + '0' : 'a' + (v2 - 10);
 				}
 			}
-			return DKString(buff, Length * 8);
+			return DKString(buff, Length * UnitSize * 2);
 		}
 	};
 	
@@ -83,6 +83,9 @@ namespace DKFoundation
 	/// Hash context for SHA2 (SHA-512)
 	typedef DKHashResult<uint32_t, 512>	DKHashResult512;
 	typedef DKHashResult<uint32_t, 512>	DKHashResultSHA512;
+	/// Hash context for non-cryptographic hash (DKHashFast64, DKHashFast128)
+	typedef DKHashResult<uint64_t, 64>	DKHashResultFast64;
+	typedef DKHashResult<uint64_t, 128>	DKHashResultFast128;
 
 	/// CRC32
 	DKGL_API DKHashResultCRC32 DKHashCRC32(const void* p, size_t len);
@@ -105,11 +108,28 @@ namespace DKFoundation
 	/// SHA2 (SHA-512)
 	DKGL_API DKHashResultSHA512 DKHashSHA512(const void* p, size_t len);
 	DKGL_API bool DKHashSHA512(DKStream*, DKHashResultSHA512&);
+	/// Fast non-cryptographic hash (wyhash based), 64 bits and 128 bits.
+	/// For hash tables, checksums and content addressing, not for security.
+	/// Results are same on any platform, DKHashFast64 with zero seed
+	/// is same as DKHashTableHashBytes (see DKHashTable.h)
+	DKGL_API DKHashResultFast64 DKHashFast64(const void* p, size_t len, uint64_t seed = 0);
+	DKGL_API bool DKHashFast64(DKStream*, DKHashResultFast64&, uint64_t seed = 0);
+	DKGL_API DKHashResultFast128 DKHashFast128(const void* p, size_t len, uint64_t seed = 0);
+	DKGL_API bool DKHashFast128(DKStream*, DKHashResultFast128&, uint64_t seed = 0);
+
+	/// Multi-buffer hashing: calculates digests of 'count' independent inputs
+	/// (data[i], length[i]) and stores them to results[i].
+	/// Short messages are interleaved through SIMD lanes if it is faster
+	/// than hashing them one at a time on the running CPU.
+	DKGL_API void DKHashCRC32(const void* const* data, const size_t* length, size_t count, DKHashResultCRC32* results);
+	DKGL_API void DKHashSHA1(const void* const* data, const size_t* length, size_t count, DKHashResultSHA1* results);
+	DKGL_API void DKHashSHA256(const void* const* data, const size_t* length, size_t count, DKHashResultSHA256* results);
 
 	/// @brief Hash calculation class
 	///
 	/// Following hash digest algorithms are supported.\n
-	/// CRC32, MD5, SHA1, SHA2, SHA-224, SHA-256, SHA-384, SHA-512
+	/// CRC32, MD5, SHA1, SHA2, SHA-224, SHA-256, SHA-384, SHA-512,
+	/// Fast64, Fast128 (non-cryptographic)
 	class DKGL_API DKHash
 	{
 	public:
@@ -130,6 +150,8 @@ namespace DKFoundation
 			Type256,	///< SHA2 (SHA-256)
 			Type384,	///< SHA2 (SHA-384)
 			Type512,	///< SHA2 (SHA-512)
+			TypeFast64,	///< Non-cryptographic 64 bits
+			TypeFast128,///< Non-cryptographic 128 bits
 		};
 		enum Name
 		{
@@ -140,12 +162,15 @@ namespace DKFoundation
 			SHA2_256   = Type256,
 			SHA2_384   = Type384,
 			SHA2_512   = Type512,
+			Fast64     = TypeFast64,
+			Fast128    = TypeFast128,
 		};
 
-		DKHash(Type t);
+		DKHash(Type t, uint64_t seed = 0);
 		DKHash(Name n) : DKHash((Type)n) {}
 
 		const Type type;
+		const uint64_t seed; ///< seed for Fast64, Fast128
 		bool finalized;
 		Context* ctxt;
 	};
@@ -191,4 +216,16 @@ namespace DKFoundation
 		DKHash512() : DKHash(Type512) {}
 		DKHashResult512 Result() const;
 	};
+	class DKGL_API DKFastHash64 : public DKHash
+	{
+	public:
+		DKFastHash64(uint64_t seed = 0) : DKHash(TypeFast64, seed) {}
+		DKHashResultFast64 Result() const;
+	};
+	class DKGL_API DKFastHash128 : public DKHash
+	{
+	public:
+		DKFastHash128(uint64_t seed = 0) : DKHash(TypeFast128, seed) {}
+		DKHashResultFast128 Result() const;
+	};
 }
@@ -0,0 +1,336 @@
+//
+//  File: DKHashMap.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2017 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <initializer_list>
+#include "../DKInclude.h"
+#include "DKHashTable.h"
+#include "DKMap.h"
+#include "DKTypeTraits.h"
+
+namespace DKFoundation
+{
+	/**
+	 @brief
+	 hash map class (using DKHashTable internally, see DKHashTable.h).
+	 DKHashMap has same interface as DKMap, but items are not ordered.
+
+	 Insert: insert value if key is not exists.
+	 Update: set value for key whether key is exists or not.
+
+	 To enumerate items:
+	 @code
+	  typedef DKHashMap<Key,Value> MyMap;
+	  MyMap map;
+	  auto enumerator1 = [](const MyMap::Pair& pair) {...}
+	  auto enumerator2 = [](const MyMap::Pair& pair, bool* stop) {...}
+	  map.EnumerateForward(enumerator1);
+	  map.EnumerateForward(enumerator2);	// cancellable by set bool to true.
+	 @endcode
+
+	 @note
+	  Unlike DKMap, pointer of Pair can be invalidated by inserting items.
+
+	 @tparam Key            key type
+	 @tparam ValueT         value type
+	 @tparam KeyHasher      key hash function
+	 @tparam KeyEqual       key equality function
+	 @tparam ValueReplacer  value copy/swap function
+	 @tparam Allocator      memory allocator
+
+	 @see DKHashTable
+	 */
+	template <
+		typename Key,											// key type
+		typename ValueT,										// value type
+		typename KeyHasher = DKHashMapKeyHasher<Key>,			// key hash
+		typename KeyEqual = DKHashMapKeyEqual<Key>,				// key equality
+		typename ValueReplacer = DKMapValueReplacer<ValueT>,	// copy value
+		typename Allocator = DKMemoryDefaultAllocator			// memory allocator
+	>
+	class DKHashMap
+	{
+	public:
+		typedef DKMapPair<const Key, ValueT>	Pair;
+		typedef DKTypeTraits<Key>				KeyTraits;
+		typedef DKTypeTraits<ValueT>			ValueTraits;
+
+		struct PairKey
+		{
+			FORCEINLINE const Key& operator () (const Pair& p) const
+			{
+				return p.key;
+			}
+		};
+		struct PairValueReplacer
+		{
+			void operator () (Pair& dst, const Pair& src) const
+			{
+				replacer(dst.value, src.value);
+			}
+			ValueReplacer replacer;
+		};
+		typedef DKHashTable<Pair, PairKey, KeyHasher, KeyEqual, Allocator> Container;
+		constexpr static size_t SlotSize() { return Container::SlotSize(); }
+
+		DKHashMap()
+		{
+		}
+		DKHashMap(DKHashMap&& m)
+			: container(static_cast<Container&&>(m.container))
+		{
+		}
+		DKHashMap(const DKHashMap& m)
+			: container(m.container)
+		{
+		}
+		DKHashMap(std::initializer_list<Pair> il)
+		{
+			container.Reserve(il.size());
+			for (const Pair& p : il)
+				container.Insert(p);
+		}
+		template <typename K, typename V>
+		DKHashMap(std::initializer_list<K> keys, std::initializer_list<V> values)
+		{
+			DKASSERT_DEBUG(keys.size() == values.size());
+			container.Reserve(keys.size());
+			auto k = keys.begin();
+			auto k_end = keys.end();
+			auto v = values.begin();
+			auto v_end = values.end();
+			while (k != k_end && v != v_end)
+			{
+				Insert(*k, *v);
+				++k; ++v;
+			}
+		}
+		~DKHashMap()
+		{
+			Clear();
+		}
+		/// overwrite value if key is exists, or insert item.
+		void Update(const Pair& p)
+		{
+			container.Update(p, PairValueReplacer());
+		}
+		void Update(Pair&& p)
+		{
+			container.Update(static_cast<Pair&&>(p), PairValueReplacer());
+		}
+		void Update(const Key& k, const ValueT& v)
+		{
+			Update(Pair(k,v));
+		}
+		void Update(const Key& k, ValueT&& v)
+		{
+			Update(Pair(k,static_cast<ValueT&&>(v)));
+		}
+		void Update(const Pair* p, size_t size)
+		{
+			for (size_t i = 0; i < size; i++)
+				Update(p[i]);
+		}
+		template <typename ...Args>
+		void Update(const DKHashMap<Key, ValueT, Args...>& m)
+		{
+			m.EnumerateForward([this](const typename DKHashMap<Key, ValueT, Args...>::Pair& pair)
+			{
+				Update(pair);
+			});
+		}
+		void Update(std::initializer_list<Pair> il)
+		{
+			for (const Pair& p : il)
+				Update(p);
+		}
+		template <typename K, typename V>
+		void Update(std::initializer_list<K> keys, std::initializer_list<V> values)
+		{
+			DKASSERT_DEBUG(keys.size() == values.size());
+
+			auto k = keys.begin();
+			auto k_end = keys.end();
+			auto v = values.begin();
+			auto v_end = values.end();
+
+			while (k != k_end && v != v_end)
+			{
+				Update(*k, *v);
+				++k; ++v;
+			}
+		}
+		/// insert item if key is not exist, fails otherwise.
+		bool Insert(const Pair& p)
+		{
+			return container.Insert(p) != NULL;
+		}
+		bool Insert(Pair&& p)
+		{
+			return container.Insert(static_cast<Pair&&>(p)) != NULL;
+		}
+		bool Insert(const Key& k, const ValueT& v)
+		{
+			return Insert(Pair(k, v));
+		}
+		bool Insert(const Key& k, ValueT&& v)
+		{
+			return Insert(Pair(k, static_cast<ValueT&&>(v)));
+		}
+		template <typename ...Args> size_t Insert(const DKHashMap<Key, ValueT, Args...>& m)
+		{
+			size_t n = 0;
+			m.EnumerateForward([this, &n](const typename DKHashMap<Key, ValueT, Args...>::Pair& pair)
+			{
+				if (container.Insert(pair) != NULL)
+					n++;
+			});
+			return n;
+		}
+		size_t Insert(std::initializer_list<Pair> il)
+		{
+			size_t n = 0;
+			for (const Pair& p : il)
+			{
+				if (container.Insert(p) != NULL)
+					n++;
+			}
+			return n;
+		}
+		template <typename K, typename V>
+		size_t Insert(std::initializer_list<K> keys, std::initializer_list<V> values)
+		{
+			DKASSERT_DEBUG(keys.size() == values.size());
+			size_t n = 0;
+			auto k = keys.begin();
+			auto k_end = keys.end();
+			auto v = values.begin();
+			auto v_end = values.end();
+
+			while (k != k_end && v != v_end)
+			{
+				if (container.Insert(Pair(*k, *v)))
+					n++;
+				++k; ++v;
+			}
+			return n;
+		}
+		void Remove(const Key& k)
+		{
+			container.Remove(k);
+		}
+		void Remove(std::initializer_list<Key> il)
+		{
+			for (const Key& k : il)
+				container.Remove(k);
+		}
+		void Clear()
+		{
+			container.Clear();
+		}
+		/// preallocate space for n items.
+		void Reserve(size_t n)
+		{
+			container.Reserve(n);
+		}
+		Pair* Find(const Key& k)
+		{
+			return const_cast<Pair*>(static_cast<const DKHashMap&>(*this).Find(k));
+		}
+		const Pair* Find(const Key& k) const
+		{
+			return container.Find(k);
+		}
+		/// if key 'k' is not exist, an new value inserted and returns.
+		ValueT& Value(const Key& k)
+		{
+			Pair* p = Find(k);
+			if (p == NULL)
+				p = const_cast<Pair*>(container.Insert(Pair(k, ValueT())));
+			return p->value;
+		}
+		bool IsEmpty() const
+		{
+			return container.Count() == 0;
+		}
+		size_t Count() const
+		{
+			return container.Count();
+		}
+		DKHashMap& operator = (DKHashMap&& m) noexcept
+		{
+			if (this != &m)
+			{
+				container = static_cast<Container&&>(m.container);
+			}
+			return *this;
+		}
+		DKHashMap& operator = (const DKHashMap& m)
+		{
+			if (this != &m)
+			{
+				container = m.container;
+			}
+			return *this;
+		}
+		DKHashMap& operator = (std::initializer_list<Pair> il)
+		{
+			container.Clear();
+			container.Reserve(il.size());
+			for (const Pair& p : il)
+				container.Insert(p);
+			return *this;
+		}
+		/// EnumerateForward: enumerate all items. (order is not specified)
+		/// You cannot insert, remove items while enumerating. (container is read-only)
+		/// enumerator can be lambda or any function type that can receive arguments (VALUE&) or (VALUE&, bool*)
+		/// (VALUE&, bool*) type can cancel iteration by set boolean value to true.
+		template <typename T> void EnumerateForward(T&& enumerator)
+		{
+			using Func = typename DKFunctionType<T>::Signature;
+			enum {ValidatePType1 = Func::template CanInvokeWithParameterTypes<Pair&>()};
+			enum {ValidatePType2 = Func::template CanInvokeWithParameterTypes<Pair&, bool*>()};
+			static_assert(ValidatePType1 || ValidatePType2, "enumerator's parameter is not compatible with (VALUE&) or (VALUE&,bool*)");
+
+			EnumerateForward(std::forward<T>(enumerator), typename Func::ParameterNumber());
+		}
+		/// lambda enumerator (const VALUE&) or (const VALUE&, bool*) function type.
+		template <typename T> void EnumerateForward(T&& enumerator) const
+		{
+			using Func = typename DKFunctionType<T>::Signature;
+			enum {ValidatePType1 = Func::template CanInvokeWithParameterTypes<const Pair&>()};
+			enum {ValidatePType2 = Func::template CanInvokeWithParameterTypes<const Pair&, bool*>()};
+			static_assert(ValidatePType1 || ValidatePType2, "enumerator's parameter is not compatible with (const VALUE&) or (const VALUE&,bool*)");
+
+			EnumerateForward(std::forward<T>(enumerator), typename Func::ParameterNumber());
+		}
+
+	private:
+		// lambda enumerator (VALUE&)
+		template <typename T> void EnumerateForward(T&& enumerator, DKNumber<1>)
+		{
+			container.Enumerate([&enumerator](Pair& val, bool*) {enumerator(val);});
+		}
+		// lambda enumerator (const VALUE&)
+		template <typename T> void EnumerateForward(T&& enumerator, DKNumber<1>) const
+		{
+			container.Enumerate([&enumerator](const Pair& val, bool*) {enumerator(val);});
+		}
+		// lambda enumerator (VALUE&, bool*)
+		template <typename T> void EnumerateForward(T&& enumerator, DKNumber<2>)
+		{
+			container.Enumerate(enumerator);
+		}
+		// lambda enumerator (const VALUE&, bool*)
+		template <typename T> void EnumerateForward(T&& enumerator, DKNumber<2>) const
+		{
+			container.Enumerate(enumerator);
+		}
+
+		Container	container;
+	};
+}
@@ -0,0 +1,183 @@
+//
+//  File: DKHashSet.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2017 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <initializer_list>
+#include "../DKInclude.h"
+#include "DKHashTable.h"
+#include "DKTypeTraits.h"
+
+namespace DKFoundation
+{
+	/// @brief A set container class. using DKHashTable (see DKHashTable.h) internally.
+	/// DKHashSet has same interface as DKSet, but elements are not ordered.
+	///
+	/// @tparam Value		value type
+	/// @tparam Hasher		element hash function
+	/// @tparam KeyEqual	element equality function
+	/// @tparam Allocator	element allocator
+	template <
+		typename Value,
+		typename Hasher = DKHashMapKeyHasher<Value>,
+		typename KeyEqual = DKHashMapKeyEqual<Value>,
+		typename Allocator = DKMemoryDefaultAllocator
+	>
+	class DKHashSet
+	{
+		struct ValueKey
+		{
+			FORCEINLINE const Value& operator () (const Value& v) const
+			{
+				return v;
+			}
+		};
+	public:
+		typedef DKTypeTraits<Value>			ValueTraits;
+		typedef DKHashTable<Value, ValueKey, Hasher, KeyEqual, Allocator>	Container;
+
+		constexpr static size_t SlotSize() { return Container::SlotSize(); }
+
+		DKHashSet()
+		{
+		}
+		DKHashSet(DKHashSet&& s)
+			: container(static_cast<Container&&>(s.container))
+		{
+		}
+		/// copy constructor. same type of DKHashSet object are allowed only.
+		DKHashSet(const DKHashSet& s)
+			: container(s.container)
+		{
+		}
+		DKHashSet(const Value* v, size_t n)
+		{
+			container.Reserve(n);
+			for (size_t i = 0; i < n; ++i)
+				container.Insert(v[i]);
+		}
+		DKHashSet(std::initializer_list<Value> il)
+		{
+			container.Reserve(il.size());
+			for (const Value& v : il)
+				container.Insert(v);
+		}
+		~DKHashSet()
+		{
+		}
+		void Insert(const Value& v)
+		{
+			container.Insert(v);
+		}
+		void Insert(Value&& v)
+		{
+			container.Insert(static_cast<Value&&>(v));
+		}
+		void Insert(const Value* v, size_t n)
+		{
+			for (size_t i = 0; i < n; ++i)
+				container.Insert(v[i]);
+		}
+		void Insert(std::initializer_list<Value> il)
+		{
+			for (const Value& v : il)
+				container.Insert(v);
+		}
+		/// import other set.
+		/// The other set can have different template parameters except Value.
+		template <typename ...Args> DKHashSet& Union(const DKHashSet<Value, Args...>& s)
+		{
+			s.EnumerateForward([this](const Value& val) { container.Insert(val); });
+			return *this;
+		}
+		/// exclude elements in other set (same as DKSet::Intersect)
+		/// The other set can have different template parameters except Value
+		template <typename ...Args> DKHashSet& Intersect(const DKHashSet<Value, Args...>& s)
+		{
+			s.EnumerateForward([this](const Value& val) {this->container.Remove(val);});
+			return *this;
+		}
+		void Remove(const Value& v)
+		{
+			container.Remove(v);
+		}
+		void Remove(std::initializer_list<Value> il)
+		{
+			for (const Value& v : il)
+				container.Remove(v);
+		}
+		void Clear()
+		{
+			container.Clear();
+		}
+		/// preallocate space for n elements.
+		void Reserve(size_t n)
+		{
+			container.Reserve(n);
+		}
+		bool Contains(const Value& v) const
+		{
+			return container.Find(v) != NULL;
+		}
+		bool IsEmpty() const
+		{
+			return container.Count() == 0;
+		}
+		size_t Count() const
+		{
+			return container.Count();
+		}
+		DKHashSet& operator = (DKHashSet&& s)
+		{
+			if (this != &s)
+			{
+				container = static_cast<Container&&>(s.container);
+			}
+			return *this;
+		}
+		DKHashSet& operator = (const DKHashSet& s)
+		{
+			if (this != &s)
+			{
+				container = s.container;
+			}
+			return *this;
+		}
+		DKHashSet& operator = (std::initializer_list<Value> il)
+		{
+			container.Clear();
+			container.Reserve(il.size());
+			for (const Value& v : il)
+				container.Insert(v);
+			return *this;
+		}
+		/// lambda enumerator (const VALUE&) or (const VALUE&, bool*) are allowed.
+		/// enumerating objects are READ-ONLY. values cannot be modified.
+		/// order of elements is not specified.
+		template <typename T> void EnumerateForward(T&& enumerator) const
+		{
+			using Func = typename DKFunctionType<T>::Signature;
+			enum {ValidatePType1 = Func::template CanInvokeWithParameterTypes<const Value&>()};
+			enum {ValidatePType2 = Func::template CanInvokeWithParameterTypes<const Value&, bool*>()};
+			static_assert(ValidatePType1 || ValidatePType2, "enumerator's parameter is not compatible with (const VALUE&) or (const VALUE&,bool*)");
+
+			EnumerateForward(std::forward<T>(enumerator), typename Func::ParameterNumber());
+		}
+	private:
+		// lambda enumerator (const VALUE&)
+		template <typename T> void EnumerateForward(T&& enumerator, DKNumber<1>) const
+		{
+			container.Enumerate([&enumerator](const Value& val, bool*) {enumerator(val);});
+		}
+		// lambda enumerator (const VALUE&, bool*)
+		template <typename T> void EnumerateForward(T&& enumerator, DKNumber<2>) const
+		{
+			container.Enumerate(enumerator);
+		}
+
+		Container container;
+	};
+}
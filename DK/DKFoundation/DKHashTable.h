@@ -0,0 +1,768 @@
+//
+//  File: DKHashTable.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2017 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <new>
+#include <type_traits>
+#include "../DKInclude.h"
+#include "DKTypeTraits.h"
+#include "DKFunction.h"
+#include "DKMemory.h"
+#include "DKEndianness.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DKGL_HASHTABLE_SSE2 1
+#include <emmintrin.h>
+#else
+#define DKGL_HASHTABLE_SSE2 0
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace DKFoundation
+{
+	namespace Private
+	{
+		/// 64bit hash finalizer. (murmur3 fmix64)
+		FORCEINLINE uint64_t DKHashTableMix64(uint64_t k)
+		{
+			k ^= k >> 33;
+			k *= 0xff51afd7ed558ccdULL;
+			k ^= k >> 33;
+			k *= 0xc4ceb9fe1a85ec53ULL;
+			k ^= k >> 33;
+			return k;
+		}
+		FORCEINLINE uint32_t DKHashTableCountTrailingZeros(uint64_t v)
+		{
+			DKASSERT_DEBUG(v != 0);
+#ifdef _MSC_VER
+			unsigned long index;
+#ifdef _WIN64
+			_BitScanForward64(&index, v);
+#else
+			if (_BitScanForward(&index, static_cast<uint32_t>(v)) == 0)
+			{
+				_BitScanForward(&index, static_cast<uint32_t>(v >> 32));
+				index += 32;
+			}
+#endif
+			return index;
+#else
+			return static_cast<uint32_t>(__builtin_ctzll(v));
+#endif
+		}
+
+		/// 64x64 bit multiplication, a,b are replaced with low,high 64 bits of result.
+		FORCEINLINE void DKHashTableMultiply128(uint64_t& a, uint64_t& b)
+		{
+#if defined(__SIZEOF_INT128__)
+			__uint128_t r = static_cast<__uint128_t>(a) * b;
+			a = static_cast<uint64_t>(r);
+			b = static_cast<uint64_t>(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+			a = _umul128(a, b, &b);
+#else
+			uint64_t ha = a >> 32, hb = b >> 32;
+			uint64_t la = static_cast<uint32_t>(a), lb = static_cast<uint32_t>(b);
+			uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+			uint64_t t = rl + (rm0 << 32);
+			uint64_t c = t < rl;
+			uint64_t lo = t + (rm1 << 32);
+			c += lo < t;
+			a = lo;
+			b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+		}
+		FORCEINLINE uint64_t DKHashTableMix128(uint64_t a, uint64_t b)
+		{
+			DKHashTableMultiply128(a, b);
+			return a ^ b;
+		}
+		FORCEINLINE uint64_t DKHashTableRead64(const uint8_t* p)
+		{
+			uint64_t v;
+			memcpy(&v, p, 8);
+			return DKSystemToLittleEndian(v);
+		}
+		FORCEINLINE uint64_t DKHashTableRead32(const uint8_t* p)
+		{
+			uint32_t v;
+			memcpy(&v, p, 4);
+			return DKSystemToLittleEndian(v);
+		}
+		/// secret for DKHashTableHash64, DKHashFast64, DKHashFast128.
+		constexpr uint64_t DKHashTableSecret[4] = {
+			0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+		};
+		/// read (up to) 16 bytes of short message (len <= 16) into a, b.
+		FORCEINLINE void DKHashTableReadShort(const uint8_t* p, size_t len, uint64_t& a, uint64_t& b)
+		{
+			if (len >= 4)
+			{
+				size_t n = (len >> 3) << 2;
+				a = (DKHashTableRead32(p) << 32) | DKHashTableRead32(p + n);
+				b = (DKHashTableRead32(p + len - 4) << 32) | DKHashTableRead32(p + len - 4 - n);
+			}
+			else if (len > 0)
+			{
+				a = (uint64_t(p[0]) << 16) | (uint64_t(p[len >> 1]) << 8) | p[len - 1];
+				b = 0;
+			}
+			else
+			{
+				a = b = 0;
+			}
+		}
+		/// process 48 bytes stripe with 3 lanes.
+		FORCEINLINE void DKHashTableStripe(uint64_t* lanes, const uint8_t* p)
+		{
+			const uint64_t* s = DKHashTableSecret;
+			lanes[0] = DKHashTableMix128(DKHashTableRead64(p) ^ s[1], DKHashTableRead64(p + 8) ^ lanes[0]);
+			lanes[1] = DKHashTableMix128(DKHashTableRead64(p + 16) ^ s[2], DKHashTableRead64(p + 24) ^ lanes[1]);
+			lanes[2] = DKHashTableMix128(DKHashTableRead64(p + 32) ^ s[3], DKHashTableRead64(p + 40) ^ lanes[2]);
+		}
+		/// 64bit hash of byte stream (wyhash algorithm, by Wang Yi)
+		/// values are same on any platform. (reads as little-endian)
+		inline uint64_t DKHashTableHash64(const void* data, size_t len, uint64_t seed)
+		{
+			const uint64_t* s = DKHashTableSecret;
+			const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+			seed ^= DKHashTableMix128(seed ^ s[0], s[1]);
+			uint64_t a, b;
+			if (len <= 16)
+			{
+				DKHashTableReadShort(p, len, a, b);
+			}
+			else
+			{
+				size_t i = len;
+				if (i > 48)
+				{
+					uint64_t lanes[3] = { seed, seed, seed };
+					do {
+						DKHashTableStripe(lanes, p);
+						p += 48;
+						i -= 48;
+					} while (i > 48);
+					seed = lanes[0] ^ lanes[1] ^ lanes[2];
+				}
+				while (i > 16)
+				{
+					seed = DKHashTableMix128(DKHashTableRead64(p) ^ s[1], DKHashTableRead64(p + 8) ^ seed);
+					p += 16;
+					i -= 16;
+				}
+				a = DKHashTableRead64(p + i - 16);
+				b = DKHashTableRead64(p + i - 8);
+			}
+			a ^= s[1];
+			b ^= seed;
+			DKHashTableMultiply128(a, b);
+			return DKHashTableMix128(a ^ s[0] ^ len, b ^ s[1]);
+		}
+	}
+
+	/// @brief hash value of byte stream, for DKHashMap, DKHashSet.
+	/// same as DKHashFast64 with zero seed. (truncated on 32bit platform)
+	FORCEINLINE size_t DKHashTableHashBytes(const void* p, size_t len)
+	{
+		return static_cast<size_t>(Private::DKHashTableHash64(p, len, 0));
+	}
+
+	/// @brief default key hasher for DKHashMap, DKHashSet.
+	/// integer, enum, pointer types are supported.
+	/// specialize this template for other types (see DKString.h)
+	template <typename Key> struct DKHashMapKeyHasher
+	{
+		static_assert(std::is_integral<Key>::value || std::is_enum<Key>::value || std::is_pointer<Key>::value,
+					  "Key type is not hashable. You need to specialize DKHashMapKeyHasher for this type.");
+
+		FORCEINLINE size_t operator () (const Key& k) const
+		{
+			return static_cast<size_t>(Private::DKHashTableMix64(Cast(k, std::is_pointer<Key>())));
+		}
+	private:
+		FORCEINLINE static uint64_t Cast(const Key& k, std::true_type)
+		{
+			return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(k));
+		}
+		FORCEINLINE static uint64_t Cast(const Key& k, std::false_type)
+		{
+			return static_cast<uint64_t>(k);
+		}
+	};
+	template <> struct DKHashMapKeyHasher<float>
+	{
+		FORCEINLINE size_t operator () (float k) const
+		{
+			if (k == 0.0f) k = 0.0f; // -0.0 == 0.0
+			uint32_t v;
+			memcpy(&v, &k, sizeof(v));
+			return static_cast<size_t>(Private::DKHashTableMix64(v));
+		}
+	};
+	template <> struct DKHashMapKeyHasher<double>
+	{
+		FORCEINLINE size_t operator () (double k) const
+		{
+			if (k == 0.0) k = 0.0; // -0.0 == 0.0
+			uint64_t v;
+			memcpy(&v, &k, sizeof(v));
+			return static_cast<size_t>(Private::DKHashTableMix64(v));
+		}
+	};
+
+	/// @brief default key equality for DKHashMap, DKHashSet.
+	template <typename Key> struct DKHashMapKeyEqual
+	{
+		FORCEINLINE bool operator () (const Key& lhs, const Key& rhs) const
+		{
+			return lhs == rhs;
+		}
+	};
+
+	/// @brief
+	///  Open addressing hash table template implementation.
+	///  (used by DKHashMap, DKHashSet)
+	///
+	///  Each slot has one control byte, which has 7bits of hash value
+	///  when slot is occupied. A group of control bytes are probed at once
+	///  with SIMD (SSE2) or 64bit-word operations, key is compared only when
+	///  control byte matched.
+	///
+	/// @note
+	///  Stored value can be moved when table grows.
+	///  Do not save pointer of value while inserting items.
+	///
+	/// @note
+	///  This class is not thread-safe. You need to use synchronization object
+	///  to serialize of access in multi-threaded environment.
+	///
+	/// @tparam Value      element type
+	/// @tparam KeyOfValue functor to extract key from element
+	/// @tparam Hasher     key hash function (returns size_t)
+	/// @tparam KeyEqual   key equality function
+	/// @tparam Allocator  memory allocator
+	template <
+		typename Value,
+		typename KeyOfValue,
+		typename Hasher,
+		typename KeyEqual,
+		typename Allocator = DKMemoryDefaultAllocator
+	>
+	class DKHashTable
+	{
+		using Ctrl = int8_t;
+		enum : Ctrl
+		{
+			CtrlEmpty = -128,	// 0b10000000
+			CtrlDeleted = -2,	// 0b11111110
+		};
+
+#if DKGL_HASHTABLE_SSE2
+		using BitMaskType = uint32_t;
+		enum { GroupWidth = 16, BitMaskShift = 0 };
+#else
+		using BitMaskType = uint64_t;
+		enum { GroupWidth = 8, BitMaskShift = 3 };
+#endif
+		/// bit mask of matched slots in group.
+		struct BitMask
+		{
+			BitMaskType mask;
+			FORCEINLINE explicit operator bool () const { return mask != 0; }
+			FORCEINLINE uint32_t LowestBitIndex() const
+			{
+				return Private::DKHashTableCountTrailingZeros(mask) >> BitMaskShift;
+			}
+			FORCEINLINE void RemoveLowestBit() { mask &= (mask - 1); }
+		};
+		/// a group of control bytes.
+		struct Group
+		{
+#if DKGL_HASHTABLE_SSE2
+			__m128i ctrl;
+			FORCEINLINE explicit Group(const Ctrl* p)
+				: ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) {}
+			FORCEINLINE BitMask Match(Ctrl h2) const
+			{
+				return BitMask{ static_cast<BitMaskType>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl))) };
+			}
+			FORCEINLINE BitMask MatchEmpty() const
+			{
+				return Match(static_cast<Ctrl>(CtrlEmpty));
+			}
+			FORCEINLINE BitMask MatchEmptyOrDeleted() const
+			{
+				// empty, deleted are negative.
+				return BitMask{ static_cast<BitMaskType>(_mm_movemask_epi8(ctrl)) };
+			}
+			FORCEINLINE BitMask MatchFull() const
+			{
+				return BitMask{ static_cast<BitMaskType>(_mm_movemask_epi8(ctrl)) ^ 0xffffU };
+			}
+#else
+			enum : uint64_t
+			{
+				LSBs = 0x0101010101010101ULL,
+				MSBs = 0x8080808080808080ULL,
+			};
+			uint64_t ctrl;
+			FORCEINLINE explicit Group(const Ctrl* p)
+			{
+				memcpy(&ctrl, p, sizeof(ctrl));
+				ctrl = DKLittleEndianToSystem(ctrl);
+			}
+			FORCEINLINE BitMask Match(Ctrl h2) const
+			{
+				// can have false positive, key comparison will filter it.
+				uint64_t x = ctrl ^ (LSBs * static_cast<uint8_t>(h2));
+				return BitMask{ (x - LSBs) & ~x & MSBs };
+			}
+			FORCEINLINE BitMask MatchEmpty() const
+			{
+				return BitMask{ (ctrl & (~ctrl << 6)) & MSBs };
+			}
+			FORCEINLINE BitMask MatchEmptyOrDeleted() const
+			{
+				return BitMask{ (ctrl & (~ctrl << 7)) & MSBs };
+			}
+			FORCEINLINE BitMask MatchFull() const
+			{
+				return BitMask{ (ctrl & MSBs) ^ MSBs };
+			}
+#endif
+		};
+
+	public:
+		typedef DKTypeTraits<Value> ValueTraits;
+
+		Hasher hasher;
+		KeyEqual keyEqual;
+
+		DKHashTable()
+			: ctrl(NULL), slots(NULL), capacity(0), count(0), growthLeft(0)
+		{
+		}
+		DKHashTable(DKHashTable&& t)
+			: hasher(static_cast<Hasher&&>(t.hasher))
+			, keyEqual(static_cast<KeyEqual&&>(t.keyEqual))
+			, ctrl(t.ctrl), slots(t.slots), capacity(t.capacity), count(t.count), growthLeft(t.growthLeft)
+		{
+			t.ctrl = NULL;
+			t.slots = NULL;
+			t.capacity = 0;
+			t.count = 0;
+			t.growthLeft = 0;
+		}
+		DKHashTable(const DKHashTable& t)
+			: hasher(t.hasher), keyEqual(t.keyEqual)
+			, ctrl(NULL), slots(NULL), capacity(0), count(0), growthLeft(0)
+		{
+			CopyFrom(t);
+		}
+		~DKHashTable()
+		{
+			Clear();
+		}
+
+		/// insert value if key is not exists.
+		/// returns NULL if key is already exists.
+		FORCEINLINE const Value* Insert(const Value& v)
+		{
+			bool inserted;
+			size_t index = FindOrPrepareInsert(KeyOfValue()(v), &inserted);
+			if (inserted)
+				return new(&slots[index]) Value(v);
+			return NULL;
+		}
+		FORCEINLINE const Value* Insert(Value&& v)
+		{
+			bool inserted;
+			size_t index = FindOrPrepareInsert(KeyOfValue()(v), &inserted);
+			if (inserted)
+				return new(&slots[index]) Value(static_cast<Value&&>(v));
+			return NULL;
+		}
+		/// insert value or replace exist value with Replacer.
+		template <typename Replacer>
+		FORCEINLINE const Value* Update(const Value& v, Replacer&& replacer)
+		{
+			bool inserted;
+			size_t index = FindOrPrepareInsert(KeyOfValue()(v), &inserted);
+			if (inserted)
+				return new(&slots[index]) Value(v);
+			replacer(slots[index], v);
+			return &slots[index];
+		}
+		template <typename Replacer>
+		FORCEINLINE const Value* Update(Value&& v, Replacer&& replacer)
+		{
+			bool inserted;
+			size_t index = FindOrPrepareInsert(KeyOfValue()(v), &inserted);
+			if (inserted)
+				return new(&slots[index]) Value(static_cast<Value&&>(v));
+			replacer(slots[index], static_cast<Value&&>(v));
+			return &slots[index];
+		}
+		template <typename Key>
+		FORCEINLINE const Value* Find(const Key& k) const
+		{
+			size_t index = FindIndex(k);
+			if (index != NotFound)
+				return &slots[index];
+			return NULL;
+		}
+		/// remove item, returns true if item was removed.
+		template <typename Key>
+		FORCEINLINE bool Remove(const Key& k)
+		{
+			size_t index = FindIndex(k);
+			if (index != NotFound)
+			{
+				EraseAt(index);
+				return true;
+			}
+			return false;
+		}
+		void Clear()
+		{
+			if (capacity > 0)
+			{
+				if (!std::is_trivially_destructible<Value>::value)
+				{
+					EnumerateIndex([this](size_t i)
+					{
+						slots[i].~Value();
+					});
+				}
+				Allocator::Free(ctrl);
+				ctrl = NULL;
+				slots = NULL;
+				capacity = 0;
+				count = 0;
+				growthLeft = 0;
+			}
+		}
+		/// reserve space for n items.
+		void Reserve(size_t n)
+		{
+			if (n > count + growthLeft)
+				Resize(CapacityForCount(n));
+		}
+		FORCEINLINE size_t Count() const
+		{
+			return count;
+		}
+		FORCEINLINE size_t Capacity() const
+		{
+			return capacity;
+		}
+		DKHashTable& operator = (DKHashTable&& t)
+		{
+			if (this != &t)
+			{
+				Clear();
+				hasher = static_cast<Hasher&&>(t.hasher);
+				keyEqual = static_cast<KeyEqual&&>(t.keyEqual);
+				ctrl = t.ctrl;
+				slots = t.slots;
+				capacity = t.capacity;
+				count = t.count;
+				growthLeft = t.growthLeft;
+				t.ctrl = NULL;
+				t.slots = NULL;
+				t.capacity = 0;
+				t.count = 0;
+				t.growthLeft = 0;
+			}
+			return *this;
+		}
+		DKHashTable& operator = (const DKHashTable& t)
+		{
+			if (this != &t)
+			{
+				Clear();
+				hasher = t.hasher;
+				keyEqual = t.keyEqual;
+				CopyFrom(t);
+			}
+			return *this;
+		}
+		/// enumerate all items. (order is not specified)
+		/// enumerator type: (Value&, bool*), set bool to true to stop.
+		template <typename T> void Enumerate(T&& enumerator)
+		{
+			bool stop = false;
+			EnumerateIndex([&](size_t i) -> bool
+			{
+				enumerator(slots[i], &stop);
+				return stop;
+			});
+		}
+		template <typename T> void Enumerate(T&& enumerator) const
+		{
+			bool stop = false;
+			EnumerateIndex([&](size_t i) -> bool
+			{
+				enumerator(const_cast<const Value&>(slots[i]), &stop);
+				return stop;
+			});
+		}
+		constexpr static size_t SlotSize() { return sizeof(Value) + 1; }
+
+	private:
+		enum : size_t { NotFound = ~size_t(0) };
+
+		FORCEINLINE static size_t H1(size_t hash) { return hash >> 7; }
+		FORCEINLINE static Ctrl H2(size_t hash) { return static_cast<Ctrl>(hash & 0x7f); }
+
+		// Slots are probed by group, with triangular sequence of groups.
+		// It visits every group once, because capacity is power of two.
+		struct ProbeSequence
+		{
+			size_t mask;
+			size_t offset;
+			size_t index;
+			FORCEINLINE ProbeSequence(size_t hash, size_t m) : mask(m), offset(H1(hash) & m), index(0) {}
+			FORCEINLINE size_t Offset(size_t i) const { return (offset + i) & mask; }
+			FORCEINLINE void Next()
+			{
+				index += GroupWidth;
+				offset = (offset + index) & mask;
+			}
+		};
+
+		template <typename Key>
+		FORCEINLINE size_t FindIndex(const Key& k) const
+		{
+			if (count == 0)
+				return NotFound;
+
+			size_t hash = hasher(k);
+			Ctrl h2 = H2(hash);
+			ProbeSequence seq(hash, capacity - 1);
+			while (true)
+			{
+				Group g(ctrl + seq.offset);
+				for (BitMask m = g.Match(h2); m; m.RemoveLowestBit())
+				{
+					size_t i = seq.Offset(m.LowestBitIndex());
+					if (keyEqual(KeyOfValue()(slots[i]), k))
+						return i;
+				}
+				if (g.MatchEmpty())
+					return NotFound;
+				seq.Next();
+				DKASSERT_DEBUG(seq.index < capacity);
+			}
+		}
+		template <typename Key>
+		FORCEINLINE size_t FindOrPrepareInsert(const Key& k, bool* inserted)
+		{
+			size_t hash = hasher(k);
+			if (count > 0)
+			{
+				Ctrl h2 = H2(hash);
+				ProbeSequence seq(hash, capacity - 1);
+				while (true)
+				{
+					Group g(ctrl + seq.offset);
+					for (BitMask m = g.Match(h2); m; m.RemoveLowestBit())
+					{
+						size_t i = seq.Offset(m.LowestBitIndex());
+						if (keyEqual(KeyOfValue()(slots[i]), k))
+						{
+							*inserted = false;
+							return i;
+						}
+					}
+					if (g.MatchEmpty())
+						break;
+					seq.Next();
+					DKASSERT_DEBUG(seq.index < capacity);
+				}
+			}
+			*inserted = true;
+			return PrepareInsert(hash);
+		}
+		// find first non-full slot for hash, and mark it full.
+		FORCEINLINE size_t FindFirstNonFull(size_t hash) const
+		{
+			ProbeSequence seq(hash, capacity - 1);
+			while (true)
+			{
+				BitMask m = Group(ctrl + seq.offset).MatchEmptyOrDeleted();
+				if (m)
+					return seq.Offset(m.LowestBitIndex());
+				seq.Next();
+				DKASSERT_DEBUG(seq.index < capacity);
+			}
+		}
+		size_t PrepareInsert(size_t hash)
+		{
+			if (capacity == 0)
+				Resize(GroupWidth);
+			size_t index = FindFirstNonFull(hash);
+			if (growthLeft == 0 && ctrl[index] != CtrlDeleted)
+			{
+				RehashAndGrow();
+				index = FindFirstNonFull(hash);
+			}
+			if (ctrl[index] == CtrlEmpty)
+				growthLeft--;
+			count++;
+			SetCtrl(index, H2(hash));
+			return index;
+		}
+		FORCEINLINE void SetCtrl(size_t i, Ctrl c)
+		{
+			ctrl[i] = c;
+			// clone first group at end of array. (for group loading without wrap)
+			if (i < GroupWidth)
+				ctrl[capacity + i] = c;
+		}
+		FORCEINLINE void EraseAt(size_t index)
+		{
+			DKASSERT_DEBUG(ctrl[index] >= 0);
+			slots[index].~Value();
+			count--;
+			// Slot can be empty if probing for other items has never stopped
+			// at this position. (no full group window includes this slot)
+			size_t before = (index - GroupWidth) & (capacity - 1);
+			BitMask emptyAfter = Group(ctrl + index).MatchEmpty();
+			BitMask emptyBefore = Group(ctrl + before).MatchEmpty();
+			if (emptyAfter && emptyBefore &&
+				(TrailingSlots(emptyAfter) + LeadingSlots(emptyBefore)) < GroupWidth)
+			{
+				SetCtrl(index, CtrlEmpty);
+				growthLeft++;
+			}
+			else
+			{
+				SetCtrl(index, CtrlDeleted);
+			}
+		}
+		FORCEINLINE static size_t TrailingSlots(BitMask m)
+		{
+			return m.LowestBitIndex();
+		}
+		FORCEINLINE static size_t LeadingSlots(BitMask m)
+		{
+			size_t n = 0;
+			for (BitMaskType b = m.mask; b; b &= (b - 1))
+				n = (Private::DKHashTableCountTrailingZeros(b) >> BitMaskShift);
+			return GroupWidth - 1 - n;
+		}
+		FORCEINLINE static size_t MaxCountForCapacity(size_t cap)
+		{
+			// max load factor: 7/8
+			return cap - cap / 8;
+		}
+		static size_t CapacityForCount(size_t n)
+		{
+			size_t cap = GroupWidth;
+			while (MaxCountForCapacity(cap) < n)
+				cap = cap * 2;
+			return cap;
+		}
+		void RehashAndGrow()
+		{
+			if (count * 32 <= capacity * 25)
+				Resize(capacity);	// too many tombstones, rehash in place.
+			else
+				Resize(capacity * 2);
+		}
+		void Resize(size_t newCapacity)
+		{
+			DKASSERT_DEBUG((newCapacity & (newCapacity - 1)) == 0);
+			DKASSERT_DEBUG(newCapacity >= GroupWidth);
+			DKASSERT_DEBUG(MaxCountForCapacity(newCapacity) >= count);
+
+			Ctrl* oldCtrl = ctrl;
+			Value* oldSlots = slots;
+			size_t oldCapacity = capacity;
+
+			size_t ctrlBytes = SlotOffset(newCapacity);
+			void* p = Allocator::Alloc(ctrlBytes + sizeof(Value) * newCapacity);
+			DKASSERT_DESC(p, "Out of memory!");
+			ctrl = reinterpret_cast<Ctrl*>(p);
+			slots = reinterpret_cast<Value*>(reinterpret_cast<uint8_t*>(p) + ctrlBytes);
+			capacity = newCapacity;
+			memset(ctrl, static_cast<uint8_t>(CtrlEmpty), newCapacity + GroupWidth);
+			growthLeft = MaxCountForCapacity(newCapacity) - count;
+
+			for (size_t i = 0; i < oldCapacity; ++i)
+			{
+				if (oldCtrl[i] >= 0)
+				{
+					size_t hash = hasher(KeyOfValue()(oldSlots[i]));
+					size_t index = FindFirstNonFull(hash);
+					SetCtrl(index, H2(hash));
+					new(&slots[index]) Value(static_cast<Value&&>(oldSlots[i]));
+					oldSlots[i].~Value();
+				}
+			}
+			if (oldCtrl)
+				Allocator::Free(oldCtrl);
+		}
+		void CopyFrom(const DKHashTable& t)
+		{
+			DKASSERT_DEBUG(capacity == 0);
+			if (t.count > 0)
+			{
+				Resize(CapacityForCount(t.count));
+				t.EnumerateIndex([&](size_t i)
+				{
+					size_t hash = hasher(KeyOfValue()(t.slots[i]));
+					size_t index = FindFirstNonFull(hash);
+					SetCtrl(index, H2(hash));
+					new(&slots[index]) Value(t.slots[i]);
+				});
+				count = t.count;
+				growthLeft -= t.count;
+			}
+		}
+		// enumerate index of occupied slots.
+		// function can return bool, stop enumerating if returns true.
+		template <typename T> void EnumerateIndex(T&& fn) const
+		{
+			for (size_t i = 0; i < capacity; i += GroupWidth)
+			{
+				for (BitMask m = Group(ctrl + i).MatchFull(); m; m.RemoveLowestBit())
+				{
+					if (InvokeIndex(fn, i + m.LowestBitIndex()))
+						return;
+				}
+			}
+		}
+		template <typename T> FORCEINLINE static auto InvokeIndex(T& fn, size_t i)
+			-> typename std::enable_if<std::is_same<decltype(fn(i)), bool>::value, bool>::type
+		{
+			return fn(i);
+		}
+		template <typename T> FORCEINLINE static auto InvokeIndex(T& fn, size_t i)
+			-> typename std::enable_if<!std::is_same<decltype(fn(i)), bool>::value, bool>::type
+		{
+			fn(i);
+			return false;
+		}
+		constexpr static size_t SlotOffset(size_t cap)
+		{
+			return (cap + GroupWidth + alignof(Value) - 1) & ~(alignof(Value) - 1);
+		}
+
+		Ctrl*	ctrl;		// capacity + GroupWidth (cloned) bytes
+		Value*	slots;
+		size_t	capacity;	// power of two
+		size_t	count;
+		size_t	growthLeft;	// number of items can be inserted without rehash
+	};
+}
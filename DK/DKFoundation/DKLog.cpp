@@ -16,6 +16,7 @@
 #include <stdlib.h>
 #include <wchar.h>
 #include <errno.h>
+#include <stdarg.h>
 
 #include "DKLog.h"
 #include "DKString.h"
@@ -23,11 +24,20 @@
 
 namespace DKFoundation
 {
+	namespace Private
+	{
+		// asynchronous logging (DKLogger.cpp)
+		bool LogPostAsync(DKLogCategory, const DKString&);
+		bool LogPostAsyncV(DKLogCategory, const char*, va_list);
+	}
+
 	DKGL_API void DKLog(DKLogCategory c, const DKString& str)
 	{
 #ifndef DKGL_DEBUG_ENABLED
 		if (c == DKLogCategory::Debug) return;
 #endif
+		if (Private::LogPostAsync(c, str))
+			return;
 		if (!DKLogger::Broadcast(c, str))
 			fprintf(stderr, "%ls", (const wchar_t*)str);
 	}
@@ -37,6 +47,12 @@ namespace DKFoundation
 		if (c == DKLogCategory::Debug) return;
 #endif
 		va_list ap;
+		va_start(ap, fmt);
+		bool posted = Private::LogPostAsyncV(c, fmt, ap);
+		va_end(ap);
+		if (posted)
+			return;
+
 		va_start(ap, fmt);
 		DKLog(c, DKString::FormatV(fmt, ap));
 		va_end(ap);
@@ -5,9 +5,21 @@
 //  Copyright (c) 2004-2017 Hongtae Kim. All rights reserved.
 //
 
+#include <stdio.h>
+#include <string.h>
+#include <new>
+#include <algorithm>
 #include "DKLog.h"
 #include "DKLogger.h"
 #include "DKSpinLock.h"
+#include "DKMutex.h"
+#include "DKCondition.h"
+#include "DKThread.h"
+#include "DKTimer.h"
+#include "DKFunction.h"
+#include "DKMemory.h"
+#include "DKAtomicNumber32.h"
+#include "DKAtomicNumber64.h"
 
 namespace DKFoundation
 {
@@ -23,6 +35,376 @@ namespace DKFoundation
 			static DKArray<DKObject<DKLogger>> loggers;
 			return loggers;
 		}
+
+		// Asynchronous logging.
+		// Each thread owns single-producer ring buffer, drain thread is
+		// the only consumer. Producer never takes a lock except ring
+		// creation, and it wakes drain thread only if it is sleeping.
+		struct LogRecord	// record header, followed by UTF-8 text.
+		{
+			DKTimer::Tick timestamp;
+			uint32_t size;		// record size including header (aligned)
+			uint16_t length;	// text length
+			uint8_t category;	// zero for padding record
+			uint8_t reserved;
+		};
+		static_assert(sizeof(LogRecord) == 16, "LogRecord size must be 16");
+
+		enum : size_t
+		{
+			LogRecordAlignment = sizeof(LogRecord),
+			LogRecordMaxLength = 4096,
+			LogRingMinSize = 0x4000,
+		};
+
+		FORCEINLINE size_t LogRecordAlign(size_t s)
+		{
+			return (s + LogRecordAlignment - 1) & ~(LogRecordAlignment - 1);
+		}
+
+		struct LogRing
+		{
+			DKThread::ThreadId threadId;
+			uint8_t* buffer;
+			size_t capacity;			// power of two
+			DKAtomicNumber64 head;		// written by owner thread only
+			DKAtomicNumber64 tail;		// written by drain thread only
+			uint64_t cachedTail;		// owner thread only
+			DKAtomicNumber32 abandoned;	// owner thread has been terminated
+			LogRing* next;
+		};
+
+		struct AsyncLogger
+		{
+			DKAtomicNumber32 enabled;
+			DKAtomicNumber32 posting;	// threads passed enabled check
+			DKAtomicNumber32 drainSleeping;
+			DKAtomicNumber64 dropped;
+			size_t ringSize = 0x10000;
+
+			DKSpinLock ringLock;
+			LogRing* rings = NULL;
+
+			DKMutex controlLock;	// enable, disable
+			DKMutex drainLock;
+			DKCondition cond;
+			bool terminate = false;
+			DKObject<DKThread> thread;
+
+			struct Entry
+			{
+				DKTimer::Tick timestamp;
+				DKThread::ThreadId threadId;
+				const LogRecord* record;
+			};
+			DKArray<Entry> entries;
+			DKArray<LogRing*> drainRings;
+			DKArray<uint64_t> drainHeads;
+
+			AsyncLogger()
+			{
+				// construct logger list before this, so that it can be
+				// destroyed after records are drained at exit.
+				LoggerLock();
+				LoggerArray();
+			}
+			~AsyncLogger()
+			{
+				// Rings are not released, because detached threads can be
+				// still alive while static objects are being destroyed.
+				enabled = 0;
+				Stop();
+				Drain();
+			}
+
+			LogRing* CreateRing()
+			{
+				size_t capacity = ringSize;
+				size_t headerSize = LogRecordAlign(sizeof(LogRing));
+				void* p = DKMemoryHeapAlloc(headerSize + capacity);
+				if (p == NULL)
+					return NULL;
+
+				LogRing* ring = new(p) LogRing();
+				ring->threadId = DKThread::CurrentThreadId();
+				ring->buffer = reinterpret_cast<uint8_t*>(p) + headerSize;
+				ring->capacity = capacity;
+				ring->cachedTail = 0;
+
+				DKCriticalSection<DKSpinLock> guard(ringLock);
+				ring->next = rings;
+				rings = ring;
+				return ring;
+			}
+			static void DestroyRing(LogRing* ring)
+			{
+				ring->~LogRing();
+				DKMemoryHeapFree(ring);
+			}
+
+			bool Post(LogRing* ring, DKLogCategory c, DKTimer::Tick timestamp, const char* text, size_t length)
+			{
+				DKASSERT_DEBUG(length <= LogRecordMaxLength);
+
+				const size_t recordSize = LogRecordAlign(sizeof(LogRecord) + length);
+				uint64_t head = static_cast<uint64_t>(static_cast<DKAtomicNumber64::Value>(ring->head));
+				size_t offset = static_cast<size_t>(head & (ring->capacity - 1));
+				size_t contiguous = ring->capacity - offset;
+				size_t required = recordSize;
+				if (contiguous < recordSize)
+					required += contiguous;	// skip remaining space with padding
+
+				if (head + required - ring->cachedTail > ring->capacity)
+				{
+					ring->cachedTail = static_cast<uint64_t>(ring->tail.Add(0));
+					if (head + required - ring->cachedTail > ring->capacity)
+					{
+						dropped.Increment();
+						return false;
+					}
+				}
+				if (contiguous < recordSize)
+				{
+					LogRecord* padding = reinterpret_cast<LogRecord*>(&ring->buffer[offset]);
+					padding->size = static_cast<uint32_t>(contiguous);
+					padding->length = 0;
+					padding->category = 0;
+					head += contiguous;
+					offset = 0;
+				}
+				LogRecord* record = reinterpret_cast<LogRecord*>(&ring->buffer[offset]);
+				record->timestamp = timestamp;
+				record->size = static_cast<uint32_t>(recordSize);
+				record->length = static_cast<uint16_t>(length);
+				record->category = static_cast<uint8_t>(c);
+				memcpy(&record[1], text, length);
+
+				// publish record.
+				ring->head.Exchange(static_cast<DKAtomicNumber64::Value>(head + recordSize));
+
+				if (drainSleeping.CompareAndSet(1, 0))
+				{
+					cond.Lock();
+					cond.Signal();
+					cond.Unlock();
+				}
+				return true;
+			}
+
+			bool HasPendingRecords()
+			{
+				DKCriticalSection<DKSpinLock> guard(ringLock);
+				for (LogRing* ring = rings; ring; ring = ring->next)
+				{
+					if (ring->head.Add(0) != ring->tail)
+						return true;
+				}
+				return false;
+			}
+
+			/// broadcast all published records. returns number of records.
+			size_t Drain()
+			{
+				DKCriticalSection<DKMutex> guard(drainLock);
+
+				drainRings.Clear();
+				drainHeads.Clear();
+				entries.Clear();
+
+				ringLock.Lock();
+				for (LogRing* ring = rings; ring; ring = ring->next)
+					drainRings.Add(ring);
+				ringLock.Unlock();
+
+				for (LogRing* ring : drainRings)
+				{
+					uint64_t head = static_cast<uint64_t>(ring->head.Add(0));
+					uint64_t tail = static_cast<uint64_t>(static_cast<DKAtomicNumber64::Value>(ring->tail));
+					while (tail < head)
+					{
+						const LogRecord* record = reinterpret_cast<const LogRecord*>(&ring->buffer[tail & (ring->capacity - 1)]);
+						if (record->category)
+							entries.Add({ record->timestamp, ring->threadId, record });
+						tail += record->size;
+					}
+					drainHeads.Add(head);
+				}
+
+				if (entries.Count() > 0)
+				{
+					// records of each thread are already ordered.
+					std::stable_sort((Entry*)entries, (Entry*)entries + entries.Count(), [](const Entry& a, const Entry& b)
+					{
+						return a.timestamp < b.timestamp;
+					});
+					for (const Entry& e : entries)
+					{
+						DKLogCategory c = static_cast<DKLogCategory>(e.record->category);
+						DKString str(reinterpret_cast<const DKUniChar8*>(&e.record[1]), e.record->length);
+						if (!DKLogger::Broadcast(c, str))
+							fprintf(stderr, "%ls", (const wchar_t*)str);
+					}
+				}
+
+				for (size_t i = 0; i < drainRings.Count(); ++i)
+					drainRings.Value(i)->tail.Exchange(static_cast<DKAtomicNumber64::Value>(drainHeads.Value(i)));
+
+				// release rings of terminated threads.
+				LogRing* unused = NULL;
+				ringLock.Lock();
+				for (LogRing** p = &rings; *p; )
+				{
+					LogRing* ring = *p;
+					if (ring->abandoned && ring->head.Add(0) == ring->tail)
+					{
+						*p = ring->next;
+						ring->next = unused;
+						unused = ring;
+					}
+					else
+						p = &ring->next;
+				}
+				ringLock.Unlock();
+				while (unused)
+				{
+					LogRing* ring = unused;
+					unused = ring->next;
+					DestroyRing(ring);
+				}
+				return entries.Count();
+			}
+
+			void DrainProc()
+			{
+				while (true)
+				{
+					if (Drain() > 0)
+						continue;
+
+					cond.Lock();
+					if (terminate)
+					{
+						cond.Unlock();
+						break;
+					}
+					drainSleeping.Exchange(1);
+					if (!HasPendingRecords())
+						cond.WaitTimeout(0.1);
+					drainSleeping.Exchange(0);
+					cond.Unlock();
+				}
+				Drain();
+			}
+
+			void Start()
+			{
+				if (thread == NULL)
+				{
+					terminate = false;
+					thread = DKThread::Create(DKFunction(this, &AsyncLogger::DrainProc)->Invocation());
+				}
+			}
+			void Stop()
+			{
+				if (thread)
+				{
+					cond.Lock();
+					terminate = true;
+					cond.Signal();
+					cond.Unlock();
+					thread->WaitTerminate();
+					thread = NULL;
+				}
+			}
+		};
+
+		static AsyncLogger& AsyncLoggerInstance()
+		{
+			static AsyncLogger logger;
+			return logger;
+		}
+
+		// ring buffer of current thread, marked as abandoned when thread exits.
+		// records posted from thread_local destructors after cleanup are
+		// logged synchronously, to not leave new ring which never released.
+		static thread_local LogRing* threadLogRing = NULL;
+		static thread_local bool threadLogRingCleanedUp = false;
+		struct LogRingCleanup
+		{
+			~LogRingCleanup()
+			{
+				if (threadLogRing)
+				{
+					threadLogRing->abandoned = 1;
+					threadLogRing = NULL;
+				}
+				threadLogRingCleanedUp = true;
+			}
+		};
+		static thread_local LogRingCleanup logRingCleanup;
+
+		static bool LogPostAsync(DKLogCategory c, DKTimer::Tick timestamp, const char* text, size_t length)
+		{
+			AsyncLogger& logger = AsyncLoggerInstance();
+			LogRing* ring = threadLogRing;
+			if (ring == NULL)
+			{
+				if (threadLogRingCleanedUp)
+					return false;
+				(void)&logRingCleanup; // register cleanup for this thread.
+				ring = logger.CreateRing();
+				if (ring == NULL)
+				{
+					logger.dropped.Increment();
+					return true;
+				}
+				threadLogRing = ring;
+			}
+			logger.Post(ring, c, timestamp, text, length);
+			return true;
+		}
+
+		// counts producers between enabled check and end of posting,
+		// DisableAsynchronous waits for them before final drain.
+		struct LogPostingScope
+		{
+			AsyncLogger& logger;
+			LogPostingScope(AsyncLogger& l) : logger(l) { logger.posting.Increment(); }
+			~LogPostingScope() { logger.posting.Decrement(); }
+			bool IsEnabled() const { return logger.enabled != 0; }
+		};
+
+		bool LogPostAsync(DKLogCategory c, const DKString& str)
+		{
+			LogPostingScope scope(AsyncLoggerInstance());
+			if (!scope.IsEnabled())
+				return false;
+
+			DKTimer::Tick timestamp = DKTimer::SystemTick();
+			DKStringU8 text(str);
+			const char* p = (const char*)text;
+			size_t length = text.Bytes();
+			if (length > LogRecordMaxLength)
+			{
+				// cut off incomplete UTF-8 sequence.
+				length = LogRecordMaxLength;
+				while (length > 0 && (static_cast<unsigned char>(p[length]) & 0xc0) == 0x80)
+					length--;
+			}
+			return LogPostAsync(c, timestamp, p, length);
+		}
+
+		bool LogPostAsyncV(DKLogCategory c, const char* fmt, va_list v)
+		{
+			LogPostingScope scope(AsyncLoggerInstance());
+			if (!scope.IsEnabled())
+				return false;
+
+			DKTimer::Tick timestamp = DKTimer::SystemTick();
+			DKUniChar8 text[LogRecordMaxLength + 1];
+			size_t length = DKStringFormatV(text, sizeof(text), fmt, v);
+			return LogPostAsync(c, timestamp, text, length);
+		}
 	}
 }
 
@@ -99,6 +481,49 @@ size_t DKLogger::Broadcast(Category c, const DKString& str)
 	return num;
 }
 
+void DKLogger::EnableAsynchronous(size_t bufferSize)
+{
+	AsyncLogger& logger = AsyncLoggerInstance();
+	DKCriticalSection<DKMutex> guard(logger.controlLock);
+
+	size_t ringSize = LogRingMinSize;
+	while (ringSize < bufferSize)
+		ringSize = ringSize << 1;
+
+	logger.ringSize = ringSize;	// applied to rings created after.
+	logger.Start();
+	logger.enabled = 1;
+}
+
+void DKLogger::DisableAsynchronous()
+{
+	AsyncLogger& logger = AsyncLoggerInstance();
+	DKCriticalSection<DKMutex> guard(logger.controlLock);
+
+	logger.enabled = 0;
+	// wait for producers which passed enabled check, not to leave their
+	// records in rings after final drain.
+	while (logger.posting != 0)
+		DKThread::Yield();
+	logger.Stop();
+	logger.Drain();
+}
+
+bool DKLogger::IsAsynchronous()
+{
+	return AsyncLoggerInstance().enabled != 0;
+}
+
+void DKLogger::Flush()
+{
+	AsyncLoggerInstance().Drain();
+}
+
+uint64_t DKLogger::DroppedRecords()
+{
+	return static_cast<uint64_t>(static_cast<DKAtomicNumber64::Value>(AsyncLoggerInstance().dropped));
+}
+
 DKObject<DKLogger> DKLogger::CreateSimpleLogger(void (*fn)(Category, const DKString&))
 {
 	struct Logger : public DKLogger
@@ -33,6 +33,23 @@ namespace DKFoundation
 
 		static size_t Broadcast(Category, const DKString&);
 
+		/// Asynchronous logging.
+		/// DKLog() pushes compact records (category, timestamp, UTF-8 text)
+		/// into lock-free ring buffer of calling thread, and background thread
+		/// drains buffers and broadcasts records in timestamp order.
+		/// A record is dropped if ring buffer is full, and record text longer
+		/// than 4KB will be truncated.
+		/// @param bufferSize size of ring buffer for each thread. (bytes)
+		static void EnableAsynchronous(size_t bufferSize = 0x10000);
+		/// stop background thread and broadcast pending records.
+		static void DisableAsynchronous();
+		static bool IsAsynchronous();
+		/// broadcast pending records on calling thread synchronously.
+		/// can be used in crash handler.
+		static void Flush();
+		/// number of records dropped because ring buffer was full.
+		static uint64_t DroppedRecords();
+
 		static DKObject<DKLogger> CreateSimpleLogger(void(*)(Category, const DKString&));
 	protected:
 		virtual void OnBind() {}
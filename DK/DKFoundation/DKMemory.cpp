@@ -29,6 +29,7 @@
 #include "DKMap.h"
 #include "DKMemory.h"
 #include "DKSpinLock.h"
+#include "DKAtomicNumber64.h"
 #include "DKDummyLock.h"
 #include "DKCriticalSection.h"
 #include "DKLog.h"
@@ -292,6 +293,7 @@ namespace DKFoundation
 		{
 			virtual ~AllocatorInterface() noexcept(!DKGL_MEMORY_DEBUG) {}
 			virtual void* Alloc(size_t) = 0;
+			virtual size_t AllocBatch(void**, size_t) = 0;
 			virtual void Dealloc(void*) = 0;
 			virtual size_t Purge() = 0;
 			virtual void Reserve(size_t) = 0;
@@ -301,6 +303,7 @@ namespace DKFoundation
 			virtual bool ConditionalDealloc(void*) = 0;
 			virtual size_t ConditionalPurge(size_t) = 0;
 			virtual bool ConditionalDeallocAndPurge(void*, size_t, size_t*) = 0;
+			virtual size_t ConditionalDeallocBatchAndPurge(void**, size_t, size_t, size_t*) = 0;
 
 			virtual size_t NumberOfAllocatedUnits() const = 0;
 			virtual size_t NumberOfUnits() const = 0;
@@ -332,6 +335,7 @@ namespace DKFoundation
 			struct Wrapper : public AllocatorInterface
 			{
 				void* Alloc(size_t s) override						{ return allocator.Alloc(s); }
+				size_t AllocBatch(void** p, size_t n) override		{ return allocator.AllocBatch(p, n); }
 				void Dealloc(void* p) override						{ return allocator.Dealloc(p); }
 				size_t Purge() override							{ return allocator.Purge(); }
 				void Reserve(size_t s) override						{ return allocator.Reserve(s); }
@@ -344,6 +348,10 @@ namespace DKFoundation
 				{
 					return allocator.ConditionalDeallocAndPurge(p, s, bp);
 				}
+				size_t ConditionalDeallocBatchAndPurge(void** p, size_t n, size_t s, size_t* bp) override
+				{
+					return allocator.ConditionalDeallocBatchAndPurge(p, n, s, bp);
+				}
 
 				size_t NumberOfAllocatedUnits() const override	{ return allocator.NumberOfAllocatedUnits(); }
 				size_t NumberOfUnits() const override			{ return allocator.NumberOfUnits(); }
@@ -371,6 +379,29 @@ namespace DKFoundation
 			static int Init(AllocatorUnit*) { return 0; }
 		};
 
+		// ThreadCache : per-thread magazines in front of small buckets.
+		//   Each thread keeps a small free-list (magazine) per bucket, which
+		//   refills from and flushes to the shared bucket in batches.
+		//   Most allocations do not touch the bucket's lock.
+		//   Cache will be flushed when thread exits. (see DKThread.cpp)
+		struct ThreadCache
+		{
+			enum { NumBuckets = 32 };		// buckets up to 512 bytes
+			enum { MagazineSize = 32 };
+			enum { BatchSize = MagazineSize / 2 };
+
+			struct Magazine
+			{
+				void* units[MagazineSize];
+				size_t count;
+				uint64_t hits;			// not published yet.
+			};
+			Magazine magazines[NumBuckets];
+
+			static ThreadCache* Instance();	// NULL if thread is being terminated.
+			static void Flush();			// flush calling thread's cache.
+		};
+
 		struct AllocatorPool : public DKAllocator
 		{
 			enum { NumAllocators = 128 };	// allocator buckets
@@ -465,6 +496,29 @@ namespace DKFoundation
 				AllocatorUnit* unit = FindAllocatorForSize(s);
 				DKASSERT_MEM_DEBUG(unit != NULL);
 				DKASSERT_MEM_DEBUG(unit->unitSize >= s);
+
+				size_t index = unit - allocators;
+				if (index < ThreadCache::NumBuckets)
+				{
+					ThreadCache* cache = ThreadCache::Instance();
+					if (cache)
+					{
+						ThreadCache::Magazine& mag = cache->magazines[index];
+						if (mag.count > 0)
+						{
+							mag.hits++;
+						}
+						else
+						{
+							mag.count = unit->allocator->AllocBatch(mag.units, ThreadCache::BatchSize);
+							cacheMisses[index].Increment();
+							PublishCacheHits(index, mag);
+							if (mag.count == 0) // out of memory!
+								return NULL;
+						}
+						return mag.units[--mag.count];
+					}
+				}
 				return unit->allocator->Alloc(s);
 			}
 
@@ -528,6 +582,24 @@ namespace DKFoundation
 					AllocatorUnit* unit = FindAllocator(p);
 					if (unit)
 					{
+						size_t index = unit - allocators;
+						if (index < ThreadCache::NumBuckets)
+						{
+							ThreadCache* cache = ThreadCache::Instance();
+							if (cache)
+							{
+								ThreadCache::Magazine& mag = cache->magazines[index];
+								if (mag.count == ThreadCache::MagazineSize)
+								{
+									// flush older half of magazine.
+									DeallocBatchAndPurge(unit, mag.units, ThreadCache::BatchSize);
+									mag.count -= ThreadCache::BatchSize;
+									memmove(&mag.units[0], &mag.units[ThreadCache::BatchSize], sizeof(void*) * mag.count);
+								}
+								mag.units[mag.count++] = p;
+								return;
+							}
+						}
 						if (!DeallocAndPurge(unit, p))
 						{
 							DKASSERT_MEM_DEBUG(0);
@@ -541,6 +613,8 @@ namespace DKFoundation
 
 			size_t Purge()
 			{
+				ThreadCache::Flush();
+
 				size_t bytesPurged = 0;
 				for (int i = 0; i < NumAllocators; ++i)
 				{
@@ -573,6 +647,35 @@ namespace DKFoundation
 				return allocators[index];
 			}
 
+			// return cached units to buckets.
+			void FlushThreadCache(ThreadCache* cache)
+			{
+				for (size_t i = 0; i < ThreadCache::NumBuckets; ++i)
+				{
+					ThreadCache::Magazine& mag = cache->magazines[i];
+					if (mag.count > 0)
+					{
+						DeallocBatchAndPurge(&allocators[i], mag.units, mag.count);
+						mag.count = 0;
+					}
+					PublishCacheHits(i, mag);
+				}
+			}
+
+			void CacheStatus(size_t index, uint64_t* hits, uint64_t* misses) const
+			{
+				if (index < ThreadCache::NumBuckets)
+				{
+					*hits = static_cast<uint64_t>(static_cast<DKAtomicNumber64::Value>(cacheHits[index]));
+					*misses = static_cast<uint64_t>(static_cast<DKAtomicNumber64::Value>(cacheMisses[index]));
+				}
+				else
+				{
+					*hits = 0;
+					*misses = 0;
+				}
+			}
+
 		private:
 			FORCEINLINE bool DeallocAndPurge(AllocatorUnit* unit, void* p)
 			{
@@ -590,6 +693,21 @@ namespace DKFoundation
 				}
 				return false;
 			}
+			FORCEINLINE void DeallocBatchAndPurge(AllocatorUnit* unit, void** p, size_t count)
+			{
+				size_t purged = 0;
+				unit->allocator->ConditionalDeallocBatchAndPurge(p, count, 0, &purged);
+				if (purged > 0)
+					backend->PurgeThreshold(16);
+			}
+			FORCEINLINE void PublishCacheHits(size_t index, ThreadCache::Magazine& mag)
+			{
+				if (mag.hits > 0)
+				{
+					cacheHits[index].Add(static_cast<DKAtomicNumber64::Value>(mag.hits));
+					mag.hits = 0;
+				}
+			}
 			FORCEINLINE AllocatorUnit* FindAllocatorForSize(size_t size)
 			{
 				size_t count = NumAllocators;
@@ -621,6 +739,9 @@ namespace DKFoundation
 			BackendAllocator* backend;
 			AllocatorUnit allocators[NumAllocators];
 			size_t maxUnitSize;
+
+			DKAtomicNumber64 cacheHits[ThreadCache::NumBuckets];
+			DKAtomicNumber64 cacheMisses[ThreadCache::NumBuckets];
 		};
 
 		AllocatorPool* GetAllocatorPool()
@@ -648,6 +769,48 @@ namespace DKFoundation
 			return GetAllocatorPool()->Backend();
 		}
 
+		// thread-local cache pointer, trivially destructible.
+		// ThreadCacheCleanup flushes cache and disables it when thread exits.
+		static thread_local ThreadCache* threadCache = NULL;
+		static thread_local bool threadCacheDisabled = false;
+		struct ThreadCacheCleanup
+		{
+			~ThreadCacheCleanup()
+			{
+				ThreadCache::Flush();
+				threadCacheDisabled = true;
+			}
+		};
+		static thread_local ThreadCacheCleanup threadCacheCleanup;
+
+		ThreadCache* ThreadCache::Instance()
+		{
+			ThreadCache* cache = threadCache;
+			if (cache == NULL && !threadCacheDisabled)
+			{
+				(void)&threadCacheCleanup; // register cleanup for this thread.
+
+				cache = (ThreadCache*)SystemHeapAllocator::Alloc(sizeof(ThreadCache));
+				if (cache)
+				{
+					memset(cache, 0, sizeof(ThreadCache));
+					threadCache = cache;
+				}
+			}
+			return cache;
+		}
+
+		void ThreadCache::Flush()
+		{
+			ThreadCache* cache = threadCache;
+			if (cache)
+			{
+				threadCache = NULL;
+				GetAllocatorPool()->FlushThreadCache(cache);
+				SystemHeapAllocator::Free(cache);
+			}
+		}
+
 		// VMSizeInfo : keep track VM-address, size pair.
 		struct VMSizeInfo
 		{
@@ -1312,8 +1475,14 @@ namespace DKFoundation
 			status[i].chunkSize = unit.unitSize;
 			status[i].totalChunks = unit.allocator->NumberOfUnits();
 			status[i].usedChunks = unit.allocator->NumberOfAllocatedUnits();
+			GetAllocatorPool()->CacheStatus(i, &status[i].cacheHits, &status[i].cacheMisses);
 		}
 	}
+
+	DKGL_API void DKMemoryPoolFlushThreadCache()
+	{
+		ThreadCache::Flush();
+	}
 }
 
 #ifndef DKGL_OPERATOR_NEW
@@ -83,7 +83,9 @@ namespace DKFoundation
 	{
 		size_t chunkSize;		///< allocation unit size of the allocator
 		size_t totalChunks;		///< total chunks in the allocator
-		size_t usedChunks;		///< allocated units
+		size_t usedChunks;		///< allocated units (including units in thread caches)
+		uint64_t cacheHits;		///< allocations served from thread caches
+		uint64_t cacheMisses;	///< allocations refilled thread caches from the bucket
 	};
 	/// Get number of buckets, a bucket is a unit of sub-allocator in memory pool.
 	/// this value does not change during run-time.
@@ -92,6 +94,13 @@ namespace DKFoundation
 	/// Do not call this function at exiting.
 	/// @see DKMemoryPoolBucketStatus
 	DKGL_API void DKMemoryPoolQueryAllocationStatus(DKMemoryPoolBucketStatus* status, size_t numBuckets);
+	/// Return units cached by calling thread to memory pool.
+	/// Small allocations are cached per thread, the cache will be flushed
+	/// automatically when thread exits.
+	/// @note
+	///   cacheHits of DKMemoryPoolBucketStatus are accumulated when thread
+	///   cache refills or flushes.
+	DKGL_API void DKMemoryPoolFlushThreadCache();
 
 	/// @brief track allocator location for debugging purpose
 	/// you can provide your own allocator.
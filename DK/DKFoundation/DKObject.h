@@ -196,7 +196,7 @@ namespace DKFoundation
 			Ref ref;
 			RefCounter::RefIdValue refId;
             void* base = BaseAddress(_target);
-			if (base && RefCounter::RefId(base, &refId))
+			if (base && RefCounter::WeakRefId(base, &refId))
 			{
 				ref.base = base;
 				ref.refId = refId;
@@ -269,7 +269,7 @@ namespace DKFoundation
 					p->~T();
 					if (allocator)
 					{
-						allocator->Dealloc(addr);
+						RefCounter::Dealloc(allocator, addr);
 					}
 					else
 					{
@@ -5,8 +5,11 @@
 //  Copyright (c) 2004-2016 Hongtae Kim. All rights reserved.
 //
 
+#include <new>
 #include "DKObjectRefCounter.h"
 #include "DKSpinLock.h"
+#include "DKAtomicNumber32.h"
+#include "DKAtomicNumber64.h"
 #include "DKMap.h"
 #include "DKArray.h"
 #include "DKMemory.h"
@@ -20,6 +23,79 @@ namespace DKFoundation
 		static DKAllocator::Maintainer maintainer;
 
 		enum {AllocatorTableLength = 977}; // should be prime-number.
+
+		////////////////////////////////////////////////////////////////////////
+		// InlineRefCounter
+		// ref-counter header placed just before the object allocated by
+		// DKObjectRefCounter::Alloc.
+		//
+		// Note:
+		//  Any pointer can be passed to DKObjectRefCounter, so the header is
+		//  identified by tag value (address of header mixed with magic number).
+		//  The header is read only if it is located in the same page as the
+		//  object, to avoid touching unmapped memory. Alloc() makes sure that
+		//  every object has its header in the same page.
+		//  Tag becomes InlineRefCounterTagReleased when object has been unset,
+		//  then Dealloc() can find allocation base address from header.
+		//  Weak-reference (IncrementRefCount with RefIdValue) does not read
+		//  the header before it found in the table, because the object might
+		//  have been destroyed already. (see WeakRefId)
+		struct InlineRefCounter
+		{
+			DKAllocator*					allocator;
+			DKObjectRefCounter::RefIdValue	refId;
+			DKAtomicNumber64				refCount;
+			DKAtomicNumber32				weakRef;	// registered to table for weak-ref.
+			uint32_t						offset;		// object offset from allocation base
+			uintptr_t						tag;
+		};
+		enum : uintptr_t
+		{
+			InlineRefCounterPageSize = 4096,	// minimum page size
+#if defined(_WIN64) || defined(__LP64__)
+			InlineRefCounterTagActive = 0x9e3779b97f4a7c15ULL,
+			InlineRefCounterTagReleased = 0xc2b2ae3d27d4eb4fULL,
+#else
+			InlineRefCounterTagActive = 0x9e3779b9U,
+			InlineRefCounterTagReleased = 0x85ebca6bU,
+#endif
+			InlineRefCounterAlignment = 16,
+			InlineRefCounterHeaderSize = (sizeof(InlineRefCounter) + InlineRefCounterAlignment - 1) & ~(InlineRefCounterAlignment - 1),
+		};
+
+		FORCEINLINE InlineRefCounter* InlineRefCounterHeader(void* p)
+		{
+			return reinterpret_cast<InlineRefCounter*>(reinterpret_cast<uintptr_t>(p) - InlineRefCounterHeaderSize);
+		}
+		FORCEINLINE uintptr_t InlineRefCounterTag(InlineRefCounter* h, uintptr_t t)
+		{
+			return reinterpret_cast<uintptr_t>(h) ^ t;
+		}
+		// return header if object has given tag state.
+		FORCEINLINE InlineRefCounter* InlineRefCounterWithTag(void* p, uintptr_t t)
+		{
+#if DKGL_INLINE_REFCOUNT
+			uintptr_t offset = reinterpret_cast<uintptr_t>(p) & (InlineRefCounterPageSize - 1);
+			if (p && offset >= InlineRefCounterHeaderSize)
+			{
+				InlineRefCounter* h = InlineRefCounterHeader(p);
+				if (h->tag == InlineRefCounterTag(h, t))
+					return h;
+			}
+#endif
+			return NULL;
+		}
+		// return header if object is ref-counted state.
+		FORCEINLINE InlineRefCounter* ActiveInlineRefCounter(void* p)
+		{
+			return InlineRefCounterWithTag(p, InlineRefCounterTagActive);
+		}
+		// return header if object has been unset, but not deallocated yet.
+		FORCEINLINE InlineRefCounter* ReleasedInlineRefCounter(void* p)
+		{
+			return InlineRefCounterWithTag(p, InlineRefCounterTagReleased);
+		}
+
 		struct AllocationNode
 		{
 			struct NodeInfo
@@ -27,6 +103,7 @@ namespace DKFoundation
 				DKAllocator*								allocator;
 				DKObjectRefCounter::RefIdValue				refId;
 				volatile DKObjectRefCounter::RefCountValue	refCount;
+				InlineRefCounter*							inlineRef;	// weak-ref of inline object
 			};
 			typedef DKSpinLock							Lock;
 			typedef DKCriticalSection<Lock>				CriticalSection;
@@ -110,6 +187,18 @@ namespace DKFoundation
 				DKObjectRefCounter::RefIdValue value = ++counter;
 				return value;
 			}
+			// remove weak-ref entry from table, mark header as released.
+			void UnsetInlineRefCounter(void* p, InlineRefCounter* h)
+			{
+				if (h->weakRef)
+				{
+					AllocationNode& node = GetAllocationNode(p);
+					AllocationNode::CriticalSection guard(node.lock);
+					node.container.Remove(p);
+					h->weakRef = 0;
+				}
+				h->tag = InlineRefCounterTag(h, InlineRefCounterTagReleased);
+			}
 		}
 
 		void CreateAllocationTable() // called by Maintainer
@@ -133,16 +222,80 @@ namespace DKFoundation
 using namespace DKFoundation;
 using namespace DKFoundation::Private;
 
-bool DKObjectRefCounter::SetRefCounter(void* p, DKAllocator* alloc, RefCountValue c, RefIdValue* refId)
+void* DKObjectRefCounter::Alloc(DKAllocator* alloc, size_t s, RefCountValue c, RefIdValue* refId)
+{
+	if (alloc == NULL)
+		return NULL;
+#if DKGL_INLINE_REFCOUNT
+	const size_t headerSize = InlineRefCounterHeaderSize;
+	size_t offset = headerSize;
+	uint8_t* base = reinterpret_cast<uint8_t*>(alloc->Alloc(s + headerSize));
+	if (base && (reinterpret_cast<uintptr_t>(base + offset) & (InlineRefCounterPageSize - 1)) < headerSize)
+	{
+		// header is not in the same page as object, allocate again with padding.
+		alloc->Dealloc(base);
+		base = reinterpret_cast<uint8_t*>(alloc->Alloc(s + headerSize * 2));
+		if (base && (reinterpret_cast<uintptr_t>(base + offset) & (InlineRefCounterPageSize - 1)) < headerSize)
+			offset += headerSize;
+	}
+	if (base)
+	{
+		void* p = base + offset;
+		InlineRefCounter* h = new(InlineRefCounterHeader(p)) InlineRefCounter();
+		h->allocator = alloc;
+		h->refId = GenerateRefId();
+		h->refCount = static_cast<DKAtomicNumber64::Value>(c);
+		h->weakRef = 0;
+		h->offset = static_cast<uint32_t>(offset);
+		h->tag = InlineRefCounterTag(h, InlineRefCounterTagActive);
+		if (refId)
+			*refId = h->refId;
+		return p;
+	}
+	return NULL;
+#else
+	void* p = alloc->Alloc(s);
+	if (p && !SetRefCounter(p, alloc, c, refId))
+	{
+		alloc->Dealloc(p);
+		return NULL;
+	}
+	return p;
+#endif
+}
+
+void DKObjectRefCounter::Dealloc(DKAllocator* alloc, void* p)
 {
 	if (p)
+	{
+		DKASSERT_MEM_DESC_DEBUG(ActiveInlineRefCounter(p) == NULL, "Object is still in ref-counted state!");
+
+		InlineRefCounter* h = ReleasedInlineRefCounter(p);
+		if (h)
+		{
+			DKASSERT_MEM_DESC_DEBUG(h->allocator == alloc, "Wrong allocator object.");
+			void* base = reinterpret_cast<uint8_t*>(p) - h->offset;
+			h->tag = 0;
+			h->~InlineRefCounter();
+			alloc->Dealloc(base);
+		}
+		else
+		{
+			alloc->Dealloc(p);
+		}
+	}
+}
+
+bool DKObjectRefCounter::SetRefCounter(void* p, DKAllocator* alloc, RefCountValue c, RefIdValue* refId)
+{
+	if (p && ActiveInlineRefCounter(p) == NULL)
 	{
 		AllocationNode& node = GetAllocationNode(p);
 		AllocationNode::CriticalSection guard(node.lock);
 		AllocationNode::Container::Pair* pair = node.container.Find(p);
 		if (pair == NULL)
 		{
-			AllocationNode::NodeInfo nodeInfo = {alloc, GenerateRefId(), c};
+			AllocationNode::NodeInfo nodeInfo = {alloc, GenerateRefId(), c, NULL};
 			node.container.Insert(p, nodeInfo);
 			if (refId)
 				*refId = nodeInfo.refId;
@@ -154,6 +307,18 @@ bool DKObjectRefCounter::SetRefCounter(void* p, DKAllocator* alloc, RefCountValu
 
 bool DKObjectRefCounter::UnsetRefCounterIfEqual(void* p, RefCountValue c, DKAllocator** alloc)
 {
+	InlineRefCounter* h = ActiveInlineRefCounter(p);
+	if (h)
+	{
+		if (static_cast<RefCountValue>(static_cast<DKAtomicNumber64::Value>(h->refCount)) == c)
+		{
+			if (alloc)
+				*alloc = h->allocator;
+			UnsetInlineRefCounter(p, h);
+			return true;
+		}
+		return false;
+	}
 	if (p)
 	{
 		AllocationNode& node = GetAllocationNode(p);
@@ -177,6 +342,16 @@ bool DKObjectRefCounter::UnsetRefCounterIfZero(void* p, DKAllocator** alloc)
 
 bool DKObjectRefCounter::UnsetRefCounter(void* p, RefCountValue* c, DKAllocator** alloc)
 {
+	InlineRefCounter* h = ActiveInlineRefCounter(p);
+	if (h)
+	{
+		if (c)
+			*c = static_cast<RefCountValue>(static_cast<DKAtomicNumber64::Value>(h->refCount));
+		if (alloc)
+			*alloc = h->allocator;
+		UnsetInlineRefCounter(p, h);
+		return true;
+	}
 	if (p)
 	{
 		AllocationNode& node = GetAllocationNode(p);
@@ -204,6 +379,18 @@ bool DKObjectRefCounter::IncrementRefCount(void* p, RefIdValue id)
 		AllocationNode::Container::Pair* pair = node.container.Find(p);
 		if (pair && pair->value.refId == id)
 		{
+			InlineRefCounter* h = pair->value.inlineRef;
+			if (h)
+			{
+				// object is alive while it is in the table,
+				// but it can be released by other thread. (ref-count is zero)
+				for (DKAtomicNumber64::Value v = h->refCount; v > 0; v = h->refCount)
+				{
+					if (h->refCount.CompareAndSet(v, v + 1))
+						return true;
+				}
+				return false;
+			}
 			++(pair->value.refCount);
 			return true;
 		}
@@ -213,6 +400,12 @@ bool DKObjectRefCounter::IncrementRefCount(void* p, RefIdValue id)
 
 bool DKObjectRefCounter::IncrementRefCount(void* p)
 {
+	InlineRefCounter* h = ActiveInlineRefCounter(p);
+	if (h)
+	{
+		h->refCount.Increment();
+		return true;
+	}
 	if (p)
 	{
 		AllocationNode& node = GetAllocationNode(p);
@@ -229,6 +422,17 @@ bool DKObjectRefCounter::IncrementRefCount(void* p)
 
 bool DKObjectRefCounter::DecrementRefCount(void* p)
 {
+	InlineRefCounter* h = ActiveInlineRefCounter(p);
+	if (h)
+	{
+		if (h->refCount.Decrement() < 0)
+		{
+			h->refCount.Increment();
+			DKERROR_THROW_DEBUG("Ref-Count already zero!");
+			return false;
+		}
+		return true;
+	}
 	if (p)
 	{
 		AllocationNode& node = GetAllocationNode(p);
@@ -253,6 +457,21 @@ bool DKObjectRefCounter::DecrementRefCount(void* p)
 
 bool DKObjectRefCounter::DecrementRefCountAndUnsetIfEqual(void* p, RefCountValue c, DKAllocator** alloc)
 {
+	InlineRefCounter* h = ActiveInlineRefCounter(p);
+	if (h)
+	{
+		DKAtomicNumber64::Value v = h->refCount.Decrement();
+		DKASSERT_STD_DEBUG(v >= 0);
+
+		if (static_cast<RefCountValue>(v) == c)
+		{
+			if (alloc)
+				*alloc = h->allocator;
+			UnsetInlineRefCounter(p, h);
+			return true;
+		}
+		return false;
+	}
 	if (p)
 	{
 		AllocationNode& node = GetAllocationNode(p);
@@ -283,6 +502,13 @@ bool DKObjectRefCounter::DecrementRefCountAndUnsetIfZero(void* p, DKAllocator**
 
 bool DKObjectRefCounter::RefCount(void* p, RefCountValue* c)
 {
+	InlineRefCounter* h = ActiveInlineRefCounter(p);
+	if (h)
+	{
+		if (c)
+			*c = static_cast<RefCountValue>(static_cast<DKAtomicNumber64::Value>(h->refCount));
+		return true;
+	}
 	if (p)
 	{
 		AllocationNode& node = GetAllocationNode(p);
@@ -300,6 +526,13 @@ bool DKObjectRefCounter::RefCount(void* p, RefCountValue* c)
 
 bool DKObjectRefCounter::RefId(void* p, RefIdValue* ref)
 {
+	InlineRefCounter* h = ActiveInlineRefCounter(p);
+	if (h)
+	{
+		if (ref)
+			*ref = h->refId;
+		return true;
+	}
 	if (p)
 	{
 		AllocationNode& node = GetAllocationNode(p);
@@ -315,8 +548,37 @@ bool DKObjectRefCounter::RefId(void* p, RefIdValue* ref)
 	return false;
 }
 
+bool DKObjectRefCounter::WeakRefId(void* p, RefIdValue* ref)
+{
+	InlineRefCounter* h = ActiveInlineRefCounter(p);
+	if (h)
+	{
+		// register to table, to be retained by weak-ref without header access.
+		if (h->weakRef == 0)
+		{
+			AllocationNode& node = GetAllocationNode(p);
+			AllocationNode::CriticalSection guard(node.lock);
+			if (h->weakRef == 0)
+			{
+				AllocationNode::NodeInfo nodeInfo = {h->allocator, h->refId, 0, h};
+				node.container.Insert(p, nodeInfo);
+				h->weakRef = 1;
+			}
+		}
+		if (ref)
+			*ref = h->refId;
+		return true;
+	}
+	return RefId(p, ref);
+}
+
 DKMemoryLocation DKObjectRefCounter::Location(void* p)
 {
+	InlineRefCounter* h = ActiveInlineRefCounter(p);
+	if (h)
+	{
+		return h->allocator->Location();
+	}
 	if (p)
 	{
 		AllocationNode& node = GetAllocationNode(p);
@@ -332,6 +594,11 @@ DKMemoryLocation DKObjectRefCounter::Location(void* p)
 
 DKAllocator* DKObjectRefCounter::Allocator(void* p)
 {
+	InlineRefCounter* h = ActiveInlineRefCounter(p);
+	if (h)
+	{
+		return h->allocator;
+	}
 	if (p)
 	{
 		AllocationNode& node = GetAllocationNode(p);
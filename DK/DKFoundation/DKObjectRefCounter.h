@@ -10,6 +10,23 @@
 #include "DKMemory.h"
 #include "DKAllocator.h"
 
+/// Store ref-counter in front of objects allocated by DKObjectRefCounter::Alloc.
+/// (operator new with DKAllocator, DKObject::New, DKObject::Alloc)
+/// Objects which are not allocated by DKObjectRefCounter::Alloc will be
+/// ref-counted by the external table.
+#ifndef DKGL_INLINE_REFCOUNT
+#   if defined(__SANITIZE_ADDRESS__)
+#       define DKGL_INLINE_REFCOUNT 0
+#   elif defined(__has_feature)
+#       if __has_feature(address_sanitizer)
+#           define DKGL_INLINE_REFCOUNT 0
+#       endif
+#   endif
+#endif
+#ifndef DKGL_INLINE_REFCOUNT
+#   define DKGL_INLINE_REFCOUNT 1
+#endif
+
 namespace DKFoundation
 {
 	/// object ref-counter, weak-ref management.
@@ -20,6 +37,13 @@ namespace DKFoundation
 	///  Typically you don't need to access this class directly.
 	///  Use this class only if you are not able to control object allocation or
 	///  allocated from other module.
+	///
+	/// @note
+	///  If DKGL_INLINE_REFCOUNT is enabled, objects allocated with Alloc()
+	///  have their ref-count, ref-id and allocator in a header placed just
+	///  before the object. Incrementing and decrementing ref-count of these
+	///  objects is a single atomic operation without table lookup.
+	///  Other objects (registered with SetRefCounter) use the external table.
 	struct DKGL_API DKObjectRefCounter
 	{
 		typedef uintptr_t RefCountValue;
@@ -39,6 +63,15 @@ namespace DKFoundation
 		/// return true if object has been removed.
 		static bool DecrementRefCountAndUnsetIfZero(void*, DKAllocator**);
 
+		/// allocate object storage from allocator and begin ref-count state.
+		/// ref-counter is stored in front of the object if DKGL_INLINE_REFCOUNT
+		/// is enabled, otherwise object will be registered to the table.
+		static void* Alloc(DKAllocator*, size_t, RefCountValue, RefIdValue*);
+		/// release object storage with allocator.
+		/// object should not be ref-counted state. (call after Unset)
+		/// pointer that is not allocated with Alloc() will be passed to allocator.
+		static void Dealloc(DKAllocator*, void*);
+
 		/// begin ref-count state for any pointer, allocator
 		static bool SetRefCounter(void*, DKAllocator*, RefCountValue, RefIdValue*);
 		/// remove item state if ref-count is equal to specified value (RefCountValue)
@@ -52,6 +85,10 @@ namespace DKFoundation
 		static bool RefCount(void*, RefCountValue*);
 		/// retrieve RefId
 		static bool RefId(void*, RefIdValue*);
+		/// retrieve RefId for weak-reference.
+		/// object can be retained with IncrementRefCount(void*, RefIdValue)
+		/// after calling this function, even if the object has been destroyed.
+		static bool WeakRefId(void*, RefIdValue*);
 		static DKMemoryLocation Location(void*);
 		/// return allocator if object has one.
 		static DKAllocator* Allocator(void*);
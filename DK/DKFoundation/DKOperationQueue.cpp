@@ -12,6 +12,8 @@
 #include "DKTimer.h"
 #include "DKCondition.h"
 #include "DKUtils.h"
+#include "DKSpinLock.h"
+#include "DKAtomicNumber32.h"
 
 namespace DKFoundation
 {
@@ -34,7 +36,7 @@ namespace DKFoundation
 			bool Sync()
 			{
 				DKCriticalSection<DKCondition> guard(operationStateCond);
-				while (state == State::StatePending)
+				while (state == State::StatePending || state == State::StateExecuting)
 					operationStateCond.Wait();
 
 				return state == State::StateProcessed;
@@ -60,20 +62,207 @@ namespace DKFoundation
 using namespace DKFoundation;
 using namespace DKFoundation::Private;
 
-DKOperationQueue::DKOperationQueue(ThreadFilter* f)
+/// per-thread queues for SchedulingWorkStealing.
+/// Owner thread pushes and pops operations at back, other threads steal
+/// operations from front.
+struct DKOperationQueue::WorkStealingScheduler
+{
+	enum { MaxWorkers = 256 };
+
+	struct Worker
+	{
+		DKSpinLock lock;		// protects queue, running
+		OperationQueue queue;
+		DKAtomicNumber32 queued;
+		bool running;			// thread is attached to this worker
+
+		DKCondition cond;		// protects sleeping
+		volatile bool sleeping;
+
+		uint32_t seed;			// victim selection
+
+		Worker() : running(false), sleeping(false), seed(DKRandom() | 1) {}
+	};
+
+	Worker* workers[MaxWorkers];
+	DKAtomicNumber32 numWorkers;	// worker slots are never removed until queue destroyed.
+	DKAtomicNumber32 maxWorkers;	// copy of maxThreadCount
+	DKAtomicNumber32 numThreads;	// copy of threadCount
+	DKAtomicNumber32 nextWorker;	// round-robin for posting from outside
+	DKAtomicNumber32 pendingOps;	// queued + executing
+	DKAtomicNumber32 activeOps;
+	DKAtomicNumber32 idleWorkers;
+	DKAtomicNumber32 completionWaiters;
+
+	static thread_local WorkStealingScheduler* currentScheduler;
+	static thread_local Worker* currentWorker;
+
+	WorkStealingScheduler()
+	{
+		memset(workers, 0, sizeof(workers));
+	}
+	~WorkStealingScheduler()
+	{
+		for (int32_t i = 0, n = numWorkers; i < n; ++i)
+			delete workers[i];
+	}
+
+	bool HasQueuedOperations() const
+	{
+		for (int32_t i = 0, n = numWorkers; i < n; ++i)
+		{
+			if (workers[i]->queued > 0)
+				return true;
+		}
+		return false;
+	}
+	size_t QueuedOperations() const
+	{
+		size_t count = 0;
+		for (int32_t i = 0, n = numWorkers; i < n; ++i)
+			count += workers[i]->queued;
+		return count;
+	}
+	void Enqueue(DKOperationQueue* queue, Operation& op)
+	{
+		int32_t pending = pendingOps.Increment();
+		if (numWorkers == 0 || (numThreads < maxWorkers && pending > numThreads))
+			queue->UpdateThreadPool();
+		WakeForOperation(Push(op));
+	}
+	/// push operation to current thread's queue, or any running worker's queue.
+	/// returns worker which received operation.
+	Worker* Push(Operation& op)
+	{
+		if (currentScheduler == this && currentWorker)
+		{
+			Worker* w = currentWorker;
+			DKCriticalSection<DKSpinLock> guard(w->lock);
+			if (w->running)
+			{
+				w->queue.PushBack(op);
+				w->queued.Increment();
+				return w;
+			}
+		}
+		int32_t n = numWorkers;
+		DKASSERT_DEBUG(n > 0);
+		uint32_t start = static_cast<uint32_t>(nextWorker.Increment());
+		for (int32_t i = 0; i < n; ++i)
+		{
+			Worker* w = workers[(start + i) % n];
+			DKCriticalSection<DKSpinLock> guard(w->lock);
+			if (w->running || i + 1 == n)
+			{
+				w->queue.PushBack(op);
+				w->queued.Increment();
+				return w;
+			}
+		}
+		return NULL;
+	}
+	/// pop operation from own queue (LIFO), or steal from others (FIFO).
+	bool Pop(Worker* self, Operation& op)
+	{
+		if (self->queued > 0)
+		{
+			DKCriticalSection<DKSpinLock> guard(self->lock);
+			if (self->queue.PopBack(op))
+			{
+				self->queued.Decrement();
+				return true;
+			}
+		}
+		int32_t n = numWorkers;
+		if (n > 1)
+		{
+			// xorshift32
+			uint32_t x = self->seed;
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			self->seed = x;
+
+			for (int32_t i = 0; i < n; ++i)
+			{
+				Worker* victim = workers[(x + i) % n];
+				if (victim != self && victim->queued > 0)
+				{
+					DKCriticalSection<DKSpinLock> guard(victim->lock);
+					if (victim->queue.PopFront(op))
+					{
+						victim->queued.Decrement();
+						return true;
+					}
+				}
+			}
+		}
+		return false;
+	}
+	/// wake up given worker if sleeping.
+	bool Wake(Worker* w)
+	{
+		// sleeping is set before idleWorkers incremented, check without lock first.
+		if (!w->sleeping)
+			return false;
+		DKCriticalSection<DKCondition> guard(w->cond);
+		if (w->sleeping)
+		{
+			w->sleeping = false;
+			w->cond.Signal();
+			return true;
+		}
+		return false;
+	}
+	/// wake up target worker, or one of idle worker to steal.
+	void WakeForOperation(Worker* target)
+	{
+		if (idleWorkers > 0)
+		{
+			if (target && target != currentWorker && Wake(target))
+				return;
+			int32_t n = numWorkers;
+			uint32_t start = static_cast<uint32_t>(nextWorker);
+			for (int32_t i = 0; i < n; ++i)
+			{
+				Worker* w = workers[(start + i) % n];
+				if (w != currentWorker && Wake(w))
+					return;
+			}
+		}
+	}
+	void WakeAll()
+	{
+		for (int32_t i = 0, n = numWorkers; i < n; ++i)
+			Wake(workers[i]);
+	}
+};
+
+thread_local DKOperationQueue::WorkStealingScheduler* DKOperationQueue::WorkStealingScheduler::currentScheduler = NULL;
+thread_local DKOperationQueue::WorkStealingScheduler::Worker* DKOperationQueue::WorkStealingScheduler::currentWorker = NULL;
+
+DKOperationQueue::DKOperationQueue(ThreadFilter* f, SchedulingMode mode)
 	: maxConcurrentOperations(16)
 	, threadCount(0)
 	, maxThreadCount(0)
 	, activeThreads(0)
 	, filter(f)
+	, workStealing(NULL)
 {
 	maxConcurrentOperations = Max(2, static_cast<int>(DKNumberOfProcessors()) - 1);
+	if (mode == SchedulingWorkStealing)
+		workStealing = new WorkStealingScheduler();
 }
 
 DKOperationQueue::~DKOperationQueue()
 {
 	threadCond.Lock();
 	maxThreadCount = 0;
+	if (workStealing)
+	{
+		workStealing->maxWorkers = 0;
+		workStealing->WakeAll();
+	}
 	threadCond.Broadcast();
 	while (threadCount > 0)
 		threadCond.Wait();
@@ -89,12 +278,27 @@ DKOperationQueue::~DKOperationQueue()
 	};
 	operationQueue.EnumerateForward(cancelOps);
 	operationQueue.Clear();
+	if (workStealing)
+	{
+		for (int32_t i = 0, n = workStealing->numWorkers; i < n; ++i)
+		{
+			workStealing->workers[i]->queue.EnumerateForward(cancelOps);
+			workStealing->workers[i]->queue.Clear();
+		}
+		delete workStealing;
+		workStealing = NULL;
+	}
 
 	operationStateCond.Broadcast();
 	operationStateCond.Unlock();
 	threadCond.Unlock();
 }
 
+DKOperationQueue::SchedulingMode DKOperationQueue::Scheduling() const
+{
+	return workStealing ? SchedulingWorkStealing : SchedulingSharedQueue;
+}
+
 void DKOperationQueue::SetMaxConcurrentOperations(size_t maxConcurrent)
 {
 	threadCond.Lock();
@@ -115,6 +319,11 @@ void DKOperationQueue::Post(DKOperation* operation)
 	if (operation)
 	{
 		Operation op = {operation, NULL};
+		if (workStealing)
+		{
+			workStealing->Enqueue(this, op);
+			return;
+		}
 		threadCond.Lock();
 		operationQueue.PushBack(op);
 		threadCond.Broadcast();
@@ -130,11 +339,18 @@ DKObject<DKOperationQueue::OperationSync> DKOperationQueue::ProcessAsync(DKOpera
 		DKObject<OperationSyncState> sync = DKOBJECT_NEW OperationSyncState();
 		sync->state = OperationSync::StatePending;
 		Operation op = {operation, sync.StaticCast<OperationSync>()};
-		threadCond.Lock();
-		operationQueue.PushBack(op);
-		threadCond.Broadcast();
-		threadCond.Unlock();
-		UpdateThreadPool();
+		if (workStealing)
+		{
+			workStealing->Enqueue(this, op);
+		}
+		else
+		{
+			threadCond.Lock();
+			operationQueue.PushBack(op);
+			threadCond.Broadcast();
+			threadCond.Unlock();
+			UpdateThreadPool();
+		}
 
 		return sync.StaticCast<OperationSync>();
 	}
@@ -152,6 +368,55 @@ bool DKOperationQueue::Process(DKOperation* operation)
 void DKOperationQueue::UpdateThreadPool()
 {
 	threadCond.Lock();
+	if (workStealing)
+	{
+		WorkStealingScheduler* ws = workStealing;
+		maxThreadCount = Min(maxConcurrentOperations, (size_t)WorkStealingScheduler::MaxWorkers);
+		if (ws->maxWorkers.Exchange(static_cast<int32_t>(maxThreadCount)) > static_cast<int32_t>(maxThreadCount))
+			ws->WakeAll();	// let idle workers terminate
+
+		// worker slot should exist before posting operation.
+		if (ws->numWorkers == 0 && maxThreadCount > 0)
+		{
+			ws->workers[0] = new WorkStealingScheduler::Worker();
+			ws->numWorkers = 1;
+		}
+		for (size_t i = 0; i < maxThreadCount && threadCount < maxThreadCount; ++i)
+		{
+			if ((size_t)ws->pendingOps <= threadCount)
+				break;
+
+			if (i >= (size_t)ws->numWorkers)
+			{
+				DKASSERT_DEBUG(i == (size_t)ws->numWorkers);
+				ws->workers[i] = new WorkStealingScheduler::Worker();
+				ws->numWorkers = static_cast<int32_t>(i + 1);
+			}
+			WorkStealingScheduler::Worker* w = ws->workers[i];
+			w->lock.Lock();
+			bool running = w->running;
+			w->running = true;
+			w->lock.Unlock();
+			if (!running)
+			{
+				DKObject<DKThread> thread = DKThread::Create(DKFunction(this, &DKOperationQueue::WorkStealingProc)->Invocation(i));
+				if (thread)
+				{
+					threadCount++;
+					ws->numThreads = static_cast<int32_t>(threadCount);
+				}
+				else
+				{
+					w->lock.Lock();
+					w->running = false;
+					w->lock.Unlock();
+					break;
+				}
+			}
+		}
+		threadCond.Unlock();
+		return;
+	}
 	maxThreadCount = maxConcurrentOperations;
 	while (threadCount < maxThreadCount)
 	{
@@ -187,6 +452,19 @@ void DKOperationQueue::CancelAllOperations()
 	};
 	operationQueue.EnumerateForward(cancelOps);
 	operationQueue.Clear();
+	if (workStealing)
+	{
+		for (int32_t i = 0, n = workStealing->numWorkers; i < n; ++i)
+		{
+			WorkStealingScheduler::Worker* w = workStealing->workers[i];
+			DKCriticalSection<DKSpinLock> guard(w->lock);
+			w->queue.EnumerateForward(cancelOps);
+			int32_t count = static_cast<int32_t>(w->queue.Count());
+			w->queue.Clear();
+			w->queued.Add(-count);
+			workStealing->pendingOps.Add(-count);
+		}
+	}
 
 	operationStateCond.Broadcast();
 	operationStateCond.Unlock();
@@ -197,6 +475,17 @@ void DKOperationQueue::CancelAllOperations()
 
 void DKOperationQueue::WaitForCompletion() const
 {
+	if (workStealing)
+	{
+		// workers broadcast threadCond only if someone is waiting.
+		workStealing->completionWaiters.Increment();
+		threadCond.Lock();
+		while (workStealing->pendingOps > 0)
+			threadCond.Wait();
+		threadCond.Unlock();
+		workStealing->completionWaiters.Decrement();
+		return;
+	}
 	DKCriticalSection<DKCondition> guard(threadCond);
 	while (operationQueue.Count() > 0 || activeThreads > 0)
 		threadCond.Wait();
@@ -205,6 +494,15 @@ void DKOperationQueue::WaitForCompletion() const
 bool DKOperationQueue::WaitForAnyOperation(double timeout) const
 {
 	timeout = Max(timeout, 0.0);
+	if (workStealing)
+	{
+		workStealing->completionWaiters.Increment();
+		threadCond.Lock();
+		bool result = threadCond.WaitTimeout(timeout);
+		threadCond.Unlock();
+		workStealing->completionWaiters.Decrement();
+		return result;
+	}
 	DKCriticalSection<DKCondition> guard(threadCond);
 	return threadCond.WaitTimeout(timeout);
 
@@ -212,12 +510,16 @@ bool DKOperationQueue::WaitForAnyOperation(double timeout) const
 
 size_t DKOperationQueue::QueueLength() const
 {
+	if (workStealing)
+		return workStealing->QueuedOperations();
 	DKCriticalSection<DKCondition> guard(threadCond);
 	return operationQueue.Count();
 }
 
 size_t DKOperationQueue::RunningOperations() const
 {
+	if (workStealing)
+		return workStealing->activeOps;
 	DKCriticalSection<DKCondition> guard(threadCond);
 	return activeThreads;
 }
@@ -228,16 +530,9 @@ size_t DKOperationQueue::RunningThreads() const
 	return threadCount;
 }
 
-void DKOperationQueue::OperationProc()
+bool DKOperationQueue::PerformOperation(Operation& op)
 {
-	DKThread::ThreadId threadId = DKThread::CurrentThreadId();
-	DKTimer timer;
-	timer.Reset();
-	size_t numOps = 0;
-
-	threadCond.Lock();
-
-	auto PerformOperation = [this](DKOperation* op)
+	auto Perform = [this](DKOperation* op)
 	{
 		struct Wrapper : public DKOperation
 		{
@@ -256,6 +551,50 @@ void DKOperationQueue::OperationProc()
 		PerformOperationInsidePool(&wr);
 	};
 
+	bool performed = false;
+	OperationSyncState* st = op.sync.StaticCast<OperationSyncState>();
+	if (st)
+	{
+		operationStateCond.Lock();
+		if (st->state == OperationSync::StatePending)
+		{
+			if (op.operation)
+			{
+				st->state = OperationSync::StateExecuting;
+				operationStateCond.Unlock();
+				Perform(op.operation);
+				performed = true;
+				operationStateCond.Lock();
+				st->state = OperationSync::StateProcessed;
+			}
+			else
+			{
+				st->state = OperationSync::StateCancelled;
+			}
+			operationStateCond.Broadcast();
+		}
+		operationStateCond.Unlock();
+	}
+	else if (op.operation)
+	{
+		Perform(op.operation);
+		performed = true;
+	}
+
+	op.operation = NULL;
+	op.sync = NULL;
+	return performed;
+}
+
+void DKOperationQueue::OperationProc()
+{
+	DKThread::ThreadId threadId = DKThread::CurrentThreadId();
+	DKTimer timer;
+	timer.Reset();
+	size_t numOps = 0;
+
+	threadCond.Lock();
+
 	if (filter)
 		filter->OnThreadInitialized();
 
@@ -275,37 +614,8 @@ void DKOperationQueue::OperationProc()
 			activeThreads++;
 			threadCond.Unlock();
 
-			OperationSyncState* st = op.sync.StaticCast<OperationSyncState>();
-			if (st)
-			{
-				operationStateCond.Lock();
-				if (st->state == OperationSync::StatePending)
-				{
-					if (op.operation)
-					{
-						st->state = OperationSync::StateExecuting;
-						operationStateCond.Unlock();
-						PerformOperation(op.operation);
-						numOps++;
-						operationStateCond.Lock();
-						st->state = OperationSync::StateProcessed;
-					}
-					else
-					{
-						st->state = OperationSync::StateCancelled;
-					}
-					operationStateCond.Broadcast();
-				}
-				operationStateCond.Unlock();
-			}
-			else if (op.operation)
-			{
-				PerformOperation(op.operation);
+			if (PerformOperation(op))
 				numOps++;
-			}
-
-			op.operation = NULL;
-			op.sync = NULL;
 
 			threadCond.Lock();
 			activeThreads--;
@@ -326,3 +636,85 @@ void DKOperationQueue::OperationProc()
 	threadCond.Broadcast();
 	threadCond.Unlock();
 }
+
+void DKOperationQueue::WorkStealingProc(size_t workerIndex)
+{
+	DKThread::ThreadId threadId = DKThread::CurrentThreadId();
+	DKTimer timer;
+	timer.Reset();
+	size_t numOps = 0;
+
+	WorkStealingScheduler* ws = workStealing;
+	WorkStealingScheduler::Worker* self = ws->workers[workerIndex];
+	WorkStealingScheduler::currentScheduler = ws;
+	WorkStealingScheduler::currentWorker = self;
+
+	if (filter)
+		filter->OnThreadInitialized();
+
+	DKLog("DKOperationQueue_Thread:0x%x started. (worker:%u)\n", threadId, (unsigned int)workerIndex);
+
+	while (true)
+	{
+		if (static_cast<int32_t>(workerIndex) >= ws->maxWorkers)
+		{
+			// terminate if queue is empty or operation-queue is being destroyed.
+			DKCriticalSection<DKSpinLock> guard(self->lock);
+			if (self->queue.Count() == 0 || ws->maxWorkers == 0)
+			{
+				self->running = false;
+				break;
+			}
+		}
+
+		Operation op = {NULL, NULL};
+		if (ws->Pop(self, op))
+		{
+			ws->activeOps.Increment();
+			if (PerformOperation(op))
+				numOps++;
+			ws->activeOps.Decrement();
+
+			ws->pendingOps.Decrement();
+			if (ws->completionWaiters > 0)
+			{
+				threadCond.Lock();
+				threadCond.Broadcast();
+				threadCond.Unlock();
+			}
+		}
+		else
+		{
+			// announce idle before checking queues again,
+			// Post() checks idleWorkers after pushing operation.
+			self->cond.Lock();
+			self->sleeping = true;
+			ws->idleWorkers.Increment();
+			while (self->sleeping)
+			{
+				if (ws->HasQueuedOperations() || static_cast<int32_t>(workerIndex) >= ws->maxWorkers)
+				{
+					self->sleeping = false;
+					break;
+				}
+				self->cond.Wait();
+			}
+			ws->idleWorkers.Decrement();
+			self->cond.Unlock();
+		}
+	}
+
+	if (filter)
+		filter->OnThreadTerminate();
+
+	WorkStealingScheduler::currentScheduler = NULL;
+	WorkStealingScheduler::currentWorker = NULL;
+
+	DKLog("DKOperationQueue_Thread:0x%x terminated. (running %f seconds, %lu processed)\n", threadId, timer.Elapsed(), numOps);
+
+	threadCond.Lock();
+	threadCount--;
+	ws->numThreads = static_cast<int32_t>(threadCount);
+	threadCond.Broadcast();
+	threadCond.Unlock();
+}
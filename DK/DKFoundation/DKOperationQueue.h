@@ -17,9 +17,23 @@ namespace DKFoundation
 {
 	/// Processing operations with multi-threaded.
 	/// This class manages thread pool automatically.
+	///
+	/// @note
+	///  With SchedulingWorkStealing, each thread has its own queue.
+	///  Operations posted from a thread of this queue are pushed to queue of
+	///  that thread and processed LIFO (fork-join), other threads steal
+	///  operations when their queue is empty. Idle thread is woken up
+	///  individually, instead of broadcasting to all threads.
+	///  Order of operations is not guaranteed in this mode.
 	class DKGL_API DKOperationQueue
 	{
 	public:
+		enum SchedulingMode
+		{
+			SchedulingSharedQueue = 0,	///< all threads share single FIFO queue.
+			SchedulingWorkStealing,		///< per-thread queues with work-stealing.
+		};
+
 		/// retrieve operation state which is enqueued by DKOperationQueue::Post
 		struct OperationSync
 		{
@@ -54,9 +68,11 @@ namespace DKFoundation
 			}
 		};
 
-		DKOperationQueue(ThreadFilter* filter = NULL);
+		DKOperationQueue(ThreadFilter* filter = NULL, SchedulingMode mode = SchedulingSharedQueue);
 		~DKOperationQueue();
 
+		SchedulingMode Scheduling() const;
+
 		void SetMaxConcurrentOperations(size_t maxConcurrent);
 		size_t MaxConcurrentOperations() const;
 
@@ -86,8 +102,13 @@ namespace DKFoundation
 		DKCondition threadCond;
 		DKObject<ThreadFilter> filter;
 
+		struct WorkStealingScheduler;
+		WorkStealingScheduler* workStealing; // NULL for SchedulingSharedQueue
+
 		void UpdateThreadPool();
 		void OperationProc();
+		void WorkStealingProc(size_t workerIndex);
+		bool PerformOperation(Operation& op);
 
 		DKOperationQueue(const DKOperationQueue&);
 		DKOperationQueue& operator = (const DKOperationQueue&) = delete;
@@ -5,8 +5,28 @@
 //  Copyright (c) 2004-2016 Hongtae Kim. All rights reserved.
 //
 
+#ifdef _WIN32
+#include <windows.h>
+#pragma comment(lib, "Synchronization.lib")
+#elif defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <pthread.h>
+#else
+#include <pthread.h>
+#endif
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
 #include "DKSpinLock.h"
 #include "DKThread.h"
+#include "DKTimer.h"
+#include "DKUtils.h"
+#include "DKLog.h"
 
 namespace DKFoundation
 {
@@ -16,7 +36,174 @@ namespace DKFoundation
 		{
 			SpinLockStateFree = 0,
 			SpinLockStateLocked = 1,
+			SpinLockStateLockedWithWaiters = 2,	// one or more threads are parked.
+		};
+
+		enum
+		{
+			SpinLockMaxSpinCount = 64,	// number of spins before parking
+			SpinLockMaxBackoff = 64,	// max pause per spin
+		};
+
+		static_assert(sizeof(DKAtomicNumber32) == sizeof(int32_t), "DKAtomicNumber32 size mismatch");
+
+		FORCEINLINE void SpinLockPause()
+		{
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+			_mm_pause();
+#elif defined(_WIN32)
+			YieldProcessor();
+#elif defined(__arm__) || defined(__aarch64__)
+			__asm__ __volatile__("yield");
+#endif
+		}
+
+		static bool SpinLockShouldSpin()
+		{
+			// spinning is useless on single processor.
+			static const bool multiProcessor = DKNumberOfProcessors() > 1;
+			return multiProcessor;
+		}
+
+#if !defined(_WIN32) && !defined(__linux__)
+		// Parking lot for platforms without futex.
+		// Static buckets of pthread mutex, cond. (no allocation)
+		struct SpinLockParkingBucket
+		{
+			pthread_mutex_t mutex;
+			pthread_cond_t cond;
 		};
+#define SPINLOCK_PARKING_BUCKET_INIT {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER}
+#define SPINLOCK_PARKING_BUCKET_INIT4 SPINLOCK_PARKING_BUCKET_INIT, SPINLOCK_PARKING_BUCKET_INIT, SPINLOCK_PARKING_BUCKET_INIT, SPINLOCK_PARKING_BUCKET_INIT
+		static SpinLockParkingBucket spinLockParkingBuckets[16] = {
+			SPINLOCK_PARKING_BUCKET_INIT4, SPINLOCK_PARKING_BUCKET_INIT4,
+			SPINLOCK_PARKING_BUCKET_INIT4, SPINLOCK_PARKING_BUCKET_INIT4,
+		};
+#undef SPINLOCK_PARKING_BUCKET_INIT4
+#undef SPINLOCK_PARKING_BUCKET_INIT
+		FORCEINLINE SpinLockParkingBucket& SpinLockBucket(volatile int32_t* addr)
+		{
+			uintptr_t h = reinterpret_cast<uintptr_t>(addr);
+			h ^= h >> 4;
+			h ^= h >> 9;
+			return spinLockParkingBuckets[h % 16];
+		}
+#endif
+
+		/// block thread while *addr == value.
+		static void SpinLockPark(volatile int32_t* addr, int32_t value)
+		{
+#ifdef _WIN32
+			WaitOnAddress(addr, &value, sizeof(int32_t), INFINITE);
+#elif defined(__linux__)
+			syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+#else
+			SpinLockParkingBucket& bucket = SpinLockBucket(addr);
+			pthread_mutex_lock(&bucket.mutex);
+			if (*addr == value)
+				pthread_cond_wait(&bucket.cond, &bucket.mutex);
+			pthread_mutex_unlock(&bucket.mutex);
+#endif
+		}
+		/// wake one thread parked on addr.
+		static void SpinLockUnpark(volatile int32_t* addr)
+		{
+#ifdef _WIN32
+			WakeByAddressSingle((PVOID)addr);
+#elif defined(__linux__)
+			syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#else
+			// bucket can be shared by other locks, wake all.
+			SpinLockParkingBucket& bucket = SpinLockBucket(addr);
+			pthread_mutex_lock(&bucket.mutex);
+			pthread_cond_broadcast(&bucket.cond);
+			pthread_mutex_unlock(&bucket.mutex);
+#endif
+		}
+
+#if DKGL_SPINLOCK_STATISTICS
+		// list of all DKSpinLock instances.
+		// Uses raw atomic lock, DKSpinLock cannot be used here.
+		struct SpinLockRegistry
+		{
+			DKAtomicNumber32 lock;
+			DKSpinLock* head = NULL;
+
+			static SpinLockRegistry& Instance()
+			{
+				static SpinLockRegistry registry;
+				return registry;
+			}
+			void Lock()
+			{
+				while (!lock.CompareAndSet(0, 1))
+					DKThread::Yield();
+			}
+			void Unlock()
+			{
+				lock = 0;
+			}
+			void Add(DKSpinLock* s)
+			{
+				Lock();
+				s->prevLock = NULL;
+				s->nextLock = head;
+				if (head)
+					head->prevLock = s;
+				head = s;
+				Unlock();
+			}
+			void Remove(DKSpinLock* s)
+			{
+				Lock();
+				if (s->prevLock)
+					s->prevLock->nextLock = s->nextLock;
+				else
+					head = s->nextLock;
+				if (s->nextLock)
+					s->nextLock->prevLock = s->prevLock;
+				Unlock();
+			}
+			size_t Query(DKSpinLock::Statistics* buffer, size_t maxCount)
+			{
+				const double tickToTime = 1.0 / static_cast<double>(DKTimer::SystemTickFrequency());
+				size_t count = 0;
+				Lock();
+				for (DKSpinLock* s = head; s; s = s->nextLock)
+				{
+					DKSpinLock::Statistics st = {
+						s,
+						s->contendedSite,
+						static_cast<uint64_t>(static_cast<DKAtomicNumber64::Value>(s->acquisitions)),
+						static_cast<uint64_t>(static_cast<DKAtomicNumber64::Value>(s->contentions)),
+						static_cast<uint64_t>(static_cast<DKAtomicNumber64::Value>(s->parks)),
+						static_cast<double>(static_cast<DKAtomicNumber64::Value>(s->waitTicks)) * tickToTime,
+					};
+					if (count < maxCount)
+					{
+						buffer[count++] = st;
+					}
+					else if (maxCount > 0)
+					{
+						// replace least waited one.
+						DKSpinLock::Statistics* least = std::min_element(buffer, buffer + maxCount,
+							[](const DKSpinLock::Statistics& a, const DKSpinLock::Statistics& b)
+						{
+							return a.waitTime < b.waitTime;
+						});
+						if (least->waitTime < st.waitTime)
+							*least = st;
+					}
+				}
+				Unlock();
+				std::sort(buffer, buffer + count, [](const DKSpinLock::Statistics& a, const DKSpinLock::Statistics& b)
+				{
+					return a.waitTime > b.waitTime;
+				});
+				return count;
+			}
+		};
+#endif
 	}
 }
 
@@ -25,25 +212,129 @@ using namespace DKFoundation::Private;
 
 DKSpinLock::DKSpinLock()
 	: state(SpinLockStateFree)
+#if DKGL_SPINLOCK_STATISTICS
+	, contendedSite(NULL)
+#endif
 {
+#if DKGL_SPINLOCK_STATISTICS
+	SpinLockRegistry::Instance().Add(this);
+#endif
 }
 
 DKSpinLock::~DKSpinLock()
 {
+#if DKGL_SPINLOCK_STATISTICS
+	SpinLockRegistry::Instance().Remove(this);
+#endif
 }
 
 void DKSpinLock::Lock() const
 {
-	while (!TryLock())
-		DKThread::Yield();
+	if (!state.CompareAndSet(SpinLockStateFree, SpinLockStateLocked))
+	{
+#ifdef _MSC_VER
+		LockContended(_ReturnAddress());
+#else
+		LockContended(__builtin_return_address(0));
+#endif
+	}
+#if DKGL_SPINLOCK_STATISTICS
+	acquisitions.Increment();
+#endif
+}
+
+#if DKGL_SPINLOCK_STATISTICS
+void DKSpinLock::LockContended(const void* site) const
+{
+	DKTimer::Tick t0 = DKTimer::SystemTick();
+	contentions.Increment();
+	contendedSite = site;
+	struct Finish
+	{
+		const DKSpinLock* lock;
+		DKTimer::Tick t0;
+		~Finish() { lock->waitTicks.Add(static_cast<DKAtomicNumber64::Value>(DKTimer::SystemTick() - t0)); }
+	} finish = { this, t0 };
+#else
+void DKSpinLock::LockContended(const void*) const
+{
+#endif
+
+	if (SpinLockShouldSpin())
+	{
+		uint32_t backoff = 1;
+		for (int i = 0; i < SpinLockMaxSpinCount; ++i)
+		{
+			for (uint32_t n = 0; n < backoff; ++n)
+				SpinLockPause();
+			if (state == SpinLockStateFree &&
+				state.CompareAndSet(SpinLockStateFree, SpinLockStateLocked))
+				return;
+			backoff = std::min<uint32_t>(backoff * 2, SpinLockMaxBackoff);
+		}
+	}
+
+	// mark lock as contended, and park until it is released.
+	volatile int32_t* addr = reinterpret_cast<volatile int32_t*>(&state);
+	while (state.Exchange(SpinLockStateLockedWithWaiters) != SpinLockStateFree)
+	{
+#if DKGL_SPINLOCK_STATISTICS
+		parks.Increment();
+#endif
+		SpinLockPark(addr, SpinLockStateLockedWithWaiters);
+	}
 }
 
 bool DKSpinLock::TryLock() const
 {
-	return state.CompareAndSet(SpinLockStateFree, SpinLockStateLocked);
+	if (state.CompareAndSet(SpinLockStateFree, SpinLockStateLocked))
+	{
+#if DKGL_SPINLOCK_STATISTICS
+		acquisitions.Increment();
+#endif
+		return true;
+	}
+	return false;
 }
 
 void DKSpinLock::Unlock() const
 {
-	state = SpinLockStateFree;
+	if (state.Exchange(SpinLockStateFree) == SpinLockStateLockedWithWaiters)
+		SpinLockUnpark(reinterpret_cast<volatile int32_t*>(&state));
+}
+
+#if DKGL_SPINLOCK_STATISTICS
+size_t DKSpinLock::QueryStatistics(Statistics* buffer, size_t maxCount)
+{
+	return SpinLockRegistry::Instance().Query(buffer, maxCount);
+}
+
+void DKSpinLock::DumpStatistics(size_t maxCount)
+{
+	Statistics* stats = new Statistics[maxCount > 0 ? maxCount : 1];
+	size_t count = QueryStatistics(stats, maxCount);
+	DKLog("DKSpinLock statistics: (%u locks)\n", (unsigned int)count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Statistics& st = stats[i];
+		DKLog(" [%u] lock:%p acquired:%llu contended:%llu (%.2f%%) parked:%llu wait:%f sec, last contended at:%p\n",
+			  (unsigned int)i, st.lock,
+			  (unsigned long long)st.acquisitions,
+			  (unsigned long long)st.contentions,
+			  st.acquisitions > 0 ? static_cast<double>(st.contentions) * 100.0 / static_cast<double>(st.acquisitions) : 0.0,
+			  (unsigned long long)st.parks,
+			  st.waitTime, st.contendedSite);
+	}
+	delete[] stats;
+}
+#else
+size_t DKSpinLock::QueryStatistics(Statistics*, size_t)
+{
+	return 0;
+}
+
+void DKSpinLock::DumpStatistics(size_t)
+{
+	DKLog("DKSpinLock statistics disabled. (build with DKGL_SPINLOCK_STATISTICS=1)\n");
 }
+#endif
@@ -8,13 +8,28 @@
 #pragma once
 #include "../DKInclude.h"
 #include "DKAtomicNumber32.h"
+#include "DKAtomicNumber64.h"
+
+/// Build with DKGL_SPINLOCK_STATISTICS=1 to record acquisitions, contentions
+/// and wait time of each DKSpinLock instance. (see DKSpinLock::DumpStatistics)
+#ifndef DKGL_SPINLOCK_STATISTICS
+#define DKGL_SPINLOCK_STATISTICS 0
+#endif
 
 namespace DKFoundation
 {
+#if DKGL_SPINLOCK_STATISTICS
+	namespace Private { struct SpinLockRegistry; }
+#endif
 	/// a busy-waiting locking class.
 	/// atomic variable used internally.
 	/// use this class for short period locking.
 	/// (such as small computation, without I/O.)
+	///
+	/// @note
+	///  Lock() spins with exponential backoff for a short time, and then
+	///  thread is parked (futex on Linux, WaitOnAddress on Windows) until
+	///  lock is released.
 	class DKGL_API DKSpinLock
 	{
 	public:
@@ -24,9 +39,36 @@ namespace DKFoundation
 		bool TryLock() const;
 		void Unlock() const;
 
+		struct Statistics
+		{
+			const DKSpinLock* lock;
+			const void* contendedSite;	///< return address of last contended Lock() call
+			uint64_t acquisitions;
+			uint64_t contentions;		///< number of Lock() which was not acquired at first try.
+			uint64_t parks;				///< number of thread parking.
+			double waitTime;			///< total waiting time in seconds.
+		};
+		/// copy statistics of living DKSpinLock instances, sorted by waitTime.
+		/// returns number of instances, zero if DKGL_SPINLOCK_STATISTICS is disabled.
+		static size_t QueryStatistics(Statistics* buffer, size_t maxCount);
+		/// print statistics of the most contended locks with DKLog.
+		static void DumpStatistics(size_t maxCount = 20);
+
 	private:
 		DKSpinLock(const DKSpinLock&) = delete;
 		DKSpinLock& operator = (const DKSpinLock&) = delete;
+		void LockContended(const void* site) const;
 		mutable DKAtomicNumber32 state;
+
+#if DKGL_SPINLOCK_STATISTICS
+		friend struct Private::SpinLockRegistry;
+		mutable DKAtomicNumber64 acquisitions;
+		mutable DKAtomicNumber64 contentions;
+		mutable DKAtomicNumber64 parks;
+		mutable DKAtomicNumber64 waitTicks;
+		mutable const void* contendedSite;
+		DKSpinLock* prevLock;
+		DKSpinLock* nextLock;
+#endif
 	};
 }
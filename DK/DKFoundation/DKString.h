@@ -12,6 +12,8 @@
 #include "DKStringW.h"
 #include "DKMap.h"
 #include "DKSet.h"
+#include "DKHashMap.h"
+#include "DKHashSet.h"
 
 namespace DKFoundation
 {
@@ -54,4 +56,21 @@ namespace DKFoundation
 		}
 	};
 
+	/// Template Spealization for DKString. (for DKHashMap, DKHashSet)
+	template <> struct DKHashMapKeyHasher<DKStringW>
+	{
+		size_t operator () (const DKStringW& str) const
+		{
+			return DKHashTableHashBytes((const DKUniCharW*)str, str.Bytes());
+		}
+	};
+	/// Template Spealization for DKString. (for DKHashMap, DKHashSet)
+	template <> struct DKHashMapKeyHasher<DKStringU8>
+	{
+		size_t operator () (const DKStringU8& str) const
+		{
+			return DKHashTableHashBytes((const DKUniChar8*)str, str.Bytes());
+		}
+	};
+
 }
@@ -1126,6 +1126,37 @@ namespace DKFoundation
 		strOut.SetValue(DKStringW::empty);
 	}
 
+	DKGL_API size_t DKStringFormatV(DKUniChar8* buffer, size_t bufferSize, const DKUniChar8* fmt, va_list v)
+	{
+		if (buffer == NULL || bufferSize == 0)
+			return 0;
+
+		size_t length = 0;
+		if (fmt && fmt[0])
+		{
+			bool truncated = false;
+			auto printer = [&](const DKUniChar8* str, size_t len)
+			{
+				if (truncated)
+					return;
+				size_t available = bufferSize - length - 1;
+				if (len > available)
+				{
+					// cut off incomplete UTF-8 sequence.
+					len = available;
+					while (len > 0 && (static_cast<unsigned char>(str[len]) & 0xc0) == 0x80)
+						len--;
+					truncated = true;
+				}
+				memcpy(&buffer[length], str, len);
+				length += len;
+			};
+			Private::PrintV(printer, fmt, v);
+		}
+		buffer[length] = 0;
+		return length;
+	}
+
 	DKGL_API bool DKStringSetValue(DKStringU8& strOut, const DKStringW& strIn)
 	{
 		const DKUniCharW* s = strIn;
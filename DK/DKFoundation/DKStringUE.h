@@ -58,6 +58,10 @@ namespace DKFoundation
 	DKGL_API void DKStringFormatV(DKStringU8& strOut, const DKUniCharW* fmt, va_list v);
 	DKGL_API void DKStringFormatV(DKStringW& strOut, const DKUniChar8* fmt, va_list v);
 	DKGL_API void DKStringFormatV(DKStringW& strOut, const DKUniCharW* fmt, va_list v);
+	/// format UTF-8 string into fixed size buffer without string object.
+	/// output is truncated at character boundary and null-terminated.
+	/// returns number of bytes written, excluding null-terminator.
+	DKGL_API size_t DKStringFormatV(DKUniChar8* buffer, size_t bufferSize, const DKUniChar8* fmt, va_list v);
 
 	DKGL_API bool DKStringSetValue(DKStringU8& strOut, const DKStringW& strIn);
 	DKGL_API bool DKStringSetValue(DKStringW& strOut, const DKStringU8& strIn);
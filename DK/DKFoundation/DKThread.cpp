@@ -108,6 +108,9 @@ namespace DKFoundation::Private
         threadCond.Broadcast();
         threadCond.Unlock();
 
+        // return units cached by this thread to memory pool.
+        DKMemoryPoolFlushThreadCache();
+
         // terminate thread.
 #ifdef _WIN32
             //ExitThread(0);
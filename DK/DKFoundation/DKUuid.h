@@ -41,5 +41,15 @@ namespace DKFoundation
 	private:
 		unsigned char data[16];
 	};
+
+	/// Template Spealization for DKUuid. (for DKHashMap, DKHashSet)
+	template <> struct DKHashMapKeyHasher<DKUuid>
+	{
+		size_t operator () (const DKUuid& uuid) const
+		{
+			static_assert(sizeof(DKUuid) == 16, "DKUuid should be 16 bytes");
+			return DKHashTableHashBytes(&uuid, sizeof(DKUuid));
+		}
+	};
 }
 #pragma pack(pop)
@@ -15,6 +15,118 @@
 #include "DKCriticalSection.h"
 #include "DKString.h"
 #include "DKLog.h"
+#include "DKFunction.h"
+#include "DKOperationQueue.h"
+#include "Private/OrderedJobs.h"
+
+namespace DKFoundation
+{
+	namespace Private
+	{
+		// entry compressed by worker thread, written by DKZipArchiver::Write.
+		struct ZipBatchJob
+		{
+			const DKZipArchiver::Entry* entry;
+			DKObject<DKData> source;	// uncompressed content
+			DKObject<DKBuffer> compressed;	// NULL if entry is stored
+			uLong crc;
+		};
+
+		enum : size_t
+		{
+			ZipSampleSize = 0x10000,		// compressibility test of large input
+			ZipMaxChunkSize = 0x40000000,	// uInt limit of zlib
+		};
+
+		static size_t ZipDeflate(const void* p, size_t len, int level, void* out, size_t outLen)
+		{
+			z_stream stream;
+			memset(&stream, 0, sizeof(z_stream));
+			if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK)
+				return 0;
+
+			const Bytef* in = reinterpret_cast<const Bytef*>(p);
+			Bytef* outp = reinterpret_cast<Bytef*>(out);
+			int err = Z_OK;
+			while (err == Z_OK)
+			{
+				if (stream.avail_in == 0 && len > 0)
+				{
+					stream.next_in = const_cast<Bytef*>(in);
+					stream.avail_in = (uInt)Min(len, size_t(ZipMaxChunkSize));
+					in += stream.avail_in;
+					len -= stream.avail_in;
+				}
+				if (stream.avail_out == 0)
+				{
+					if (outLen == 0)
+						break;	// output is larger than limit
+					stream.next_out = outp;
+					stream.avail_out = (uInt)Min(outLen, size_t(ZipMaxChunkSize));
+					outp += stream.avail_out;
+					outLen -= stream.avail_out;
+				}
+				err = deflate(&stream, len > 0 ? Z_NO_FLUSH : Z_FINISH);
+				if (err == Z_BUF_ERROR)
+					err = Z_OK;
+			}
+			size_t result = (err == Z_STREAM_END) ? (size_t)stream.total_out : 0;
+			deflateEnd(&stream);
+			return result;
+		}
+
+		// compress entry, store uncompressed if it is not compressible.
+		static bool ZipCompressEntry(ZipBatchJob* job)
+		{
+			const DKZipArchiver::Entry* entry = job->entry;
+			DKObject<DKStream> stream = entry->stream;
+			if (entry->data)
+				job->source = entry->data;
+			else if (stream && stream->IsReadable())
+			{
+				if (stream->RemainLength() > 0)
+					job->source = DKBuffer::Create(stream).SafeCast<DKData>();
+				else
+					job->source = DKBuffer::Create(NULL, 0).SafeCast<DKData>();
+			}
+			if (job->source == NULL)
+				return false;
+
+			const Bytef* p = reinterpret_cast<const Bytef*>(job->source->Contents());
+			size_t len = job->source->Length();
+
+			job->crc = crc32(0L, Z_NULL, 0);
+			for (size_t offset = 0; offset < len; offset += ZipMaxChunkSize)
+				job->crc = crc32(job->crc, p + offset, (uInt)Min(len - offset, size_t(ZipMaxChunkSize)));
+
+			int level = Clamp(entry->compressionLevel, 0, 9);
+			if (level == 0 || len == 0)
+				return true;
+
+			// test first block of large input with fastest level,
+			// (already compressed data such as images or audio)
+			if (len > ZipSampleSize * 4)
+			{
+				Bytef sample[ZipSampleSize];
+				size_t n = ZipDeflate(p, ZipSampleSize, 1, sample, sizeof(sample));
+				if (n == 0 || n > ZipSampleSize - ZipSampleSize / 32)
+					return true;
+			}
+			// compressed data should be smaller than 97% of input.
+			size_t limit = len - len / 32;
+			DKObject<DKBuffer> buffer = DKBuffer::Create(NULL, limit);
+			if (buffer == NULL)
+				return false;
+			size_t n = ZipDeflate(p, len, level, buffer->MutableContents(), limit);
+			if (n > 0 && n < limit)
+			{
+				buffer->SetContents(buffer->Contents(), n);
+				job->compressed = buffer;
+			}
+			return true;
+		}
+	}
+}
 
 using namespace DKFoundation;
 
@@ -189,3 +301,92 @@ bool DKZipArchiver::Write(const DKString& file, const void* data, size_t len, in
 	}
 	return false;
 }
+
+size_t DKZipArchiver::Write(const Entry* entries, size_t count, DKOperationQueue* queue)
+{
+	if (zipHandle == NULL || entries == NULL)
+		return 0;
+
+	using Job = Private::ZipBatchJob;
+
+	DKCriticalSection<DKLock>	section(lock);
+
+	// write compressed entry as raw data.
+	auto WriteJob = [this](Job* job)->bool
+	{
+		DKStringU8 filenameUTF8(job->entry->name);
+		if (filenameUTF8.Bytes() == 0)
+			return false;
+
+		const void* data = job->source->Contents();
+		size_t len = job->source->Length();
+		int method = 0;
+		int level = 0;
+		if (job->compressed)
+		{
+			data = job->compressed->Contents();
+			len = job->compressed->Length();
+			method = Z_DEFLATED;
+			level = Clamp(job->entry->compressionLevel, 0, 9);
+		}
+		uint64_t uncompressedSize = job->source->Length();
+		int zip64 = (uncompressedSize >= 0xffffffff) ? 1 : 0;
+
+		zip_fileinfo	zinfo;
+		memset(&zinfo, 0, sizeof(zip_fileinfo));
+
+		if (zipOpenNewFileInZip2_64(zipHandle, (const char*)filenameUTF8, &zinfo,
+			NULL,0,NULL,0,NULL, method, level, 1, zip64) != ZIP_OK)
+		{
+			DKLog("[%s] zipOpenNewFileInZip2_64 error!\n", DKGL_FUNCTION_NAME);
+			return false;
+		}
+		const char* cdata = reinterpret_cast<const char*>(data);
+		while (len > 0)
+		{
+			unsigned int toWrite = (unsigned int)Min(len, size_t(Private::ZipMaxChunkSize));
+			if (zipWriteInFileInZip(zipHandle, cdata, toWrite) < 0)
+			{
+				DKLog("[%s] zipWriteInFileInZip error!\n", DKGL_FUNCTION_NAME);
+				return false;
+			}
+			cdata += toWrite;
+			len -= toWrite;
+		}
+		if (zipCloseFileInZipRaw64(zipHandle, uncompressedSize, job->crc) != ZIP_OK)
+		{
+			DKLog("[%s] zipCloseFileInZip error!\n", DKGL_FUNCTION_NAME);
+			return false;
+		}
+		return true;
+	};
+
+	// compress entries concurrently, write in order.
+	size_t next = 0;
+	size_t written = 0;
+	Private::ProcessOrderedJobs<Job>(queue, [&](Job* job, bool& more)->bool
+	{
+		more = next < count;
+		if (more)
+			job->entry = &entries[next++];
+		return true;
+	}, [](Job* job)->bool
+	{
+		if (Private::ZipCompressEntry(job))
+			return true;
+		DKLog("DKZipArchiver Error: Cannot write file: %ls\n", (const wchar_t*)job->entry->name);
+		return false;
+	}, [&](Job* job)->bool
+	{
+		bool result = WriteJob(job);
+		if (result)
+			written++;
+		else
+			DKLog("DKZipArchiver Error: Cannot write file: %ls\n", (const wchar_t*)job->entry->name);
+		// job will be reused for next entry.
+		job->source = NULL;
+		job->compressed = NULL;
+		return result;
+	});
+	return written;
+}
@@ -16,10 +16,25 @@
 
 namespace DKFoundation
 {
+	class DKOperationQueue;
 	/// A zip file writer.
+	///
+	/// Write(const Entry*, size_t, DKOperationQueue*) compresses many files in
+	/// parallel and appends them in given order. Each entry is stored without
+	/// compression if deflate does not reduce size enough.
 	class DKGL_API DKZipArchiver
 	{
 	public:
+		/// file entry for batch writing.
+		/// one of stream or data should be set. (data is used if both are set)
+		struct Entry
+		{
+			DKString			name;
+			DKObject<DKStream>	stream;
+			DKObject<DKData>	data;
+			int					compressionLevel;
+		};
+
 		DKZipArchiver();
 		~DKZipArchiver();
 
@@ -30,6 +45,11 @@ namespace DKFoundation
 		/// (0: no-compression, 9: maximum compression)
 		bool Write(const DKString& file, DKStream* stream, int compressionLevel, const char* password = NULL);
 		bool Write(const DKString& file, const void* data, size_t len, int compressionLevel, const char* password = NULL);
+		/// add many files into zip-archive, files are compressed in parallel
+		/// if queue is not NULL. entries are written in given order.
+		/// returns number of entries written, stops at first error.
+		/// (password is not supported)
+		size_t Write(const Entry* entries, size_t count, DKOperationQueue* queue);
 
 		const DKString& GetArchiveName() const		{return filename;}
 	private:
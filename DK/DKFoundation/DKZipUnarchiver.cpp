@@ -14,46 +14,50 @@
 #include "DKZipUnarchiver.h"
 #include "DKString.h"
 #include "DKLog.h"
+#include "DKHash.h"
+#include "DKCriticalSection.h"
 
 namespace DKFoundation
 {
 	namespace Private
 	{
+		static unzFile OpenZipHandle(const DKString& filename)
+		{
+			unzFile uf = NULL;
+#ifdef _WIN32
+			{
+				zlib_filefunc64_def ffunc;
+				fill_win32_filefunc64W(&ffunc);
+				uf = unzOpen2_64((const wchar_t*)filename, &ffunc); // UTF16LE
+			}
+#else
+			{
+				DKStringU8 filenameUTF8(filename);
+				if (filenameUTF8.Bytes() > 0)
+					uf = unzOpen64((const char*)filenameUTF8); // UTF8
+			}
+#endif
+			return uf;
+		}
+
 		// openning zip file as new handle for extract one file.
 		// we should use separate handles to extract files from one zip file simultaneously.
 		// becouse of each handles calcualte and store hash (crc-32) when reading data,
 		// multiple handle is better for multiple file extracting.
-
+		// (used for encrypted or bzip2 entries, see ZipEntryStream)
 		class UnZipFile : public DKStream
 		{
 		public:
-			static DKObject<UnZipFile> Create(const DKString& zipFile, const DKString& file, const char* password)
+			static DKObject<UnZipFile> Create(const DKString& zipFile, const DKString& file, unz64_file_pos pos, const char* password)
 			{
-				if (zipFile.Length() == 0 || file.Length() == 0)
+				if (zipFile.Length() == 0)
 					return NULL;
 
-				DKString filename = zipFile.FilePathString();
-
-				unzFile uf = NULL;
-#ifdef _WIN32
-				{
-					zlib_filefunc64_def ffunc;
-					fill_win32_filefunc64W(&ffunc);
-					uf = unzOpen2_64((const wchar_t*)filename, &ffunc); // UTF16LE
-				}
-#else
-				{
-					DKStringU8 filenameUTF8(filename);
-					if (filenameUTF8.Bytes() > 0)
-						uf = unzOpen64((const char*)filenameUTF8); // UTF8
-				}
-#endif
+				unzFile uf = OpenZipHandle(zipFile.FilePathString());
 				if (uf)
 				{
 					unz_file_info64 file_info;
-					DKStringU8 fileUTF8(file);
-					if (fileUTF8.Bytes() > 0 &&
-						unzLocateFile(uf, (const char*)fileUTF8, 0) == UNZ_OK &&
+					if (unzGoToFilePos64(uf, &pos) == UNZ_OK &&
 						unzGetCurrentFileInfo64(uf, &file_info, NULL, 0, NULL, 0, NULL, 0) == UNZ_OK &&
 						file_info.uncompressed_size > 0)
 					{
@@ -67,6 +71,7 @@ namespace DKFoundation
 							DKLog("[%s] failed to open file: %ls.\n", DKGL_FUNCTION_NAME, (const wchar_t*)file);
 						}
 					}
+					unzClose(uf);
 				}
 				return NULL;
 			}
@@ -168,6 +173,286 @@ namespace DKFoundation
 			const unz_file_info64	fileInfo;
 			DKArray<char>			password;
 		};
+
+		// stream of stored or deflated entry.
+		// data is read from file handle shared with DKZipUnarchiver by positional read.
+		// deflated entry saves inflate state periodically after first backward seek,
+		// seeking restarts from the nearest checkpoint instead of beginning of entry.
+		// each checkpoint holds copy of inflate state (about 40KB), number of
+		// checkpoints is bounded by doubling interval and dropping every other one.
+		class ZipEntryStream : public DKStream
+		{
+		public:
+			enum : uint64_t
+			{
+				CheckpointInterval = 0x100000,	// initial interval
+				MaxCheckpoints = 64,
+				InputBufferSize = 0x10000,
+			};
+
+			ZipEntryStream(DKFile* f, uint64_t offset, const DKZipUnarchiver::FileInfo& info)
+				: file(f)
+				, dataOffset(offset)
+				, compressedSize(info.compressedSize)
+				, uncompressedSize(info.uncompressedSize)
+				, deflated(info.method == DKZipUnarchiver::MethodDeflated)
+				, expectedCRC(info.crc32)
+				, position(0)
+				, compressedPos(0)
+				, inputBuffer(NULL)
+				, checkpointInterval(0)
+				, crcPosition(0)
+				, crcValue(::crc32(0L, Z_NULL, 0))
+			{
+				DKASSERT_DEBUG(file != NULL);
+				memset(&stream, 0, sizeof(z_stream));
+				if (deflated)
+				{
+					inputBuffer = (Bytef*)DKMalloc((size_t)Min(compressedSize, uint64_t(InputBufferSize)) + 1);
+					if (inputBuffer == NULL)
+						DKLogE("[%s] Error: Out of memory!\n", DKGL_FUNCTION_NAME);
+					if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+						DKERROR_THROW_DEBUG("inflateInit2 failed!");
+				}
+			}
+			~ZipEntryStream()
+			{
+				if (deflated)
+				{
+					inflateEnd(&stream);
+					for (Checkpoint& ck : checkpoints)
+					{
+						inflateEnd(ck.state);
+						delete ck.state;
+					}
+					if (inputBuffer)
+						DKFree(inputBuffer);
+				}
+			}
+
+			Position SetCurrentPosition(Position p) override
+			{
+				if (p > uncompressedSize)
+					return PositionError;
+				if (p == position)
+					return p;
+				if (!deflated)
+				{
+					position = p;
+					return p;
+				}
+
+				// sequential reader does not need checkpoints,
+				// start saving checkpoints from first backward seek.
+				if (p < position && checkpointInterval == 0)
+					checkpointInterval = CheckpointInterval;
+
+				// restore nearest checkpoint, if it is closer than current position.
+				const Checkpoint* ck = NULL;
+				for (const Checkpoint& c : checkpoints)
+				{
+					if (c.position > p)
+						break;
+					ck = &c;
+				}
+				uint64_t restorePosition = ck ? ck->position : 0;
+				if (p < position || restorePosition > position)
+				{
+					if (ck == NULL)
+					{
+						if (inflateReset(&stream) != Z_OK)
+							return PositionError;
+						compressedPos = 0;
+					}
+					else
+					{
+						inflateEnd(&stream);
+						if (inflateCopy(&stream, ck->state) != Z_OK)
+						{
+							DKLogE("[%s] Error: inflateCopy failed.\n", DKGL_FUNCTION_NAME);
+							memset(&stream, 0, sizeof(z_stream));
+							inflateInit2(&stream, -MAX_WBITS);
+							compressedPos = 0;
+							restorePosition = 0;
+						}
+						else
+						{
+							compressedPos = ck->input;
+						}
+					}
+					stream.next_in = NULL;
+					stream.avail_in = 0;
+					position = restorePosition;
+				}
+				// decode and discard until p.
+				Bytef buffer[0x4000];
+				while (position < p)
+				{
+					size_t n = (size_t)Min(p - position, Position(sizeof(buffer)));
+					if (Inflate(buffer, n) != n)
+						return PositionError;
+				}
+				return position;
+			}
+			Position CurrentPosition() const override
+			{
+				return position;
+			}
+			Position RemainLength() const override
+			{
+				return uncompressedSize - position;
+			}
+			Position TotalLength() const override
+			{
+				return uncompressedSize;
+			}
+			size_t Read(void* p, size_t s) override
+			{
+				if (s == 0)
+					return 0;
+				if (p == NULL)
+					return 0;
+
+				s = (size_t)Min(uint64_t(s), uncompressedSize - position);
+				if (deflated)
+					return Inflate(reinterpret_cast<Bytef*>(p), s);
+
+				size_t numRead = file->ReadAt(dataOffset + position, p, s);
+				if (numRead == (size_t)-1)
+					return 0;
+				UpdateCRC(reinterpret_cast<const Bytef*>(p), numRead);
+				position += numRead;
+				return numRead;
+			}
+			size_t Write(const void*, size_t) override
+			{
+				return 0;
+			}
+
+			bool IsReadable() const override {return true;}
+			bool IsWritable() const override {return false;}
+			bool IsSeekable() const override {return true;}
+
+		private:
+			struct Checkpoint
+			{
+				uint64_t position;		// uncompressed position
+				uint64_t input;			// compressed bytes consumed
+				z_stream* state;
+			};
+
+			size_t Inflate(Bytef* out, size_t size)
+			{
+				if (inputBuffer == NULL)
+					return 0;
+
+				size_t total = 0;
+				while (total < size && position < uncompressedSize)
+				{
+					if (stream.avail_in == 0 && compressedPos < compressedSize)
+					{
+						size_t toRead = (size_t)Min(compressedSize - compressedPos, uint64_t(InputBufferSize));
+						size_t numRead = file->ReadAt(dataOffset + compressedPos, inputBuffer, toRead);
+						if (numRead == 0 || numRead == (size_t)-1)
+						{
+							DKLogE("[%s] Error: file read failed.\n", DKGL_FUNCTION_NAME);
+							break;
+						}
+						stream.next_in = inputBuffer;
+						stream.avail_in = (uInt)numRead;
+						compressedPos += numRead;
+					}
+					// stop at next checkpoint boundary to save state at there.
+					uint64_t boundary = uncompressedSize;
+					if (checkpointInterval > 0)
+						boundary = (position / checkpointInterval + 1) * checkpointInterval;
+					size_t n = (size_t)Min(uint64_t(size - total), boundary - position);
+					n = Min(n, size_t(0x40000000));
+
+					stream.next_out = out + total;
+					stream.avail_out = (uInt)n;
+					int err = inflate(&stream, Z_NO_FLUSH);
+					size_t produced = n - stream.avail_out;
+					UpdateCRC(out + total, produced);
+					total += produced;
+					position += produced;
+
+					if (err == Z_STREAM_END)
+						break;
+					if (err != Z_OK && err != Z_BUF_ERROR)
+					{
+						DKLogE("[%s] Error: inflate failed (%d).\n", DKGL_FUNCTION_NAME, err);
+						break;
+					}
+					if (produced == 0 && stream.avail_in == 0 && compressedPos >= compressedSize)
+						break;
+
+					if (position == boundary && position < uncompressedSize &&
+						(checkpoints.IsEmpty() || checkpoints.Value(checkpoints.Count() - 1).position < position))
+					{
+						SaveCheckpoint();
+					}
+				}
+				return total;
+			}
+			void SaveCheckpoint()
+			{
+				Checkpoint ck = { position, compressedPos - stream.avail_in, new z_stream };
+				if (inflateCopy(ck.state, &stream) != Z_OK)
+				{
+					delete ck.state;
+					return;
+				}
+				checkpoints.Add(ck);
+
+				if (checkpoints.Count() > MaxCheckpoints)
+				{
+					// double interval, keep checkpoints on new interval only.
+					checkpointInterval *= 2;
+					size_t count = 0;
+					for (Checkpoint& c : checkpoints)
+					{
+						if (c.position % checkpointInterval == 0)
+						{
+							checkpoints.Value(count++) = c;
+						}
+						else
+						{
+							inflateEnd(c.state);
+							delete c.state;
+						}
+					}
+					checkpoints.Remove(count, checkpoints.Count() - count);
+				}
+			}
+			// verify crc of sequentially decoded data.
+			void UpdateCRC(const Bytef* p, size_t len)
+			{
+				if (len > 0 && position == crcPosition)
+				{
+					crcValue = ::crc32(crcValue, p, (uInt)len);
+					crcPosition += len;
+					if (crcPosition == uncompressedSize && crcValue != expectedCRC)
+						DKLogE("[%s] Error: CRC mismatch.\n", DKGL_FUNCTION_NAME);
+				}
+			}
+
+			DKObject<DKFile>	file;
+			const uint64_t		dataOffset;
+			const uint64_t		compressedSize;
+			const uint64_t		uncompressedSize;
+			const bool			deflated;
+			const uLong			expectedCRC;
+
+			uint64_t			position;			// uncompressed position
+			uint64_t			compressedPos;		// compressed bytes read from file
+			z_stream			stream;
+			Bytef*				inputBuffer;
+			DKArray<Checkpoint>	checkpoints;		// ordered by position
+			uint64_t			checkpointInterval;	// zero if checkpoints are not used yet
+			uint64_t			crcPosition;
+			uLong				crcValue;
+		};
 	}
 }
 
@@ -194,33 +479,30 @@ DKObject<DKZipUnarchiver> DKZipUnarchiver::Create(const DKString& file)
 
 	DKString filename = file.FilePathString();
 
-	unzFile uf = NULL;
-#ifdef _WIN32
-	{
-		zlib_filefunc64_def ffunc;
-		fill_win32_filefunc64W(&ffunc);
-		uf = unzOpen2_64((const wchar_t*)filename, &ffunc); // UTF16LE
-	}
-#else
-	{
-		DKStringU8 filenameUTF8(filename);
-		if (filenameUTF8.Bytes() > 0)
-			uf = unzOpen64((const char*)filenameUTF8); // UTF8
-	}
-#endif
+	unzFile uf = Private::OpenZipHandle(filename);
 	if (uf)
 	{
-		DKArray<FileInfo>	filesArray;
+		DKObject<DKZipUnarchiver> unarchiver = DKObject<DKZipUnarchiver>::New();
+		unarchiver->zipHandle = uf;
+		unarchiver->filename = filename;
+
+		DKArray<FileInfo>& filesArray = unarchiver->files;
+		DKArray<Entry>& entries = unarchiver->entries;
 		unz_global_info64 gi;
 		int err = unzGetGlobalInfo64(uf,&gi);
 		if (err == UNZ_OK)
 		{
 			filesArray.Reserve(gi.number_entry);
+			entries.Reserve(gi.number_entry);
+			unarchiver->index.Reserve(gi.number_entry);
 			for (int i = 0; i < gi.number_entry; i++)
 			{
 				DKUniChar8 filename_inzip[1024];
 				unz_file_info64 file_info;
+				unz64_file_pos file_pos;
 				err = unzGetCurrentFileInfo64(uf,&file_info,filename_inzip,sizeof(filename_inzip),NULL,0,NULL,0);
+				if (err == UNZ_OK)
+					err = unzGetFilePos64(uf, &file_pos);
 				if (err == UNZ_OK)
 				{
 					FileInfo	file;
@@ -257,6 +539,24 @@ DKObject<DKZipUnarchiver> DKZipUnarchiver::Create(const DKString& file)
 						}
 						file.crc32 = file_info.crc;
 						file.date = DKDateTime(file_info.tmu_date.tm_year, file_info.tmu_date.tm_mon, file_info.tmu_date.tm_mday, file_info.tmu_date.tm_hour, file_info.tmu_date.tm_min, file_info.tmu_date.tm_sec, 0);
+
+						Entry entry = { file_pos.pos_in_zip_directory, file_pos.num_of_file, 0, InvalidIndex };
+						size_t entryIndex = entries.Add(entry);
+
+						// index by lowercase name, entries with same name are chained.
+						DKString key = file.name.LowercaseString();
+						auto* p = unarchiver->index.Find(key);
+						if (p)
+						{
+							size_t last = p->value;
+							while (entries.Value(last).next != InvalidIndex)
+								last = entries.Value(last).next;
+							entries.Value(last).next = entryIndex;
+						}
+						else
+						{
+							unarchiver->index.Insert(key, entryIndex);
+						}
 						filesArray.Add(file);
 					}
 				}
@@ -275,11 +575,8 @@ DKObject<DKZipUnarchiver> DKZipUnarchiver::Create(const DKString& file)
 				}
 			}
 
-			DKObject<DKZipUnarchiver> unarchiver = DKObject<DKZipUnarchiver>::New();
-			unarchiver->zipHandle = uf;
-			unarchiver->filename = filename;
-			unarchiver->files = filesArray;
-
+			// shared file handle for reading entries without minizip.
+			unarchiver->file = DKFile::Create(filename, DKFile::ModeOpenReadOnly, DKFile::ModeShareAll);
 			return unarchiver;
 		}
 		else
@@ -295,29 +592,194 @@ DKObject<DKZipUnarchiver> DKZipUnarchiver::Create(const DKString& file)
 	return NULL;
 }
 
-const DKZipUnarchiver::FileInfo* DKZipUnarchiver::GetFileInfo(const DKString& file) const
+size_t DKZipUnarchiver::FindEntry(const DKString& file, bool caseSensitive) const
 {
-	for (int i = 0; i < files.Count(); i++)
+	if (file.Length() > 0)
 	{
-		if (file.CompareNoCase(files.Value(i).name) == 0)
-			return &(files.Value(i));
+		auto* p = index.Find(file.LowercaseString());
+		if (p)
+		{
+			if (!caseSensitive)
+				return p->value;
+			for (size_t i = p->value; i != InvalidIndex; i = entries.Value(i).next)
+			{
+				if (file.Compare(files.Value(i).name) == 0)
+					return i;
+			}
+		}
 	}
+	return InvalidIndex;
+}
+
+const DKZipUnarchiver::FileInfo* DKZipUnarchiver::GetFileInfo(const DKString& file) const
+{
+	size_t i = FindEntry(file, false);
+	if (i != InvalidIndex)
+		return &(files.Value(i));
 	return NULL;
 }
 
+size_t DKZipUnarchiver::FindEntry(const DKString& file) const
+{
+	// case sensitivity follows minizip default (unzLocateFile).
+#if defined(__linux__) || (defined(__unix__) && !defined(__APPLE__))
+	return FindEntry(file, true);
+#else
+	return FindEntry(file, false);
+#endif
+}
+
+uint64_t DKZipUnarchiver::DataOffset(size_t i) const
+{
+	const Entry& entry = entries.Value(i);
+
+	DKCriticalSection<DKMutex> guard(lock);
+	if (entry.dataOffset == 0)
+	{
+		unz64_file_pos pos;
+		pos.pos_in_zip_directory = entry.directoryPos;
+		pos.num_of_file = entry.fileNumber;
+
+		// open raw entry to read local header.
+		if (unzGoToFilePos64(zipHandle, &pos) == UNZ_OK &&
+			unzOpenCurrentFile2(zipHandle, NULL, NULL, 1) == UNZ_OK)
+		{
+			entry.dataOffset = unzGetCurrentFileZStreamPos64(zipHandle);
+			unzCloseCurrentFile(zipHandle);
+		}
+	}
+	return entry.dataOffset;
+}
+
 DKObject<DKStream> DKZipUnarchiver::OpenFileStream(const DKString& file, const char* password) const
 {
-	// check file is exists, open if file exists.
-	DKStringU8 fileUTF8(file);
+	size_t i = FindEntry(file);
+	if (i == InvalidIndex)
+		return NULL;
 
-	unz_file_info64 file_info;
+	const FileInfo& info = files.Value(i);
+	const Entry& entry = entries.Value(i);
+	if (info.directory || info.uncompressedSize == 0)
+		return NULL;
 
-	if (fileUTF8.Bytes() > 0 &&
-		unzLocateFile(zipHandle, (const char*)fileUTF8, 0) == UNZ_OK &&
-		unzGetCurrentFileInfo64(zipHandle, &file_info, NULL, 0, NULL, 0, NULL, 0) == UNZ_OK &&
-		file_info.uncompressed_size > 0)
+	if (this->file && !info.crypted &&
+		(info.method == MethodStored || info.method == MethodDeflated))
 	{
-		return Private::UnZipFile::Create(filename, file, password).SafeCast<DKStream>();
+		uint64_t offset = DataOffset(i);
+		if (offset > 0)
+		{
+			// streams share file handle, read by DKFile::ReadAt only.
+			DKFile* f = const_cast<DKFile*>(static_cast<const DKFile*>(this->file));
+			return DKOBJECT_NEW Private::ZipEntryStream(f, offset, info);
+		}
 	}
+
+	unz64_file_pos pos;
+	pos.pos_in_zip_directory = entry.directoryPos;
+	pos.num_of_file = entry.fileNumber;
+	return Private::UnZipFile::Create(filename, file, pos, password).SafeCast<DKStream>();
+}
+
+DKObject<DKData> DKZipUnarchiver::OpenFileData(const DKString& file, bool mapFileIfPossible, const char* password) const
+{
+	size_t i = FindEntry(file);
+	if (i == InvalidIndex)
+		return NULL;
+
+	const FileInfo& info = files.Value(i);
+	if (info.directory || info.uncompressedSize == 0)
+		return NULL;
+
+	if (this->file && !info.crypted &&
+		(info.method == MethodStored || info.method == MethodDeflated))
+	{
+		uint64_t offset = DataOffset(i);
+		if (offset > 0)
+		{
+			DKFile* f = const_cast<DKFile*>(static_cast<const DKFile*>(this->file));
+			if (info.method == MethodStored)
+			{
+				// stored entry can be mapped directly, no copy.
+				if (mapFileIfPossible)
+				{
+					DKObject<DKData> data = f->MapContentRange((size_t)offset, info.uncompressedSize);
+					if (data)
+						return data;
+				}
+				DKObject<DKBuffer> buffer = DKBuffer::Create(NULL, info.uncompressedSize);
+				if (buffer && f->ReadAt(offset, buffer->MutableContents(), info.uncompressedSize) == info.uncompressedSize)
+					return buffer.SafeCast<DKData>();
+				return NULL;
+			}
+
+			// inflate whole entry into buffer of exact size at once.
+			// compressed data is mapped if possible, read into temporary buffer otherwise.
+			DKObject<DKData> input = NULL;
+			if (mapFileIfPossible)
+				input = f->MapContentRange((size_t)offset, info.compressedSize);
+			if (input == NULL)
+			{
+				DKObject<DKBuffer> tmp = DKBuffer::Create(NULL, info.compressedSize);
+				if (tmp && f->ReadAt(offset, tmp->MutableContents(), info.compressedSize) == info.compressedSize)
+					input = tmp.SafeCast<DKData>();
+			}
+			DKObject<DKBuffer> output = DKBuffer::Create(NULL, info.uncompressedSize);
+			if (input && output)
+			{
+				z_stream stream;
+				memset(&stream, 0, sizeof(z_stream));
+				if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+					return NULL;
+
+				Bytef* in = (Bytef*)input->Contents();
+				Bytef* out = (Bytef*)output->MutableContents();
+				size_t inputLength = info.compressedSize;
+				size_t outputLength = info.uncompressedSize;
+				int err = Z_OK;
+				while (err == Z_OK)
+				{
+					// avail_in, avail_out is 32 bits.
+					if (stream.avail_in == 0)
+					{
+						stream.next_in = in;
+						stream.avail_in = (uInt)Min(inputLength, size_t(0x40000000));
+						in += stream.avail_in;
+						inputLength -= stream.avail_in;
+					}
+					if (stream.avail_out == 0)
+					{
+						stream.next_out = out;
+						stream.avail_out = (uInt)Min(outputLength, size_t(0x40000000));
+						out += stream.avail_out;
+						outputLength -= stream.avail_out;
+					}
+					err = inflate(&stream, Z_NO_FLUSH);
+					if (err == Z_BUF_ERROR && ((stream.avail_in == 0 && inputLength > 0) || (stream.avail_out == 0 && outputLength > 0)))
+						err = Z_OK;
+				}
+				// total_out is uLong, which is 32 bits on Windows.
+				uint64_t produced = info.uncompressedSize - outputLength - stream.avail_out;
+				inflateEnd(&stream);
+
+				if (err != Z_STREAM_END || produced != info.uncompressedSize)
+				{
+					DKLogE("[%s] Error: inflate failed (%d).\n", DKGL_FUNCTION_NAME, err);
+					return NULL;
+				}
+				if (DKHashCRC32(output->Contents(), info.uncompressedSize).digest[0] != info.crc32)
+				{
+					DKLogE("[%s] Error: CRC mismatch.\n", DKGL_FUNCTION_NAME);
+					return NULL;
+				}
+				return output.SafeCast<DKData>();
+			}
+			return NULL;
+		}
+	}
+
+	// encrypted or other compression method.
+	DKObject<DKStream> stream = OpenFileStream(file, password);
+	if (stream)
+		return DKBuffer::Create(stream).SafeCast<DKData>();
 	return NULL;
 }
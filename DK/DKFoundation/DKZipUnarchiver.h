@@ -12,11 +12,20 @@
 #include "DKDateTime.h"
 #include "DKArray.h"
 #include "DKStream.h"
+#include "DKFile.h"
+#include "DKMutex.h"
 
 namespace DKFoundation
 {
 	/// A zip file reader.
 	/// read and decompress from zip-archive file.
+	///
+	/// Entries are indexed by name when archive is opened, lookup does not
+	/// scan central directory. Stored and deflated entries are read through
+	/// a file handle shared by all streams (positional read), and deflated
+	/// streams keep inflate checkpoints to seek without decompressing from
+	/// beginning of the entry. Stored entries can be mapped into memory
+	/// directly with OpenFileData.
 	class DKGL_API DKZipUnarchiver
 	{
 	public:
@@ -49,11 +58,31 @@ namespace DKFoundation
 		const FileInfo* GetFileInfo(const DKString& file) const;
 
 		DKObject<DKStream> OpenFileStream(const DKString& file, const char* password = NULL) const;
+		/// load whole file content.
+		/// stored (uncompressed) file is mapped from archive without copy if mapFileIfPossible is true,
+		/// compressed file is decompressed into a buffer of exact size.
+		DKObject<DKData> OpenFileData(const DKString& file, bool mapFileIfPossible = true, const char* password = NULL) const;
 
 		const DKString& GetArchiveName() const		{return filename;}
 	private:
+		struct Entry
+		{
+			uint64_t	directoryPos;	///< entry position in central directory
+			uint64_t	fileNumber;		///< entry number in archive
+			mutable uint64_t dataOffset;	///< file data offset, resolved on first open (0 if not)
+			size_t		next;			///< next entry which has same name ignoring case
+		};
+		enum : size_t { InvalidIndex = (size_t)-1 };
+		size_t FindEntry(const DKString& file, bool caseSensitive) const;
+		size_t FindEntry(const DKString& file) const;
+		uint64_t DataOffset(size_t index) const;
+
 		void*							zipHandle;
 		DKArray<FileInfo>				files;
+		DKArray<Entry>					entries;	///< same order with files
+		DKHashMap<DKString, size_t>		index;		///< lowercase name -> first entry
+		DKObject<DKFile>				file;		///< shared handle for reading data
+		DKMutex							lock;		///< lock for zipHandle
 		DKString						filename;
 	};
 }
@@ -0,0 +1,108 @@
+//
+//  File: OrderedJobs.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2022 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include "../../DKInclude.h"
+#include "../DKObject.h"
+#include "../DKArray.h"
+#include "../DKFunction.h"
+#include "../DKOperationQueue.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// OrderedJobs.h
+// Ordered job pipeline shared by DKCompressor block format and DKZipArchiver
+// batch write. jobs are processed concurrently with operation queue and
+// written in reading order.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	namespace Private
+	{
+		/// process jobs in order, running up to 'window' jobs concurrently.
+		/// jobs are processed on calling thread if queue is NULL.
+		/// - readNext(Job*, bool& next) reads next job input, sets next to
+		///   false to finish. returns false on error.
+		/// - process(Job*) processes job, returns false on error.
+		/// - writeJob(Job*) writes result, returns false to stop.
+		/// returns true if all jobs have been processed and written.
+		template <typename Job, typename ReadFunc, typename ProcessFunc, typename WriteFunc>
+		bool ProcessOrderedJobs(DKOperationQueue* queue, ReadFunc&& readNext, ProcessFunc&& process, WriteFunc&& writeJob)
+		{
+			struct Slot
+			{
+				Job job;
+				bool result = false;
+				DKObject<DKOperationQueue::OperationSync> sync;
+			};
+
+			size_t window = 1;
+			if (queue)
+				window = Max(queue->MaxConcurrentOperations(), size_t(1)) * 2;
+
+			// ring buffer of slots, jobs are reused after written.
+			DKArray<DKObject<Slot>> slots;
+			slots.Reserve(window);
+			size_t first = 0;
+			size_t numPending = 0;
+			bool result = true;
+			auto Flush = [&]()
+			{
+				Slot* slot = slots.Value(first);
+				if (slot->sync)
+				{
+					// job operation not started yet (or cancelled by queue),
+					// process it here. (no deadlock in operation of queue)
+					if (slot->sync->Cancel() || !slot->sync->Sync())
+					{
+						if (result)
+							slot->result = process(&slot->job);
+					}
+					slot->sync = NULL;
+				}
+				if (result)
+					result = slot->result && writeJob(&slot->job);
+				first = (first + 1) % window;
+				numPending--;
+			};
+			while (result)
+			{
+				size_t index = (first + numPending) % window;
+				if (index >= slots.Count())
+					slots.Add(DKOBJECT_NEW Slot());
+				Slot* slot = slots.Value(index);
+
+				bool next = false;
+				if (!readNext(&slot->job, next))
+				{
+					result = false;
+					break;
+				}
+				if (!next)
+					break;
+
+				if (queue)
+				{
+					slot->sync = queue->ProcessAsync(DKFunction([slot, &process]()
+					{
+						slot->result = process(&slot->job);
+					})->Invocation());
+				}
+				else
+				{
+					slot->result = process(&slot->job);
+				}
+				numPending++;
+				while (numPending >= window)
+					Flush();
+			}
+			while (numPending > 0)
+				Flush();
+			return result;
+		}
+	}
+}
@@ -9,12 +9,47 @@
 #include <cstdlib>
 #include "DKMath.h"
 #include "DKBvh.h"
+#include "Private/ParallelScheduler.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DKGL_BVH_RAY_PACKET_SSE 1
+#else
+#define DKGL_BVH_RAY_PACKET_SSE 0
+#endif
 
 #define MAX_NODE_COUNT (0x7fffffff >> 1)
 
 using namespace DKFramework;
 
-DKBvh::DKBvh() : volume(NULL)
+namespace DKFramework
+{
+	namespace Private
+	{
+		enum
+		{
+			BvhSAHBinCount = 16,
+			BvhMaxSAHDepth = 48,			// split in median from this depth.
+			BvhParallelBuildLeaves = 4096,	// minimum leaves of subtree task.
+			BvhParallelRayPackets = 64,		// minimum packets of ray-test task.
+		};
+		static_assert(DKBvh::RayPacket::MaxRays == 4, "RayPacket should be 4 wide for SSE");
+
+		// interleave lower 10 bits with 2 zero bits, for morton code.
+		inline uint32_t SpreadBits10(uint32_t v)
+		{
+			v &= 0x3ff;
+			v = (v | (v << 16)) & 0x030000ff;
+			v = (v | (v << 8)) & 0x0300f00f;
+			v = (v | (v << 4)) & 0x030c30c3;
+			v = (v | (v << 2)) & 0x09249249;
+			return v;
+		}
+	}
+}
+using namespace DKFramework::Private;
+
+DKBvh::DKBvh() : volume(NULL), numObjects(0)
 {
 }
 
@@ -22,18 +57,30 @@ DKBvh::~DKBvh()
 {
 }
 
-void DKBvh::Build(VolumeInterface* vi)
+void DKBvh::Build(VolumeInterface* vi, DKOperationQueue* queue)
 {
 	this->volume = vi;
-	BuildInternal();
+	BuildInternal(queue);
+}
+
+void DKBvh::Rebuild(DKOperationQueue* queue)
+{
+	BuildInternal(queue);
 }
 
-void DKBvh::Rebuild()
+void DKBvh::QuantizeAabb(const DKAabb& aabb, QuantizedAabbNode& node) const
 {
-	BuildInternal();
+	// quantize conservatively, node should contain whole aabb.
+	for (int i = 0; i < 3; ++i)
+	{
+		float minValue = (aabb.positionMin.val[i] - this->aabbOffset.val[i]) / this->aabbScale.val[i] * float(0xffff);
+		float maxValue = (aabb.positionMax.val[i] - this->aabbOffset.val[i]) / this->aabbScale.val[i] * float(0xffff);
+		node.aabbMin[i] = static_cast<unsigned short>(Min(Max(floor(minValue), 0.0f), float(0xffff)));
+		node.aabbMax[i] = static_cast<unsigned short>(Min(Max(ceil(maxValue), 0.0f), float(0xffff)));
+	}
 }
 
-void DKBvh::BuildInternal()
+void DKBvh::BuildInternal(DKOperationQueue* queue)
 {
 	if (this->volume)
 	{
@@ -44,6 +91,7 @@ void DKBvh::BuildInternal()
 
 		// Query all leaf-nodes (all triangles)
 		int numTriangles = this->volume->NumberOfObjects();
+		this->numObjects = numTriangles;
 		if (numTriangles > 0)
 		{
 			struct LeafNode
@@ -88,16 +136,8 @@ void DKBvh::BuildInternal()
 			quantizedLeafNodes.Reserve(leafNodes.Count());
 			for (LeafNode& n : leafNodes)
 			{
-				DKVector3 aabbMin = (n.aabb.positionMin - this->aabbOffset) / this->aabbScale * float(0xffff);
-				DKVector3 aabbMax = (n.aabb.positionMax - this->aabbOffset) / this->aabbScale * float(0xffff);
-
 				QuantizedAabbNode node;
-				node.aabbMin[0] = aabbMin.val[0];
-				node.aabbMin[1] = aabbMin.val[1];
-				node.aabbMin[2] = aabbMin.val[2];
-				node.aabbMax[0] = aabbMax.val[0];
-				node.aabbMax[1] = aabbMax.val[1];
-				node.aabbMax[2] = aabbMax.val[2];
+				QuantizeAabb(n.aabb, node);
 				node.objectIndex = n.objectIndex;
 				quantizedLeafNodes.Add(node);
 			}
@@ -105,8 +145,63 @@ void DKBvh::BuildInternal()
 
 		if (quantizedLeafNodes.Count() > 0 && quantizedLeafNodes.Count() < MAX_NODE_COUNT)
 		{
-			nodes.Reserve(quantizedLeafNodes.Count() * 2);
-			BuildTree(quantizedLeafNodes, (int)quantizedLeafNodes.Count());
+			// tree of N leaves has (2N - 1) nodes.
+			int count = (int)quantizedLeafNodes.Count();
+			nodes.Resize(count * 2 - 1);
+
+			size_t maxThreads = queue ? queue->MaxConcurrentOperations() : 1;
+			if (maxThreads > 1 && count > BvhParallelBuildLeaves * 2)
+			{
+				// split top-level nodes on this thread, until there are
+				// enough subtrees, then build subtrees in parallel.
+				struct Subtree
+				{
+					QuantizedAabbNode* leafNodes;
+					int count;
+					QuantizedAabbNode* output;
+					int depth;
+				};
+				struct TopLevelSplit
+				{
+					DKArray<Subtree> subtrees;
+					DKArray<QuantizedAabbNode*> parents;
+					int subtreeLeaves;
+					void operator () (QuantizedAabbNode* leafNodes, int count, QuantizedAabbNode* output, int depth)
+					{
+						if (count <= subtreeLeaves)
+						{
+							subtrees.Add({ leafNodes, count, output, depth });
+							return;
+						}
+						int split = DKBvh::PartitionLeafNodes(leafNodes, count, depth);
+						parents.Add(output);
+						this->operator()(leafNodes, split, &output[1], depth + 1);
+						this->operator()(&leafNodes[split], count - split, &output[split * 2], depth + 1);
+					}
+				} topLevel;
+				topLevel.subtreeLeaves = Max(count / int(maxThreads * 4), int(BvhParallelBuildLeaves));
+				topLevel(quantizedLeafNodes, count, nodes, 0);
+
+				// calling thread builds subtrees too, subtrees not started by
+				// queue are built here. (no deadlock in operation of queue)
+				ParallelScheduler scheduler(queue);
+				scheduler.ParallelFor(topLevel.subtrees.Count(), 1, [&](size_t begin, size_t end)
+				{
+					for (size_t i = begin; i < end; ++i)
+					{
+						const Subtree& st = topLevel.subtrees.Value(i);
+						BuildTree(st.leafNodes, st.count, st.output, st.depth);
+					}
+				});
+
+				// update top-level nodes, children first.
+				for (size_t i = topLevel.parents.Count(); i > 0; --i)
+					MergeChildNodes(*topLevel.parents.Value(i - 1));
+			}
+			else
+			{
+				BuildTree(quantizedLeafNodes, count, nodes, 0);
+			}
 		}
 
 		this->volume->Unlock();
@@ -115,6 +210,89 @@ void DKBvh::BuildInternal()
 		nodes.Clear();
 }
 
+bool DKBvh::Refit()
+{
+	if (this->volume)
+	{
+		this->volume->Lock();
+		if (this->volume->NumberOfObjects() != this->numObjects)
+		{
+			this->volume->Unlock();
+			return false;
+		}
+
+		int count = (int)this->nodes.Count();
+		QuantizedAabbNode* nodes = this->nodes;
+
+		DKArray<DKAabb> leafAabbs;
+		leafAabbs.Reserve((count + 1) / 2);
+
+		DKAabb aabb;
+		aabb.positionMin = DKVector3(FLT_MAX, FLT_MAX, FLT_MAX);
+		aabb.positionMax = DKVector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (int i = 0; i < count; ++i)
+		{
+			if (nodes[i].objectIndex >= 0)
+			{
+				DKAabb box = this->volume->AabbForObjectAtIndex(nodes[i].objectIndex);
+				if (box.IsValid())
+				{
+					for (int k = 0; k < 3; ++k)
+					{
+						if (aabb.positionMin.val[k] > box.positionMin.val[k])
+							aabb.positionMin.val[k] = box.positionMin.val[k];
+						if (aabb.positionMax.val[k] < box.positionMax.val[k])
+							aabb.positionMax.val[k] = box.positionMax.val[k];
+					}
+				}
+				leafAabbs.Add(box);
+			}
+		}
+		this->volume->Unlock();
+
+		if (aabb.IsValid())
+		{
+			// quantization range can be changed, all nodes should be updated.
+			DKVector3 scale = aabb.positionMax - aabb.positionMin;
+			this->aabbScale.x = Max(scale.x, 0.00001);
+			this->aabbScale.y = Max(scale.y, 0.00001);
+			this->aabbScale.z = Max(scale.z, 0.00001);
+			this->aabbOffset = aabb.positionMin;
+		}
+
+		// leaf nodes, in tree order.
+		size_t leafIndex = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			QuantizedAabbNode& node = nodes[i];
+			if (node.objectIndex >= 0)
+			{
+				const DKAabb& box = leafAabbs.Value(leafIndex++);
+				if (box.IsValid())
+				{
+					QuantizeAabb(box, node);
+				}
+				else	// empty node, merged parent will not be affected.
+				{
+					for (int k = 0; k < 3; ++k)
+					{
+						node.aabbMin[k] = 0xffff;
+						node.aabbMax[k] = 0;
+					}
+				}
+			}
+		}
+		// sub-nodes, children are placed after parent.
+		for (int i = count - 1; i >= 0; --i)
+		{
+			if (nodes[i].objectIndex < 0)
+				MergeChildNodes(nodes[i]);
+		}
+		return true;
+	}
+	return false;
+}
+
 DKAabb DKBvh::Aabb() const
 {
 	if (volume)
@@ -124,113 +302,192 @@ DKAabb DKBvh::Aabb() const
 	return DKAabb();
 }
 
-#define BVH_PARTITION_FULL_SORT	1
-
-void DKBvh::BuildTree(QuantizedAabbNode* leafNodes, int count)
+void DKBvh::MergeChildNodes(QuantizedAabbNode& node)
 {
-	DKASSERT_DEBUG(leafNodes);
-	DKASSERT_DEBUG(count > 0);
+	// left child is next to node, right child is next to left subtree.
+	QuantizedAabbNode* left = &node + 1;
+	int leftSize = left->objectIndex >= 0 ? 1 : -left->negativeTreeSize;
+	QuantizedAabbNode* right = left + leftSize;
+	int rightSize = right->objectIndex >= 0 ? 1 : -right->negativeTreeSize;
 
-	if (count == 1)	// leaf-node
+	for (int i = 0; i < 3; ++i)
 	{
-		this->nodes.Add(leafNodes[0]);
-		return;
+		node.aabbMin[i] = Min(left->aabbMin[i], right->aabbMin[i]);
+		node.aabbMax[i] = Max(left->aabbMax[i], right->aabbMax[i]);
 	}
+	node.negativeTreeSize = -(1 + leftSize + rightSize);
+}
 
-	using VectorI64 = int64_t[3];
-	using VectorI32 = int32_t[3];
-	using VectorI16 = int16_t[3];
+int DKBvh::PartitionLeafNodes(QuantizedAabbNode* leafNodes, int count, int depth)
+{
+	DKASSERT_DEBUG(count > 1);
+	if (count == 2)
+		return 1;
 
-	// calculate means
-	VectorI32 means;
-	if (1)
+	// centroid of node is (aabbMin + aabbMax), without divide.
+	auto centroid = [](const QuantizedAabbNode& node, int axis)->int32_t
 	{
-		VectorI64 tmp = { 0, 0, 0 };
-		for (int i = 0; i < count; ++i)
+		return int32_t(node.aabbMin[axis]) + int32_t(node.aabbMax[axis]);
+	};
+
+	int32_t centroidMin[3] = { INT32_MAX, INT32_MAX, INT32_MAX };
+	int32_t centroidMax[3] = { INT32_MIN, INT32_MIN, INT32_MIN };
+	for (int i = 0; i < count; ++i)
+	{
+		for (int k = 0; k < 3; ++k)
 		{
-			QuantizedAabbNode& node = leafNodes[i];
-			tmp[0] += node.aabbMin[0] + node.aabbMax[0];
-			tmp[1] += node.aabbMin[1] + node.aabbMax[1];
-			tmp[2] += node.aabbMin[2] + node.aabbMax[2];
+			int32_t c = centroid(leafNodes[i], k);
+			centroidMin[k] = Min(centroidMin[k], c);
+			centroidMax[k] = Max(centroidMax[k], c);
 		}
-		int c = count << 1;
-		means[0] = (int32_t)(tmp[0] / c);
-		means[1] = (int32_t)(tmp[1] / c);
-		means[2] = (int32_t)(tmp[2] / c);
 	}
 
-	// calculate axis (0: x-axis, 1: y-axis, 2: z-axis, DKVector3::val order)
-	int splitAxis = 0;
-	if (1)
+	if (depth >= BvhMaxSAHDepth)
 	{
-		VectorI32 center, variance = { 0, 0, 0 };
-		for (int i = 0; i < count; ++i)
+		// too deep, split in median of longest axis.
+		int axis = 0;
+		for (int k = 1; k < 3; ++k)
 		{
-			QuantizedAabbNode& node = leafNodes[i];
-			center[0] = (node.aabbMin[0] + node.aabbMax[0]) >> 1;
-			center[1] = (node.aabbMin[1] + node.aabbMax[1]) >> 1;
-			center[2] = (node.aabbMin[2] + node.aabbMax[2]) >> 1;
-			variance[0] += std::abs(center[0] - means[0]);
-			variance[1] += std::abs(center[1] - means[1]);
-			variance[2] += std::abs(center[2] - means[2]);
+			if (centroidMax[k] - centroidMin[k] > centroidMax[axis] - centroidMin[axis])
+				axis = k;
 		}
-		splitAxis = (variance[0] < variance[1] ? (variance[1] < variance[2] ? 2 : 1) : (variance[0] < variance[2] ? 2 : 0));
+		int median = count / 2;
+		std::nth_element(leafNodes, leafNodes + median, leafNodes + count,
+			[&centroid, axis](const QuantizedAabbNode& a, const QuantizedAabbNode& b)->bool
+		{
+			return centroid(a, axis) < centroid(b, axis);
+		});
+		return median;
 	}
 
-	// partitioning
-	int splitValue = means[splitAxis];
-	int splitIndex = 0;
+	struct Bin
+	{
+		int count;
+		unsigned short aabbMin[3];
+		unsigned short aabbMax[3];
+
+		void Reset()
+		{
+			count = 0;
+			aabbMin[0] = aabbMin[1] = aabbMin[2] = 0xffff;
+			aabbMax[0] = aabbMax[1] = aabbMax[2] = 0;
+		}
+		void Merge(const unsigned short* nodeMin, const unsigned short* nodeMax)
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				aabbMin[i] = Min(aabbMin[i], nodeMin[i]);
+				aabbMax[i] = Max(aabbMax[i], nodeMax[i]);
+			}
+		}
+		uint64_t HalfArea() const
+		{
+			if (count == 0)
+				return 0;
+			uint64_t dx = aabbMax[0] - aabbMin[0];
+			uint64_t dy = aabbMax[1] - aabbMin[1];
+			uint64_t dz = aabbMax[2] - aabbMin[2];
+			return dx * dy + dy * dz + dz * dx;
+		}
+	};
+	// small nodes use less bins, (count-1) internal nodes are small mostly.
+	const int binCount = Min(count, int(BvhSAHBinCount));
+	float binScale[3];
+	for (int k = 0; k < 3; ++k)
+		binScale[k] = float(binCount) / float(centroidMax[k] - centroidMin[k] + 1);
+	auto binIndex = [&](const QuantizedAabbNode& node, int axis)->int
+	{
+		int index = int(float(centroid(node, axis) - centroidMin[axis]) * binScale[axis]);
+		return Min(index, binCount - 1);
+	};
 
-#if BVH_PARTITION_FULL_SORT
-	// soft leaf-nodes, place larger value front.
-	std::sort(leafNodes, leafNodes + count,
-		[splitAxis](const QuantizedAabbNode& a, const QuantizedAabbNode& b)->bool
+	Bin bins[3][BvhSAHBinCount];
+	for (int k = 0; k < 3; ++k)
 	{
-		return (a.aabbMax[splitAxis] + a.aabbMin[splitAxis]) > (b.aabbMax[splitAxis] + b.aabbMin[splitAxis]);
-	});
-	splitIndex = count / 2;
-#else
-	// sort leaf-nodes, place larger than splitValue to left.
+		for (int b = 0; b < binCount; ++b)
+			bins[k][b].Reset();
+	}
 	for (int i = 0; i < count; ++i)
 	{
-		QuantizedAabbNode& node = leafNodes[i];
-		if (node.aabbMax[splitAxis] + node.aabbMin[splitAxis] > splitValue)
+		const QuantizedAabbNode& node = leafNodes[i];
+		for (int k = 0; k < 3; ++k)
 		{
-			QuantizedAabbNode tmp = leafNodes[i];
-			leafNodes[i] = leafNodes[splitIndex];
-			leafNodes[splitIndex] = tmp;
-			splitIndex++;
+			if (centroidMax[k] > centroidMin[k])
+			{
+				Bin& bin = bins[k][binIndex(node, k)];
+				bin.count++;
+				bin.Merge(node.aabbMin, node.aabbMax);
+			}
 		}
 	}
-	int balancedRangeMin = count / 3;
-	int balancedRangeMax = count - balancedRangeMin - 1;
 
-	if (splitIndex <= balancedRangeMin || splitIndex >= balancedRangeMax)
+	// find split which has lowest cost. (count * area of both sides)
+	int splitAxis = -1;
+	int splitBin = 0;
+	uint64_t splitCost = UINT64_MAX;
+	for (int k = 0; k < 3; ++k)
 	{
-		splitIndex = count / 2;
+		if (centroidMax[k] <= centroidMin[k])
+			continue;
+
+		uint64_t rightCost[BvhSAHBinCount];
+		Bin right;
+		right.Reset();
+		for (int b = binCount - 1; b > 0; --b)
+		{
+			right.count += bins[k][b].count;
+			right.Merge(bins[k][b].aabbMin, bins[k][b].aabbMax);
+			rightCost[b] = right.HalfArea() * uint64_t(right.count);
+		}
+		Bin left;
+		left.Reset();
+		for (int b = 0; b < binCount - 1; ++b)
+		{
+			left.count += bins[k][b].count;
+			left.Merge(bins[k][b].aabbMin, bins[k][b].aabbMax);
+			if (left.count == 0 || left.count == count)
+				continue;
+			uint64_t cost = left.HalfArea() * uint64_t(left.count) + rightCost[b + 1];
+			if (cost < splitCost)
+			{
+				splitCost = cost;
+				splitAxis = k;
+				splitBin = b;
+			}
+		}
 	}
-	DKASSERT_DEBUG(splitIndex < count);
-#endif
-	// recursion
-	int currentNodeIndex = (int)nodes.Add(QuantizedAabbNode());
 
-	// build left sub tree
-	int leftChildNodeIndex = (int)nodes.Count();
-	BuildTree(leafNodes, splitIndex);
+	if (splitAxis < 0)	// all centroids are same.
+		return count / 2;
 
-	// build right sub tree
-	int rightChildNodeIndex = (int)nodes.Count();
-	BuildTree(&leafNodes[splitIndex], count - splitIndex);
+	QuantizedAabbNode* mid = std::partition(leafNodes, leafNodes + count,
+		[&binIndex, splitAxis, splitBin](const QuantizedAabbNode& node)->bool
+	{
+		return binIndex(node, splitAxis) <= splitBin;
+	});
+	int splitIndex = int(mid - leafNodes);
+	DKASSERT_DEBUG(splitIndex > 0 && splitIndex < count);
+	return splitIndex;
+}
 
-	QuantizedAabbNode& node = nodes.Value(currentNodeIndex);
-	QuantizedAabbNode& left = nodes.Value(leftChildNodeIndex);
-	QuantizedAabbNode& right = nodes.Value(rightChildNodeIndex);
-	for (int i = 0; i < 3; ++i)
+void DKBvh::BuildTree(QuantizedAabbNode* leafNodes, int count, QuantizedAabbNode* output, int depth)
+{
+	DKASSERT_DEBUG(leafNodes);
+	DKASSERT_DEBUG(count > 0);
+
+	if (count == 1)	// leaf-node
 	{
-		node.aabbMin[i] = Min(left.aabbMin[i], right.aabbMin[i]);
-		node.aabbMax[i] = Max(left.aabbMax[i], right.aabbMax[i]);
+		output[0] = leafNodes[0];
+		return;
 	}
-	node.negativeTreeSize = currentNodeIndex - static_cast<int>(nodes.Count());
+
+	int splitIndex = PartitionLeafNodes(leafNodes, count, depth);
+
+	// left subtree (2 * splitIndex - 1 nodes) is placed next to this node.
+	BuildTree(leafNodes, splitIndex, &output[1], depth + 1);
+	BuildTree(&leafNodes[splitIndex], count - splitIndex, &output[splitIndex * 2], depth + 1);
+
+	MergeChildNodes(output[0]);
 }
 
 template <typename T>
@@ -262,43 +519,60 @@ bool DKBvh::RayTest(const DKLine& ray, RayCastResultCallback* cb) const
 			DKAabb rayOverlapAabb;
 			rayOverlapAabb.Expand(p1);
 			rayOverlapAabb.Expand(p2);
+
+			// ray in quantized space, to test ray with node's bounds (slab test)
+			float rayOrigin[3];
+			float rayInvDir[3];
+			bool rayParallel[3];
 			for (int i = 0; i < 3; ++i)
 			{
-				rayAabbMin[i] = (rayOverlapAabb.positionMin.val[i] - offset.val[i]) / scale.val[i] * float(0xffff);
-				rayAabbMax[i] = (rayOverlapAabb.positionMax.val[i] - offset.val[i]) / scale.val[i] * float(0xffff);
+				float qMin = (rayOverlapAabb.positionMin.val[i] - offset.val[i]) / scale.val[i] * float(0xffff);
+				float qMax = (rayOverlapAabb.positionMax.val[i] - offset.val[i]) / scale.val[i] * float(0xffff);
+				rayAabbMin[i] = static_cast<unsigned short>(Min(Max(floor(qMin), 0.0f), float(0xffff)));
+				rayAabbMax[i] = static_cast<unsigned short>(Min(Max(ceil(qMax), 0.0f), float(0xffff)));
+
+				float qBegin = (ray.begin.val[i] - offset.val[i]) / scale.val[i] * float(0xffff);
+				float qEnd = (ray.end.val[i] - offset.val[i]) / scale.val[i] * float(0xffff);
+				rayOrigin[i] = qBegin;
+				rayParallel[i] = qEnd == qBegin;
+				rayInvDir[i] = rayParallel[i] ? 0.0f : 1.0f / (qEnd - qBegin);
 			}
+			auto isRayOverlapped = [&](const QuantizedAabbNode& node)->bool
+			{
+				float tMin = 0.0f;
+				float tMax = 1.0f;
+				for (int i = 0; i < 3; ++i)
+				{
+					if (rayParallel[i])	// covered by rayAabb test.
+						continue;
+					float t1 = (float(node.aabbMin[i]) - rayOrigin[i]) * rayInvDir[i];
+					float t2 = (float(node.aabbMax[i]) - rayOrigin[i]) * rayInvDir[i];
+					if (t1 > t2)
+						std::swap(t1, t2);
+					tMin = Max(tMin, t1);
+					tMax = Min(tMax, t2);
+				}
+				// quantization error is smaller than 1.0, node has margin.
+				return tMin <= tMax;
+			};
 
 			int currentNodeIndex = 0;
 			int nodeCount = (int)this->nodes.Count();
 			bool isLeafNode = false;
 			bool isOverlapped = false;
-			DKAabb nodeAabb;
-
-			const DKVector3 scaleFactor = scale / float(0xffff);
 
 			while (currentNodeIndex < nodeCount)
 			{
 				const QuantizedAabbNode& node = nodes.Value(currentNodeIndex);
-				isOverlapped = IsAabbOverlapped(rayAabbMin, rayAabbMax, node.aabbMin, node.aabbMax);
+				isOverlapped = IsAabbOverlapped(rayAabbMin, rayAabbMax, node.aabbMin, node.aabbMax) && isRayOverlapped(node);
 				isLeafNode = node.objectIndex >= 0;
 
 				if (isLeafNode)
 				{
 					if (isOverlapped)
 					{
-						// un-quantize
-						nodeAabb.positionMin.val[0] = (float(node.aabbMin[0]) * scaleFactor.val[0]) + offset.val[0];
-						nodeAabb.positionMin.val[1] = (float(node.aabbMin[1]) * scaleFactor.val[1]) + offset.val[1];
-						nodeAabb.positionMin.val[2] = (float(node.aabbMin[2]) * scaleFactor.val[2]) + offset.val[2];
-						nodeAabb.positionMax.val[0] = (float(node.aabbMax[0]) * scaleFactor.val[0]) + offset.val[0];
-						nodeAabb.positionMax.val[1] = (float(node.aabbMax[1]) * scaleFactor.val[1]) + offset.val[1];
-						nodeAabb.positionMax.val[2] = (float(node.aabbMax[2]) * scaleFactor.val[2]) + offset.val[2];
-
-						if (nodeAabb.RayTest(ray))
-						{
-							if (cb == NULL || !cb->Invoke(node.objectIndex, ray))
-								return true;
-						}
+						if (cb == NULL || !cb->Invoke(node.objectIndex, ray))
+							return true;
 					}
 					currentNodeIndex++;
 				}
@@ -315,6 +589,197 @@ bool DKBvh::RayTest(const DKLine& ray, RayCastResultCallback* cb) const
 	return false;
 }
 
+void DKBvh::RayPacketTest(RayPacket& packet, RayPacketResultCallback* cb) const
+{
+	const int numLanes = RayPacket::MaxRays;
+	const unsigned int validMask = packet.activeMask;
+
+	// rays in quantized space, slab test with nodes.
+	alignas(16) float origin[3][numLanes];
+	alignas(16) float invDir[3][numLanes];
+	alignas(16) float tMax[numLanes];
+	for (int i = 0; i < 3; ++i)
+	{
+		float scale = float(0xffff) / this->aabbScale.val[i];
+		for (int k = 0; k < numLanes; ++k)
+		{
+			origin[i][k] = (packet.origin[i][k] - this->aabbOffset.val[i]) * scale;
+			float d = packet.direction[i][k] * scale;
+			// ray parallel to slab, large value makes t1, t2 have same sign if outside.
+			invDir[i][k] = fabs(d) > 1.0e-20f ? 1.0f / d : 1.0e30f;
+		}
+	}
+	for (int k = 0; k < numLanes; ++k)
+		tMax[k] = (validMask & (1U << k)) ? Min(packet.hitFraction[k], 1.0f) : -1.0f;
+
+#if DKGL_BVH_RAY_PACKET_SSE
+	const __m128 ox = _mm_load_ps(origin[0]);
+	const __m128 oy = _mm_load_ps(origin[1]);
+	const __m128 oz = _mm_load_ps(origin[2]);
+	const __m128 ix = _mm_load_ps(invDir[0]);
+	const __m128 iy = _mm_load_ps(invDir[1]);
+	const __m128 iz = _mm_load_ps(invDir[2]);
+	const __m128 zero = _mm_setzero_ps();
+	__m128 laneMax = _mm_load_ps(tMax);
+
+	auto overlappedLanes = [&](const QuantizedAabbNode& node)->unsigned int
+	{
+		__m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(float(node.aabbMin[0])), ox), ix);
+		__m128 t2x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(float(node.aabbMax[0])), ox), ix);
+		__m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(float(node.aabbMin[1])), oy), iy);
+		__m128 t2y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(float(node.aabbMax[1])), oy), iy);
+		__m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(float(node.aabbMin[2])), oz), iz);
+		__m128 t2z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(float(node.aabbMax[2])), oz), iz);
+		__m128 tNear = _mm_max_ps(_mm_max_ps(_mm_min_ps(t1x, t2x), _mm_min_ps(t1y, t2y)), _mm_max_ps(_mm_min_ps(t1z, t2z), zero));
+		__m128 tFar = _mm_min_ps(_mm_min_ps(_mm_max_ps(t1x, t2x), _mm_max_ps(t1y, t2y)), _mm_min_ps(_mm_max_ps(t1z, t2z), laneMax));
+		return (unsigned int)_mm_movemask_ps(_mm_cmple_ps(tNear, tFar));
+	};
+#else
+	auto overlappedLanes = [&](const QuantizedAabbNode& node)->unsigned int
+	{
+		unsigned int mask = 0;
+		for (int k = 0; k < numLanes; ++k)
+		{
+			float tNear = 0.0f;
+			float tFar = tMax[k];
+			for (int i = 0; i < 3; ++i)
+			{
+				float t1 = (float(node.aabbMin[i]) - origin[i][k]) * invDir[i][k];
+				float t2 = (float(node.aabbMax[i]) - origin[i][k]) * invDir[i][k];
+				tNear = Max(tNear, Min(t1, t2));
+				tFar = Min(tFar, Max(t1, t2));
+			}
+			if (tNear <= tFar)
+				mask |= (1U << k);
+		}
+		return mask;
+	};
+#endif
+
+	int currentNodeIndex = 0;
+	int nodeCount = (int)this->nodes.Count();
+	while (currentNodeIndex < nodeCount)
+	{
+		const QuantizedAabbNode& node = nodes.Value(currentNodeIndex);
+		unsigned int mask = overlappedLanes(node) & validMask;
+
+		if (node.objectIndex >= 0)	// leaf-node
+		{
+			if (mask)
+			{
+				packet.activeMask = mask;
+				cb->Invoke(node.objectIndex, packet);
+
+				// shorten rays to closest hit, to skip farther nodes.
+				for (int k = 0; k < numLanes; ++k)
+				{
+					if (mask & (1U << k))
+						tMax[k] = Min(packet.hitFraction[k], 1.0f);
+				}
+#if DKGL_BVH_RAY_PACKET_SSE
+				laneMax = _mm_load_ps(tMax);
+#endif
+			}
+			currentNodeIndex++;
+		}
+		else
+		{
+			if (mask)
+				currentNodeIndex++;
+			else
+				currentNodeIndex -= node.negativeTreeSize;
+		}
+	}
+	packet.activeMask = validMask;
+}
+
+size_t DKBvh::RayTest(const DKLine* rays, size_t numRays, float* hitFractions, RayPacketResultCallback* cb, DKOperationQueue* queue) const
+{
+	for (size_t i = 0; i < numRays; ++i)
+		hitFractions[i] = FLT_MAX;
+
+	if (this->volume == NULL || this->nodes.Count() == 0 || numRays == 0 || cb == NULL)
+		return 0;
+
+	// sort rays with direction octant and morton code of center,
+	// to make rays in each packet coherent.
+	struct RayOrder
+	{
+		uint64_t key;
+		size_t index;
+	};
+	DKArray<RayOrder> order;
+	order.Reserve(numRays);
+	for (size_t i = 0; i < numRays; ++i)
+	{
+		const DKLine& ray = rays[i];
+		DKVector3 dir = ray.end - ray.begin;
+		DKVector3 center = ((ray.begin + ray.end) * 0.5f - this->aabbOffset) / this->aabbScale * 1023.0f;
+		uint32_t cx = static_cast<uint32_t>(Min(Max(center.x, 0.0f), 1023.0f));
+		uint32_t cy = static_cast<uint32_t>(Min(Max(center.y, 0.0f), 1023.0f));
+		uint32_t cz = static_cast<uint32_t>(Min(Max(center.z, 0.0f), 1023.0f));
+		uint64_t octant = (dir.x < 0.0f ? 1 : 0) | (dir.y < 0.0f ? 2 : 0) | (dir.z < 0.0f ? 4 : 0);
+		uint64_t morton = SpreadBits10(cx) | (SpreadBits10(cy) << 1) | (SpreadBits10(cz) << 2);
+		RayOrder ro = { (octant << 30) | morton, i };
+		order.Add(ro);
+	}
+	std::sort(static_cast<RayOrder*>(order), static_cast<RayOrder*>(order) + numRays,
+		[](const RayOrder& a, const RayOrder& b)->bool
+	{
+		return a.key < b.key;
+	});
+
+	const int numLanes = RayPacket::MaxRays;
+	const size_t numPackets = (numRays + numLanes - 1) / numLanes;
+	const RayOrder* orderedRays = order;
+
+	auto testPackets = [=](size_t begin, size_t end)
+	{
+		RayPacket packet;
+		for (size_t p = begin; p < end; ++p)
+		{
+			packet.activeMask = 0;
+			for (int k = 0; k < numLanes; ++k)
+			{
+				size_t n = p * numLanes + k;
+				// fill empty lanes with first ray, they are masked out.
+				size_t index = orderedRays[n < numRays ? n : p * numLanes].index;
+				const DKLine& ray = rays[index];
+				for (int i = 0; i < 3; ++i)
+				{
+					packet.origin[i][k] = ray.begin.val[i];
+					packet.direction[i][k] = ray.end.val[i] - ray.begin.val[i];
+				}
+				packet.hitFraction[k] = FLT_MAX;
+				packet.rayIndex[k] = index;
+				if (n < numRays)
+					packet.activeMask |= (1U << k);
+			}
+
+			RayPacketTest(packet, cb);
+
+			for (int k = 0; k < numLanes; ++k)
+			{
+				if (packet.activeMask & (1U << k))
+					hitFractions[packet.rayIndex[k]] = packet.hitFraction[k];
+			}
+		}
+	};
+
+	// calling thread tests packets too, nested call from operation of
+	// queue is finished by calling thread if no other thread is available.
+	ParallelScheduler scheduler(queue);
+	scheduler.ParallelFor(numPackets, BvhParallelRayPackets, testPackets);
+
+	size_t numHits = 0;
+	for (size_t i = 0; i < numRays; ++i)
+	{
+		if (hitFractions[i] <= 1.0f)
+			numHits++;
+	}
+	return numHits;
+}
+
 bool DKBvh::AabbOverlapTest(const DKAabb& aabb, AabbOverlapResultCallback* cb) const
 {
 	if (this->volume && aabb.IsValid())
@@ -33,8 +33,17 @@ namespace DKFramework
 		DKBvh();
 		~DKBvh();
 
-		void Build(VolumeInterface*);
-		void Rebuild();
+		/// build tree with binned SAH (surface area heuristic).
+		/// if queue is not NULL, subtrees are built in parallel with queue.
+		void Build(VolumeInterface*, DKOperationQueue* queue = NULL);
+		void Rebuild(DKOperationQueue* queue = NULL);
+
+		/// update bounds of nodes in place, without changing tree topology.
+		/// use this when objects moved slightly, tree quality degrades as
+		/// objects move away from where they were built.
+		/// returns false if number of objects has been changed, you need to
+		/// rebuild tree in that case.
+		bool Refit();
 
 		VolumeInterface* Volume() { return volume;}
 		const VolumeInterface* Volume() const { return volume;}
@@ -50,6 +59,32 @@ namespace DKFramework
 		using RayCastResultCallback = DKFunctionSignature<bool (int, const DKLine&)>;
 		bool RayTest(const DKLine& ray, RayCastResultCallback*) const;
 
+		/// rays tested together in batch ray-test.
+		/// ray components are stored in SoA layout, to be tested with SIMD.
+		struct RayPacket
+		{
+			enum { MaxRays = 4 };
+			float origin[3][MaxRays];		///< ray.begin
+			float direction[3][MaxRays];	///< ray.end - ray.begin
+			float hitFraction[MaxRays];		///< closest hit fraction so far, greater than 1 if not hit.
+			size_t rayIndex[MaxRays];		///< index of ray in batch.
+			unsigned int activeMask;		///< bit-mask of rays overlapped with object.
+		};
+		/// RayPacketResultCallback : test object with rays of packet.
+		///   callback should test rays in packet.activeMask only, and
+		///   update packet.hitFraction if ray hits object closer than hitFraction.
+		///   hit position is (origin + direction * hitFraction), in range 0.0 ~ 1.0.
+		/// callback can be invoked from multiple threads if queue is not NULL.
+		/// parameter: (object-index, packet)
+		using RayPacketResultCallback = DKFunctionSignature<void (int, RayPacket&)>;
+		/// batch ray-test, finds closest hit of each rays.
+		/// rays are reordered and grouped into packets to traverse tree together,
+		/// packets are processed in parallel if queue is not NULL.
+		/// hitFractions should be able to hold numRays values, hit fraction of
+		/// each ray will be stored, (FLT_MAX if ray did not hit)
+		/// returns number of rays hit.
+		size_t RayTest(const DKLine* rays, size_t numRays, float* hitFractions, RayPacketResultCallback*, DKOperationQueue* queue = NULL) const;
+
 		/// AabbCastResultCallback : filter-callback function.
 		///   return false if aabb-overlap test no longer necessary.
 		///   return true if callback needs next overlapped object continously.
@@ -70,13 +105,18 @@ namespace DKFramework
 			};
 		};
 
-		void BuildInternal();
-		void BuildTree(QuantizedAabbNode* nodes, int count);
+		void BuildInternal(DKOperationQueue* queue);
+		static void BuildTree(QuantizedAabbNode* leafNodes, int count, QuantizedAabbNode* output, int depth);
+		static int PartitionLeafNodes(QuantizedAabbNode* leafNodes, int count, int depth);
+		static void MergeChildNodes(QuantizedAabbNode& node);
+		void QuantizeAabb(const DKAabb& aabb, QuantizedAabbNode& node) const;
+		void RayPacketTest(RayPacket& packet, RayPacketResultCallback* cb) const;
 
 		DKObject<VolumeInterface> volume;
 		DKArray<QuantizedAabbNode> nodes;
 		DKVector3 aabbOffset;
 		DKVector3 aabbScale;
+		int numObjects; ///< number of objects when tree was built.
 	};
 }
 #pragma pack(pop)
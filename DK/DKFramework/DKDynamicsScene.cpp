@@ -6,17 +6,26 @@
 //
 
 #include "Private/BulletPhysics.h"
+#include "Private/ParallelScheduler.h"
 #include "DKMath.h"
 #include "DKDynamicsScene.h"
 
 namespace DKFramework::Private
 {
+    // scheduler of thread which is stepping simulation.
+    // (island dispatch function has no user data.)
+    thread_local ParallelScheduler* steppingScheduler = NULL;
+
     struct CollisionDispatcher : public btCollisionDispatcher
     {
         typedef DKFunctionSignature<bool (DKCollisionObject*, DKCollisionObject*)> CollisionHandler;
         DKObject<CollisionHandler> collisionFunc;
         DKObject<CollisionHandler> responseFunc;
 
+        enum { ParallelPairBatch = 64 };
+        ParallelScheduler scheduler;
+        DKSpinLock lock; // manifolds, algorithms allocation while dispatching in parallel.
+
         CollisionDispatcher(btCollisionConfiguration* config) : btCollisionDispatcher(config) {}
 
         bool needsCollision(const btCollisionObject* body0,const btCollisionObject* body1)
@@ -49,20 +58,178 @@ namespace DKFramework::Private
             }
             return false;
         }
-        //void dispatchAllCollisionPairs(btOverlappingPairCache* pairCache,const btDispatcherInfo& dispatchInfo,btDispatcher* dispatcher)
-        //{
-        //	btCollisionDispatcher::dispatchAllCollisionPairs(pairCache, dispatchInfo, dispatcher);
-        //}
+        btPersistentManifold* getNewManifold(const btCollisionObject* body0, const btCollisionObject* body1)
+        {
+            if (scheduler.IsParallel())
+            {
+                DKCriticalSection<DKSpinLock> guard(lock);
+                return btCollisionDispatcher::getNewManifold(body0, body1);
+            }
+            return btCollisionDispatcher::getNewManifold(body0, body1);
+        }
+        void releaseManifold(btPersistentManifold* manifold)
+        {
+            if (scheduler.IsParallel())
+            {
+                DKCriticalSection<DKSpinLock> guard(lock);
+                btCollisionDispatcher::releaseManifold(manifold);
+            }
+            else
+                btCollisionDispatcher::releaseManifold(manifold);
+        }
+        void* allocateCollisionAlgorithm(int size)
+        {
+            if (scheduler.IsParallel())
+            {
+                DKCriticalSection<DKSpinLock> guard(lock);
+                return btCollisionDispatcher::allocateCollisionAlgorithm(size);
+            }
+            return btCollisionDispatcher::allocateCollisionAlgorithm(size);
+        }
+        void freeCollisionAlgorithm(void* ptr)
+        {
+            if (scheduler.IsParallel())
+            {
+                DKCriticalSection<DKSpinLock> guard(lock);
+                btCollisionDispatcher::freeCollisionAlgorithm(ptr);
+            }
+            else
+                btCollisionDispatcher::freeCollisionAlgorithm(ptr);
+        }
+        void dispatchAllCollisionPairs(btOverlappingPairCache* pairCache, const btDispatcherInfo& dispatchInfo, btDispatcher* dispatcher)
+        {
+            size_t numPairs = pairCache->getNumOverlappingPairs();
+            if (scheduler.IsParallel() && numPairs > ParallelPairBatch)
+            {
+                // same as btCollisionPairCallback, which never removes pairs.
+                btBroadphasePair* pairs = pairCache->getOverlappingPairArrayPtr();
+                btNearCallback nearCallback = getNearCallback();
+                scheduler.ParallelFor(numPairs, ParallelPairBatch, [&](size_t begin, size_t end)
+                {
+                    for (size_t i = begin; i < end; ++i)
+                        nearCallback(pairs[i], *this, dispatchInfo);
+                });
+
+                // rebuild manifolds in order of pairs, to be independent of threads timing.
+                m_manifoldsPtr.resizeNoInitialize(0);
+                for (size_t i = 0; i < numPairs; ++i)
+                {
+                    if (pairs[i].m_algorithm)
+                        pairs[i].m_algorithm->getAllContactManifolds(m_manifoldsPtr);
+                }
+                for (int i = 0; i < m_manifoldsPtr.size(); ++i)
+                    m_manifoldsPtr[i]->m_index1a = i;
+            }
+            else
+            {
+                btCollisionDispatcher::dispatchAllCollisionPairs(pairCache, dispatchInfo, dispatcher);
+            }
+        }
     };
 
-    CollisionWorldContext* CreateDynamicsWorldContext()
+    // solver for each thread, an island is solved by any solver not in use.
+    struct ConstraintSolverPool : public btConstraintSolver
+    {
+        struct Solver
+        {
+            btSequentialImpulseConstraintSolver* solver;
+            DKSpinLock lock;
+        };
+        Solver* solvers;
+        size_t numSolvers;
+
+        ConstraintSolverPool(size_t n) : numSolvers(Max(n, size_t(1)))
+        {
+            solvers = new Solver[numSolvers];
+            for (size_t i = 0; i < numSolvers; ++i)
+                solvers[i].solver = new btSequentialImpulseConstraintSolver();
+        }
+        ~ConstraintSolverPool()
+        {
+            for (size_t i = 0; i < numSolvers; ++i)
+                delete solvers[i].solver;
+            delete[] solvers;
+        }
+        btScalar solveGroup(btCollisionObject** bodies, int numBodies,
+                            btPersistentManifold** manifolds, int numManifolds,
+                            btTypedConstraint** constraints, int numConstraints,
+                            const btContactSolverInfo& info, btIDebugDraw* debugDrawer, btDispatcher* dispatcher)
+        {
+            // number of solvers is not less than number of threads,
+            // one of them is always available.
+            for (size_t i = 0; ; i = (i + 1) % numSolvers)
+            {
+                Solver& s = solvers[i];
+                if (s.lock.TryLock())
+                {
+                    btScalar r = s.solver->solveGroup(bodies, numBodies, manifolds, numManifolds,
+                                                      constraints, numConstraints, info, debugDrawer, dispatcher);
+                    s.lock.Unlock();
+                    return r;
+                }
+            }
+        }
+        void reset()
+        {
+            for (size_t i = 0; i < numSolvers; ++i)
+                solvers[i].solver->reset();
+        }
+        btConstraintSolverType getSolverType() const
+        {
+            return BT_SEQUENTIAL_IMPULSE_SOLVER;
+        }
+    };
+
+    void ParallelIslandDispatch(btAlignedObjectArray<btSimulationIslandManagerMt::Island*>* islandsPtr, btSimulationIslandManagerMt::IslandCallback* callback)
+    {
+        ParallelScheduler* scheduler = steppingScheduler;
+        if (scheduler == NULL)
+        {
+            btSimulationIslandManagerMt::defaultIslandDispatch(islandsPtr, callback);
+            return;
+        }
+
+        btAlignedObjectArray<btSimulationIslandManagerMt::Island*>& islands = *islandsPtr;
+        scheduler->ParallelFor(islands.size(), 1, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                btSimulationIslandManagerMt::Island* island = islands[i];
+                btPersistentManifold** manifolds = island->manifoldArray.size() ? &island->manifoldArray[0] : NULL;
+                btTypedConstraint** constraints = island->constraintArray.size() ? &island->constraintArray[0] : NULL;
+                callback->processIsland(&island->bodyArray[0],
+                                        island->bodyArray.size(),
+                                        manifolds,
+                                        island->manifoldArray.size(),
+                                        constraints,
+                                        island->constraintArray.size(),
+                                        island->id);
+            }
+        });
+    }
+
+    CollisionWorldContext* CreateDynamicsWorldContext(DKOperationQueue* queue, size_t maxThreads)
     {
         CollisionWorldContext* ctxt = new CollisionWorldContext();
         ctxt->configuration = new btDefaultCollisionConfiguration();
-        ctxt->dispatcher = new CollisionDispatcher(ctxt->configuration);
+        CollisionDispatcher* dispatcher = new CollisionDispatcher(ctxt->configuration);
+        ctxt->dispatcher = dispatcher;
         ctxt->broadphase = new btDbvtBroadphase();
-        ctxt->solver = new btSequentialImpulseConstraintSolver();
-        ctxt->world = new btDiscreteDynamicsWorld(ctxt->dispatcher, ctxt->broadphase, ctxt->solver, ctxt->configuration);
+        if (queue && maxThreads > 1)
+        {
+            dispatcher->scheduler.queue = queue;
+            dispatcher->scheduler.maxThreads = maxThreads;
+
+            ctxt->solver = new ConstraintSolverPool(maxThreads);
+            btDiscreteDynamicsWorldMt* world = new btDiscreteDynamicsWorldMt(ctxt->dispatcher, ctxt->broadphase, ctxt->solver, ctxt->configuration);
+            static_cast<btSimulationIslandManagerMt*>(world->getSimulationIslandManager())->setIslandDispatchFunction(ParallelIslandDispatch);
+            ctxt->world = world;
+        }
+        else
+        {
+            ctxt->solver = new btSequentialImpulseConstraintSolver();
+            ctxt->world = new btDiscreteDynamicsWorld(ctxt->dispatcher, ctxt->broadphase, ctxt->solver, ctxt->configuration);
+        }
         ctxt->tick = 0;
         return ctxt;
     }
@@ -83,7 +250,12 @@ using namespace DKFramework;
 using namespace DKFramework::Private;
 
 DKDynamicsScene::DKDynamicsScene()
-	: DKScene(CreateDynamicsWorldContext())
+	: DKDynamicsScene(NULL, 1)
+{
+}
+
+DKDynamicsScene::DKDynamicsScene(DKOperationQueue* queue, size_t maxThreads)
+	: DKScene(CreateDynamicsWorldContext(queue, maxThreads))
 	, dynamicsFixedFPS(0.0)
 	, actionInterface(NULL)
 {
@@ -109,6 +281,9 @@ DKDynamicsScene::DKDynamicsScene()
 	act->updater = DKFunction(this, &DKDynamicsScene::UpdateActions);
 	this->actionInterface = act;
 	world->addAction(this->actionInterface);	
+
+	// root hierarchies are updated in parallel too.
+	this->SetUpdateQueue(queue, maxThreads);
 }
 
 DKDynamicsScene::~DKDynamicsScene()
@@ -156,6 +331,13 @@ void DKDynamicsScene::Update(double tickDelta, DKTimeTick tick)
 
 	PrepareUpdateNode();
 
+	// simulation islands are dispatched to scheduler of stepping thread.
+	ParallelScheduler* prevScheduler = steppingScheduler;
+	steppingScheduler = &static_cast<CollisionDispatcher*>(context->dispatcher)->scheduler;
+
+	DKTimer timer;
+	timer.Reset();
+
 	if (dynamicsFixedFPS > 0.001)	// fixed frame rate for calculate physics (frame per second)
 	{
 		const double fixedTimeStep = 1.0 / dynamicsFixedFPS;
@@ -169,6 +351,11 @@ void DKDynamicsScene::Update(double tickDelta, DKTimeTick tick)
 		static_cast<btDiscreteDynamicsWorld*>(context->world)->stepSimulation(tickDelta);
 	}
 
+	steppingScheduler = prevScheduler;
+
+	// kinematics are updated in sub-steps of simulation.
+	updateTimings.simulation = Max(timer.Elapsed() - updateTimings.kinematics, 0.0);
+
 	UpdateObjectSceneStates();
 	CleanupUpdateNode();
 }
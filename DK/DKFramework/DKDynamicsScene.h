@@ -20,10 +20,22 @@ namespace DKFramework
 	/// You can extend physical behavior with DKActionController.
 	/// @note
 	/// dynamics simulation is performed in Bullet-Physics.
+	/// Scene can be constructed with DKOperationQueue to process collision
+	/// pairs and simulation islands in parallel. In that case, NeedCollision
+	/// and NeedResponse can be called from multiple threads concurrently.
+	/// Tick callbacks and actions are called on thread calling Update.
 	class DKGL_API DKDynamicsScene : public DKScene
 	{
 	public:
 		DKDynamicsScene();
+		/// multi-threaded scene, works with threads of queue.
+		/// maxThreads is number of threads including the thread calling
+		/// Update. queue must be valid while scene is alive.
+		/// root hierarchies are also updated with queue. (see SetUpdateQueue)
+		/// @note
+		///  result is reproducible with same number of threads, but it can be
+		///  different from single-threaded scene or other number of threads.
+		DKDynamicsScene(DKOperationQueue* queue, size_t maxThreads);
 		virtual ~DKDynamicsScene();
 
 		void SetGravity(const DKVector3& g);
@@ -56,6 +68,7 @@ namespace DKFramework
 
 		virtual void UpdateActions(double tickDelta);
 
+		/// collision filters, invoked from worker threads in multi-threaded scene.
 		virtual bool NeedCollision(DKCollisionObject* objA, DKCollisionObject* objB);
 		virtual bool NeedResponse(DKCollisionObject* objA, DKCollisionObject* objB);
 
@@ -8,8 +8,25 @@
 #include "../Libs/libpng/png.h"
 #include "../Libs/jpeg/jpeglib.h"
 
+#include <math.h>
+#include <limits>
+
 #include "DKImage.h"
 #include "DKResourceLoader.h"
+#include "Private/ParallelScheduler.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DKGL_IMAGE_RESAMPLE_SSE 1
+#else
+#define DKGL_IMAGE_RESAMPLE_SSE 0
+#endif
+#if DKGL_IMAGE_RESAMPLE_SSE && defined(__AVX__)
+#include <immintrin.h>
+#define DKGL_IMAGE_RESAMPLE_AVX 1
+#else
+#define DKGL_IMAGE_RESAMPLE_AVX 0
+#endif
 
 #define JPEG_BUFFER_SIZE	4096
 #define BMP_DEFAULT_PPM		96
@@ -175,43 +192,1547 @@ namespace DKFramework::Private
                     f = FormatPNG;
                     return true;
                 }
-            }
-            if (s > 3)
-            {
-                if (p[0] == 0xff && p[1] == 0xd8 && p[2] == 0xff)
+            }
+            if (s > 3)
+            {
+                if (p[0] == 0xff && p[1] == 0xd8 && p[2] == 0xff)
+                {
+                    f = FormatJPEG;
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+
+    inline size_t BytesPerPixel(DKImage::PixelFormat format)
+    {
+        switch (format)
+        {
+        case DKImage::R8:		return 1;
+        case DKImage::RG8:		return 2;
+        case DKImage::RGB8:		return 3;
+        case DKImage::RGBA8:	return 4;
+        case DKImage::R16:		return 2;
+        case DKImage::RG16:		return 4;
+        case DKImage::RGB16:	return 6;
+        case DKImage::RGBA16:	return 8;
+        case DKImage::R32:		return 4;
+        case DKImage::RG32:		return 8;
+        case DKImage::RGB32:	return 12;
+        case DKImage::RGBA32:	return 16;
+        case DKImage::R32F:		return 4;
+        case DKImage::RG32F:	return 8;
+        case DKImage::RGB32F:	return 12;
+        case DKImage::RGBA32F:	return 16;
+        }
+        return 0;
+    }
+
+    // Image decoding source, reads from memory or stream.
+    // a few bytes can be peeked to identify format without seeking.
+    struct ImageDecodeSource
+    {
+        const uint8_t* data = nullptr;  // memory source (if not null)
+        size_t length = 0;              // length of memory source
+        DKStream* stream = nullptr;
+        DKStream::Position streamBase = 0;
+        size_t position = 0;            // position from beginning of image
+        uint8_t peeked[16];
+        size_t peekedLength = 0;
+
+        ImageDecodeSource(const void* p, size_t s)
+            : data(reinterpret_cast<const uint8_t*>(p)), length(s)
+        {
+        }
+        ImageDecodeSource(DKStream* s)
+            : stream(s), streamBase(s->CurrentPosition())
+        {
+            if (streamBase == DKStream::PositionError)
+                streamBase = 0;
+        }
+        bool IsMemory() const { return data != nullptr; }
+        bool IsSeekable() const { return data != nullptr || stream->IsSeekable(); }
+        /// total length of source, zero if unknown.
+        size_t TotalLength() const
+        {
+            if (data)
+                return length;
+            if (stream->IsSeekable())
+            {
+                DKStream::Position total = stream->TotalLength();
+                if (total != DKStream::PositionError && total > streamBase)
+                    return static_cast<size_t>(total - streamBase);
+            }
+            return 0;
+        }
+        size_t Peek(void* p, size_t s)
+        {
+            DKASSERT_DEBUG(position == 0);
+            if (data)
+            {
+                s = Min(s, length);
+                memcpy(p, data, s);
+                return s;
+            }
+            s = Min(s, sizeof(peeked));
+            while (peekedLength < s)
+            {
+                size_t r = stream->Read(&peeked[peekedLength], s - peekedLength);
+                if (r == 0 || r == size_t(-1))
+                    break;
+                peekedLength += r;
+            }
+            s = Min(s, peekedLength);
+            memcpy(p, peeked, s);
+            return s;
+        }
+        size_t Read(void* p, size_t s)
+        {
+            if (data)
+            {
+                s = Min(s, length - position);
+                memcpy(p, &data[position], s);
+                position += s;
+                return s;
+            }
+            uint8_t* output = reinterpret_cast<uint8_t*>(p);
+            size_t numRead = 0;
+            if (position < peekedLength)
+            {
+                size_t n = Min(s, peekedLength - position);
+                memcpy(output, &peeked[position], n);
+                position += n;
+                numRead += n;
+            }
+            while (numRead < s)
+            {
+                size_t r = stream->Read(&output[numRead], s - numRead);
+                if (r == 0 || r == size_t(-1))
+                    break;
+                position += r;
+                numRead += r;
+            }
+            return numRead;
+        }
+        /// move position to p (offset from beginning of image)
+        bool Seek(size_t p)
+        {
+            if (data)
+            {
+                if (p > length)
+                    return false;
+                position = p;
+                return true;
+            }
+            if (p == position)
+                return true;
+            if (stream->IsSeekable())
+            {
+                DKStream::Position pos = streamBase + p;
+                if (stream->SetCurrentPosition(pos) != pos)
+                    return false;
+                position = p;
+                peekedLength = 0;
+                return true;
+            }
+            // stream is not seekable, skip forward by reading.
+            uint8_t buffer[1024];
+            while (position < p)
+            {
+                size_t n = Min(p - position, sizeof(buffer));
+                if (Read(buffer, n) != n)
+                    return false;
+            }
+            return position == p;
+        }
+    };
+
+    // streaming image decoder.
+    // decodes image rows from top to bottom sequentially.
+    struct ImageDecoder
+    {
+        ImageDecodeSource& source;
+        DKImage::Info info;
+
+        ImageDecoder(ImageDecodeSource& s) : source(s), info() {}
+        virtual ~ImageDecoder() {}
+
+        virtual bool ReadHeader() = 0;
+        /// decode next rows, output rows are tightly packed.
+        virtual bool ReadRows(uint8_t* output, uint32_t numRows) = 0;
+
+        size_t RowBytes() const
+        {
+            return BytesPerPixel(info.format) * info.width;
+        }
+    };
+
+    struct PNGImageDecoder : public ImageDecoder
+    {
+        png_structp png = nullptr;
+        png_infop pngInfo = nullptr;
+        int numPasses = 1;
+        uint8_t* image = nullptr;   // interlaced image should be decoded entirely
+        uint32_t row = 0;
+
+        PNGImageDecoder(ImageDecodeSource& s) : ImageDecoder(s) {}
+        ~PNGImageDecoder()
+        {
+            if (png)
+                png_destroy_read_struct(&png, &pngInfo, nullptr);
+            if (image)
+                DKFree(image);
+        }
+        bool ReadHeader() override
+        {
+            png = png_create_read_struct(PNG_LIBPNG_VER_STRING, this,
+                                         [](png_structp png, png_const_charp msg)
+            {
+                DKLogE("[DKImage::Decode] PNG Error: %s", msg);
+                png_longjmp(png, 1);
+            }, [](png_structp, png_const_charp) {});
+            if (png == nullptr)
+                return false;
+            pngInfo = png_create_info_struct(png);
+            if (pngInfo == nullptr)
+                return false;
+            if (setjmp(png_jmpbuf(png)))
+                return false;
+
+            png_set_read_fn(png, &source, [](png_structp png, png_bytep data, png_size_t length)
+            {
+                ImageDecodeSource* source = reinterpret_cast<ImageDecodeSource*>(png_get_io_ptr(png));
+                if (source->Read(data, length) != length)
+                    png_error(png, "Unexpected end of data");
+            });
+            png_read_info(png, pngInfo);
+
+            int colorType = png_get_color_type(png, pngInfo);
+            int bitDepth = png_get_bit_depth(png, pngInfo);
+            if (colorType == PNG_COLOR_TYPE_PALETTE)
+                png_set_palette_to_rgb(png);
+            if (colorType == PNG_COLOR_TYPE_GRAY && bitDepth < 8)
+                png_set_expand_gray_1_2_4_to_8(png);
+            if (png_get_valid(png, pngInfo, PNG_INFO_tRNS))
+                png_set_tRNS_to_alpha(png);
+            if (bitDepth == 16)
+            {
+                // same as png_image (simplified API): linear with associated alpha.
+                png_set_alpha_mode(png, PNG_ALPHA_STANDARD, PNG_GAMMA_LINEAR);
+#if __LITTLE_ENDIAN__
+                png_set_swap(png);
+#endif
+            }
+            else
+            {
+                png_set_alpha_mode(png, PNG_ALPHA_PNG, PNG_DEFAULT_sRGB);
+            }
+            numPasses = png_set_interlace_handling(png);
+            png_read_update_info(png, pngInfo);
+
+            const DKImage::PixelFormat formats8[] = { DKImage::R8, DKImage::RG8, DKImage::RGB8, DKImage::RGBA8 };
+            const DKImage::PixelFormat formats16[] = { DKImage::R16, DKImage::RG16, DKImage::RGB16, DKImage::RGBA16 };
+            int channels = png_get_channels(png, pngInfo);
+            bitDepth = png_get_bit_depth(png, pngInfo);
+            if (channels < 1 || channels > 4 || (bitDepth != 8 && bitDepth != 16))
+            {
+                DKLogE("[DKImage::Decode] Error: Unsupported PNG format.");
+                return false;
+            }
+            info.width = png_get_image_width(png, pngInfo);
+            info.height = png_get_image_height(png, pngInfo);
+            info.format = bitDepth == 16 ? formats16[channels - 1] : formats8[channels - 1];
+            return info.width > 0 && info.height > 0;
+        }
+        bool ReadRows(uint8_t* output, uint32_t numRows) override
+        {
+            DKASSERT_DEBUG(row + numRows <= info.height);
+            const size_t rowBytes = RowBytes();
+            if (numPasses > 1 && image == nullptr)
+            {
+                image = reinterpret_cast<uint8_t*>(DKMalloc(rowBytes * info.height));
+                if (image == nullptr)
+                {
+                    DKLogE("[DKImage::Decode] Error: Out of memory!");
+                    return false;
+                }
+                DKArray<png_bytep> rows;
+                rows.Resize(info.height);
+                for (uint32_t i = 0; i < info.height; ++i)
+                    rows.Value(i) = &image[rowBytes * i];
+
+                if (setjmp(png_jmpbuf(png)))
+                    return false;
+                png_read_image(png, rows);
+            }
+            if (image)
+            {
+                memcpy(output, &image[rowBytes * row], rowBytes * numRows);
+                row += numRows;
+                return true;
+            }
+            if (setjmp(png_jmpbuf(png)))
+                return false;
+            for (uint32_t i = 0; i < numRows; ++i)
+                png_read_row(png, &output[rowBytes * i], nullptr);
+            row += numRows;
+            return true;
+        }
+    };
+
+    struct JPEGImageDecoder : public ImageDecoder
+    {
+        struct JpegSource
+        {
+            struct jpeg_source_mgr pub;
+            ImageDecodeSource* source;
+            JOCTET eofMarker[2];
+            JOCTET buffer[JPEG_BUFFER_SIZE];
+        };
+        jpeg_decompress_struct cinfo = {};
+        JpegErrorMgr err = {};
+        JpegSource jpegSource;
+        bool created = false;
+        JSAMPARRAY cmykBuffer = nullptr;
+
+        JPEGImageDecoder(ImageDecodeSource& s) : ImageDecoder(s) {}
+        ~JPEGImageDecoder()
+        {
+            if (created)
+                jpeg_destroy_decompress(&cinfo);
+        }
+        bool ReadHeader() override
+        {
+            JpegSource& src = jpegSource;
+            src.source = &source;
+            src.pub.bytes_in_buffer = 0;
+            src.pub.next_input_byte = NULL;
+            src.pub.init_source = [](j_decompress_ptr cinfo) {};
+            src.pub.fill_input_buffer = [](j_decompress_ptr cinfo)->boolean
+            {
+                JpegSource* src = reinterpret_cast<JpegSource*>(cinfo->src);
+                ImageDecodeSource* source = src->source;
+                size_t s = 0;
+                if (source->IsMemory())
+                {
+                    // use memory directly.
+                    s = source->length - source->position;
+                    src->pub.next_input_byte = (const JOCTET*)&source->data[source->position];
+                    source->position += s;
+                }
+                else
+                {
+                    s = source->Read(src->buffer, JPEG_BUFFER_SIZE);
+                    src->pub.next_input_byte = src->buffer;
+                }
+                if (s > 0)
+                {
+                    src->pub.bytes_in_buffer = s;
+                }
+                else
+                {
+                    src->pub.next_input_byte = (const JOCTET*)src->eofMarker;
+                    src->eofMarker[0] = 0xff;
+                    src->eofMarker[1] = JPEG_EOI;
+                    src->pub.bytes_in_buffer = 2;
+                }
+                return TRUE;
+            };
+            src.pub.skip_input_data = [](j_decompress_ptr cinfo, long numBytes)
+            {
+                if (numBytes > 0)
+                {
+                    JpegSource* src = reinterpret_cast<JpegSource*>(cinfo->src);
+                    while (numBytes > (long)src->pub.bytes_in_buffer)
+                    {
+                        numBytes -= (long)src->pub.bytes_in_buffer;
+                        src->pub.fill_input_buffer(cinfo);
+                    }
+                    src->pub.next_input_byte += (size_t)numBytes;
+                    src->pub.bytes_in_buffer -= (size_t)numBytes;
+                }
+            };
+            src.pub.resync_to_restart = jpeg_resync_to_restart;
+            src.pub.term_source = [](j_decompress_ptr cinfo) {};
+
+            cinfo.err = jpeg_std_error(&err.pub);
+            err.pub.error_exit = [](j_common_ptr cinfo)
+            {
+                JpegErrorMgr* err = (JpegErrorMgr*)cinfo->err;
+                err->pub.format_message(cinfo, err->buffer);
+                longjmp(err->setjmpBuffer, 1);
+            };
+
+            if (setjmp(err.setjmpBuffer))
+            {
+                DKLogE("[DKImage::Decode] JPEG Error: %s", err.buffer);
+                return false;
+            }
+            jpeg_create_decompress(&cinfo);
+            created = true;
+            cinfo.src = (jpeg_source_mgr*)&src;
+            jpeg_read_header(&cinfo, TRUE);
+
+            if (cinfo.out_color_space == JCS_CMYK || cinfo.out_color_space == JCS_YCCK)
+                cinfo.out_color_space = JCS_CMYK;
+            else
+                cinfo.out_color_space = JCS_RGB;
+            jpeg_start_decompress(&cinfo);
+
+            if (cinfo.out_color_space == JCS_CMYK)
+            {
+                cmykBuffer = (*cinfo.mem->alloc_sarray)
+                    ((j_common_ptr)&cinfo, JPOOL_IMAGE, cinfo.output_width * 4, 1);
+            }
+            info.width = cinfo.output_width;
+            info.height = cinfo.output_height;
+            info.format = DKImage::RGB8;
+            return info.width > 0 && info.height > 0;
+        }
+        bool ReadRows(uint8_t* output, uint32_t numRows) override
+        {
+            if (setjmp(err.setjmpBuffer))
+            {
+                DKLogE("[DKImage::Decode] JPEG Error: %s", err.buffer);
+                return false;
+            }
+            const size_t rowBytes = RowBytes();
+            for (uint32_t i = 0; i < numRows; ++i)
+            {
+                uint8_t* data = &output[rowBytes * i];
+                if (cmykBuffer == nullptr)
+                {
+                    JSAMPROW rowPointer = data;
+                    jpeg_read_scanlines(&cinfo, &rowPointer, 1);
+                }
+                else
+                {
+                    auto CmykToRgb = [](uint8_t* rgb, uint8_t* cmyk)
+                    {
+                        uint32_t k1 = 255 - cmyk[3];
+                        uint32_t k2 = cmyk[3];
+                        for (int i = 0; i < 3; ++i)
+                        {
+                            uint32_t c = k1 + k2 * (255 - cmyk[i]) / 255;
+                            rgb[i] = (c > 255) ? 0 : (255 - c);
+                        }
+                    };
+                    jpeg_read_scanlines(&cinfo, cmykBuffer, 1);
+                    uint8_t* input = (uint8_t*)cmykBuffer[0];
+                    for (size_t x = 0; x < cinfo.output_width; ++x)
+                    {
+                        CmykToRgb(data, input);
+                        data += 3;
+                        input += 4;
+                    }
+                }
+            }
+            if (cinfo.output_scanline >= cinfo.output_height)
+                jpeg_finish_decompress(&cinfo);
+            return true;
+        }
+    };
+
+    struct BMPImageDecoder : public ImageDecoder
+    {
+        BMPFileHeader fileHeader;
+        BMPInfoHeader bmpInfo;
+        bool topDown = false;
+        size_t colorTableEntrySize = 4;
+        DKArray<uint8_t> colorTable;    // also bit masks for BITFIELDS
+        uint32_t bitMask[3] = { 0, 0, 0 };
+        uint32_t bitShift[3] = { 0, 0, 0 };
+        uint32_t numBits[3] = { 0, 0, 0 };
+        size_t rowBytes = 0;            // bytes of row in file
+        size_t rowBytesAligned = 0;     // aligned (4-bytes) row bytes
+        DKArray<uint8_t> rowBuffer;
+        uint8_t* image = nullptr;       // decoded image (RLE, bottom-up without seek)
+        uint32_t row = 0;
+
+        BMPImageDecoder(ImageDecodeSource& s) : ImageDecoder(s) {}
+        ~BMPImageDecoder()
+        {
+            if (image)
+                DKFree(image);
+        }
+
+        bool ReadHeader() override
+        {
+            if (source.Read(&fileHeader, sizeof(BMPFileHeader)) != sizeof(BMPFileHeader))
+            {
+                DKLogE("[DKImage::Decode] Error: BMP data size is too small!");
+                return false;
+            }
+            fileHeader.size = DKLittleEndianToSystem(fileHeader.size);
+            fileHeader.offBits = DKLittleEndianToSystem(fileHeader.offBits);
+            size_t totalLength = source.TotalLength();
+            if (totalLength > 0 && (totalLength < fileHeader.size || totalLength < fileHeader.offBits))
+            {
+                DKLogE("[DKImage::Decode] Error: BMP data overflow!");
+                return false;
+            }
+
+            uint8_t header[sizeof(BMPInfoHeader)];
+            if (source.Read(header, sizeof(BMPCoreHeader)) != sizeof(BMPCoreHeader))
+            {
+                DKLogE("[DKImage::Decode] Error: BMP data overflow!");
+                return false;
+            }
+            size_t headerSize = DKLittleEndianToSystem(reinterpret_cast<const BMPCoreHeader*>(header)->size);
+            if (headerSize >= sizeof(BMPInfoHeader))
+            {
+                size_t s = sizeof(BMPInfoHeader) - sizeof(BMPCoreHeader);
+                if (source.Read(&header[sizeof(BMPCoreHeader)], s) != s)
+                {
+                    DKLogE("[DKImage::Decode] Error: BMP data overflow!");
+                    return false;
+                }
+                BMPInfoHeader& info = bmpInfo;
+                info = *reinterpret_cast<const BMPInfoHeader*>(header);
+                info.size = DKLittleEndianToSystem(info.size);
+                info.width = DKLittleEndianToSystem(info.width);
+                info.height = DKLittleEndianToSystem(info.height);
+                info.planes = DKLittleEndianToSystem(info.planes);
+                info.bitCount = DKLittleEndianToSystem(info.bitCount);
+                info.compression = DKLittleEndianToSystem(info.compression);
+                info.sizeImage = DKLittleEndianToSystem(info.sizeImage);
+                info.xPelsPerMeter = DKLittleEndianToSystem(info.xPelsPerMeter);
+                info.yPelsPerMeter = DKLittleEndianToSystem(info.yPelsPerMeter);
+                info.clrUsed = DKLittleEndianToSystem(info.clrUsed);
+                info.clrImportant = DKLittleEndianToSystem(info.clrImportant);
+                colorTableEntrySize = 4; // RGBA
+            }
+            else if (headerSize >= sizeof(BMPCoreHeader))
+            {
+                const BMPCoreHeader& core = *reinterpret_cast<const BMPCoreHeader*>(header);
+                BMPInfoHeader& info = bmpInfo;
+                info.size = DKLittleEndianToSystem(core.size);
+                info.width = DKLittleEndianToSystem(core.width);
+                info.height = DKLittleEndianToSystem(core.height);
+                info.planes = DKLittleEndianToSystem(core.planes);
+                info.bitCount = DKLittleEndianToSystem(core.bitCount);
+                info.compression = BMPCompressionRGB;
+                info.sizeImage = 0;
+                info.xPelsPerMeter = BMP_DEFAULT_PPM;
+                info.yPelsPerMeter = BMP_DEFAULT_PPM;
+                info.clrUsed = 0;
+                info.clrImportant = 0;
+                colorTableEntrySize = 3; // old-style
+            }
+            else
+            {
+                DKLogE("[DKImage::Decode] Error: Unsupported bitmap format.");
+                return false;
+            }
+            const BMPInfoHeader& info = bmpInfo;
+            if (info.bitCount != 1 && info.bitCount != 4 && info.bitCount != 8 &&
+                info.bitCount != 16 && info.bitCount != 24 && info.bitCount != 32)
+            {
+                DKLogE("[DKImage::Decode] Error: Unsupported bitmap format.");
+                return false;
+            }
+            if ((info.compression == BMPCompressionRLE4 && info.bitCount != 4) ||
+                (info.compression == BMPCompressionRLE8 && info.bitCount != 8) ||
+                (info.compression == BMPCompressionBITFIELDS && (info.bitCount != 16 && info.bitCount != 32)))
+            {
+                DKLogE("[DKImage::Decode] Error: Invalid BMP data format.");
+                return false;
+            }
+            topDown = info.height < 0;
+            if (topDown)
+                bmpInfo.height = -info.height;
+
+            if (info.width <= 0 || info.height <= 0)
+            {
+                DKLogE("[DKImage::Decode] Error: Invalid BMP data format.");
+                return false;
+            }
+
+            // color-table map or bit masks (between header and bitmap data)
+            size_t tablePos = sizeof(BMPFileHeader) + info.size;
+            if (fileHeader.offBits > tablePos)
+            {
+                if (!source.Seek(tablePos))
+                {
+                    DKLogE("[DKImage::Decode] Error: BMP data overflow!");
+                    return false;
+                }
+                colorTable.Resize(fileHeader.offBits - tablePos);
+                if (source.Read(colorTable, colorTable.Count()) != colorTable.Count())
+                {
+                    DKLogE("[DKImage::Decode] Error: BMP data overflow!");
+                    return false;
+                }
+            }
+
+            if (info.compression == BMPCompressionBITFIELDS)
+            {
+                if (colorTable.Count() < sizeof(uint32_t) * 3)
+                {
+                    DKLogE("[DKImage::Decode] Error: BMP data overflow!");
+                    return false;
+                }
+                for (int i = 0; i < 3; ++i)
+                    bitMask[i] = DKLittleEndianToSystem(reinterpret_cast<const uint32_t*>((const uint8_t*)colorTable)[i]);
+
+                for (int bit = 31; bit >= 0; --bit)
+                {
+                    for (int i = 0; i < 3; ++i)
+                    {
+                        if (bitMask[i] & (1U << bit))
+                            bitShift[i] = bit;
+                    }
+                }
+                for (int i = 0; i < 3; ++i)
+                    bitMask[i] = bitMask[i] >> bitShift[i];
+
+                for (int bit = 0; bit < 32; ++bit)
+                {
+                    for (int i = 0; i < 3; ++i)
+                    {
+                        if (bitMask[i] & (1U << bit))
+                            numBits[i] = bit + 1;
+                    }
+                }
+                if (numBits[0] <= 8 && numBits[1] <= 8 && numBits[2] <= 8)
+                    this->info.format = DKImage::RGB8;
+                else
+                    this->info.format = DKImage::RGB32F;
+            }
+            else if (info.bitCount == 32 && info.compression == BMPCompressionRGB)
+                this->info.format = DKImage::RGBA8;
+            else
+                this->info.format = DKImage::RGB8;
+
+            if (info.bitCount <= 8)
+            {
+                // make sure color table has all entries.
+                size_t tableSize = colorTableEntrySize << info.bitCount;
+                if (colorTable.Count() < tableSize)
+                    colorTable.Resize(tableSize, 0);
+            }
+
+            this->info.width = info.width;
+            this->info.height = info.height;
+
+            uint32_t bits = info.width * info.bitCount;
+            rowBytes = (bits % 8) ? (bits / 8 + 1) : (bits / 8);
+            // each row must be align of 4-bytes
+            rowBytesAligned = (rowBytes % 4) ? (rowBytes | 0x3) + 1 : rowBytes;
+
+            if (totalLength > 0 && info.compression != BMPCompressionRLE8 && info.compression != BMPCompressionRLE4)
+            {
+                size_t requiredBytes = rowBytesAligned * (info.height - 1) + rowBytes;
+                if (totalLength < fileHeader.offBits + requiredBytes)
+                {
+                    DKLogE("[DKImage::Decode] Error: BMP data overflow!");
+                    return false;
+                }
+            }
+            return source.Seek(fileHeader.offBits);
+        }
+
+        void ConvertRow(const uint8_t* input, uint8_t* output) const
+        {
+            const BMPInfoHeader& info = bmpInfo;
+            const uint32_t width = info.width;
+            if (info.compression == BMPCompressionBITFIELDS)
+            {
+                auto Pixel = [&](uint32_t x)->uint32_t
+                {
+                    if (info.bitCount == 32)
+                        return DKLittleEndianToSystem(reinterpret_cast<const uint32_t*>(input)[x]);
+                    return DKLittleEndianToSystem(reinterpret_cast<const uint16_t*>(input)[x]);
+                };
+                if (this->info.format == DKImage::RGB8)
+                {
+                    uint32_t lshift[3] = { 8 - numBits[0], 8 - numBits[1], 8 - numBits[2] };
+                    for (uint32_t x = 0; x < width; ++x)
+                    {
+                        uint32_t rgb = Pixel(x);
+                        for (int i = 0; i < 3; ++i)
+                        {
+                            output[0] = ((rgb >> bitShift[i]) & bitMask[i]) << lshift[i];
+                            output++;
+                        }
+                    }
+                }
+                else // RGB32F
+                {
+                    float denum[3] = {
+                        static_cast<float>(bitMask[0]),
+                        static_cast<float>(bitMask[1]),
+                        static_cast<float>(bitMask[2])
+                    };
+                    float* outputF = reinterpret_cast<float*>(output);
+                    for (uint32_t x = 0; x < width; ++x)
+                    {
+                        uint32_t rgb = Pixel(x);
+                        for (int i = 0; i < 3; ++i)
+                        {
+                            if (denum[i] != 0.0f)
+                                outputF[0] = static_cast<float>((rgb >> bitShift[i]) & bitMask[i]) / denum[i];
+                            else
+                                outputF[0] = 0.0f;
+                            outputF++;
+                        }
+                    }
+                }
+            }
+            else if (info.bitCount == 32 || info.bitCount == 24)
+            {
+                const uint32_t colorIndices[] = { 2, 1, 0, 3 }; // BGRA -> RGBA
+                const uint32_t bpp = info.bitCount / 8;
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    for (uint32_t i = 0; i < bpp; ++i)
+                        output[i] = input[colorIndices[i]];
+                    output += bpp;
+                    input += bpp;
+                }
+            }
+            else if (info.bitCount == 16)
+            {
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    uint16_t pixel = DKLittleEndianToSystem(reinterpret_cast<const uint16_t*>(input)[x]);
+                    uint16_t r = (pixel & 0x7c00) >> 10;
+                    uint16_t g = (pixel & 0x03e0) >> 5;
+                    uint16_t b = (pixel & 0x001f);
+
+                    output[0] = static_cast<uint8_t>((r << 3) & 0xff);
+                    output[1] = static_cast<uint8_t>((g << 3) & 0xff);
+                    output[2] = static_cast<uint8_t>((b << 3) & 0xff);
+                    output += 3;
+                }
+            }
+            else // 1, 4, 8
+            {
+                const uint8_t* colorTableEntries = colorTable;
+                const uint32_t bits = info.bitCount;
+                const uint8_t mask = (1 << bits) - 1;
+                uint32_t x = 0;
+                while (x < width)
+                {
+                    uint8_t c = *input;
+                    for (uint32_t bit = 0; bit < 8 && x < width; ++x)
+                    {
+                        bit += bits;
+                        uint8_t index = (c >> (8 - bit)) & mask;
+                        const uint8_t* cm = &colorTableEntries[uint32_t(colorTableEntrySize) * uint32_t(index)];
+                        output[0] = cm[2];
+                        output[1] = cm[1];
+                        output[2] = cm[0];
+                        output += 3; //RGB8
+                    }
+                    input++;
+                }
+            }
+        }
+
+        bool DecodeRLE(const uint8_t* data, size_t s, uint8_t* output) const
+        {
+            const BMPInfoHeader& info = bmpInfo;
+            const uint8_t* colorTableEntries = colorTable;
+            // set background color to first color-table entry
+            for (size_t i = 0, n = size_t(info.width) * size_t(info.height) * 3; i < n; ++i)
+                output[i] = colorTableEntries[2 - (i % 3)];
+
+            auto SetPixelAtPosition = [&](int32_t x, int32_t y, uint8_t index)
+            {
+                if (x < info.width && y < info.height)
+                {
+                    if (!topDown)
+                        y = info.height - y - 1;
+
+                    DKASSERT_DEBUG(index < (1 << info.bitCount));
+                    uint8_t* data = &output[(size_t(y) * info.width + x) * 3];
+                    const uint8_t* cm = &colorTableEntries[uint32_t(4) * uint32_t(index)];
+                    data[0] = cm[2];
+                    data[1] = cm[1];
+                    data[2] = cm[0];
+                }
+            };
+            size_t pos = 0;
+            int32_t x = 0;
+            int32_t y = 0;
+            while ((pos + 1) < s && y < info.height)
+            {
+                uint32_t first = data[pos++];
+                uint32_t second = data[pos++];
+                if (first == 0)
+                {
+                    switch (second)
+                    {
+                    case 0:		// end of line
+                        x = 0;
+                        y++;
+                        break;
+                    case 1:		// end of bitmap
+                        y = info.height;
+                        break;
+                    case 2:		// move position
+                        if (pos + 1 < s)
+                        {
+                            uint8_t deltaX = data[pos++];
+                            uint8_t deltaY = data[pos++];
+                            x += deltaX / (8 / info.bitCount);
+                            y += deltaY;
+                        }
+                        break;
+                    default:	// absolute mode.
+                        if (info.compression == BMPCompressionRLE8)
+                        {
+                            for (uint32_t i = 0; i < second && pos < s && x < info.width; ++i)
+                            {
+                                uint8_t index = data[pos++];
+                                SetPixelAtPosition(x++, y, index);
+                            }
+                            if (second & 1)
+                                pos++;
+                        }
+                        else
+                        {
+                            uint8_t nibble[2];
+                            uint32_t bytesRead = 0;
+                            for (uint32_t i = 0; i < second && pos < s && x < info.width; ++i)
+                            {
+                                if (!(i % 2))
+                                {
+                                    bytesRead++;
+                                    uint8_t index = data[pos++];
+                                    nibble[0] = (index >> 4) & 0xf;
+                                    nibble[1] = index & 0xf;
+                                }
+                                SetPixelAtPosition(x++, y, nibble[i % 2]);
+                            }
+                            if (bytesRead & 1)
+                                pos++;
+                        }
+                        break;
+                    }
+                }
+                else
+                {
+                    if (info.compression == BMPCompressionRLE8)
+                    {
+                        while (first > 0 && x < info.width)
+                        {
+                            SetPixelAtPosition(x++, y, second);
+                            first--;
+                        }
+                    }
+                    else
+                    {
+                        while (first > 0 && x < info.width)
+                        {
+                            uint8_t h = (second >> 4) & 0xf;
+                            SetPixelAtPosition(x++, y, h);
+                            first--;
+                            if (first > 1)
+                            {
+                                uint8_t l = second & 0xf;
+                                SetPixelAtPosition(x++, y, l);
+                                first--;
+                            }
+                        }
+                    }
+                }
+            }
+            return true;
+        }
+
+        // decode entire image for RLE or bottom-up bitmap from non-seekable stream.
+        bool DecodeImage()
+        {
+            const BMPInfoHeader& info = bmpInfo;
+            const size_t outputRowBytes = RowBytes();
+            image = reinterpret_cast<uint8_t*>(DKMalloc(outputRowBytes * info.height));
+            if (image == nullptr)
+            {
+                DKLogE("[DKImage::Decode] Error: Out of memory!");
+                return false;
+            }
+            DKArray<uint8_t> data;
+            if (info.compression == BMPCompressionRLE8 || info.compression == BMPCompressionRLE4)
+            {
+                uint8_t buffer[4096];
+                size_t r;
+                while ((r = source.Read(buffer, sizeof(buffer))) > 0)
+                    data.Add(buffer, r);
+                return DecodeRLE(data, data.Count(), image);
+            }
+            size_t requiredBytes = rowBytesAligned * (info.height - 1) + rowBytes;
+            data.Resize(rowBytesAligned * info.height);
+            if (source.Read(data, requiredBytes) != requiredBytes)
+            {
+                DKLogE("[DKImage::Decode] Error: BMP data overflow!");
+                return false;
+            }
+            for (int32_t y = 0; y < info.height; ++y)
+            {
+                int32_t fileRow = topDown ? y : info.height - y - 1;
+                ConvertRow(&data.Value(rowBytesAligned * fileRow), &image[outputRowBytes * y]);
+            }
+            return true;
+        }
+
+        bool ReadRows(uint8_t* output, uint32_t numRows) override
+        {
+            const BMPInfoHeader& info = bmpInfo;
+            const size_t outputRowBytes = RowBytes();
+            DKASSERT_DEBUG(row + numRows <= info.height);
+
+            bool compressed = info.compression == BMPCompressionRLE8 || info.compression == BMPCompressionRLE4;
+            if (image == nullptr && (compressed || (!topDown && !source.IsSeekable())))
+            {
+                if (!DecodeImage())
+                    return false;
+            }
+            if (image)
+            {
+                memcpy(output, &image[outputRowBytes * row], outputRowBytes * numRows);
+                row += numRows;
+                return true;
+            }
+
+            if (rowBuffer.Count() < rowBytesAligned)
+                rowBuffer.Resize(rowBytesAligned);
+            for (uint32_t i = 0; i < numRows; ++i)
+            {
+                uint32_t y = row + i;
+                uint32_t fileRow = topDown ? y : info.height - y - 1;
+                size_t pos = fileHeader.offBits + rowBytesAligned * fileRow;
+                if (!source.Seek(pos) || source.Read(rowBuffer, rowBytes) != rowBytes)
+                {
+                    DKLogE("[DKImage::Decode] Error: BMP data overflow!");
+                    return false;
+                }
+                ConvertRow(rowBuffer, &output[outputRowBytes * i]);
+            }
+            row += numRows;
+            return true;
+        }
+    };
+
+    inline DKObject<ImageDecoder> CreateImageDecoder(ImageDecodeSource& source)
+    {
+        uint8_t header[16];
+        size_t s = source.Peek(header, sizeof(header));
+
+        ImageFormat fmt;
+        if (!IdentifyImageFormatFromHeader(header, s, fmt))
+        {
+            DKLogE("[DKImage::Decode] Error: Unable to identify image format!");
+            return NULL;
+        }
+        DKObject<ImageDecoder> decoder;
+        switch (fmt)
+        {
+        case FormatPNG:
+            decoder = DKOBJECT_NEW PNGImageDecoder(source);
+            break;
+        case FormatJPEG:
+            decoder = DKOBJECT_NEW JPEGImageDecoder(source);
+            break;
+        case FormatBMP:
+            decoder = DKOBJECT_NEW BMPImageDecoder(source);
+            break;
+        }
+        if (decoder && decoder->ReadHeader())
+            return decoder;
+        return NULL;
+    }
+
+    // Image resampling
+    // Pixels are converted to RGBA float vector and filtered with
+    // separable two-pass convolution. (horizontal pass first)
+    // Destination rows are split into bands, each band can be processed
+    // in parallel with DKOperationQueue.
+    struct ResampleFilter
+    {
+        float radius;
+        float (*fn)(float);
+    };
+
+    inline float ResampleBox(float x)
+    {
+        return (x >= -0.5f && x < 0.5f) ? 1.0f : 0.0f;
+    }
+    inline float ResampleTriangle(float x) // Bilinear
+    {
+        x = fabsf(x);
+        return x < 1.0f ? 1.0f - x : 0.0f;
+    }
+    inline float ResampleCubic(float x) // Bicubic (Keys, a = -0.5)
+    {
+        constexpr float a = -0.5f;
+        x = fabsf(x);
+        if (x < 1.0f)
+            return ((a + 2.0f) * x - (a + 3.0f)) * x * x + 1.0f;
+        if (x < 2.0f)
+            return ((a * x - 5.0f * a) * x + 8.0f * a) * x - 4.0f * a;
+        return 0.0f;
+    }
+    inline float ResampleBSpline(float x) // Spline (cubic B-spline)
+    {
+        x = fabsf(x);
+        if (x < 1.0f)
+            return (0.5f * x - 1.0f) * x * x + 2.0f / 3.0f;
+        if (x < 2.0f)
+        {
+            x = 2.0f - x;
+            return x * x * x / 6.0f;
+        }
+        return 0.0f;
+    }
+    inline float ResampleLanczos3(float x)
+    {
+        constexpr float pi = 3.14159265358979323846f;
+        x = fabsf(x);
+        if (x < 1.0e-6f)
+            return 1.0f;
+        if (x < 3.0f)
+        {
+            float px = pi * x;
+            return 3.0f * sinf(px) * sinf(px / 3.0f) / (px * px);
+        }
+        return 0.0f;
+    }
+    inline float ResampleGaussian(float x) // sigma = 0.5
+    {
+        return x > -2.0f && x < 2.0f ? expf(-2.0f * x * x) : 0.0f;
+    }
+    inline float ResampleQuadratic(float x)
+    {
+        x = fabsf(x);
+        if (x < 0.5f)
+            return 0.75f - x * x;
+        if (x < 1.5f)
+        {
+            x = x - 1.5f;
+            return 0.5f * x * x;
+        }
+        return 0.0f;
+    }
+
+    inline ResampleFilter GetResampleFilter(DKImage::Interpolation interpolation)
+    {
+        switch (interpolation)
+        {
+        case DKImage::Nearest:      return { 0.5f, ResampleBox };
+        case DKImage::Bilinear:     return { 1.0f, ResampleTriangle };
+        case DKImage::Bicubic:      return { 2.0f, ResampleCubic };
+        case DKImage::Spline:       return { 2.0f, ResampleBSpline };
+        case DKImage::Lanczos:      return { 3.0f, ResampleLanczos3 };
+        case DKImage::Gaussian:     return { 2.0f, ResampleGaussian };
+        case DKImage::Quadratic:    return { 1.5f, ResampleQuadratic };
+        }
+        return { 1.0f, ResampleTriangle };
+    }
+
+    // filter weights of each destination pixel (of one axis)
+    struct ResampleContributions
+    {
+        struct Contribution
+        {
+            uint32_t start;     // first source pixel
+            uint32_t count;     // number of source pixels
+            uint32_t weights;   // offset of weights
+        };
+        DKArray<Contribution> contributions;
+        DKArray<float> weights;
+
+        bool IsIdentity() const
+        {
+            return identity;
+        }
+
+        void Build(uint32_t srcSize, uint32_t dstSize, DKImage::Interpolation interpolation)
+        {
+            contributions.Clear();
+            weights.Clear();
+            contributions.Reserve(dstSize);
+            identity = srcSize == dstSize;
+
+            if (identity || interpolation == DKImage::Nearest)
+            {
+                // point sampling
+                const double scale = double(srcSize) / double(dstSize);
+                weights.Add(1.0f);
+                for (uint32_t i = 0; i < dstSize; ++i)
+                {
+                    uint32_t src = Min(static_cast<uint32_t>((double(i) + 0.5) * scale), srcSize - 1);
+                    contributions.Add({ src, 1, 0 });
+                }
+                return;
+            }
+
+            const ResampleFilter filter = GetResampleFilter(interpolation);
+            const double scale = double(srcSize) / double(dstSize);
+            const double filterScale = Max(scale, 1.0); // widen filter to minify
+            const double support = filter.radius * filterScale;
+            weights.Reserve(dstSize * (static_cast<size_t>(ceil(support)) * 2 + 1));
+
+            for (uint32_t i = 0; i < dstSize; ++i)
+            {
+                const double center = (double(i) + 0.5) * scale;
+                int64_t begin = Max(static_cast<int64_t>(floor(center - support + 0.5)), int64_t(0));
+                int64_t end = Min(static_cast<int64_t>(floor(center + support + 0.5)), int64_t(srcSize));
+                if (end <= begin)
+                {
+                    begin = Min(static_cast<int64_t>(center), int64_t(srcSize) - 1);
+                    end = begin + 1;
+                }
+
+                size_t offset = weights.Count();
+                double total = 0.0;
+                for (int64_t j = begin; j < end; ++j)
+                {
+                    float w = filter.fn(static_cast<float>((double(j) + 0.5 - center) / filterScale));
+                    weights.Add(w);
+                    total += w;
+                }
+                // trim zero weights
+                size_t first = offset;
+                size_t last = weights.Count();
+                while (first + 1 < last && weights.Value(first) == 0.0f)
+                    first++;
+                while (last - 1 > first && weights.Value(last - 1) == 0.0f)
+                    last--;
+
+                if (total != 0.0)
+                {
+                    const float inv = static_cast<float>(1.0 / total);
+                    for (size_t k = first; k < last; ++k)
+                        weights.Value(k) *= inv;
+                }
+                else
+                {
+                    first = offset;
+                    last = offset + 1;
+                    weights.Value(first) = 1.0f;
+                    begin = Min(static_cast<int64_t>(center), int64_t(srcSize) - 1);
+                }
+                if (first > offset)
+                {
+                    memmove(&weights.Value(offset), &weights.Value(first), sizeof(float) * (last - first));
+                }
+                begin += first - offset;
+                weights.Remove(offset + (last - first), weights.Count() - (offset + (last - first)));
+
+                contributions.Add({ static_cast<uint32_t>(begin),
+                                    static_cast<uint32_t>(last - first),
+                                    static_cast<uint32_t>(offset) });
+            }
+        }
+    private:
+        bool identity = false;
+    };
+
+    // pixel format conversion, (to/from RGBA float)
+    template <typename T> struct PixelComponent
+    {
+        // unsigned normalized integer
+        static FORCEINLINE float ToFloat(T v)
+        {
+            return static_cast<float>(double(v) / double(std::numeric_limits<T>::max()));
+        }
+        static FORCEINLINE T FromFloat(float v)
+        {
+            double d = Clamp(double(v), 0.0, 1.0) * double(std::numeric_limits<T>::max()) + 0.5;
+            return static_cast<T>(d);
+        }
+    };
+    template <> struct PixelComponent<float>
+    {
+        static FORCEINLINE float ToFloat(float v) { return v; }
+        static FORCEINLINE float FromFloat(float v) { return v; }
+    };
+
+    template <typename T, int Channels>
+    void LoadPixelsGeneric(const void* src, size_t count, float* output)
+    {
+        const T* p = reinterpret_cast<const T*>(src);
+        for (size_t i = 0; i < count; ++i)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                if (c < Channels)
+                    output[c] = PixelComponent<T>::ToFloat(p[c]);
+                else
+                    output[c] = (c == 3) ? 1.0f : 0.0f;
+            }
+            p += Channels;
+            output += 4;
+        }
+    }
+    template <typename T, int Channels>
+    void StorePixelsGeneric(const float* input, size_t count, void* dst)
+    {
+        T* p = reinterpret_cast<T*>(dst);
+        for (size_t i = 0; i < count; ++i)
+        {
+            for (int c = 0; c < Channels; ++c)
+                p[c] = PixelComponent<T>::FromFloat(input[c]);
+            p += Channels;
+            input += 4;
+        }
+    }
+
+#if DKGL_IMAGE_RESAMPLE_SSE
+    // RGBA8 is most common format, convert 4 channels at once.
+    void LoadPixelsRGBA8(const void* src, size_t count, float* output)
+    {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(src);
+        const __m128i zero = _mm_setzero_si128();
+        const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+        for (size_t i = 0; i < count; ++i)
+        {
+            int32_t rgba;
+            memcpy(&rgba, &p[i * 4], 4);
+            __m128i v = _mm_cvtsi32_si128(rgba);
+            v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(v, zero), zero);
+            _mm_storeu_ps(&output[i * 4], _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+        }
+    }
+    void StorePixelsRGBA8(const float* input, size_t count, void* dst)
+    {
+        uint8_t* p = reinterpret_cast<uint8_t*>(dst);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 scale = _mm_set1_ps(255.0f);
+        for (size_t i = 0; i < count; ++i)
+        {
+            __m128 f = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&input[i * 4]), zero), one);
+            __m128i v = _mm_cvtps_epi32(_mm_mul_ps(f, scale));
+            v = _mm_packus_epi16(_mm_packs_epi32(v, v), v);
+            int32_t rgba = _mm_cvtsi128_si32(v);
+            memcpy(&p[i * 4], &rgba, 4);
+        }
+    }
+#endif
+
+    using LoadPixelsFunc = void (*)(const void*, size_t, float*);
+    using StorePixelsFunc = void (*)(const float*, size_t, void*);
+
+    inline LoadPixelsFunc GetLoadPixelsFunc(DKImage::PixelFormat format)
+    {
+        switch (format)
+        {
+        case DKImage::R8:       return LoadPixelsGeneric<uint8_t, 1>;
+        case DKImage::RG8:      return LoadPixelsGeneric<uint8_t, 2>;
+        case DKImage::RGB8:     return LoadPixelsGeneric<uint8_t, 3>;
+#if DKGL_IMAGE_RESAMPLE_SSE
+        case DKImage::RGBA8:    return LoadPixelsRGBA8;
+#else
+        case DKImage::RGBA8:    return LoadPixelsGeneric<uint8_t, 4>;
+#endif
+        case DKImage::R16:      return LoadPixelsGeneric<uint16_t, 1>;
+        case DKImage::RG16:     return LoadPixelsGeneric<uint16_t, 2>;
+        case DKImage::RGB16:    return LoadPixelsGeneric<uint16_t, 3>;
+        case DKImage::RGBA16:   return LoadPixelsGeneric<uint16_t, 4>;
+        case DKImage::R32:      return LoadPixelsGeneric<uint32_t, 1>;
+        case DKImage::RG32:     return LoadPixelsGeneric<uint32_t, 2>;
+        case DKImage::RGB32:    return LoadPixelsGeneric<uint32_t, 3>;
+        case DKImage::RGBA32:   return LoadPixelsGeneric<uint32_t, 4>;
+        case DKImage::R32F:     return LoadPixelsGeneric<float, 1>;
+        case DKImage::RG32F:    return LoadPixelsGeneric<float, 2>;
+        case DKImage::RGB32F:   return LoadPixelsGeneric<float, 3>;
+        case DKImage::RGBA32F:  return LoadPixelsGeneric<float, 4>;
+        }
+        return NULL;
+    }
+    inline StorePixelsFunc GetStorePixelsFunc(DKImage::PixelFormat format)
+    {
+        switch (format)
+        {
+        case DKImage::R8:       return StorePixelsGeneric<uint8_t, 1>;
+        case DKImage::RG8:      return StorePixelsGeneric<uint8_t, 2>;
+        case DKImage::RGB8:     return StorePixelsGeneric<uint8_t, 3>;
+#if DKGL_IMAGE_RESAMPLE_SSE
+        case DKImage::RGBA8:    return StorePixelsRGBA8;
+#else
+        case DKImage::RGBA8:    return StorePixelsGeneric<uint8_t, 4>;
+#endif
+        case DKImage::R16:      return StorePixelsGeneric<uint16_t, 1>;
+        case DKImage::RG16:     return StorePixelsGeneric<uint16_t, 2>;
+        case DKImage::RGB16:    return StorePixelsGeneric<uint16_t, 3>;
+        case DKImage::RGBA16:   return StorePixelsGeneric<uint16_t, 4>;
+        case DKImage::R32:      return StorePixelsGeneric<uint32_t, 1>;
+        case DKImage::RG32:     return StorePixelsGeneric<uint32_t, 2>;
+        case DKImage::RGB32:    return StorePixelsGeneric<uint32_t, 3>;
+        case DKImage::RGBA32:   return StorePixelsGeneric<uint32_t, 4>;
+        case DKImage::R32F:     return StorePixelsGeneric<float, 1>;
+        case DKImage::RG32F:    return StorePixelsGeneric<float, 2>;
+        case DKImage::RGB32F:   return StorePixelsGeneric<float, 3>;
+        case DKImage::RGBA32F:  return StorePixelsGeneric<float, 4>;
+        }
+        return NULL;
+    }
+
+    // horizontal pass: filter one row of RGBA float pixels.
+    inline void ResampleRow(const float* input, float* output, const ResampleContributions& contrib)
+    {
+        const float* weights = contrib.weights;
+        const size_t count = contrib.contributions.Count();
+        for (size_t i = 0; i < count; ++i)
+        {
+            const ResampleContributions::Contribution& c = contrib.contributions.Value(i);
+            const float* w = &weights[c.weights];
+            const float* p = &input[size_t(c.start) * 4];
+            uint32_t k = 0;
+#if DKGL_IMAGE_RESAMPLE_AVX
+            __m256 acc2 = _mm256_setzero_ps();
+            for (; k + 1 < c.count; k += 2)
+            {
+                __m256 w2 = _mm256_set_m128(_mm_set1_ps(w[k + 1]), _mm_set1_ps(w[k]));
+                acc2 = _mm256_add_ps(acc2, _mm256_mul_ps(w2, _mm256_loadu_ps(&p[k * 4])));
+            }
+            __m128 acc = _mm_add_ps(_mm256_castps256_ps128(acc2), _mm256_extractf128_ps(acc2, 1));
+#elif DKGL_IMAGE_RESAMPLE_SSE
+            __m128 acc = _mm_setzero_ps();
+#endif
+#if DKGL_IMAGE_RESAMPLE_SSE
+            for (; k < c.count; ++k)
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[k]), _mm_loadu_ps(&p[k * 4])));
+            _mm_storeu_ps(&output[i * 4], acc);
+#else
+            float r = 0.0f, g = 0.0f, b = 0.0f, a = 0.0f;
+            for (; k < c.count; ++k)
+            {
+                r += w[k] * p[k * 4];
+                g += w[k] * p[k * 4 + 1];
+                b += w[k] * p[k * 4 + 2];
+                a += w[k] * p[k * 4 + 3];
+            }
+            output[i * 4] = r;
+            output[i * 4 + 1] = g;
+            output[i * 4 + 2] = b;
+            output[i * 4 + 3] = a;
+#endif
+        }
+    }
+
+    // vertical pass: weighted sum of rows.
+    inline void ResampleColumns(const float* const* rows, const float* weights, uint32_t numRows, float* output, size_t numFloats)
+    {
+        size_t i = 0;
+#if DKGL_IMAGE_RESAMPLE_AVX
+        for (; i + 8 <= numFloats; i += 8)
+        {
+            __m256 acc = _mm256_setzero_ps();
+            for (uint32_t k = 0; k < numRows; ++k)
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(&rows[k][i])));
+            _mm256_storeu_ps(&output[i], acc);
+        }
+#endif
+#if DKGL_IMAGE_RESAMPLE_SSE
+        for (; i + 4 <= numFloats; i += 4)
+        {
+            __m128 acc = _mm_setzero_ps();
+            for (uint32_t k = 0; k < numRows; ++k)
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(&rows[k][i])));
+            _mm_storeu_ps(&output[i], acc);
+        }
+#endif
+        for (; i < numFloats; ++i)
+        {
+            float acc = 0.0f;
+            for (uint32_t k = 0; k < numRows; ++k)
+                acc += weights[k] * rows[k][i];
+            output[i] = acc;
+        }
+    }
+
+    struct ResampleContext
+    {
+        const uint8_t* source;
+        uint32_t sourceWidth;
+        size_t sourcePitch;
+        uint8_t* target;
+        uint32_t targetWidth;
+        size_t targetPitch;
+        LoadPixelsFunc load;
+        StorePixelsFunc store;
+        ResampleContributions horizontal;
+        ResampleContributions vertical;
+        DKAtomicNumber32 failed;
+
+        enum
+        {
+            BandHeight = 32,
+            MaxBufferedRows = 256,          // filtered source rows per pass.
+            MaxBufferBytes = 32 << 20,      // bound of filtered rows buffer.
+        };
+
+        // resample rows in range [y0, y1) of target image.
+        void ProcessBand(uint32_t y0, uint32_t y1)
+        {
+            uint32_t srcBegin = ~uint32_t(0);
+            uint32_t srcEnd = 0;
+            for (uint32_t y = y0; y < y1; ++y)
+            {
+                const ResampleContributions::Contribution& c = vertical.contributions.Value(y);
+                srcBegin = Min(srcBegin, c.start);
+                srcEnd = Max(srcEnd, c.start + c.count);
+            }
+            const size_t numSrcRows = srcEnd - srcBegin;
+            const size_t rowFloats = size_t(targetWidth) * 4;
+            const bool identityH = horizontal.IsIdentity();
+
+            // number of filtered rows can be buffered at once.
+            const size_t maxRows = Max(Min(size_t(MaxBufferBytes) / (rowFloats * sizeof(float)), size_t(MaxBufferedRows)), size_t(1));
+            if (numSrcRows > maxRows)
+            {
+                if (y1 - y0 > 1)
+                {
+                    // heavy vertical minification, split band to bound buffer.
+                    uint32_t mid = y0 + (y1 - y0) / 2;
+                    ProcessBand(y0, mid);
+                    ProcessBand(mid, y1);
+                }
+                else
+                {
+                    ProcessRowInChunks(y0, maxRows);
+                }
+                return;
+            }
+
+            // filtered source rows, source row (for horizontal pass), output row.
+            size_t bufferFloats = rowFloats * (numSrcRows + 1);
+            if (!identityH)
+                bufferFloats += size_t(sourceWidth) * 4;
+            float* buffer = reinterpret_cast<float*>(DKMalloc(bufferFloats * sizeof(float)));
+            if (buffer == NULL)
+            {
+                failed = 1;
+                return;
+            }
+            float* filteredRows = buffer;
+            float* outputRow = &filteredRows[rowFloats * numSrcRows];
+            float* sourceRow = &outputRow[rowFloats];
+
+            // point sampling (minification) does not use all rows in range.
+            DKArray<bool> rowUsed;
+            rowUsed.Resize(numSrcRows, false);
+            for (uint32_t y = y0; y < y1; ++y)
+            {
+                const ResampleContributions::Contribution& c = vertical.contributions.Value(y);
+                for (uint32_t k = 0; k < c.count; ++k)
+                    rowUsed.Value(c.start + k - srcBegin) = true;
+            }
+
+            for (size_t i = 0; i < numSrcRows; ++i)
+            {
+                if (!rowUsed.Value(i))
+                    continue;
+                const uint8_t* src = &source[(srcBegin + i) * sourcePitch];
+                if (identityH)
+                {
+                    load(src, sourceWidth, &filteredRows[rowFloats * i]);
+                }
+                else
+                {
+                    load(src, sourceWidth, sourceRow);
+                    ResampleRow(sourceRow, &filteredRows[rowFloats * i], horizontal);
+                }
+            }
+
+            const float* rows[257];
+            for (uint32_t y = y0; y < y1; ++y)
+            {
+                const ResampleContributions::Contribution& c = vertical.contributions.Value(y);
+                const float* weights = &vertical.weights.Value(c.weights);
+                uint32_t k = 0;
+                while (k < c.count)
+                {
+                    // bound number of rows per iteration. (heavy minification)
+                    uint32_t n = Min(c.count - k, uint32_t(256));
+                    for (uint32_t r = 0; r < n; ++r)
+                        rows[r] = &filteredRows[rowFloats * (c.start + k + r - srcBegin)];
+                    if (k == 0)
+                    {
+                        ResampleColumns(rows, weights, n, outputRow, rowFloats);
+                    }
+                    else
+                    {
+                        rows[n] = outputRow;
+                        const float one = 1.0f;
+                        float w[257];
+                        memcpy(w, &weights[k], sizeof(float) * n);
+                        w[n] = one;
+                        ResampleColumns(rows, w, n + 1, outputRow, rowFloats);
+                    }
+                    k += n;
+                }
+                store(outputRow, targetWidth, &target[size_t(y) * targetPitch]);
+            }
+            DKFree(buffer);
+        }
+
+        // resample single row of target image, which has too many source rows
+        // to be buffered. filter and accumulate source rows in chunks.
+        void ProcessRowInChunks(uint32_t y, size_t maxRows)
+        {
+            const size_t rowFloats = size_t(targetWidth) * 4;
+            const bool identityH = horizontal.IsIdentity();
+
+            size_t bufferFloats = rowFloats * (maxRows + 1);
+            if (!identityH)
+                bufferFloats += size_t(sourceWidth) * 4;
+            float* buffer = reinterpret_cast<float*>(DKMalloc(bufferFloats * sizeof(float)));
+            if (buffer == NULL)
+            {
+                failed = 1;
+                return;
+            }
+            float* filteredRows = buffer;
+            float* outputRow = &filteredRows[rowFloats * maxRows];
+            float* sourceRow = &outputRow[rowFloats];
+
+            const ResampleContributions::Contribution& c = vertical.contributions.Value(y);
+            const float* weights = &vertical.weights.Value(c.weights);
+            const float* rows[MaxBufferedRows + 1];
+            float w[MaxBufferedRows + 1];
+            uint32_t k = 0;
+            while (k < c.count)
+            {
+                uint32_t n = Min(c.count - k, uint32_t(maxRows));
+                for (uint32_t r = 0; r < n; ++r)
+                {
+                    const uint8_t* src = &source[size_t(c.start + k + r) * sourcePitch];
+                    float* row = &filteredRows[rowFloats * r];
+                    if (identityH)
+                    {
+                        load(src, sourceWidth, row);
+                    }
+                    else
+                    {
+                        load(src, sourceWidth, sourceRow);
+                        ResampleRow(sourceRow, row, horizontal);
+                    }
+                    rows[r] = row;
+                }
+                if (k == 0)
+                {
+                    ResampleColumns(rows, &weights[k], n, outputRow, rowFloats);
+                }
+                else
                 {
-                    f = FormatJPEG;
-                    return true;
+                    rows[n] = outputRow;
+                    memcpy(w, &weights[k], sizeof(float) * n);
+                    w[n] = 1.0f;
+                    ResampleColumns(rows, w, n + 1, outputRow, rowFloats);
                 }
+                k += n;
             }
+            store(outputRow, targetWidth, &target[size_t(y) * targetPitch]);
+            DKFree(buffer);
         }
-        return false;
     };
 
-    inline size_t BytesPerPixel(DKImage::PixelFormat format)
-    {
-        switch (format)
-        {
-        case DKImage::R8:		return 1;
-        case DKImage::RG8:		return 2;
-        case DKImage::RGB8:		return 3;
-        case DKImage::RGBA8:	return 4;
-        case DKImage::R16:		return 2;
-        case DKImage::RG16:		return 4;
-        case DKImage::RGB16:	return 6;
-        case DKImage::RGBA16:	return 8;
-        case DKImage::R32:		return 4;
-        case DKImage::RG32:		return 8;
-        case DKImage::RGB32:	return 12;
-        case DKImage::RGBA32:	return 16;
-        case DKImage::R32F:		return 4;
-        case DKImage::RG32F:	return 8;
-        case DKImage::RGB32F:	return 12;
-        case DKImage::RGBA32F:	return 16;
-        }
-        return 0;
-    }
-
     // register image extensions to resource-loader.
     int RegisterImageFileExts()
     {
@@ -329,12 +1850,37 @@ DKObject<DKImage> DKImage::Create(const DKString &path)
 	return NULL;
 }
 
+DKObject<DKImage> DKImage::DecodeImage(ImageDecodeSource& source)
+{
+	DKObject<ImageDecoder> decoder = CreateImageDecoder(source);
+	if (decoder)
+	{
+		const Info& info = decoder->info;
+		DKObject<DKImage> image = Create(info.width, info.height, info.format, nullptr);
+		if (image)
+		{
+			if (decoder->ReadRows(reinterpret_cast<uint8_t*>(image->data), info.height))
+				return image;
+		}
+		else
+		{
+			DKLogE("[DKImage::Decode] Error: Out of memory!");
+		}
+	}
+	return NULL;
+}
+
 DKObject<DKImage> DKImage::Create(DKStream* stream)
 {
 	DKObject<DKDataStream> ds = DKObject<DKStream>(stream).SafeCast<DKDataStream>();
 	if (ds)
 		return Create(ds->Data());
-	return Create(DKBuffer::Create(stream));
+	if (stream)
+	{
+		ImageDecodeSource source(stream);
+		return DecodeImage(source);
+	}
+	return NULL;
 }
 
 DKObject<DKImage> DKImage::Create(DKData* data)
@@ -347,801 +1893,84 @@ DKObject<DKImage> DKImage::Create(const void *p, size_t s)
 	if (p == NULL || s == 0)
 		return NULL;
 
-	ImageFormat fmt;
-	if (!IdentifyImageFormatFromHeader(reinterpret_cast<const uint8_t*>(p), s, fmt))
+	ImageDecodeSource source(p, s);
+	return DecodeImage(source);
+}
+
+bool DKImage::ReadInfo(DKStream* stream, Info& info)
+{
+	if (stream == NULL)
+		return false;
+
+	DKStream::Position pos = stream->CurrentPosition();
+	ImageDecodeSource source(stream);
+	DKObject<ImageDecoder> decoder = CreateImageDecoder(source);
+	if (stream->IsSeekable())
+		stream->SetCurrentPosition(pos);
+	if (decoder)
 	{
-		DKLogE("[DKImage::Create] Error: Unable to identify image format!");
-		return NULL;
+		info = decoder->info;
+		return true;
 	}
+	return false;
+}
 
-	switch (fmt)
+bool DKImage::Decode(DKStream* stream, DecodeCallback* callback, uint32_t bandHeight)
+{
+	if (stream == NULL || callback == NULL)
+		return false;
+
+	ImageDecodeSource source(stream);
+	DKObject<ImageDecoder> decoder = CreateImageDecoder(source);
+	if (decoder == NULL)
+		return false;
+
+	const Info& info = decoder->info;
+	bandHeight = Clamp(bandHeight, 1U, info.height);
+	const size_t rowBytes = decoder->RowBytes();
+	void* buffer = DKMalloc(rowBytes * bandHeight);
+	if (buffer == NULL)
 	{
-	case FormatPNG:
-		if (1)
-		{
-			png_image image = {};
-			image.version = PNG_IMAGE_VERSION;
-			if (png_image_begin_read_from_memory(&image, p, s))
-			{
-				PixelFormat pixelFormat;
-				switch (image.format)
-				{
-				case PNG_FORMAT_GRAY:
-					pixelFormat = R8;
-					break;
-				case PNG_FORMAT_AG:
-					image.format = PNG_FORMAT_GA;
-				case PNG_FORMAT_GA:
-					pixelFormat = RG8;
-					break;
-				case PNG_FORMAT_BGR:
-					image.format = PNG_FORMAT_RGB;
-				case PNG_FORMAT_RGB:
-					pixelFormat = RGB8;
-					break;
-				case PNG_FORMAT_ARGB:
-				case PNG_FORMAT_BGRA:
-				case PNG_FORMAT_ABGR:
-					image.format = PNG_FORMAT_RGBA;
-				case PNG_FORMAT_RGBA:
-					pixelFormat = RGBA8;
-					break;
-				case PNG_FORMAT_LINEAR_Y:
-					pixelFormat = R16;
-					break;
-				case PNG_FORMAT_LINEAR_Y_ALPHA:
-					pixelFormat = RG16;
-					break;
-				case PNG_FORMAT_LINEAR_RGB:
-					pixelFormat = RGB16;
-					break;
-				case PNG_FORMAT_LINEAR_RGB_ALPHA:
-					pixelFormat = RGBA16;
-					break;
-				default:
-					image.format = PNG_FORMAT_RGBA;
-					//png_image_free(&image);
-					//return false;
-				}
-
-				DKObject<DKImage> output = DKImage::Create(image.width, image.height, pixelFormat, nullptr);
-				if (output)
-				{
-					size_t imageSizeInBytes = PNG_IMAGE_SIZE(image);
-					if (imageSizeInBytes == output->BytesPerPixel() * output->width * output->height)
-					{
-						if (png_image_finish_read(&image, nullptr, output->data, 0, nullptr))
-							return output;
-					}
-					output = NULL;
-					DKLogE("[DKImage::Create] Error: PNG buffer error!");
-				}
-				else
-				{
-					DKLogE("[DKImage::Create] Error: Out of memory!");
-				}
-				// failed! (dealloc buffer and return)
-				png_image_free(&image);
-			}
-		}
-		break;
-	case FormatJPEG:
-		if (1)
-		{
-			jpeg_decompress_struct cinfo = {};
-			JpegErrorMgr err = {};
-			struct JpegSource
-			{
-				struct jpeg_source_mgr pub;
-				const uint8_t* data;
-				size_t length;
-				uint8_t eofMarker[2];
-			};
-			JpegSource source;
-			source.data = reinterpret_cast<const uint8_t*>(p);
-			source.length = s;
-			source.pub.bytes_in_buffer = 0;
-			source.pub.next_input_byte = NULL;
-			source.pub.init_source = [](j_decompress_ptr cinfo) {};
-			source.pub.fill_input_buffer = [](j_decompress_ptr cinfo)->boolean
-			{
-				JpegSource* src = reinterpret_cast<JpegSource*>(cinfo->src);
-				if (src->length > 0)
-				{
-					src->pub.next_input_byte = (const JOCTET*)src->data;
-					size_t s = Min(src->length, size_t(JPEG_BUFFER_SIZE));
-					src->pub.bytes_in_buffer = s;
-					src->length -= s;
-					src->data += s;
-				}
-				else
-				{
-					src->pub.next_input_byte = (const JOCTET*)src->eofMarker;
-					src->eofMarker[0] = 0xff;
-					src->eofMarker[1] = JPEG_EOI;
-					src->pub.bytes_in_buffer = 2;
-				}
-				return TRUE;
-			};
-			source.pub.skip_input_data = [](j_decompress_ptr cinfo, long numBytes)
-			{
-				if (numBytes > 0)
-				{
-					JpegSource* src = reinterpret_cast<JpegSource*>(cinfo->src);
-					while (numBytes > (long)src->pub.bytes_in_buffer)
-					{
-						numBytes -= (long)src->pub.bytes_in_buffer;
-						src->pub.fill_input_buffer(cinfo);
-					}
-					src->pub.next_input_byte += (size_t)numBytes;
-					src->pub.bytes_in_buffer -= (size_t)numBytes;
-
-				}
-			};
-			source.pub.term_source = [](j_decompress_ptr cinfo) {};
-
-			cinfo.err = jpeg_std_error(&err.pub);
-			err.pub.error_exit = [](j_common_ptr cinfo)
-			{
-				JpegErrorMgr* err = (JpegErrorMgr*)cinfo->err;
-				err->pub.format_message(cinfo, err->buffer);
-				longjmp(err->setjmpBuffer, 1);
-			};
-
-			if (setjmp(err.setjmpBuffer))
-			{
-				DKLogE("[DKImage::Create] JPEG Error: %s", err.buffer);
-				jpeg_destroy_decompress(&cinfo);
-				return NULL;
-			}
-			jpeg_create_decompress(&cinfo);
-			cinfo.src = (jpeg_source_mgr*)&source;
-			jpeg_read_header(&cinfo, TRUE);
-
-			int32_t bytesPerPixel;
-			if (cinfo.out_color_space == JCS_CMYK || cinfo.out_color_space == JCS_YCCK)
-			{
-				cinfo.out_color_space = JCS_CMYK;
-				bytesPerPixel = 4;
-			}
-			else
-			{
-				cinfo.out_color_space = JCS_RGB;
-				bytesPerPixel = 3;
-			}
-			jpeg_start_decompress(&cinfo);
-
-			DKObject<DKImage> output = DKImage::Create(cinfo.image_width, cinfo.image_height, RGB8, 0);
-			if (output)
-			{
-				uint32_t rowStride = output->width * 3;
-				uint8_t* data = (uint8_t*)output->data;
-
-				if (cinfo.out_color_space == JCS_RGB)
-				{
-					JSAMPARRAY buffer = (*cinfo.mem->alloc_sarray)
-						((j_common_ptr)&cinfo, JPOOL_IMAGE, rowStride, 1);
-					while (cinfo.output_scanline < cinfo.output_height)
-					{
-						jpeg_read_scanlines(&cinfo, buffer, 1);
-						memcpy(data, buffer[0], rowStride);
-						data += rowStride;
-					}
-				}
-				else
-				{
-					JSAMPARRAY buffer = (*cinfo.mem->alloc_sarray)
-						((j_common_ptr)&cinfo, JPOOL_IMAGE, output->width * 4, 1);
-					auto CmykToRgb = [](uint8_t* rgb, uint8_t* cmyk)
-					{
-						uint32_t k1 = 255 - cmyk[3];
-						uint32_t k2 = cmyk[3];
-						for (int i = 0; i < 3; ++i)
-						{
-							uint32_t c = k1 + k2 * (255 - cmyk[i]) / 255;
-							rgb[i] = (c > 255) ? 0 : (255 - c);
-						}
-					};
-					while (cinfo.output_scanline < cinfo.output_height)
-					{
-						jpeg_read_scanlines(&cinfo, buffer, 1);
-						uint8_t* input = (uint8_t*)buffer[0];
-						for (size_t i = 0; i < cinfo.output_width; ++i)
-						{
-							CmykToRgb(data, input);
-							data += 3;
-							input += 4;
-						}
-					}
-				}
-			}
-			else
-			{
-				DKLogE("[DKImage::Create] Error: Out of memory!");				
-			}
-			jpeg_finish_decompress(&cinfo);
-			jpeg_destroy_decompress(&cinfo);
-			return output;
-		}
-		break;
-	case FormatBMP:
-		if (s > sizeof(BMPFileHeader) + sizeof(BMPCoreHeader))
-		{
-			auto CheckOverflow = [s](size_t pos)->bool
-			{
-				if (s < pos)
-				{
-					DKLogE("[DKImage::Create] Error: BMP data overflow!");
-					return false;
-				}
-				return true;
-			};
-
-			const uint8_t* data = reinterpret_cast<const uint8_t*>(p);
-			size_t pos = 0;
-			BMPFileHeader fileHeader = *reinterpret_cast<const BMPFileHeader*>(data);
-			fileHeader.size = DKLittleEndianToSystem(fileHeader.size);
-			fileHeader.offBits = DKLittleEndianToSystem(fileHeader.offBits);
-			if (!CheckOverflow(fileHeader.size))
-				return NULL;
-			if (!CheckOverflow(fileHeader.offBits))
-				return NULL;
-
-			pos += sizeof(BMPFileHeader);
-			size_t headerSize = DKLittleEndianToSystem(reinterpret_cast<const BMPCoreHeader*>(&data[pos])->size);
-
-			if (!CheckOverflow(pos + headerSize))
-				return NULL;
-
-			size_t colorTableEntrySize;
-			BMPInfoHeader info = {};
-			if (headerSize >= sizeof(BMPInfoHeader))
-			{
-				info = *reinterpret_cast<const BMPInfoHeader*>(&data[pos]);
-				info.size = DKLittleEndianToSystem(info.size);
-				info.width = DKLittleEndianToSystem(info.width);
-				info.height = DKLittleEndianToSystem(info.height);
-				info.planes = DKLittleEndianToSystem(info.planes);
-				info.bitCount = DKLittleEndianToSystem(info.bitCount);
-				info.compression = DKLittleEndianToSystem(info.compression);
-				info.sizeImage = DKLittleEndianToSystem(info.sizeImage);
-				info.xPelsPerMeter = DKLittleEndianToSystem(info.xPelsPerMeter);
-				info.yPelsPerMeter = DKLittleEndianToSystem(info.yPelsPerMeter);
-				info.clrUsed = DKLittleEndianToSystem(info.clrUsed);
-				info.clrImportant = DKLittleEndianToSystem(info.clrImportant);
-				colorTableEntrySize = 4; // RGBA
-			}
-			else if (headerSize >= sizeof(BMPCoreHeader))
-			{
-				const BMPCoreHeader& core = *reinterpret_cast<const BMPCoreHeader*>(&data[pos]);
-				info.size = DKLittleEndianToSystem(core.size);
-				info.width = DKLittleEndianToSystem(core.width);
-				info.height = DKLittleEndianToSystem(core.height);
-				info.planes = DKLittleEndianToSystem(core.planes);
-				info.bitCount = DKLittleEndianToSystem(core.bitCount);
-				info.compression = BMPCompressionRGB;
-				info.sizeImage = 0;
-				info.xPelsPerMeter = BMP_DEFAULT_PPM;
-				info.yPelsPerMeter = BMP_DEFAULT_PPM;
-				info.clrUsed = 0;
-				info.clrImportant = 0;
-				colorTableEntrySize = 3; // old-style
-			}
-			else
-			{
-				DKLogE("[DKImage::Create] Error: Unsupported bitmap format.");
-				return NULL;
-			}
-			if (info.bitCount != 1 && info.bitCount != 4 && info.bitCount != 8 &&
-				info.bitCount != 16 && info.bitCount != 24 && info.bitCount != 32)
-			{
-				DKLogE("[DKImage::Create] Error: Unsupported bitmap format.");
-				return NULL;
-			}
-			if ((info.compression == BMPCompressionRLE4 && info.bitCount != 4) ||
-				(info.compression == BMPCompressionRLE8 && info.bitCount != 8) ||
-				(info.compression == BMPCompressionBITFIELDS && (info.bitCount != 16 && info.bitCount != 32)))
-			{
-				DKLogE("[DKImage::Create] Error: Invalid BMP data format.");
-				return NULL;
-			}
-			bool topDown = info.height < 0;
-			if (topDown)
-				info.height = -info.height;
-
-			if (info.width <= 0 || info.height <= 0)
-			{
-				DKLogE("[DKImage::Create] Error: Invalid BMP data format.");
-				return NULL;
-			}
-			pos += info.size; // set position to color-table map (if available)
-
-			if ((info.compression == BMPCompressionRLE8) || (info.compression == BMPCompressionRLE4))
-			{
-				DKObject<DKImage> image = Create(info.width, info.height, RGB8, nullptr);
-				if (image == nullptr)
-				{
-					DKLogE("[DKImage::Create] Error: Out of memory!");
-					return NULL;
-				}
-				const uint8_t* colorTableEntries = &data[pos];
-				uint8_t* output = reinterpret_cast<uint8_t*>(image->data);
-				// set background color to first color-table entry
-				for (size_t i = 0, n = info.width * info.height * 3; i < n; ++i)
-					output[i] = colorTableEntries[2 - (i % 3)];
-
-				auto SetPixelAtPosition = [&](int32_t x, int32_t y, uint8_t index)
-				{
-					if (x < info.width && y < info.height)
-					{
-						if (!topDown)
-							y = info.height - y - 1;
-
-						DKASSERT_DEBUG(index < (1 << info.bitCount));
-						uint8_t* data = &output[(y * info.width + x) * 3];
-						const uint8_t* cm = &colorTableEntries[uint32_t(4) * uint32_t(index)];
-						data[0] = cm[2];
-						data[1] = cm[1];
-						data[2] = cm[0];
-					}
-				};
-				// set position to bitmap data
-				pos = fileHeader.offBits;
-				int32_t x = 0;
-				int32_t y = 0;
-				while ((pos + 1) < s && y < info.height)
-				{
-					uint32_t first = data[pos++];
-					uint32_t second = data[pos++];
-					if (first == 0)
-					{
-						switch (second)
-						{
-						case 0:		// end of line
-							x = 0;
-							y++;
-							break;
-						case 1:		// end of bitmap
-							y = info.height;
-							break;
-						case 2:		// move position 
-							if (pos + 1 < s)
-							{
-								uint8_t deltaX = data[pos++];
-								uint8_t deltaY = data[pos++];
-								x += deltaX / (8 / info.bitCount);
-								y += deltaY;
-							}
-							break;
-						default:	// absolute mode.
-							if (info.compression == BMPCompressionRLE8)
-							{
-								for (uint32_t i = 0; i < second && pos < s && x < info.width; ++i)
-								{
-									uint8_t index = data[pos++];
-									SetPixelAtPosition(x++, y, index);
-								}
-								if (second & 1)
-									pos++;
-							}
-							else
-							{
-								uint8_t nibble[2];
-								uint32_t bytesRead = 0;
-								for (uint32_t i = 0; i < second && pos < s && x < info.width; ++i)
-								{
-									if (!(i % 2))
-									{
-										bytesRead++;
-										uint8_t index = data[pos++];
-										nibble[0] = (index >> 4) & 0xf;
-										nibble[1] = index & 0xf;
-									}
-									SetPixelAtPosition(x++, y, nibble[i % 2]);
-								}
-								if (bytesRead & 1)
-									pos++;
-							}
-							break;
-						}
-					}
-					else
-					{
-						if (info.compression == BMPCompressionRLE8)
-						{
-							while (first > 0 && x < info.width)
-							{
-								SetPixelAtPosition(x++, y, second);
-								first--;
-							}
-						}
-						else
-						{
-							while (first > 0 && x < info.width)
-							{
-								uint8_t h = (second >> 4) & 0xf;
-								SetPixelAtPosition(x++, y, h);
-								first--;
-								if (first > 1)
-								{
-									uint8_t l = second & 0xf;
-									SetPixelAtPosition(x++, y, l);
-									first--;
-								}
-							}
-						}
-					}
-				}
-				return image;
-			}
-			else
-			{
-				uint32_t rowBytes = info.width * info.bitCount;
-				if (rowBytes % 8)
-					rowBytes = rowBytes / 8 + 1;
-				else
-					rowBytes = rowBytes / 8;
-				// each row must be align of 4-bytes
-				size_t rowBytesAligned = (rowBytes % 4) ? (rowBytes | 0x3) + 1 : rowBytes;
-
-				size_t requiredBytes = rowBytesAligned * (info.height - 1) + rowBytes;
-
-				if (!CheckOverflow(fileHeader.offBits + requiredBytes))
-					return NULL;
+		DKLogE("[DKImage::Decode] Error: Out of memory!");
+		return false;
+	}
+	bool result = true;
+	for (uint32_t row = 0; row < info.height && result; row += bandHeight)
+	{
+		uint32_t numRows = Min(bandHeight, info.height - row);
+		result = decoder->ReadRows(reinterpret_cast<uint8_t*>(buffer), numRows) &&
+			callback->Invoke(info, row, numRows, buffer);
+	}
+	DKFree(buffer);
+	return result;
+}
 
-				const uint8_t* bitmapData = &data[fileHeader.offBits];
+bool DKImage::Decode(DKStream* stream, DKData* output, Info* info)
+{
+	if (stream == NULL || output == NULL)
+		return false;
 
-				if (info.compression == BMPCompressionBITFIELDS)
-				{
-					uint32_t bitMask[3] = {
-						DKLittleEndianToSystem(reinterpret_cast<const uint32_t*>(&data[pos])[0]),
-						DKLittleEndianToSystem(reinterpret_cast<const uint32_t*>(&data[pos])[1]),
-						DKLittleEndianToSystem(reinterpret_cast<const uint32_t*>(&data[pos])[2])
-					};
-					uint32_t bitShift[3] = { 0, 0, 0 };
-					uint32_t numBits[3] = { 0, 0, 0 };
-
-					for (int bit = 31; bit >= 0; --bit)
-					{
-						for (int i = 0; i < 3; ++i)
-						{
-							if (bitMask[i] & (1U << bit))
-								bitShift[i] = bit;
-						}
-					}
-					for (int i = 0; i < 3; ++i)
-						bitMask[i] = bitMask[i] >> bitShift[i];
+	ImageDecodeSource source(stream);
+	DKObject<ImageDecoder> decoder = CreateImageDecoder(source);
+	if (decoder == NULL)
+		return false;
 
-					for (int bit = 0; bit < 32; ++bit)
-					{
-						for (int i = 0; i < 3; ++i)
-						{
-							if (bitMask[i] & (1U << bit))
-								numBits[i] = bit + 1;
-						}
-					}
-					if (numBits[0] <= 8 && numBits[1] <= 8 && numBits[2] <= 8) // RGB8
-					{
-						uint32_t lshift[3] = { 8 - numBits[0], 8 - numBits[1], 8 - numBits[2] };
-
-						DKObject<DKImage> image = Create(info.width, info.height, RGB8, nullptr);
-						if (image == nullptr)
-						{
-							DKLogE("[DKImage::Create] Error: Out of memory!");
-							return NULL;
-						}
-
-						uint8_t* output = reinterpret_cast<uint8_t*>(image->data);
-
-						if (info.bitCount == 32)
-						{
-							auto SetRowPixels = [&](uint8_t*& output, const uint32_t* input, uint32_t width)
-							{
-								for (uint32_t x = 0; x < width; ++x)
-								{
-									uint32_t rgb = DKLittleEndianToSystem(*input);
-									for (int i = 0; i < 3; ++i)
-									{
-										output[0] = ((rgb >> bitShift[i]) & bitMask[i]) << lshift[i];
-										output++;
-									}
-									input++;
-								}
-							};
-							if (topDown)
-							{
-								for (int32_t y = 0; y < info.height; ++y)
-								{
-									const uint32_t* row = reinterpret_cast<const uint32_t*>(&bitmapData[rowBytesAligned * y]);
-									SetRowPixels(output, row, info.width);
-								}
-							}
-							else
-							{
-								for (int32_t y = info.height - 1; y >= 0; --y)
-								{
-									const uint32_t* row = reinterpret_cast<const uint32_t*>(&bitmapData[rowBytesAligned * y]);
-									SetRowPixels(output, row, info.width);
-								}
-							}
-						}
-						else // 16
-						{
-							auto SetRowPixels = [&](uint8_t*& output, const uint16_t* input, uint32_t width)
-							{
-								for (uint32_t x = 0; x < width; ++x)
-								{
-									uint16_t rgb = DKLittleEndianToSystem(*input);
-									for (int i = 0; i < 3; ++i)
-									{
-										output[0] = ((rgb >> bitShift[i]) & bitMask[i]) << lshift[i];
-										output++;
-									}
-									input++;
-								}
-							};
-							if (topDown)
-							{
-								for (int32_t y = 0; y < info.height; ++y)
-								{
-									const uint16_t* row = reinterpret_cast<const uint16_t*>(&bitmapData[rowBytesAligned * y]);
-									SetRowPixels(output, row, info.width);
-								}
-							}
-							else
-							{
-								for (int32_t y = info.height - 1; y >= 0; --y)
-								{
-									const uint16_t* row = reinterpret_cast<const uint16_t*>(&bitmapData[rowBytesAligned * y]);
-									SetRowPixels(output, row, info.width);
-								}
-							}
-						}
-						return image;
-					}
-					else // RGB32F
-					{
-						DKObject<DKImage> image = Create(info.width, info.height, RGB32F, nullptr);
-						if (image == nullptr)
-						{
-							DKLogE("[DKImage::Create] Error: Out of memory!");
-							return NULL;
-						}
-
-						float denum[3] = {
-							static_cast<float>(bitMask[0]),
-							static_cast<float>(bitMask[1]),
-							static_cast<float>(bitMask[2])
-						};
-
-						float* output = reinterpret_cast<float*>(image->data);
-
-						if (info.bitCount == 32)
-						{
-							auto SetRowPixels = [&](float*& output, const uint32_t* input, uint32_t width)
-							{
-								for (uint32_t x = 0; x < width; ++x)
-								{
-									uint32_t rgb = DKLittleEndianToSystem(*input);
-									for (int i = 0; i < 3; ++i)
-									{
-										if (denum[i] != 0.0f)
-											output[0] = static_cast<float>((rgb >> bitShift[i]) & bitMask[i]) / denum[i];
-										else
-											output[0] = 0.0f;
-										output++;
-									}
-									input++;
-								}
-							};
-							if (topDown)
-							{
-								for (int32_t y = 0; y < info.height; ++y)
-								{
-									const uint32_t* row = reinterpret_cast<const uint32_t*>(&bitmapData[rowBytesAligned * y]);
-									SetRowPixels(output, row, info.width);
-								}
-							}
-							else
-							{
-								for (int32_t y = info.height - 1; y >= 0; --y)
-								{
-									const uint32_t* row = reinterpret_cast<const uint32_t*>(&bitmapData[rowBytesAligned * y]);
-									SetRowPixels(output, row, info.width);
-								}
-							}
-						}
-						else // 16
-						{
-							auto SetRowPixels = [&](float*& output, const uint16_t* input, uint32_t width)
-							{
-								for (uint32_t x = 0; x < width; ++x)
-								{
-									uint16_t rgb = DKLittleEndianToSystem(*input);
-									for (int i = 0; i < 3; ++i)
-									{
-										if (denum[i] != 0.0f)
-											output[0] = static_cast<float>((rgb >> bitShift[i]) & bitMask[i]) / denum[i];
-										else
-											output[0] = 0.0f;
-										output++;
-									}
-									input++;
-								}
-							};
-							if (topDown)
-							{
-								for (int32_t y = 0; y < info.height; ++y)
-								{
-									const uint16_t* row = reinterpret_cast<const uint16_t*>(&bitmapData[rowBytesAligned * y]);
-									SetRowPixels(output, row, info.width);
-								}
-							}
-							else
-							{
-								for (int32_t y = info.height - 1; y >= 0; --y)
-								{
-									const uint16_t* row = reinterpret_cast<const uint16_t*>(&bitmapData[rowBytesAligned * y]);
-									SetRowPixels(output, row, info.width);
-								}
-							}
-						}
-						return image;
-					}
-				}
-				else if (info.bitCount == 32 || info.bitCount == 24)
-				{
-					DKObject<DKImage> image;
-					if (info.bitCount == 32)
-						image = Create(info.width, info.height, RGBA8, nullptr);
-					else
-						image = Create(info.width, info.height, RGB8, nullptr);
-					if (image == nullptr)
-					{
-						DKLogE("[DKImage::Create] Error: Out of memory!");
-						return NULL;
-					}
-					int32_t bpp = info.bitCount / 8;
-					const uint32_t colorIndices[] = { 2, 1, 0, 3 }; // BGRA -> RGBA
+	if (info)
+		*info = decoder->info;
 
-					auto SetRowPixels = [&](uint8_t*& output, const uint8_t* input, uint32_t width, uint8_t bpp)
-					{
-						for (uint32_t x = 0; x < width; ++x)
-						{
-							for (int32_t i = 0; i < bpp; ++i)
-								output[i] = input[colorIndices[i]];
-							output += bpp;
-							input += bpp;
-						}
-					};
-
-					uint8_t* output = reinterpret_cast<uint8_t*>(image->data);
-					if (topDown)
-					{
-						for (int32_t y = 0; y < info.height; ++y)
-						{
-							const uint8_t* row = &bitmapData[rowBytesAligned * y];
-							SetRowPixels(output, row, info.width, bpp);
-						}
-					}
-					else
-					{
-						for (int32_t y = info.height - 1; y >= 0; --y)
-						{
-							const uint8_t* row = &bitmapData[rowBytesAligned * y];
-							SetRowPixels(output, row, info.width, bpp);
-						}
-					}
-					return image;
-				}
-				else if (info.bitCount == 16)
-				{
-					DKObject<DKImage> image = Create(info.width, info.height, RGB8, nullptr);
-					if (image == nullptr)
-					{
-						DKLogE("[DKImage::Create] Error: Out of memory!");
-						return NULL;
-					}
-					uint8_t* output = reinterpret_cast<uint8_t*>(image->data);
-					auto SetRowPixels = [&](uint8_t*& output, const uint16_t* input, uint32_t width)
-					{
-						for (uint32_t x = 0; x < width; ++x)
-						{
-							uint16_t pixel = DKLittleEndianToSystem(*input);
-							uint16_t r = (pixel & 0x7c00) >> 10;
-							uint16_t g = (pixel & 0x03e0) >> 5;
-							uint16_t b = (pixel & 0x001f);
-
-							output[0] = static_cast<uint8_t>((r << 3) & 0xff);
-							output[1] = static_cast<uint8_t>((g << 3) & 0xff);
-							output[2] = static_cast<uint8_t>((b << 3) & 0xff);
-
-							output += 3;
-							input++;
-						}
-					};
-					if (topDown)
-					{
-						for (int32_t y = 0; y < info.height; ++y)
-						{
-							const uint16_t* row = reinterpret_cast<const uint16_t*>(&bitmapData[rowBytesAligned * y]);
-							SetRowPixels(output, row, info.width);
-						}
-					}
-					else
-					{
-						for (int32_t y = info.height - 1; y >= 0; --y)
-						{
-							const uint16_t* row = reinterpret_cast<const uint16_t*>(&bitmapData[rowBytesAligned * y]);
-							SetRowPixels(output, row, info.width);
-						}
-					}
-					return image;
-				}
-				else // 1, 4, 8
-				{
-					DKObject<DKImage> image = Create(info.width, info.height, RGB8, nullptr);
-					if (image == nullptr)
-					{
-						DKLogE("[DKImage::Create] Error: Out of memory!");
-						return NULL;
-					}
-					auto SetPixelFromCMap = [&](uint8_t index, uint8_t* output)
-					{
-						const uint8_t* colorTableEntries = &data[pos];
-						DKASSERT_DEBUG(index < (1 << info.bitCount));
-						const uint8_t* c = &colorTableEntries[uint32_t(colorTableEntrySize) * uint32_t(index)];
-						output[0] = c[2];
-						output[1] = c[1];
-						output[2] = c[0];
-					};
-					auto SetRowPixels = [&](uint8_t*& output, const uint8_t* input, size_t width, uint16_t bits, uint8_t mask)
-					{
-						int32_t x = 0;
-						while (x < width)
-						{
-							uint8_t c = *input;
-							for (int32_t bit = 0; bit < 8 && x < width; ++x)
-							{
-								bit += bits;
-								uint8_t index = (c >> (8 - bit)) & mask;
-								SetPixelFromCMap(index, output);
-								output += 3; //RGB8
-							}
-							input++;
-						}
-						DKASSERT_DEBUG(x == width);
-					};
-					uint8_t* output = reinterpret_cast<uint8_t*>(image->data);
-					uint8_t pixelMask = (1 << info.bitCount) - 1;
-
-					if (topDown)
-					{
-						for (int32_t y = 0; y < info.height;++y)
-						{
-							const uint8_t* row = &bitmapData[rowBytesAligned * y];
-							SetRowPixels(output, row, info.width, info.bitCount, pixelMask);
-						}
-					}
-					else
-					{
-						for (int32_t y = info.height - 1; y >= 0; --y)
-						{
-							const uint8_t* row = &bitmapData[rowBytesAligned * y];
-							SetRowPixels(output, row, info.width, info.bitCount, pixelMask);
-						}
-					}
-					return image;
-				}
-			}
-		}
-		else
-		{
-			DKLogE("[DKImage::Create] Error: BMP data size is too small!");
-		}
-		break;
+	size_t length = decoder->RowBytes() * decoder->info.height;
+	if (output->Length() < length)
+	{
+		DKLogE("[DKImage::Decode] Error: Output data is too small! (%zu < %zu)", output->Length(), length);
+		return false;
 	}
-	return NULL;
+	void* p = output->MutableContents();
+	if (p == NULL)
+	{
+		DKLogE("[DKImage::Decode] Error: Output data is not writable!");
+		return false;
+	}
+	return decoder->ReadRows(reinterpret_cast<uint8_t*>(p), decoder->info.height);
 }
 
 DKObject<DKData> DKImage::EncodeData(const DKString& str, DKOperationQueue* queue) const
@@ -1477,26 +2306,53 @@ DKObject<DKImage> DKImage::Resample(uint32_t w, uint32_t h, PixelFormat f, Inter
 		output->height = h;
 		output->format = f;
 
+		size_t bpp = Private::BytesPerPixel(f);
+		size_t dataSize = bpp * w * h;
+		output->data = DKMalloc(dataSize);
+		if (output->data == NULL)
+		{
+			DKLogE("[DKImage::Resample] Error: Out of memory!");
+			return NULL;
+		}
+
 		if (w == this->width && h == this->height && f == this->format)
 		{
-			size_t s = Private::BytesPerPixel(f);
-			size_t dataSize = s * w * h;
-			output->data = DKMalloc(dataSize);
-			if (output->data)
-			{
-				memcpy(output->data, this->data, dataSize);
-			}
-			else
+			memcpy(output->data, this->data, dataSize);
+			return output;
+		}
+
+		ResampleContext context;
+		context.source = reinterpret_cast<const uint8_t*>(this->data);
+		context.sourceWidth = this->width;
+		context.sourcePitch = BytesPerPixel() * this->width;
+		context.target = reinterpret_cast<uint8_t*>(output->data);
+		context.targetWidth = w;
+		context.targetPitch = bpp * w;
+		context.load = GetLoadPixelsFunc(this->format);
+		context.store = GetStorePixelsFunc(f);
+		context.horizontal.Build(this->width, w, intp);
+		context.vertical.Build(this->height, h, intp);
+		DKASSERT_DEBUG(context.load && context.store);
+
+		const uint32_t bandHeight = ResampleContext::BandHeight;
+		// calling thread processes bands too, bands not started by queue
+		// are processed here. (no deadlock in operation of queue)
+		const size_t numBands = (h + bandHeight - 1) / bandHeight;
+		Private::ParallelScheduler(queue).ParallelFor(numBands, 1, [&context, h](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
 			{
-				DKLogE("[DKImage::Resample] Error: Out of memory!");
-				output = NULL;
+				uint32_t y = uint32_t(i) * bandHeight;
+				context.ProcessBand(y, Min(y + bandHeight, h));
 			}
-		}
-		else
+		});
+
+		if (context.failed)
 		{
-			//TODO: Resample image format!
+			DKLogE("[DKImage::Resample] Error: Out of memory!");
+			return NULL;
 		}
-		return NULL;
+		return output;
 	}
 	else
 	{
@@ -12,6 +12,8 @@
 
 namespace DKFramework
 {
+	namespace Private { struct ImageDecodeSource; }
+
 	/// a graphics image data represents 2D picture.
 	class DKGL_API DKImage : public DKResource
 	{
@@ -62,6 +64,27 @@ namespace DKFramework
 		static DKObject<DKImage> Create(const void* data, size_t length);
 		static DKObject<DKImage> Create(uint32_t width, uint32_t height, PixelFormat format, const void* data);
 
+		struct Info
+		{
+			uint32_t width;
+			uint32_t height;
+			PixelFormat format;
+		};
+		/// read image dimensions and decoded pixel format without decoding pixels.
+		/// stream position will be restored if stream is seekable.
+		static bool ReadInfo(DKStream* stream, Info& info);
+
+		/// decoded rows are tightly packed, top to bottom.
+		/// return false from callback to stop decoding.
+		using DecodeCallback = DKFunctionSignature<bool (const Info& info, uint32_t firstRow, uint32_t numRows, const void* rows)>;
+		/// Decode image from stream progressively, passes decoded row bands to callback.
+		/// The whole image is not kept in memory, except for interlaced PNG and
+		/// RLE (or bottom-up from non-seekable stream) BMP which should be decoded entirely.
+		static bool Decode(DKStream* stream, DecodeCallback* callback, uint32_t bandHeight = 64);
+		/// Decode image into writable data (eg. DKFileMap, DKBuffer) directly.
+		/// output length should be large enough to hold entire image.
+		static bool Decode(DKStream* stream, DKData* output, Info* info = NULL);
+
 		/// Resize image using CPU.
 		/// If given operation-queue is valid, this operation will be processed with multi-threaded. 
 		DKObject<DKImage> Resample(uint32_t width, uint32_t height, PixelFormat format, Interpolation, DKOperationQueue*) const;
@@ -72,6 +95,8 @@ namespace DKFramework
 		DKObject<DKSerializer> Serializer() override;
 
 	private:
+		static DKObject<DKImage> DecodeImage(Private::ImageDecodeSource&);
+
 		uint32_t width;
 		uint32_t height;
 		PixelFormat format;
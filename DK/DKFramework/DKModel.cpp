@@ -11,7 +11,7 @@
 using namespace DKFramework;
 
 DKModel::DKModel(Type t)
-: type(t), parent(NULL), scene(NULL), hideDescendants(false), needResolveTree(true)
+: type(t), parent(NULL), scene(NULL), hideDescendants(false), needResolveTree(true), transformSlot(~size_t(0))
 {
 }
 
@@ -68,6 +68,8 @@ bool DKModel::AddChild(DKModel* obj)
 			}
 
 			this->RootObject()->needResolveTree = true;
+			if (this->scene)
+				this->scene->InvalidateTransformHierarchy();
 			return true;
 		}
 	}
@@ -95,6 +97,8 @@ void DKModel::RemoveFromParent()
 		this->OnRemovedFromParent();
 		this->needResolveTree = true;
 		p->RootObject()->needResolveTree = true;
+		if (this->scene)
+			this->scene->InvalidateTransformHierarchy();
 	}
 }
 
@@ -274,6 +278,8 @@ void DKModel::SetWorldTransform(const DKNSTransform& t)
 		localTransform = t * DKNSTransform(parent->WorldTransform()).Inverse();
 	else
 		localTransform = t;
+	if (scene)
+		scene->SetTransformDirty(this);
 }
 
 void DKModel::SetLocalTransform(const DKNSTransform& t)
@@ -283,6 +289,8 @@ void DKModel::SetLocalTransform(const DKNSTransform& t)
 		worldTransform = t * parent->WorldTransform();
 	else
 		worldTransform = t;
+	if (scene)
+		scene->SetTransformDirty(this);
 }
 
 void DKModel::CreateNamedObjectMap(NamedObjectMap& map)
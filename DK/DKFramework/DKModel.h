@@ -168,6 +168,9 @@ namespace DKFramework
 		// set true to call OnUpdateTreeReferences() when next update.
 		bool needResolveTree;
 
+		// slot index of scene's transform hierarchy.
+		size_t transformSlot;
+
 		bool EnumerateInternal(Enumerator* e);
 		void EnumerateInternal(EnumeratorLoop* e);
 		bool EnumerateInternal(ConstEnumerator* e) const;
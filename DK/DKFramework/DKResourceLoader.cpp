@@ -357,6 +357,23 @@ DKObject<DKResource> DKResourceLoader::ResourceFromFile(const DKString& path, co
 	return nullptr;
 }
 
+DKObject<DKResource> DKResourceLoader::AllocateResource(const DKString& classId)
+{
+	DKObject<ResourceAllocator> allocator = GetAllocator(L"", classId);
+	if (allocator)
+	{
+		DKAllocator& alloc = this->Allocator();
+		DKObject<DKResource> obj = allocator->Invoke(alloc);
+		if (obj)
+		{
+			if (obj->allocator == nullptr)
+				obj->allocator = &alloc;
+			return obj;
+		}
+	}
+	return nullptr;
+}
+
 DKAllocator& DKResourceLoader::Allocator() const
 {
 	return DKAllocator::DefaultAllocator();
@@ -42,6 +42,8 @@ namespace DKFramework
 		DKObject<DKResource> ResourceFromData(const DKData* data, const DKString& name);
 		DKObject<DKResource> ResourceFromStream(DKStream* stream, const DKString& name);
 		DKObject<DKResource> ResourceFromFile(const DKString& path, const DKString& name);
+		/// allocate object of class registered with SetResourceAllocator.
+		DKObject<DKResource> AllocateResource(const DKString& classId);
 
 		/// add resource into resource-pool
 		virtual void AddResource(const DKString& name, DKResource* res) = 0;
@@ -71,18 +71,22 @@ DKResourcePool::Locator* DKResourcePool::AddLocatorForPath(const DKString& path)
 		}
 		else	 // zip file with prefix (".../mydata.zip/prefix")
 		{
+			// find archive file from longest path, rest of path is prefix.
 			size_t len = path.Length();
 			const wchar_t* str = path;
-			for (size_t i = 0; i < len; ++i)
+			for (size_t i = len; i > 0; --i)
 			{
 #ifdef _WIN32
-				if (str[i] == L'/' || str[i] == L'\\')
+				if (i == len || str[i] == L'/' || str[i] == L'\\')
 #else
-				if (str[i] == L'/')
+				if (i == len || str[i] == L'/')
 #endif
 				{
-					DKString file = path.Left(i - 1);
-					if (DKDirectory::IsDirExist(file) == false)
+					DKString file = path.Left(i);
+					if (DKDirectory::IsDirExist(file))
+						break;
+					DKFile::FileInfo info;
+					if (DKFile::GetInfo(file, info))
 					{
 						DKObject<DKZipUnarchiver> arc = DKZipUnarchiver::Create(file);
 						if (arc)
@@ -92,12 +96,22 @@ DKResourcePool::Locator* DKResourcePool::AddLocatorForPath(const DKString& path)
 								DKObject<DKZipUnarchiver> arc;
 								DKString prefix;
 
-								ZipLocator(DKZipUnarchiver* z, const DKString& pf) : arc(z), prefix(pf) {}
+								ZipLocator(DKZipUnarchiver* z, const DKString& pf) : arc(z), prefix(pf)
+								{
+									// entry names in archive are separated by '/'.
+									size_t len = prefix.Length();
+									if (len > 0 && ((const wchar_t*)prefix)[len - 1] != L'/')
+										prefix += L"/";
+								}
 								DKString FindSystemPath(const DKString&) const {return "";}
 								DKObject<DKStream> OpenStream(const DKString& name) const
 								{
 									return arc->OpenFileStream(prefix + name);
 								}
+								DKObject<DKData> OpenData(const DKString& name, bool mapFileIfPossible) const
+								{
+									return arc->OpenFileData(prefix + name, mapFileIfPossible);
+								}
 							};
 							locator = DKOBJECT_NEW ZipLocator(arc, path.Right(i+1));
 						}
@@ -192,6 +206,26 @@ DKObject<DKStream> DKResourcePool::OpenResourceStream(const DKString& name) cons
 	return NULL;
 }
 
+DKObject<DKData> DKResourcePool::OpenResourceData(const DKString& name, bool mapFileIfPossible) const
+{
+	DKArray<DKObject<Locator>> locs;
+	if (true)
+	{
+		DKCriticalSection<DKSpinLock> guard(this->lock);
+		locs.Reserve(locators.Count());
+		for (const NamedLocator& loc : locators)
+			locs.Add(loc.locator);
+	}
+	// decompressing can take long, do not hold lock.
+	for (Locator* loc : locs)
+	{
+		DKObject<DKData> data = loc->OpenData(name, mapFileIfPossible);
+		if (data)
+			return data;
+	}
+	return NULL;
+}
+
 void DKResourcePool::AddResource(const DKString& name, DKResource* res)
 {
 	if (name.Length() > 0 && res)
@@ -369,10 +403,14 @@ DKObject<DKData> DKResourcePool::LoadResourceData(const DKString& name, bool map
 			}
 			else	// file could not be located. (or could be zip-file contents)
 			{
-				// open stream first (includes zip-file contents)
-				DKObject<DKStream> stream = OpenResourceStream(name);
-				if (stream)
-					ret = DKBuffer::Create(stream);
+				// load from locators first (includes zip-file contents)
+				ret = OpenResourceData(name, mapFileIfPossible);
+				if (ret == NULL)
+				{
+					DKObject<DKStream> stream = OpenResourceStream(name);
+					if (stream)
+						ret = DKBuffer::Create(stream);
+				}
 				if (ret == NULL && mapFileIfPossible)
 					ret = DKFileMap::Open(name, 0, false);
 				if (ret == NULL)
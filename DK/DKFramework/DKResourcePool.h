@@ -52,6 +52,9 @@ namespace DKFramework
 			virtual ~Locator() {}
 			virtual DKString FindSystemPath(const DKString&) const = 0;
 			virtual DKObject<DKStream> OpenStream(const DKString&) const = 0;
+			/// load whole content, locator can provide mapped data without copy.
+			/// returns NULL to load content from OpenStream.
+			virtual DKObject<DKData> OpenData(const DKString&, bool) const { return NULL; }
 		};
 
 		DKResourcePool();
@@ -108,6 +111,9 @@ namespace DKFramework
 		DKAllocator& Allocator() const;
 
 	private:
+		/// load whole content with locators, without holding lock.
+		DKObject<DKData> OpenResourceData(const DKString& name, bool mapFileIfPossible) const;
+
 		struct NamedLocator
 		{
 			DKString name;
@@ -6,6 +6,7 @@
 //
 
 #include "Private/BulletPhysics.h"
+#include "Private/ParallelScheduler.h"
 #include "DKMath.h"
 #include "DKScene.h"
 #include "DKModel.h"
@@ -841,6 +842,40 @@ namespace DKFramework
 }
 #endif
 
+namespace DKFramework
+{
+	namespace Private
+	{
+		// minimum number of nodes for each batch of parallel update.
+		enum { ParallelUpdateBatchNodes = 64 };
+
+		template <typename Fn>
+		void UpdateHierarchies(DKArray<DKObject<DKModel>>& objects, const DKArray<size_t>& batches, DKOperationQueue* queue, size_t maxThreads, Fn&& fn)
+		{
+			if (batches.Count() > 1)
+			{
+				ParallelScheduler scheduler;
+				scheduler.queue = queue;
+				scheduler.maxThreads = maxThreads;
+				scheduler.ParallelFor(batches.Count(), 1, [&](size_t begin, size_t end)
+				{
+					for (size_t b = begin; b < end; ++b)
+					{
+						size_t last = batches.Value(b);
+						for (size_t i = b > 0 ? batches.Value(b - 1) : 0; i < last; ++i)
+							fn(objects.Value(i));
+					}
+				});
+			}
+			else
+			{
+				for (DKModel* m : objects)
+					fn(m);
+			}
+		}
+	}
+}
+
 using namespace DKFramework;
 using namespace DKFramework::Private;
 
@@ -848,6 +883,9 @@ using namespace DKFramework::Private;
 DKScene::DKScene()
 : context(NULL)
 , ambientColor(0, 0, 0)
+, updateTimings({ 0, 0, 0 })
+, updateQueue(NULL)
+, updateMaxThreads(1)
 {
 	context = new CollisionWorldContext();
 	context->configuration = new btDefaultCollisionConfiguration();
@@ -866,11 +904,16 @@ DKScene::DKScene()
 
 //	context->world->setDebugDrawer(new ShapeDrawer());
 	context->world->setForceUpdateAllAabbs(false);
+
+	transformHierarchy.valid = 0;
 }
 
 DKScene::DKScene(CollisionWorldContext* ctxt)
 : context(ctxt)
 , ambientColor(0, 0, 0)
+, updateTimings({ 0, 0, 0 })
+, updateQueue(NULL)
+, updateMaxThreads(1)
 {
 	DKASSERT_DEBUG(context);
 	DKASSERT_DEBUG(context->broadphase);
@@ -880,6 +923,8 @@ DKScene::DKScene(CollisionWorldContext* ctxt)
 	context->tick = 0;
 	context->internalTick = 0;
 //	context->world->setDebugDrawer(new ShapeDrawer());
+
+	transformHierarchy.valid = 0;
 }
 
 DKScene::~DKScene()
@@ -918,6 +963,8 @@ void DKScene::Update(double tickDelta, DKTimeTick tick)
 	PrepareUpdateNode();
 	UpdateObjectKinematics(tickDelta, tick);
 
+	DKTimer timer;
+	timer.Reset();
 	if (true)
 	{
 		DKCriticalSection<DKSpinLock> guard(context->lock);
@@ -949,6 +996,8 @@ void DKScene::Update(double tickDelta, DKTimeTick tick)
 		if (updated > 0)
 			context->world->performDiscreteCollisionDetection();
 	}
+	updateTimings.simulation = timer.Elapsed();
+
 	UpdateObjectSceneStates();
 	CleanupUpdateNode();
 }
@@ -969,27 +1018,205 @@ void DKScene::PrepareUpdateNode()
 			updatePendingObjects.Add((const_cast<DKModel*>(model)));
 		}
 	});
+
+	this->updateTimings = { 0, 0, 0 };
+
+	// split root objects into batches which have similar number of nodes.
+	// make more batches than threads, hierarchies can be uneven.
+	this->updateBatches.Clear();
+	if (updateQueue && updateMaxThreads > 1 && updatePendingObjects.Count() > 1)
+	{
+		DKArray<size_t> weights;
+		weights.Reserve(updatePendingObjects.Count());
+		size_t totalNodes = 0;
+		for (DKModel* m : updatePendingObjects)
+		{
+			size_t n = m->NumberOfDescendants();
+			weights.Add(n);
+			totalNodes += n;
+		}
+		size_t batchNodes = Max(totalNodes / (updateMaxThreads * 4), size_t(ParallelUpdateBatchNodes));
+		size_t nodes = 0;
+		for (size_t i = 0; i < weights.Count(); ++i)
+		{
+			nodes += weights.Value(i);
+			if (nodes >= batchNodes)
+			{
+				updateBatches.Add(i + 1);
+				nodes = 0;
+			}
+		}
+		if (nodes > 0)
+			updateBatches.Add(weights.Count());
+	}
 }
 
 void DKScene::CleanupUpdateNode()
 {
 	updatePendingObjects.Clear();
+	updateBatches.Clear();
 }
 
 void DKScene::UpdateObjectKinematics(double tickDelta, DKTimeTick tick)
 {
-	for (DKModel* m : updatePendingObjects)
+	DKTimer timer;
+	timer.Reset();
+	UpdateHierarchies(updatePendingObjects, updateBatches, updateQueue, updateMaxThreads, [&](DKModel* m)
 	{
 		m->UpdateKinematic(tickDelta, tick);
-	}
+	});
+	// dynamics scene updates kinematics for each sub-steps.
+	updateTimings.kinematics += timer.Elapsed();
 }
 
 void DKScene::UpdateObjectSceneStates()
 {
-	for (DKModel* m : updatePendingObjects)
+	DKTimer timer;
+	timer.Reset();
+	UpdateHierarchies(updatePendingObjects, updateBatches, updateQueue, updateMaxThreads, [](DKModel* m)
 	{
 		m->UpdateSceneState(DKNSTransform::identity);
+	});
+	// transforms are written to models directly.
+	transformHierarchy.synced = 0;
+	updateTimings.sceneStates = timer.Elapsed();
+}
+
+void DKScene::InvalidateTransformHierarchy()
+{
+	transformHierarchy.valid = 0;
+}
+
+void DKScene::SetTransformDirty(const DKModel* model)
+{
+	// called from DKModel transform setters, which can be run on worker
+	// threads while updating kinematics. each model writes its own slot only,
+	// slots are not reallocated until next UpdateWorldTransforms.
+	TransformHierarchy& th = this->transformHierarchy;
+	if (th.valid)
+	{
+		size_t slot = model->transformSlot;
+		if (slot < th.models.Count() && th.models.Value(slot) == model)
+		{
+			th.locals.Value(slot) = model->localTransform;
+			th.worlds.Value(slot) = model->worldTransform;
+			th.dirty.Value(slot) = 1;
+		}
+		else
+			th.valid = 0;
+	}
+}
+
+void DKScene::UpdateWorldTransforms()
+{
+	DKCriticalSection<DKSpinLock> guard(this->lock);
+
+	TransformHierarchy& th = this->transformHierarchy;
+	if (!th.valid)
+	{
+		th.models.Clear();
+		th.parents.Clear();
+		th.models.Reserve(sceneObjects.Count());
+		th.parents.Reserve(sceneObjects.Count());
+
+		struct Insert
+		{
+			TransformHierarchy& th;
+			void operator () (DKModel* model, size_t parentSlot)
+			{
+				size_t slot = th.models.Count();
+				model->transformSlot = slot;
+				th.models.Add(model);
+				th.parents.Add(parentSlot);
+				for (DKModel* c : model->children)
+					this->operator()(c, slot);
+			}
+		} insert = { th };
+		this->sceneObjects.EnumerateForward([&insert](const DKModel* model)
+		{
+			if (model->Parent() == NULL)
+				insert(const_cast<DKModel*>(model), TransformHierarchy::InvalidSlot);
+		});
+		DKASSERT_DEBUG(th.models.Count() == sceneObjects.Count());
+
+		th.locals.Clear();
+		th.worlds.Clear();
+		th.locals.Resize(th.models.Count());
+		th.worlds.Resize(th.models.Count());
+		th.synced = 0;
+		// all nodes need to be updated.
+		th.dirty.Clear();
+		th.dirty.Resize(th.models.Count(), 1);
+		th.valid = 1;
 	}
+
+	const size_t count = th.models.Count();
+	DKModel** models = th.models;
+	const size_t* parents = th.parents;
+	DKNSTransform* locals = th.locals;
+	DKNSTransform* worlds = th.worlds;
+	uint8_t* dirty = th.dirty;
+
+	// models have been updated without their slots. (UpdateSceneState)
+	if (!th.synced)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			locals[i] = models[i]->localTransform;
+			worlds[i] = models[i]->worldTransform;
+		}
+		th.synced = 1;
+	}
+	// propagate dirty flags, parent is always visited before children.
+	for (size_t i = 0; i < count; ++i)
+	{
+		size_t p = parents[i];
+		if (p != TransformHierarchy::InvalidSlot && dirty[p])
+			dirty[i] = 1;
+	}
+	// world transform calculated with parent's one, which is already updated.
+	// models are accessed only if their world transforms have been changed.
+	// do not call virtual SetLocalTransform, it activates collision objects
+	// even if transform is not changed, only moved objects are activated.
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (dirty[i] == 0)
+			continue;
+
+		DKNSTransform t = locals[i];
+		if (parents[i] != TransformHierarchy::InvalidSlot)
+			t = t * worlds[parents[i]];
+		if (t == worlds[i])
+			continue;
+
+		worlds[i] = t;
+		DKModel* model = models[i];
+		model->worldTransform = t;
+		if (model->type == DKModel::TypeCollision)
+		{
+			DKASSERT_DEBUG(dynamic_cast<DKCollisionObject*>(model) != NULL);
+			btCollisionObject* co = BulletCollisionObject(static_cast<DKCollisionObject*>(model));
+			btTransform trans = BulletTransform(t);
+			btRigidBody* body = btRigidBody::upcast(co);
+			if (body)
+			{
+				if (body->getMotionState())
+					body->getMotionState()->setWorldTransform(trans);
+				body->setCenterOfMassTransform(trans);
+			}
+			else
+				co->setWorldTransform(trans);
+			co->activate(true);
+		}
+	}
+	memset(dirty, 0, count);
+}
+
+void DKScene::SetUpdateQueue(DKOperationQueue* queue, size_t maxThreads)
+{
+	DKCriticalSection<DKSpinLock> guard(this->lock);
+	this->updateQueue = queue;
+	this->updateMaxThreads = Max(maxThreads, size_t(1));
 }
 
 #if 0
@@ -1361,6 +1588,8 @@ bool DKScene::AddObject(DKModel* obj)
 			model->OnAddedToScene();
 		}
 	};
+	// invalidate first, transform can be changed in OnAddedToScene().
+	InvalidateTransformHierarchy();
 	InsertObject(this)(obj);
 	return true;
 }
@@ -1397,10 +1626,12 @@ void DKScene::RemoveObject(DKModel* obj)
 			target->RemoveSingleObject(model);
 			target->sceneObjects.Remove(model);
 			model->scene = NULL;   // set scene to NULL before call OnRemovedFromScene().
+			model->transformSlot = TransformHierarchy::InvalidSlot;
 			model->OnRemovedFromScene();
 		}
 	};
 	RemoveObject(this)(obj);
+	InvalidateTransformHierarchy();
 }
 
 bool DKScene::AddSingleObject(DKModel* obj)
@@ -1468,10 +1699,12 @@ void DKScene::RemoveAllObjects()
 	{
 		DKModel* model = const_cast<DKModel*>(obj);
 		model->scene = NULL;
+		model->transformSlot = TransformHierarchy::InvalidSlot;
 		model->OnRemovedFromScene();
 	});
 	this->sceneObjects.Clear();
 //	this->meshes.Clear();
+	InvalidateTransformHierarchy();
 }
 
 size_t DKScene::NumberOfSceneObjects() const
@@ -42,6 +42,32 @@ namespace DKFramework
 #endif
 		virtual void Update(double tickDelta, DKTimeTick tick);
 
+		/// update root hierarchies of scene in parallel with threads of queue.
+		/// maxThreads is number of threads including the thread calling Update.
+		/// set queue to NULL to update serially. (default)
+		/// @note
+		///  hierarchies are updated concurrently, they should not share
+		///  objects (like animation) which are not thread-safe.
+		void SetUpdateQueue(DKOperationQueue* queue, size_t maxThreads);
+
+		/// elapsed time of each phase of last Update, in seconds.
+		struct UpdateTimings
+		{
+			double kinematics;	///< UpdateKinematic of all hierarchies
+			double simulation;	///< collision detection (and dynamics)
+			double sceneStates;	///< UpdateSceneState of all hierarchies
+		};
+		UpdateTimings LastUpdateTimings() const		{ return updateTimings; }
+
+		/// update world transforms of all nodes from local transforms.
+		/// similar to DKModel::UpdateWorldTransform() of all root objects,
+		/// but nodes are processed in flat array which is sorted in
+		/// parent-first order, and only changed subtrees are updated.
+		/// local transforms are not modified. (UpdateWorldTransform does)
+		/// transforms of nodes can be set from multiple threads, but must not
+		/// be set while this function is running.
+		void UpdateWorldTransforms();
+
 		enum : unsigned int
 		{
 			DrawMeshes				= 1,
@@ -99,10 +125,35 @@ namespace DKFramework
 		void PrepareUpdateNode();
 		void CleanupUpdateNode();
 
+		UpdateTimings updateTimings;
+
 	private:
 		DKSpinLock lock;
 
 		DKArray<DKObject<DKModel>> updatePendingObjects;
+		/// end index of each update batch, for parallel update.
+		DKArray<size_t> updateBatches;
+		DKOperationQueue* updateQueue;
+		size_t updateMaxThreads;
+
+		/// flat hierarchy of scene nodes in depth-first order, for
+		/// UpdateWorldTransforms. (parent precedes its children)
+		/// transforms are stored in slots, calculated world transforms are
+		/// written back to models. DKModel copies its transforms to its slot
+		/// and marks it dirty when its transform has been changed.
+		struct TransformHierarchy
+		{
+			enum : size_t { InvalidSlot = ~size_t(0) };
+			DKArray<DKModel*> models;
+			DKArray<size_t> parents;	///< slot of parent, InvalidSlot for root.
+			DKArray<DKNSTransform> locals;
+			DKArray<DKNSTransform> worlds;
+			DKArray<uint8_t> dirty;
+			DKAtomicNumber32 valid;		///< 0 if hierarchy has been changed.
+			DKAtomicNumber32 synced;	///< 0 if slots need to be reloaded from models.
+		} transformHierarchy;
+		void InvalidateTransformHierarchy();
+		void SetTransformDirty(const DKModel*);
 
 		DKScene(const DKScene&);
 		DKScene& operator = (const DKScene&);
@@ -8,6 +8,7 @@
 #include "DKSerializer.h"
 #include "DKResource.h"
 #include "DKResourceLoader.h"
+#include "Private/BufferedStream.h"
 
 using namespace DKFramework;
 
@@ -1866,6 +1867,920 @@ bool DKSerializer::DeserializeBinary(DKStream* s, DKResourceLoader* p) const
 	return false;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// DKSerializer compact binary format layout (SerializeFormCompactBinary)
+//
+//  HEADER_STRING(fixed) = "DKSerializeC"
+//  byteOrder(uint8) = 'B' or 'L', byte-order of fixed size values.
+//  version(uint8)
+//  object
+//
+//  all lengths, counts and indices are unsigned LEB128 (varint).
+//  written in single pass, no chunk or object sizes ahead.
+//
+//  key
+//		index(varint), index into key table (1-based)
+//		if index is 0, new key follows and appended to key table.
+//			length(varint), key(utf-8)
+//
+//  object
+//		classId(key)
+//		records, terminated by zero tag.
+//
+//  record
+//		tag(uint8), key(key)
+//			'v'	VariantEntity: value
+//			's'	SerializerEntity: object
+//			'e'	ExternalEntity: external
+//			'a'	ExternalEntityArray: count(varint), external...
+//			'm'	ExternalEntityMap: count(varint), (key, external)...
+//
+//  external
+//		type(uint8)
+//			0	none (failed to serialize, ignored)
+//			'o'	object, included resource with serializer.
+//			'n'	resource name (filename), length(varint), name(utf-8)
+//			'd'	resource data (SerializeFormBinary), length(varint), data
+//
+//  value
+//		type(uint8), see CompactValueType below.
+//		integer: zig-zag varint
+//		float, vector, matrix, quaternion: IEEE 754 with byte-order.
+//		rational-number: numerator, denominator (zig-zag varint)
+//		date-time: seconds(int64), microseconds(uint32)
+//		string: length(varint), utf-8
+//		data: length(varint), bytes
+//		structured-data: length(varint), DKVariant binary
+//		array: count(varint), value...
+//		pairs: count(varint), (key, value)...
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#define DKSERIALIZER_COMPACT_VERSION		1
+#define DKSERIALIZER_COMPACT_HEADER_STRING	"DKSerializeC"
+
+namespace DKFramework
+{
+	namespace Private
+	{
+		enum CompactValueType : uint8_t
+		{
+			CompactValueUndefined = 0,
+			CompactValueInteger,
+			CompactValueFloat,
+			CompactValueVector2,
+			CompactValueVector3,
+			CompactValueVector4,
+			CompactValueMatrix2,
+			CompactValueMatrix3,
+			CompactValueMatrix4,
+			CompactValueQuaternion,
+			CompactValueRationalNumber,
+			CompactValueString,
+			CompactValueDateTime,
+			CompactValueData,
+			CompactValueStructData,
+			CompactValueArray,
+			CompactValuePairs,
+		};
+		FORCEINLINE uint64_t ZigZagEncode(int64_t v)
+		{
+			return (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+		}
+		FORCEINLINE int64_t ZigZagDecode(uint64_t v)
+		{
+			return int64_t(v >> 1) ^ -int64_t(v & 1);
+		}
+	}
+}
+using namespace DKFramework::Private;
+
+class DKSerializer::CompactWriter : public BufferedStreamWriter
+{
+public:
+	CompactWriter(DKStream* s, DKByteOrder bo) : BufferedStreamWriter(s, bo) {}
+
+	void WriteHeader()
+	{
+		WriteBytes(DKSERIALIZER_COMPACT_HEADER_STRING, strlen(DKSERIALIZER_COMPACT_HEADER_STRING));
+		WriteByte(byteOrder == DKByteOrder::BigEndian ? 'B' : 'L');
+		WriteByte(DKSERIALIZER_COMPACT_VERSION);
+	}
+	void WriteVarint(uint64_t v)
+	{
+		uint8_t buf[10];
+		size_t n = 0;
+		while (v >= 0x80)
+		{
+			buf[n++] = uint8_t(v) | 0x80;
+			v >>= 7;
+		}
+		buf[n++] = uint8_t(v);
+		WriteBytes(buf, n);
+	}
+	void WriteString(const DKStringU8& str)
+	{
+		size_t len = str.Bytes();
+		WriteVarint(len);
+		if (len > 0)
+			WriteBytes((const char*)str, len);
+	}
+	// write key index, key string written once.
+	void WriteKey(const DKString& key)
+	{
+		const KeyMap::Pair* p = keys.Find(key);
+		if (p)
+		{
+			WriteVarint(p->value);
+		}
+		else
+		{
+			keys.Insert(key, keys.Count() + 1);
+			WriteVarint(0);
+			WriteString(DKStringU8(key));
+		}
+	}
+	void WriteValue(const DKVariant& var)
+	{
+		switch (var.ValueType())
+		{
+		case DKVariant::TypeInteger:
+			WriteByte(CompactValueInteger);
+			WriteVarint(ZigZagEncode(var.Integer()));
+			break;
+		case DKVariant::TypeFloat:
+			WriteByte(CompactValueFloat);
+			Write(var.Float());
+			break;
+		case DKVariant::TypeVector2:
+			WriteByte(CompactValueVector2);
+			WriteArray(var.Vector2().val, 2);
+			break;
+		case DKVariant::TypeVector3:
+			WriteByte(CompactValueVector3);
+			WriteArray(var.Vector3().val, 3);
+			break;
+		case DKVariant::TypeVector4:
+			WriteByte(CompactValueVector4);
+			WriteArray(var.Vector4().val, 4);
+			break;
+		case DKVariant::TypeMatrix2:
+			WriteByte(CompactValueMatrix2);
+			WriteArray(var.Matrix2().val, 4);
+			break;
+		case DKVariant::TypeMatrix3:
+			WriteByte(CompactValueMatrix3);
+			WriteArray(var.Matrix3().val, 9);
+			break;
+		case DKVariant::TypeMatrix4:
+			WriteByte(CompactValueMatrix4);
+			WriteArray(var.Matrix4().val, 16);
+			break;
+		case DKVariant::TypeQuaternion:
+			WriteByte(CompactValueQuaternion);
+			WriteArray(var.Quaternion().val, 4);
+			break;
+		case DKVariant::TypeRationalNumber:
+			WriteByte(CompactValueRationalNumber);
+			WriteVarint(ZigZagEncode(var.RationalNumber().Numerator()));
+			WriteVarint(ZigZagEncode(var.RationalNumber().Denominator()));
+			break;
+		case DKVariant::TypeString:
+			WriteByte(CompactValueString);
+			WriteString(DKStringU8(var.String()));
+			break;
+		case DKVariant::TypeDateTime:
+			WriteByte(CompactValueDateTime);
+			Write(int64_t(var.DateTime().SecondsSinceEpoch()));
+			Write(uint32_t(var.DateTime().Microsecond()));
+			break;
+		case DKVariant::TypeData:
+			WriteByte(CompactValueData);
+			WriteVarint(var.Data().Length());
+			if (var.Data().Length() > 0)
+				WriteBytes(var.Data().Contents(), var.Data().Length());
+			break;
+		case DKVariant::TypeStructData:
+			// rarely used in serializer, stored as DKVariant binary.
+			{
+				DKBufferStream stream;
+				var.ExportStream(&stream, byteOrder);
+				DKBuffer* data = stream.Buffer();
+				size_t len = data ? data->Length() : 0;
+				WriteByte(CompactValueStructData);
+				WriteVarint(len);
+				if (len > 0)
+					WriteBytes(data->Contents(), len);
+			}
+			break;
+		case DKVariant::TypeArray:
+			{
+				const DKVariant::VArray& a = var.Array();
+				WriteByte(CompactValueArray);
+				WriteVarint(a.Count());
+				for (const DKVariant& v : a)
+					WriteValue(v);
+			}
+			break;
+		case DKVariant::TypePairs:
+			WriteByte(CompactValuePairs);
+			WriteVarint(var.Pairs().Count());
+			var.Pairs().EnumerateForward([this](const DKVariant::VPairs::Pair& pair)
+			{
+				WriteKey(pair.key);
+				WriteValue(pair.value);
+			});
+			break;
+		default:
+			WriteByte(CompactValueUndefined);
+			break;
+		}
+	}
+
+private:
+	typedef DKMap<DKString, uint64_t> KeyMap;
+	KeyMap keys;
+};
+
+class DKSerializer::CompactReader : public BufferedStreamReader
+{
+public:
+	// read from stream, reads ahead if stream is seekable.
+	CompactReader(DKStream* s) : BufferedStreamReader(s) {}
+	// read from memory directly.
+	CompactReader(const void* p, size_t len) : BufferedStreamReader(p, len) {}
+
+	bool ReadHeader()
+	{
+		size_t headerLen = strlen(DKSERIALIZER_COMPACT_HEADER_STRING);
+		const uint8_t* p = Consume(headerLen + 2);
+		if (p == NULL || strncmp((const char*)p, DKSERIALIZER_COMPACT_HEADER_STRING, headerLen) != 0)
+			return Fail();
+
+		DKByteOrder byteOrder;
+		if (p[headerLen] == 'B')
+			byteOrder = DKByteOrder::BigEndian;
+		else if (p[headerLen] == 'L')
+			byteOrder = DKByteOrder::LittleEndian;
+		else
+			return Fail();
+
+		if (p[headerLen + 1] > DKSERIALIZER_COMPACT_VERSION)
+		{
+			DKLog("DKSerializer::Deserialize failed: wrong compact binary version: 0x%x.\n", static_cast<unsigned int>(p[headerLen + 1]));
+			return Fail();
+		}
+		SetByteOrder(byteOrder);
+		return true;
+	}
+	bool ReadVarint(uint64_t& v)
+	{
+		v = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			uint8_t b;
+			if (!ReadByte(b))
+				return false;
+			v |= uint64_t(b & 0x7f) << shift;
+			if ((b & 0x80) == 0)
+				return true;
+		}
+		return Fail();
+	}
+	bool ReadLength(size_t& len)
+	{
+		uint64_t v;
+		if (ReadVarint(v))
+		{
+			if (v <= RemainLength() && v <= (uint64_t)(size_t)-1)
+			{
+				len = (size_t)v;
+				return true;
+			}
+			return Fail();
+		}
+		return false;
+	}
+	bool ReadString(DKString& str)
+	{
+		size_t len;
+		if (ReadLength(len))
+		{
+			if (len > 0)
+			{
+				const uint8_t* p = Consume(len);
+				if (p == NULL)
+					return false;
+				str.SetValue((const DKUniChar8*)p, len);
+			}
+			else
+				str = L"";
+			return true;
+		}
+		return false;
+	}
+	bool ReadKey(DKString& key)
+	{
+		uint64_t index;
+		if (ReadVarint(index))
+		{
+			if (index == 0)
+			{
+				if (!ReadString(key))
+					return false;
+				keys.Add(key);
+				return true;
+			}
+			if (index <= keys.Count())
+			{
+				key = keys.Value(index - 1);
+				return true;
+			}
+			return Fail();
+		}
+		return false;
+	}
+	bool ReadValue(DKVariant& var)
+	{
+		uint8_t type;
+		if (!ReadByte(type))
+			return false;
+
+		switch (type)
+		{
+		case CompactValueUndefined:
+			var.SetValueType(DKVariant::TypeUndefined);
+			break;
+		case CompactValueInteger:
+			{
+				uint64_t v;
+				if (!ReadVarint(v))
+					return false;
+				var.SetInteger(ZigZagDecode(v));
+			}
+			break;
+		case CompactValueFloat:
+			{
+				DKVariant::VFloat v;
+				if (!Read(v))
+					return false;
+				var.SetFloat(v);
+			}
+			break;
+		case CompactValueVector2:
+			return ReadArray(var.SetValueType(DKVariant::TypeVector2).Vector2().val, 2);
+		case CompactValueVector3:
+			return ReadArray(var.SetValueType(DKVariant::TypeVector3).Vector3().val, 3);
+		case CompactValueVector4:
+			return ReadArray(var.SetValueType(DKVariant::TypeVector4).Vector4().val, 4);
+		case CompactValueMatrix2:
+			return ReadArray(var.SetValueType(DKVariant::TypeMatrix2).Matrix2().val, 4);
+		case CompactValueMatrix3:
+			return ReadArray(var.SetValueType(DKVariant::TypeMatrix3).Matrix3().val, 9);
+		case CompactValueMatrix4:
+			return ReadArray(var.SetValueType(DKVariant::TypeMatrix4).Matrix4().val, 16);
+		case CompactValueQuaternion:
+			return ReadArray(var.SetValueType(DKVariant::TypeQuaternion).Quaternion().val, 4);
+		case CompactValueRationalNumber:
+			{
+				uint64_t n, d;
+				if (!ReadVarint(n) || !ReadVarint(d))
+					return false;
+				var.SetRationalNumber(DKVariant::VRationalNumber(ZigZagDecode(n), ZigZagDecode(d)));
+			}
+			break;
+		case CompactValueString:
+			return ReadString(var.SetValueType(DKVariant::TypeString).String());
+		case CompactValueDateTime:
+			{
+				int64_t s;
+				uint32_t us;
+				if (!Read(s) || !Read(us))
+					return false;
+				var.SetDateTime(DKDateTime(s, us));
+			}
+			break;
+		case CompactValueData:
+			{
+				size_t len;
+				if (!ReadLength(len))
+					return false;
+				if (len > 0)
+				{
+					void* p = DKMalloc(len);
+					if (p == NULL)
+						return Fail();
+					if (!ReadBytes(p, len))
+					{
+						DKFree(p);
+						return false;
+					}
+					DKObject<DKOperation> cleanup = DKFunction([p]() {DKFree(p); })->Invocation().SafeCast<DKOperation>();
+					var.SetData(DKData::StaticData((const void*)p, len, cleanup));
+				}
+				else
+					var.SetData(0);
+			}
+			break;
+		case CompactValueStructData:
+			{
+				size_t len;
+				if (!ReadLength(len))
+					return false;
+				const uint8_t* p = Consume(len);
+				if (p == NULL)
+					return false;
+				DKDataStream stream(DKData::StaticData(p, len));
+				if (!var.ImportStream(&stream) || var.ValueType() != DKVariant::TypeStructData)
+					return Fail();
+			}
+			break;
+		case CompactValueArray:
+			{
+				size_t count;
+				if (!ReadLength(count))
+					return false;
+				DKVariant::VArray& a = var.SetValueType(DKVariant::TypeArray).Array();
+				a.Reserve(Min(count, size_t(BufferSize)));
+				for (size_t i = 0; i < count; ++i)
+				{
+					// restore element in place.
+					if (!ReadValue(a.Value(a.Add(DKVariant()))))
+						return false;
+				}
+			}
+			break;
+		case CompactValuePairs:
+			{
+				size_t count;
+				if (!ReadLength(count))
+					return false;
+				DKVariant::VPairs& pairs = var.SetValueType(DKVariant::TypePairs).Pairs();
+				DKString key;
+				for (size_t i = 0; i < count; ++i)
+				{
+					if (!ReadKey(key) || !ReadValue(pairs.Value(key)))
+						return false;
+				}
+			}
+			break;
+		default:
+			DKLog("DKSerializer::Deserialize failed: Unknown value type(0x%x).\n", static_cast<unsigned int>(type));
+			return Fail();
+		}
+		return true;
+	}
+	// skip object records. (object class not available)
+	bool SkipRecords()
+	{
+		DKString key;
+		uint8_t tag;
+		while (ReadByte(tag))
+		{
+			if (tag == 0)
+				return true;
+			if (!ReadKey(key))
+				return false;
+			size_t count;
+			switch (tag)
+			{
+			case 'v':
+				{
+					DKVariant v;
+					if (!ReadValue(v))
+						return false;
+				}
+				break;
+			case 's':
+				if (!ReadKey(key) || !SkipRecords())
+					return false;
+				break;
+			case 'e':
+				if (!SkipExternal())
+					return false;
+				break;
+			case 'a':
+				if (!ReadLength(count))
+					return false;
+				for (size_t i = 0; i < count; ++i)
+				{
+					if (!SkipExternal())
+						return false;
+				}
+				break;
+			case 'm':
+				if (!ReadLength(count))
+					return false;
+				for (size_t i = 0; i < count; ++i)
+				{
+					if (!ReadKey(key) || !SkipExternal())
+						return false;
+				}
+				break;
+			default:
+				return Fail();
+			}
+		}
+		return false;
+	}
+	bool SkipExternal()
+	{
+		uint8_t type;
+		if (!ReadByte(type))
+			return false;
+		DKString str;
+		size_t len;
+		switch (type)
+		{
+		case 0:
+			return true;
+		case 'o':
+			return ReadKey(str) && SkipRecords();
+		case 'n':
+			return ReadString(str);
+		case 'd':
+			return ReadLength(len) && Skip(len);
+		}
+		return Fail();
+	}
+
+private:
+	DKArray<DKString> keys;
+};
+
+bool DKSerializer::SerializeCompact(CompactWriter& writer) const
+{
+	DKCriticalSection<DKSpinLock> guard(this->lock);
+
+	if (this->callback)
+		this->callback->Invoke(StateSerializeBegin);
+
+	bool entityError = false;
+	if (this->resourceClass.Length() == 0)
+	{
+		DKLog("DKSerializer::Serialize failed. (Class-Id invalid)\n");
+		entityError = true;
+	}
+
+	// write external resource as name, nested object or data.
+	auto writeExternal = [&writer](DKResource* res, ExternalResource ext) -> bool
+	{
+		DKString resourceName = res->Name();
+		if ((ext == ExternalResourceReferenceIfPossible && resourceName.Length() > 0) || (ext == ExternalResourceForceReference))
+		{
+			if (resourceName.Length() > 0)
+			{
+				writer.WriteByte('n');
+				writer.WriteString(DKStringU8(resourceName));
+				return true;
+			}
+		}
+		else
+		{
+			DKObject<DKSerializer> s = res->Serializer();
+			if (s && s->ResourceClass().Compare(L"DKResource") != 0)
+			{
+				writer.WriteByte('o');
+				return s->SerializeCompact(writer);
+			}
+			DKObject<DKData> data = res->Serialize(SerializeFormBinary);
+			if (data)
+			{
+				writer.WriteByte('d');
+				writer.WriteVarint(data->Length());
+				writer.WriteBytes(data->Contents(), data->Length());
+				return true;
+			}
+		}
+		writer.WriteByte(0);
+		return false;
+	};
+
+	writer.WriteKey(this->resourceClass);
+	if (!entityError)
+	{
+		this->entityMap.EnumerateForward([&](const EntityMap::Pair& p, bool* stop)
+		{
+			bool failed = false;
+			const VariantEntity* ve = p.value->Variant();
+			const SerializerEntity* se = p.value->Serializer();
+			const ExternalEntity* ee = p.value->External();
+			const ExternalEntityArray* ea = p.value->ExternalArray();
+			const ExternalEntityMap* em = p.value->ExternalMap();
+			if (ve && ve->getter)
+			{
+				DKVariant v(DKVariant::TypeUndefined);
+				ve->getter->Invoke(v);
+				if (v.ValueType() != DKVariant::TypeUndefined)
+				{
+					writer.WriteByte('v');
+					writer.WriteKey(p.key);
+					writer.WriteValue(v);
+				}
+				else
+					failed = true;
+			}
+			if (se && se->serializer)
+			{
+				writer.WriteByte('s');
+				writer.WriteKey(p.key);
+				if (!se->serializer->SerializeCompact(writer))
+					failed = true;
+			}
+			if (ee && ee->getter)
+			{
+				DKObject<DKResource> res = NULL;
+				ee->getter->Invoke(res);
+				if (res)
+				{
+					writer.WriteByte('e');
+					writer.WriteKey(p.key);
+					if (!writeExternal(res, ee->external))
+						failed = true;
+				}
+				else
+					failed = true;
+			}
+			if (ea && ea->getter)
+			{
+				ExternalArrayType eat;
+				ea->getter->Invoke(eat);
+				size_t count = 0;
+				for (DKResource* res : eat)
+				{
+					if (res)
+						count++;
+				}
+				writer.WriteByte('a');
+				writer.WriteKey(p.key);
+				writer.WriteVarint(count);
+				for (DKResource* res : eat)
+				{
+					if (res && !writeExternal(res, ea->external))
+						failed = true;
+				}
+			}
+			if (em && em->getter)
+			{
+				ExternalMapType emt;
+				em->getter->Invoke(emt);
+				size_t count = 0;
+				emt.EnumerateForward([&count](ExternalMapType::Pair& pair)
+				{
+					if (pair.value)
+						count++;
+				});
+				writer.WriteByte('m');
+				writer.WriteKey(p.key);
+				writer.WriteVarint(count);
+				emt.EnumerateForward([&](ExternalMapType::Pair& pair)
+				{
+					if (pair.value)
+					{
+						writer.WriteKey(pair.key);
+						if (!writeExternal(pair.value, em->external))
+							failed = true;
+					}
+				});
+			}
+
+			if (failed && p.value->faultHandler == NULL)
+			{
+				DKLog("DKSerializer Error: entity(%ls) invalid.\n", (const wchar_t*)p.key);
+				entityError = true;
+			}
+			if (entityError || writer.Failed())
+				*stop = true;
+		});
+	}
+	writer.WriteByte(0);	// end of records
+
+	bool serializeSucceed = !entityError && !writer.Failed();
+	if (this->callback)
+	{
+		if (serializeSucceed)
+			this->callback->Invoke(StateSerializeSucceed);
+		else
+			this->callback->Invoke(StateSerializeFailed);
+	}
+	return serializeSucceed;
+}
+
+bool DKSerializer::DeserializeCompactOperations(CompactReader& reader, DKArray<DKObject<DeserializerEntity>>& entities, DKResourceLoader* loader) const
+{
+	DKCriticalSection<DKSpinLock> guard(lock);
+
+	// read external resource, nested object restored in place.
+	auto readExternal = [&reader, loader](const DKString& key, DKObject<DKResource>& res) -> bool
+	{
+		uint8_t type;
+		if (!reader.ReadByte(type))
+			return false;
+
+		if (type == 0)
+			return true;
+		if (type == 'o')
+		{
+			DKString classId;
+			if (!reader.ReadKey(classId))
+				return false;
+			DKObject<DKResource> obj = NULL;
+			DKObject<DKSerializer> s = NULL;
+			if (loader)
+			{
+				obj = loader->AllocateResource(classId);
+				if (obj)
+					s = obj->Serializer();
+				else
+					DKLog("DKSerializer warning: Class(%ls) not found!\n", (const wchar_t*)classId);
+			}
+			if (s && s->resourceClass.Compare(classId) == 0)
+			{
+				if (s->DeserializeCompact(reader, loader))
+					res = obj;
+				return !reader.Failed();
+			}
+			return reader.SkipRecords();
+		}
+		if (type == 'n')
+		{
+			DKString filename;
+			if (!reader.ReadString(filename))
+				return false;
+			if (filename.Length() > 0 && loader)
+				res = loader->LoadResource(filename);
+			return true;
+		}
+		if (type == 'd')
+		{
+			size_t len;
+			if (!reader.ReadLength(len))
+				return false;
+			const uint8_t* p = reader.Consume(len);
+			if (p == NULL)
+				return false;
+			if (loader)
+				res = loader->ResourceFromData(DKData::StaticData(p, len), key);
+			return true;
+		}
+		DKLog("DKSerializer warning: Unknown external type(0x%x) found!\n", static_cast<unsigned int>(type));
+		return reader.Fail();	// position of next record is unknown.
+	};
+
+	EntityRestore::Entity restoreEntities;
+	DKString key = L"";
+	uint8_t tag = 0xff;
+	while (reader.ReadByte(tag) && tag != 0)
+	{
+		if (!reader.ReadKey(key))
+			break;
+
+		size_t count;
+		bool proceed = true;
+		switch (tag)
+		{
+		case 'v':
+			proceed = reader.ReadValue(restoreEntities.deserializer->rootValue.Pairs().Value(key));
+			break;
+		case 's':
+			{
+				DKString classId;
+				if (!reader.ReadKey(classId))
+					return false;
+
+				const EntityMap::Pair* ep = entityMap.Find(key);
+				const SerializerEntity* se = ep ? ep->value->Serializer() : NULL;
+				if (se && se->serializer)
+				{
+					if (se->serializer->resourceClass.Compare(classId))
+					{
+						// skip records of child, entity will not be restored.
+						DKLog("DKSerializer warning: ClassId mismatch. (%ls != %ls)\n", (const wchar_t*)se->serializer->resourceClass, (const wchar_t*)classId);
+						proceed = reader.SkipRecords();
+					}
+					else
+					{
+						EntityRestore::DeserializerArray de;
+						if (se->serializer->DeserializeCompactOperations(reader, de, loader))
+							restoreEntities.includes.Insert(key, de);
+						proceed = !reader.Failed();
+					}
+				}
+				else
+					proceed = reader.SkipRecords();
+			}
+			break;
+		case 'e':
+			{
+				DKObject<DKResource> res = NULL;
+				proceed = readExternal(key, res);
+				if (res)
+					restoreEntities.deserializer->externals.Update(key, res);
+			}
+			break;
+		case 'a':
+			if (reader.ReadLength(count))
+			{
+				ExternalArrayType& resources = restoreEntities.deserializer->externalArrays.Value(key);
+				resources.Reserve(Min(count, size_t(CompactReader::BufferSize)));
+				for (size_t i = 0; i < count && proceed; ++i)
+				{
+					DKObject<DKResource> res = NULL;
+					proceed = readExternal(L"", res);
+					if (res)
+						resources.Add(res);
+				}
+			}
+			else
+				proceed = false;
+			break;
+		case 'm':
+			if (reader.ReadLength(count))
+			{
+				ExternalMapType& resources = restoreEntities.deserializer->externalMaps.Value(key);
+				DKString resKey = L"";
+				for (size_t i = 0; i < count && proceed; ++i)
+				{
+					DKObject<DKResource> res = NULL;
+					proceed = reader.ReadKey(resKey) && readExternal(resKey, res);
+					if (res)
+						resources.Update(resKey, res);
+				}
+			}
+			else
+				proceed = false;
+			break;
+		default:
+			DKLog("DKSerializer warning: Unknown type(0x%x) found!\n", static_cast<unsigned int>(tag));
+			proceed = false;
+			break;
+		}
+		if (!proceed)
+			break;
+	}
+	if (tag != 0 || reader.Failed())
+	{
+		// records are not consumed to the end, caller should not continue.
+		reader.Fail();
+		DKLog("DKSerializer::Deserialize failed: Stream error.\n");
+		return false;
+	}
+
+	// compare internal type with data that picked out, and generate operations.
+	return EntityRestore().ExtractOperations(this, restoreEntities, entities);
+}
+
+bool DKSerializer::DeserializeCompact(CompactReader& reader, DKResourceLoader* p) const
+{
+	DKArray<DKObject<DeserializerEntity>> deserializers;
+
+	if (DeserializeCompactOperations(reader, deserializers, p))
+	{
+		for (size_t i = 0; i < deserializers.Count(); ++i)
+		{
+			if (deserializers.Value(i)->callback)
+				deserializers.Value(i)->callback->Invoke(StateDeserializeBegin);
+		}
+
+		for (size_t i = 0; i < deserializers.Count(); ++i)
+		{
+			DeserializerEntity* de = deserializers.Value(i);
+			for (size_t k = 0; k < de->operations.Count(); ++k)
+				de->operations.Value(k)->Perform();
+
+			// clear finished operations.
+			de->operations.Clear();
+			de->rootValue.SetValueType(DKVariant::TypeUndefined);
+		}
+
+		for (size_t i = 0; i < deserializers.Count(); ++i)
+		{
+			if (deserializers.Value(i)->callback)
+				deserializers.Value(i)->callback->Invoke(StateDeserializeSucceed);
+		}
+		return true;
+	}
+	return false;
+}
+
+bool DKSerializer::DeserializeCompact(CompactReader& reader, DKResourceLoader* p, Selector* sel)
+{
+	DKASSERT_DEBUG(sel != NULL);
+
+	DKString classId = L"";
+	if (reader.ReadHeader() && reader.ReadKey(classId) && classId.Length() > 0)
+	{
+		DKObject<DKSerializer> serializer = sel->Invoke(classId);
+		if (serializer)
+		{
+			if (serializer->resourceClass.Compare(classId) == 0)
+				return serializer->DeserializeCompact(reader, p);
+			DKLog("DKSerializer::Deserialize failed: ClassId mismatch. (%ls != %ls)\n", (const wchar_t*)serializer->resourceClass, (const wchar_t*)classId);
+		}
+	}
+	return false;
+}
+
 bool DKSerializer::Deserialize(DKStream* s, DKResourceLoader* p) const
 {
 	if (s->IsReadable())
@@ -1875,11 +2790,14 @@ bool DKSerializer::Deserialize(DKStream* s, DKResourceLoader* p) const
 		size_t headerLen = strlen(DKSERIALIZER_HEADER_STRING);
 		char name[64];
 		bool validHeader = false;
+		bool compactHeader = false;
 		if (s->Read(name, headerLen) == headerLen)
 		{
 			if (strncmp(name, DKSERIALIZER_HEADER_STRING_BIG_ENDIAN, headerLen) == 0 ||
 				strncmp(name, DKSERIALIZER_HEADER_STRING_LITTLE_ENDIAN, headerLen) == 0)
 				validHeader = true;
+			else
+				compactHeader = strncmp(name, DKSERIALIZER_COMPACT_HEADER_STRING, headerLen) == 0;
 		}
 
 		s->SetCurrentPosition(pos);
@@ -1887,6 +2805,21 @@ bool DKSerializer::Deserialize(DKStream* s, DKResourceLoader* p) const
 		{
 			return DeserializeBinary(s, p);
 		}
+		else if (compactHeader)
+		{
+			CompactReader reader(s);
+			DKString classId = L"";
+			bool ret = false;
+			if (reader.ReadHeader() && reader.ReadKey(classId))
+			{
+				if (this->resourceClass.Compare(classId) == 0)
+					ret = DeserializeCompact(reader, p);
+				else
+					DKLog("DKSerializer::Deserialize failed: ClassId mismatch. (%ls != %ls)\n", (const wchar_t*)this->resourceClass, (const wchar_t*)classId);
+			}
+			reader.Finish();
+			return ret;
+		}
 		else // try to open with XMLParser.
 		{
 			DKObject<DKXmlDocument> doc = DKXmlDocument::Open(DKXmlDocument::TypeXML, s);
@@ -1922,6 +2855,18 @@ bool DKSerializer::Deserialize(const DKData* d, DKResourceLoader* p) const
 			data = nullptr;
 			return ret;
 		}
+		else if (len >= headerLen && strncmp(ptr, DKSERIALIZER_COMPACT_HEADER_STRING, headerLen) == 0)
+		{
+			CompactReader reader(ptr, len);
+			DKString classId = L"";
+			if (reader.ReadHeader() && reader.ReadKey(classId))
+			{
+				if (this->resourceClass.Compare(classId) == 0)
+					return DeserializeCompact(reader, p);
+				DKLog("DKSerializer::Deserialize failed: ClassId mismatch. (%ls != %ls)\n", (const wchar_t*)this->resourceClass, (const wchar_t*)classId);
+			}
+			return false;
+		}
 		else // try to open with XMLParser.
 		{
 			DKObject<DKXmlDocument> doc = DKXmlDocument::Open(DKXmlDocument::TypeXML, d);
@@ -2042,10 +2987,12 @@ bool DKSerializer::RestoreObject(DKStream* s, DKResourceLoader* p, Selector* sel
 		size_t headerLen = strlen(DKSERIALIZER_HEADER_STRING);
 		char name[64];
 		bool validHeader = false;
+		bool compactHeader = false;
 		if (s->Read(name, headerLen) == headerLen)
 		{
 			validHeader = (strncmp(name, DKSERIALIZER_HEADER_STRING_BIG_ENDIAN, headerLen) == 0 ||
 						   strncmp(name, DKSERIALIZER_HEADER_STRING_LITTLE_ENDIAN, headerLen) == 0);
+			compactHeader = strncmp(name, DKSERIALIZER_COMPACT_HEADER_STRING, headerLen) == 0;
 		}
 
 		s->SetCurrentPosition(pos);
@@ -2053,6 +3000,13 @@ bool DKSerializer::RestoreObject(DKStream* s, DKResourceLoader* p, Selector* sel
 		{
 			return DeserializeBinary(s, p, sel);
 		}
+		else if (compactHeader)
+		{
+			CompactReader reader(s);
+			bool ret = DeserializeCompact(reader, p, sel);
+			reader.Finish();
+			return ret;
+		}
 		else
 		{
 			DKObject<DKXmlDocument> doc = DKXmlDocument::Open(DKXmlDocument::TypeXML, s);
@@ -2088,6 +3042,11 @@ bool DKSerializer::RestoreObject(const DKData* d, DKResourceLoader* p, Selector*
 			data = nullptr;
 			return ret;
 		}
+		else if (len >= headerLen && strncmp(ptr, DKSERIALIZER_COMPACT_HEADER_STRING, headerLen) == 0)
+		{
+			CompactReader reader(ptr, len);
+			return DeserializeCompact(reader, p, sel);
+		}
 		else
 		{
 			DKObject<DKXmlDocument> doc = DKXmlDocument::Open(DKXmlDocument::TypeXML, d);
@@ -2111,6 +3070,17 @@ size_t DKSerializer::Serialize(SerializeForm sf, DKStream* output) const
 	case SerializeFormCompressedBinary:
 		s = this->SerializeBinary(sf, output);
 		break;
+	case SerializeFormCompactBinary:
+		if (output && output->IsWritable())
+		{
+			CompactWriter writer(output, outputStreamByteOrder);
+			writer.WriteHeader();
+			if (this->SerializeCompact(writer) && writer.Flush())
+				s = writer.BytesWritten();
+			else
+				DKLog("DKSerializer::Serialize failed.\n");
+		}
+		break;
 	}
 	return s;
 }
@@ -2142,6 +3112,16 @@ DKObject<DKData> DKSerializer::Serialize(SerializeForm sf) const
 			}
 		}
 		break;
+	case SerializeFormCompactBinary:
+		if (true)
+		{
+			DKBufferStream stream;
+			if (this->Serialize(sf, &stream) > 0)
+			{
+				data = stream.Data();
+			}
+		}
+		break;
 	}
 	return data;
 }
@@ -82,12 +82,16 @@ namespace DKFramework
 		///    - uncompressed binary format. (faster loading)
 		/// - SerializeFormCompressedBinary:
 		///    - compressed binary format. (smallest, faster than xml)
+		/// - SerializeFormCompactBinary:
+		///    - binary format written in single pass with shared key table.
+		///    - included resources are nested in place. (fastest)
 		enum SerializeForm : int
 		{
 			SerializeFormXML				= '_XML',
 			SerializeFormBinXML				= 'bXML',
 			SerializeFormBinary				= '_BIN',
 			SerializeFormCompressedBinary	= 'cBIN',
+			SerializeFormCompactBinary		= 'kBIN',
 		};
 		/// serialize/deserialize callback state
 		enum State
@@ -246,6 +250,13 @@ namespace DKFramework
 		size_t SerializeBinary(SerializeForm sf, DKStream* output) const;
 		bool DeserializeBinary(DKStream* s, DKResourceLoader* p) const;
 		static bool DeserializeBinary(DKStream* s, DKResourceLoader* p, Selector* sel);
+
+		class CompactWriter;
+		class CompactReader;
+		bool SerializeCompact(CompactWriter& writer) const;
+		bool DeserializeCompactOperations(CompactReader& reader, DKArray<DKObject<DeserializerEntity>>& entities, DKResourceLoader* p) const;
+		bool DeserializeCompact(CompactReader& reader, DKResourceLoader* p) const;
+		static bool DeserializeCompact(CompactReader& reader, DKResourceLoader* p, Selector* sel);
 		
 		// copy constructor not allowed.
 		DKSerializer(const DKSerializer&) = delete;
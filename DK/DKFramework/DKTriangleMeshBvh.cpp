@@ -8,7 +8,113 @@
 #include "DKMath.h"
 #include "DKTriangleMeshBvh.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DKGL_TRIANGLE_RAY_PACKET_SSE 1
+#else
+#define DKGL_TRIANGLE_RAY_PACKET_SSE 0
+#endif
+
+namespace DKFramework
+{
+	namespace Private
+	{
+		// ray-triangle test with all rays in packet, (both faces)
+		// same algorithm with DKTriangle::RayTest, except ray direction is
+		// not normalized to get hit fraction directly.
+		// updates hitFraction of packet, returns mask of rays hit closer.
+		unsigned int RayPacketTriangleTest(const DKTriangle& tri, DKBvh::RayPacket& packet, float epsilon = 0.000001f)
+		{
+			const DKVector3 edge1 = tri.position2 - tri.position1;
+			const DKVector3 edge2 = tri.position3 - tri.position1;
+#if DKGL_TRIANGLE_RAY_PACKET_SSE
+			const __m128 dx = _mm_loadu_ps(packet.direction[0]);
+			const __m128 dy = _mm_loadu_ps(packet.direction[1]);
+			const __m128 dz = _mm_loadu_ps(packet.direction[2]);
+			const __m128 e1x = _mm_set1_ps(edge1.x), e1y = _mm_set1_ps(edge1.y), e1z = _mm_set1_ps(edge1.z);
+			const __m128 e2x = _mm_set1_ps(edge2.x), e2y = _mm_set1_ps(edge2.y), e2z = _mm_set1_ps(edge2.z);
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 one = _mm_set1_ps(1.0f);
+
+			// p = cross(dir, edge2)
+			__m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+			__m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+			__m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+			__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+
+			// epsilon scaled by ray length, direction is not normalized.
+			__m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+			__m128 absDet = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+			__m128 mask = _mm_cmpge_ps(absDet, _mm_mul_ps(_mm_sqrt_ps(lengthSq), _mm_set1_ps(epsilon)));
+			if (_mm_movemask_ps(mask) == 0)
+				return 0;
+
+			__m128 invDet = _mm_div_ps(one, det);
+			__m128 sx = _mm_sub_ps(_mm_loadu_ps(packet.origin[0]), _mm_set1_ps(tri.position1.x));
+			__m128 sy = _mm_sub_ps(_mm_loadu_ps(packet.origin[1]), _mm_set1_ps(tri.position1.y));
+			__m128 sz = _mm_sub_ps(_mm_loadu_ps(packet.origin[2]), _mm_set1_ps(tri.position1.z));
+			__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+			mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmple_ps(u, one)));
+
+			// q = cross(s, edge1)
+			__m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+			__m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+			__m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+			__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDet);
+			mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(v, zero), _mm_cmple_ps(_mm_add_ps(u, v), one)));
+
+			__m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+			__m128 hitFraction = _mm_loadu_ps(packet.hitFraction);
+			mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(t, zero), _mm_cmple_ps(t, one)));
+			mask = _mm_and_ps(mask, _mm_cmplt_ps(t, hitFraction));
+
+			unsigned int hitMask = (unsigned int)_mm_movemask_ps(mask) & packet.activeMask;
+			if (hitMask)
+			{
+				mask = _mm_castsi128_ps(_mm_set_epi32(
+					(hitMask & 8) ? -1 : 0, (hitMask & 4) ? -1 : 0, (hitMask & 2) ? -1 : 0, (hitMask & 1) ? -1 : 0));
+				hitFraction = _mm_or_ps(_mm_and_ps(mask, t), _mm_andnot_ps(mask, hitFraction));
+				_mm_storeu_ps(packet.hitFraction, hitFraction);
+			}
+			return hitMask;
+#else
+			unsigned int hitMask = 0;
+			for (int k = 0; k < DKBvh::RayPacket::MaxRays; ++k)
+			{
+				if ((packet.activeMask & (1U << k)) == 0)
+					continue;
+
+				DKVector3 dir(packet.direction[0][k], packet.direction[1][k], packet.direction[2][k]);
+				DKVector3 p = DKVector3::Cross(dir, edge2);
+				float det = DKVector3::Dot(edge1, p);
+				if (fabs(det) < dir.Length() * epsilon)
+					continue;
+
+				float invDet = 1.0f / det;
+				DKVector3 s = DKVector3(packet.origin[0][k], packet.origin[1][k], packet.origin[2][k]) - tri.position1;
+				float u = DKVector3::Dot(s, p) * invDet;
+				if (u < 0.0f || u > 1.0f)
+					continue;
+
+				DKVector3 q = DKVector3::Cross(s, edge1);
+				float v = DKVector3::Dot(dir, q) * invDet;
+				if (v < 0.0f || u + v > 1.0f)
+					continue;
+
+				float t = DKVector3::Dot(edge2, q) * invDet;
+				if (t >= 0.0f && t <= 1.0f && t < packet.hitFraction[k])
+				{
+					packet.hitFraction[k] = t;
+					hitMask |= (1U << k);
+				}
+			}
+			return hitMask;
+#endif
+		}
+	}
+}
 using namespace DKFramework;
+using namespace DKFramework::Private;
 
 DKTriangleMeshBvh::DKTriangleMeshBvh() : mesh(NULL)
 {
@@ -23,7 +129,7 @@ DKAabb DKTriangleMeshBvh::Aabb() const
 	return bvh.Aabb();
 }
 
-void DKTriangleMeshBvh::Build(DKTriangleMesh* m)
+void DKTriangleMeshBvh::Build(DKTriangleMesh* m, DKOperationQueue* queue)
 {
 	struct TriangleAabb : public DKBvh::VolumeInterface
 	{
@@ -51,12 +157,17 @@ void DKTriangleMeshBvh::Build(DKTriangleMesh* m)
 	DKObject<TriangleAabb> vol = DKOBJECT_NEW TriangleAabb();
 	this->mesh = m;
 	vol->mesh = this->mesh;
-	bvh.Build(vol.SafeCast<DKBvh::VolumeInterface>());
+	bvh.Build(vol.SafeCast<DKBvh::VolumeInterface>(), queue);
 }
 
-void DKTriangleMeshBvh::Rebuild()
+void DKTriangleMeshBvh::Rebuild(DKOperationQueue* queue)
 {
-	bvh.Rebuild();
+	bvh.Rebuild(queue);
+}
+
+bool DKTriangleMeshBvh::Refit()
+{
+	return bvh.Refit();
 }
 
 bool DKTriangleMeshBvh::RayTest(const DKLine& ray, DKVector3* hitPoint) const
@@ -101,3 +212,43 @@ bool DKTriangleMeshBvh::RayTest(const DKLine& ray, DKVector3* hitPoint) const
 	}
 	return false;
 }
+
+size_t DKTriangleMeshBvh::RayTest(const DKLine* rays, size_t numRays, RayHit* results, DKOperationQueue* queue) const
+{
+	for (size_t i = 0; i < numRays; ++i)
+		results[i].triangleIndex = -1;
+
+	if (this->mesh == NULL || numRays == 0)
+		return 0;
+
+	DKArray<float> hitFractions;
+	hitFractions.Resize(numRays);
+
+	auto trianglePacketTest = [&](int index, DKBvh::RayPacket& packet)
+	{
+		DKTriangle tri;
+		if (this->mesh->GetTriangleAtIndex(index, tri))
+		{
+			unsigned int hitMask = RayPacketTriangleTest(tri, packet);
+			for (int k = 0; hitMask; ++k, hitMask >>= 1)
+			{
+				if (hitMask & 1)
+					results[packet.rayIndex[k]].triangleIndex = index;
+			}
+		}
+	};
+
+	const_cast<DKTriangleMeshBvh*>(this)->mesh->Lock();
+	size_t numHits = this->bvh.RayTest(rays, numRays, hitFractions, DKFunction(trianglePacketTest), queue);
+	const_cast<DKTriangleMeshBvh*>(this)->mesh->Unlock();
+
+	for (size_t i = 0; i < numRays; ++i)
+	{
+		if (results[i].triangleIndex >= 0)
+		{
+			const DKLine& ray = rays[i];
+			results[i].hitPoint = ray.begin + (ray.end - ray.begin) * hitFractions.Value(i);
+		}
+	}
+	return numHits;
+}
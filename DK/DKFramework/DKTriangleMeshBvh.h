@@ -23,12 +23,27 @@ namespace DKFramework
 		DKTriangleMeshBvh();
 		~DKTriangleMeshBvh();
 		
-		void Build(DKTriangleMesh* mesh);
-		void Rebuild();
+		void Build(DKTriangleMesh* mesh, DKOperationQueue* queue = NULL);
+		void Rebuild(DKOperationQueue* queue = NULL);
+		/// update bounds of bvh after vertices of mesh are moved.
+		/// returns false if number of triangles has been changed.
+		bool Refit();
 
 		DKAabb Aabb() const;
 		bool RayTest(const DKLine& ray, DKVector3* hitPoint = NULL) const;
 
+		/// closest hit of ray, result of batch ray test.
+		struct RayHit
+		{
+			int triangleIndex;		///< -1 if ray did not hit.
+			DKVector3 hitPoint;
+		};
+		/// batch ray test, rays are tested in packets with SIMD.
+		/// packets are processed in parallel if queue is not NULL.
+		/// results should be able to hold numRays values.
+		/// returns number of rays hit.
+		size_t RayTest(const DKLine* rays, size_t numRays, RayHit* results, DKOperationQueue* queue = NULL) const;
+
 		const DKBvh& Bvh() const { return bvh; }
 
 	private:
@@ -6,6 +6,7 @@
 //
 
 #include "DKVariant.h"
+#include "Private/BufferedStream.h"
 
 namespace DKFramework
 {
@@ -111,6 +112,76 @@ namespace DKFramework
 			}
 			return false;
 		}
+		// byte-swap array of integers. (vectorized by compiler)
+		template <typename T> static void SwitchByteOrderArray(uint8_t* p, size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				T v;
+				memcpy(&v, &p[i * sizeof(T)], sizeof(T));
+				v = DKSwitchIntegralByteOrder(v);
+				memcpy(&p[i * sizeof(T)], &v, sizeof(T));
+			}
+		}
+		// byte-swap arithmetic fields of structured elements.
+		// layout of single field size (vectors, matrices) is swapped as flat array.
+		static void SwitchStructElementsByteOrder(uint8_t* p, size_t count, const VStructuredData& sd)
+		{
+			struct Field { size_t offset; uint8_t size; };
+			DKArray<Field> fields;
+			fields.Reserve(sd.layout.Count());
+			size_t n = 0;
+			uint8_t uniformSize = 0;
+			bool uniform = true;
+			for (StructElem e : sd.layout)
+			{
+				uint8_t fieldSize = static_cast<uint8_t>(e) & 0x0f;
+				if ((n + fieldSize) > sd.elementSize)
+				{
+					uniform = false;
+					break;
+				}
+				if ((static_cast<uint8_t>(e) & 0xf0) == 0 && fieldSize > 1)
+				{
+					fields.Add({ n, fieldSize });
+					if (uniformSize == 0)
+						uniformSize = fieldSize;
+					else if (uniformSize != fieldSize)
+						uniform = false;
+				}
+				else
+					uniform = false;
+				n += fieldSize;
+			}
+			size_t numFields = fields.Count();
+			if (numFields == 0)
+				return;
+
+			if (uniform && n == sd.elementSize)
+			{
+				size_t units = count * sd.elementSize / uniformSize;
+				switch (uniformSize)
+				{
+				case 2:	SwitchByteOrderArray<uint16_t>(p, units); break;
+				case 4:	SwitchByteOrderArray<uint32_t>(p, units); break;
+				case 8:	SwitchByteOrderArray<uint64_t>(p, units); break;
+				}
+				return;
+			}
+			for (size_t i = 0; i < count; ++i)
+			{
+				uint8_t* p2 = &p[i * sd.elementSize];
+				for (const Field& f : fields)
+				{
+					switch (f.size)
+					{
+					case 2:	SwitchByteOrderArray<uint16_t>(&p2[f.offset], 1); break;
+					case 4:	SwitchByteOrderArray<uint32_t>(&p2[f.offset], 1); break;
+					case 8:	SwitchByteOrderArray<uint64_t>(&p2[f.offset], 1); break;
+					}
+				}
+			}
+		}
 		static bool ConvertStructuredDataByteOrder(VStructuredData& sd, DKByteOrder bo)
 		{
 			size_t len = 0;
@@ -121,38 +192,7 @@ namespace DKFramework
 				uint8_t* p = reinterpret_cast<uint8_t*>(sd.data->MutableContents());
 				if (p)
 				{
-					size_t pos = 0;
-					while (pos < len)
-					{
-						size_t n = 0;
-						uint8_t* p2 = &(p[pos]);
-						for (StructElem e : sd.layout)
-						{
-							uint8_t fieldSize = static_cast<uint8_t>(e) & 0x0f;
-							n += fieldSize;
-							if (n > sd.elementSize)
-								break;
-
-							if ((static_cast<uint8_t>(e) & 0xf0) == 0)
-							{
-								switch (fieldSize)
-								{
-								case 2:
-									reinterpret_cast<uint16_t*>(p2)[0] = DKSwitchIntegralByteOrder(reinterpret_cast<uint16_t*>(p2)[0]);
-									break;
-								case 4:
-									reinterpret_cast<uint32_t*>(p2)[0] = DKSwitchIntegralByteOrder(reinterpret_cast<uint32_t*>(p2)[0]);
-									break;
-								case 8:
-									reinterpret_cast<uint64_t*>(p2)[0] = DKSwitchIntegralByteOrder(reinterpret_cast<uint64_t*>(p2)[0]);
-									break;
-								}
-							}
-
-							p2 += fieldSize;
-						}
-						pos += sd.elementSize;
-					}
+					SwitchStructElementsByteOrder(p, len / sd.elementSize, sd);
 					return true;
 				}
 				return false;
@@ -1002,913 +1042,639 @@ bool DKVariant::ImportXML(const DKXmlElement* e)
 #define DKVARIANT_HEADER_STRING_BIG_ENDIAN		"DKVariantB"
 #define DKVARIANT_HEADER_STRING_LITTLE_ENDIAN	"DKVariantL"
 
-#pragma pack(push, 4)
-
 static_assert(sizeof(uint32_t) == sizeof(float), "Size mismatch!");
 static_assert(sizeof(uint64_t) == sizeof(DKVariant::VFloat), "Size mismatch!");
 static_assert(sizeof(uint64_t) == sizeof(DKVariant::VInteger), "Size mismatch!");
 
-
-bool DKVariant::ExportStream(DKStream* stream, DKByteOrder byteOrder) const
+namespace DKFramework
 {
-	DKString errorDesc = L"Unknown error";
-	bool validType = false;
-
-	if (stream == NULL || stream->IsWritable() == false)
-	{
-		errorDesc = L"Invalid stream.";
-		goto FAILED;
-	}
-
-	switch (valueType)
-	{
-	case TypeUndefined:
-	case TypeInteger:
-	case TypeFloat:
-	case TypeVector2:
-	case TypeVector3:
-	case TypeVector4:
-	case TypeMatrix2:
-	case TypeMatrix3:
-	case TypeMatrix4:
-	case TypeQuaternion:
-	case TypeRationalNumber:
-	case TypeString:
-	case TypeDateTime:
-	case TypeData:
-	case TypeStructData:
-	case TypeArray:
-	case TypePairs:
-		validType = true;
-		break;
-	}
-	if (validType)
+	namespace Private
 	{
-		if (byteOrder == DKByteOrder::Unknown)
-			byteOrder = DKRuntimeByteOrder();
-
-		// write file header
-		const char* headerString = byteOrder == DKByteOrder::BigEndian ?
-			DKVARIANT_HEADER_STRING_BIG_ENDIAN : DKVARIANT_HEADER_STRING_LITTLE_ENDIAN;
-		size_t headerLen = strlen(headerString);
-		if (stream->Write(headerString, headerLen) != headerLen)
+		// buffered output of DKVariant::ExportStream.
+		// nested variants (array, pairs) share same writer.
+		class VariantStreamWriter : public BufferedStreamWriter
 		{
-			errorDesc = L"Failed to write to stream.";
-			goto FAILED;
-		}
-
-		struct ByteOrderedStream
-		{
-			DKStream* stream;
-			bool bigEndian;
-			bool Write(uint16_t v)
-			{
-				v = this->bigEndian ? DKSystemToBigEndian(v) : DKSystemToLittleEndian(v);
-				return stream->Write(&v, sizeof(uint16_t)) == sizeof(uint16_t);
-			}
-			bool Write(uint32_t v)
-			{
-				v = this->bigEndian ? DKSystemToBigEndian(v) : DKSystemToLittleEndian(v);
-				return stream->Write(&v, sizeof(uint32_t)) == sizeof(uint32_t);
-			}
-			bool Write(uint64_t v)
-			{
-				v = this->bigEndian ? DKSystemToBigEndian(v) : DKSystemToLittleEndian(v);
-				return stream->Write(&v, sizeof(uint64_t)) == sizeof(uint64_t);
-			}
-		} output = { stream, byteOrder == DKByteOrder::BigEndian };
+		public:
+			VariantStreamWriter(DKStream* s, DKByteOrder bo) : BufferedStreamWriter(s, bo) {}
 
-		// version
-		if (!output.Write(uint16_t(DKVARIANT_VERSION)))
-		{
-			errorDesc = L"Failed to write to stream.";
-			goto FAILED;
-		}
-		if (!output.Write(uint32_t(valueType)))
-		{
-			errorDesc = L"Failed to write to stream.";
-			goto FAILED;
-		}
-		if (valueType == TypeUndefined)
-		{
-		}
-		else if (valueType == TypeInteger)
-		{
-			if (!output.Write(uint64_t(this->Integer())))
+			// write structured elements, swap byte order in buffer.
+			void WriteStructElements(const uint8_t* p, size_t count, const VStructuredData& sd)
 			{
-				errorDesc = L"Failed to write to stream.";
-				goto FAILED;
-			}
-		}
-		else if (valueType == TypeFloat)
-		{
-			VFloat value = this->Float();
-			if (!output.Write(*reinterpret_cast<uint64_t*>(&value)))
-			{
-				errorDesc = L"Failed to write to stream.";
-				goto FAILED;
-			}
-		}
-		else if (valueType == TypeVector2)
-		{
-			VVector2 value = this->Vector2();
-			for (int i = 0; i < 2; ++i)
-			{
-				if (!output.Write(*reinterpret_cast<uint32_t*>(&value.val[i])))
-				{
-					errorDesc = L"Failed to write to stream.";
-					goto FAILED;
-				}
-			}
-		}
-		else if (valueType == TypeVector3)
-		{
-			VVector3 value = this->Vector3();
-			for (int i = 0; i < 3; ++i)
-			{
-				if (!output.Write(*reinterpret_cast<uint32_t*>(&value.val[i])))
+				size_t elementsPerBuffer = Max(BufferSize / sd.elementSize, size_t(1));
+				while (count > 0 && !Failed())
 				{
-					errorDesc = L"Failed to write to stream.";
-					goto FAILED;
-				}
-			}
-		}
-		else if (valueType == TypeVector4)
-		{
-			VVector4 value = this->Vector4();
-			for (int i = 0; i < 4; ++i)
-			{
-				if (!output.Write(*reinterpret_cast<uint32_t*>(&value.val[i])))
-				{
-					errorDesc = L"Failed to write to stream.";
-					goto FAILED;
+					size_t n = Min(count, elementsPerBuffer);
+					size_t bytes = n * sd.elementSize;
+					uint8_t* buffer = Allocate(bytes);
+					if (buffer)
+					{
+						memcpy(buffer, p, bytes);
+						SwitchStructElementsByteOrder(buffer, n, sd);
+					}
+					else // element is larger than buffer.
+					{
+						DKBuffer tmp(p, bytes);
+						SwitchStructElementsByteOrder(reinterpret_cast<uint8_t*>(tmp.MutableContents()), n, sd);
+						WriteBytes(tmp.Contents(), bytes);
+					}
+					p += bytes;
+					count -= n;
 				}
 			}
-		}
-		else if (valueType == TypeMatrix2)
+		};
+
+		// buffered input of DKVariant::ImportStream, DKVariant::ImportData.
+		// values are read in runtime byte order, swapped by ImportVariant.
+		using VariantStreamReader = BufferedStreamReader;
+
+		// payload is read-only data, refers source data of reader if possible.
+		static DKObject<DKData> ReadVariantPayload(VariantStreamReader& input, size_t len)
 		{
-			VMatrix2 value = this->Matrix2();
-			for (int i = 0; i < 4; ++i)
+			DKObject<DKData> data = input.ReadView(len);
+			if (data == NULL)
 			{
-				if (!output.Write(*reinterpret_cast<uint32_t*>(&value.val[i])))
+				void* p = DKMalloc(len);
+				if (p == NULL)
+					return NULL;
+				if (!input.ReadBytes(p, len))
 				{
-					errorDesc = L"Failed to write to stream.";
-					goto FAILED;
+					DKFree(p);
+					return NULL;
 				}
+				DKObject<DKOperation> cleanup = DKFunction([p]() {DKFree(p);})->Invocation().SafeCast<DKOperation>();
+				data = DKData::StaticData((const void*)p, len, cleanup);
 			}
+			return data;
 		}
-		else if (valueType == TypeMatrix3)
+
+		static bool IsValidVariantType(DKVariant::Type t)
 		{
-			VMatrix3 value = this->Matrix3();
-			for (int i = 0; i < 9; ++i)
-			{
-				if (!output.Write(*reinterpret_cast<uint32_t*>(&value.val[i])))
-				{
-					errorDesc = L"Failed to write to stream.";
-					goto FAILED;
-				}
+			switch (t)
+			{
+			case DKVariant::TypeUndefined:
+			case DKVariant::TypeInteger:
+			case DKVariant::TypeFloat:
+			case DKVariant::TypeVector2:
+			case DKVariant::TypeVector3:
+			case DKVariant::TypeVector4:
+			case DKVariant::TypeMatrix2:
+			case DKVariant::TypeMatrix3:
+			case DKVariant::TypeMatrix4:
+			case DKVariant::TypeQuaternion:
+			case DKVariant::TypeRationalNumber:
+			case DKVariant::TypeString:
+			case DKVariant::TypeDateTime:
+			case DKVariant::TypeData:
+			case DKVariant::TypeStructData:
+			case DKVariant::TypeArray:
+			case DKVariant::TypePairs:
+				return true;
 			}
+			return false;
 		}
-		else if (valueType == TypeMatrix4)
+
+		static bool ExportVariant(const DKVariant& var, VariantStreamWriter& output, DKString& errorDesc)
 		{
-			VMatrix4 value = this->Matrix4();
-			for (int i = 0; i < 16; ++i)
+			using Type = DKVariant::Type;
+			Type valueType = var.ValueType();
+			if (!IsValidVariantType(valueType))
 			{
-				if (!output.Write(*reinterpret_cast<uint32_t*>(&value.val[i])))
-				{
-					errorDesc = L"Failed to write to stream.";
-					goto FAILED;
-				}
+				errorDesc = DKString::Format("Unknown Type: 0x%x.", valueType);
+				return false;
 			}
-		}
-		else if (valueType == TypeQuaternion)
-		{
-			VQuaternion value = this->Quaternion();
-			for (int i = 0; i < 4; ++i)
+
+			// header, each variant (including elements of array, pairs) has its own header.
+			const char* headerString = output.byteOrder == DKByteOrder::BigEndian ?
+				DKVARIANT_HEADER_STRING_BIG_ENDIAN : DKVARIANT_HEADER_STRING_LITTLE_ENDIAN;
+			output.WriteBytes(headerString, strlen(headerString));
+			output.Write(uint16_t(DKVARIANT_VERSION));
+			output.Write(uint32_t(valueType));
+
+			switch (valueType)
 			{
-				if (!output.Write(*reinterpret_cast<uint32_t*>(&value.val[i])))
+			case DKVariant::TypeUndefined:
+				break;
+			case DKVariant::TypeInteger:
+				output.Write(uint64_t(var.Integer()));
+				break;
+			case DKVariant::TypeFloat:
+				output.Write(var.Float());
+				break;
+			case DKVariant::TypeVector2:
+				output.WriteArray(var.Vector2().val, 2);
+				break;
+			case DKVariant::TypeVector3:
+				output.WriteArray(var.Vector3().val, 3);
+				break;
+			case DKVariant::TypeVector4:
+				output.WriteArray(var.Vector4().val, 4);
+				break;
+			case DKVariant::TypeMatrix2:
+				output.WriteArray(var.Matrix2().val, 4);
+				break;
+			case DKVariant::TypeMatrix3:
+				output.WriteArray(var.Matrix3().val, 9);
+				break;
+			case DKVariant::TypeMatrix4:
+				output.WriteArray(var.Matrix4().val, 16);
+				break;
+			case DKVariant::TypeQuaternion:
+				output.WriteArray(var.Quaternion().val, 4);
+				break;
+			case DKVariant::TypeRationalNumber:
+				output.Write(uint64_t(var.RationalNumber().Numerator()));
+				output.Write(uint64_t(var.RationalNumber().Denominator()));
+				break;
+			case DKVariant::TypeString:
 				{
-					errorDesc = L"Failed to write to stream.";
-					goto FAILED;
+					DKStringU8 str(var.String());
+					uint64_t len = str.Bytes();
+					output.Write(len);
+					if (len > 0)
+						output.WriteBytes((const char*)str, len);
 				}
-			}
-		}
-		else if (valueType == TypeRationalNumber)
-		{
-			if (!output.Write(uint64_t(this->RationalNumber().Numerator())))
-			{
-				errorDesc = L"Failed to write to stream.";
-				goto FAILED;
-			}
-			if (!output.Write(uint64_t(this->RationalNumber().Denominator())))
-			{
-				errorDesc = L"Failed to write to stream.";
-				goto FAILED;
-			}
-		}
-		else if (valueType == TypeString)
-		{
-			DKStringU8 str(this->String());
-			uint64_t len = str.Bytes();
-			if (!output.Write(len))
-			{
-				errorDesc = L"Failed to write to stream.";
-				goto FAILED;
-			}
-			if (len > 0 && stream->Write((const char*)str, len) != len)
-			{
-				errorDesc = L"Failed to write to stream.";
-				goto FAILED;
-			}
-		}
-		else if (valueType == TypeDateTime)
-		{
-			if (!output.Write(uint64_t(this->DateTime().SecondsSinceEpoch())))
-			{
-				errorDesc = L"Failed to write to stream.";
-				goto FAILED;
-			}
-			if (!output.Write(uint32_t(this->DateTime().Microsecond())))
-			{
-				errorDesc = L"Failed to write to stream.";
-				goto FAILED;
-			}
-		}
-		else if (valueType == TypeData)
-		{
-			const void* ptr = this->Data().Contents();
-			uint64_t len = this->Data().Length();
-			if (!output.Write(len))
-			{
-				errorDesc = L"Failed to write to stream.";
-				goto FAILED;
-			}
-			if (len > 0 && stream->Write(ptr, len) != len)
-			{
-				errorDesc = L"Failed to write to stream.";
-				goto FAILED;
-			}
-		}
-		else if (valueType == TypeStructData)
-		{
-			const VStructuredData& stData = this->StructuredData();
-			size_t length = 0;
-			size_t numLayouts = stData.layout.Count();
-			if (stData.data)
-				length = stData.data->Length();
-			for (uint64_t hdr : { uint64_t(stData.elementSize), uint64_t(numLayouts), uint64_t(length)})
-			{
-				if (!output.Write(hdr))
+				break;
+			case DKVariant::TypeDateTime:
+				output.Write(uint64_t(var.DateTime().SecondsSinceEpoch()));
+				output.Write(uint32_t(var.DateTime().Microsecond()));
+				break;
+			case DKVariant::TypeData:
 				{
-					errorDesc = L"Failed to write to stream.";
-					goto FAILED;
+					uint64_t len = var.Data().Length();
+					output.Write(len);
+					if (len > 0)
+						output.WriteBytes(var.Data().Contents(), len);
 				}
-			}
-			if (stream->Write(stData.layout, numLayouts) != numLayouts)
-			{
-				errorDesc = L"Failed to write to stream.";
-				goto FAILED;
-			}
-			if (length > 0)
-			{
-				const uint8_t* dataPtr = reinterpret_cast<const uint8_t*>(stData.data->Contents());
-				bool succeeded = true;
-
-				if (byteOrder != DKRuntimeByteOrder())
-				{
-					size_t pos = 0;
-					while (pos < length && succeeded)
+				break;
+			case DKVariant::TypeStructData:
+				{
+					const VStructuredData& stData = var.StructuredData();
+					size_t length = 0;
+					size_t numLayouts = stData.layout.Count();
+					if (stData.data)
+						length = stData.data->Length();
+					output.Write(uint64_t(stData.elementSize));
+					output.Write(uint64_t(numLayouts));
+					output.Write(uint64_t(length));
+					if (numLayouts > 0)
+						output.WriteBytes((const StructElem*)stData.layout, numLayouts);
+					if (length > 0)
 					{
-						size_t n = 0;
-						const uint8_t* p2 = &(dataPtr[pos]);
-						for (StructElem e : stData.layout)
+						const uint8_t* dataPtr = reinterpret_cast<const uint8_t*>(stData.data->Contents());
+						if (output.swap && stData.elementSize > 0)
 						{
-							uint8_t fieldSize = static_cast<uint8_t>(e) & 0x0f;
-							if ((n + fieldSize) > stData.elementSize)
-								break;
-
-							if ((static_cast<uint8_t>(e) & 0xf0) == 0)
-							{
-								switch (fieldSize)
-								{
-								case 1:
-									succeeded = stream->Write(p2, 1) == 1;
-								case 2:
-									succeeded = output.Write(reinterpret_cast<const uint16_t*>(p2)[0]); break;
-								case 4:
-									succeeded = output.Write(reinterpret_cast<const uint32_t*>(p2)[0]); break;
-								case 8:
-									succeeded = output.Write(reinterpret_cast<const uint64_t*>(p2)[0]); break;
-								}
-							}
-							else
-							{
-								succeeded = stream->Write(p2, fieldSize) == fieldSize;
-							}
-							p2 += fieldSize;
-							n += fieldSize;
-
-							if (!succeeded)
-								break;
+							size_t count = length / stData.elementSize;
+							output.WriteStructElements(dataPtr, count, stData);
+							if (length > count * stData.elementSize)
+								output.WriteBytes(&dataPtr[count * stData.elementSize], length - count * stData.elementSize);
 						}
-						if (n < stData.elementSize && succeeded) // no entry in layout. (Raw-data)
+						else // same byte-order, just write data at once
 						{
-							size_t r = stData.elementSize - n;
-							succeeded = stream->Write(p2, r) == r;
+							output.WriteBytes(dataPtr, length);
 						}
-						pos += stData.elementSize;
 					}
 				}
-				else // same byte-order, just write data at once
+				break;
+			case DKVariant::TypeArray:
 				{
-					succeeded = stream->Write(dataPtr, length) == length;
+					const DKVariant::VArray& a = var.Array();
+					uint64_t len = a.Count();
+					output.Write(len);
+					for (size_t i = 0; i < len; ++i)
+					{
+						if (!ExportVariant(a.Value(i), output, errorDesc))
+							return false;
+					}
 				}
-
-				if (!succeeded)
+				break;
+			case DKVariant::TypePairs:
 				{
-					errorDesc = L"Failed to write to stream.";
-					goto FAILED;
+					const DKVariant::VPairs& pairs = var.Pairs();
+					output.Write(uint64_t(pairs.Count()));
+					bool result = true;
+					pairs.EnumerateForward([&](const DKVariant::VPairs::Pair& pair, bool* stop)
+					{
+						DKStringU8 key(pair.key);
+						uint64_t keyLen = key.Bytes();
+						output.Write(keyLen);				// key length
+						if (keyLen > 0)
+							output.WriteBytes((const char*)key, keyLen);	// key (utf8)
+						if (!ExportVariant(pair.value, output, errorDesc))	// value (DKVariant)
+						{
+							result = false;
+							*stop = true;
+						}
+					});
+					if (!result)
+						return false;
 				}
+				break;
 			}
-		}
-		else if (valueType == TypeArray)
-		{
-			const VArray& a = this->Array();
-
-			uint64_t len = a.Count();
-			if (!output.Write(len))
+			if (output.Failed())
 			{
 				errorDesc = L"Failed to write to stream.";
-				goto FAILED;
-			}
-			for (size_t i = 0; i < len; ++i)
-			{
-				if (a.Value(i).ExportStream(stream, byteOrder) == false)
-				{
-					errorDesc = L"Failed to extract array into stream.";
-					goto FAILED;
-				}
+				return false;
 			}
+			return true;
 		}
-		else if (valueType == TypePairs)
-		{
-			const VPairs& pairs = this->Pairs();
 
-			DKArray<const VPairs::Pair*> a;
-			a.Reserve(pairs.Count());
-			pairs.EnumerateForward([&a](const VPairs::Pair& pair)
-			{
-				a.Add(&pair); 
-			});
+		static bool ImportVariant(DKVariant& var, VariantStreamReader& input, DKString& errorDesc)
+		{
+			using Type = DKVariant::Type;
+			const size_t headerLen = strlen(DKVARIANT_HEADER_STRING_BIG_ENDIAN);
+			DKASSERT_DEBUG(headerLen == strlen(DKVARIANT_HEADER_STRING_LITTLE_ENDIAN));
 
-			uint64_t len = a.Count();
-			if (!output.Write(len))
+			char name[64];
+			if (!input.ReadBytes(name, headerLen))
 			{
-				errorDesc = L"Failed to write to stream.";
-				goto FAILED;
+				errorDesc = L"Failed to read from stream.";
+				return false;
 			}
-			for (size_t i = 0; i < len; ++i)
+			bool littleEndian = false;
+			if (strncmp(name, DKVARIANT_HEADER_STRING_BIG_ENDIAN, headerLen) == 0)
+				littleEndian = false;
+			else if (strncmp(name, DKVARIANT_HEADER_STRING_LITTLE_ENDIAN, headerLen) == 0)
+				littleEndian = true;
+			else
 			{
-				const VPairs::Pair* pair = a.Value(i);
-				DKStringU8 key(pair->key);
+				errorDesc = L"Format is not DKVariant";
+				return false;
+			}
+			const DKByteOrder byteOrder = littleEndian ? DKByteOrder::LittleEndian : DKByteOrder::BigEndian;
+			const bool swap = byteOrder != DKRuntimeByteOrder();
 
-				uint64_t keyLen = key.Bytes();
-				if (!output.Write(keyLen))  // key length
-				{
-					errorDesc = L"Failed to write to stream.";
-					goto FAILED;
-				}
-				if (keyLen > 0 && stream->Write((const char*)key, keyLen) != keyLen)	// key (utf8)
+			// read integers, floats in byte order of header.
+			auto Read = [&](auto& v) -> bool
+			{
+				if (!input.Read(v))
 				{
-					errorDesc = L"Failed to write to stream.";
-					goto FAILED;
+					errorDesc = L"Failed to read from stream.";
+					return false;
 				}
-				if (pair->value.ExportStream(stream, byteOrder) == false)		// value (DKVariant)
+				if (swap)
+					v = DKSwitchIntegralByteOrder(v);
+				return true;
+			};
+			auto ReadArray = [&](uint32_t* v, size_t count) -> bool
+			{
+				if (!input.ReadBytes(v, sizeof(uint32_t) * count))
 				{
-					errorDesc = L"Failed to extract array into stream.";
-					goto FAILED;
+					errorDesc = L"Failed to read from stream.";
+					return false;
 				}
-			}
-		}
-		else
-		{
-			errorDesc = DKString::Format("Unknown Type: 0x%x.", valueType);
-			goto FAILED;
-		}
-		return true;
-	}
-	else
-	{
-		errorDesc = DKString::Format("Unknown Type: 0x%x.", valueType);
-		goto FAILED;
-	}
-
-FAILED:
-	DKLog("DKVariant Error: %ls\n", (const wchar_t*)errorDesc);
-	return false;
-}
-
-bool DKVariant::ImportStream(DKStream* stream)
-{
-	size_t headerLen = strlen(DKVARIANT_HEADER_STRING_BIG_ENDIAN);
-	DKASSERT_DEBUG(headerLen == strlen(DKVARIANT_HEADER_STRING_LITTLE_ENDIAN));
-
-	DKString errorDesc = L"Unknown error";
-
-	bool validHeader = false;
-	bool littleEndian = false;
-
-	if (stream == NULL || stream->IsReadable() == false)
-	{
-		errorDesc = L"Invalid stream.";
-		goto FAILED;
-	}
-
-	char name[64];
-	if (stream->Read(name, headerLen) != headerLen)
-	{
-		errorDesc = L"Failed to read from stream.";
-		goto FAILED;
-	}
-
-	if (strncmp(name, DKVARIANT_HEADER_STRING_BIG_ENDIAN, headerLen) == 0)
-	{
-		validHeader = true;
-		littleEndian = false;
-	}
-	else if (strncmp(name, DKVARIANT_HEADER_STRING_LITTLE_ENDIAN, headerLen) == 0)
-	{
-		validHeader = true;
-		littleEndian = true;
-	}
-	else
-	{
-		validHeader = false;
-	}
+				if (swap)
+					SwitchByteOrderArray<uint32_t>(reinterpret_cast<uint8_t*>(v), count);
+				return true;
+			};
 
-	if (validHeader)
-	{
-		struct
-		{
-			uint16_t operator () (uint16_t v) const
-			{
-				return this->littleEndian ? DKLittleEndianToSystem(v) : DKBigEndianToSystem(v);
-			}
-			uint32_t operator () (uint32_t v) const
+			uint16_t version;
+			if (!Read(version))
+				return false;
+			if (version > DKVARIANT_VERSION)
 			{
-				return this->littleEndian ? DKLittleEndianToSystem(v) : DKBigEndianToSystem(v);
+				errorDesc = DKString::Format("Wrong binary version: 0x%x.", static_cast<unsigned int>(version));
+				return false;
 			}
-			uint64_t operator () (uint64_t v) const
+			if (version < DKVARIANT_VERSION)
 			{
-				return this->littleEndian ? DKLittleEndianToSystem(v) : DKBigEndianToSystem(v);
+				DKLog("DKVariant Warning: file is older version:0x%x current-version:0x%0x.\n", static_cast<unsigned int>(version), static_cast<unsigned int>(DKVARIANT_VERSION));
 			}
-			bool littleEndian;
-		} byteorder = { littleEndian };
 
-		unsigned short v;
-		if (stream->Read(&v, sizeof(v)) != sizeof(v))
-		{
-			errorDesc = L"Failed to read from stream.";
-			goto FAILED;
-		}
-		v = byteorder(v);
-		if (v <= DKVARIANT_VERSION)
-		{
-			if (v < DKVARIANT_VERSION)
-			{
-				DKLog("DKVariant Warning: file is older version:0x%x current-version:0x%0x.\n", static_cast<unsigned int>(v), static_cast<unsigned int>(DKVARIANT_VERSION));
-			}
-
-			unsigned int type;
-			if (stream->Read(&type, sizeof(type)) != sizeof(type))
+			uint32_t type;
+			if (!Read(type))
+				return false;
+			if (!IsValidVariantType(static_cast<Type>(type)))
 			{
-				errorDesc = L"Failed to read from stream.";
-				goto FAILED;
+				errorDesc = DKString::Format("Unknown Type: 0x%x.", type);
+				return false;
 			}
-			type = byteorder(type);
 
-			bool validType = false;
 			switch (static_cast<Type>(type))
 			{
-			case TypeUndefined:
-			case TypeInteger:
-			case TypeFloat:
-			case TypeVector2:
-			case TypeVector3:
-			case TypeVector4:
-			case TypeMatrix2:
-			case TypeMatrix3:
-			case TypeMatrix4:
-			case TypeQuaternion:
-			case TypeRationalNumber:
-			case TypeString:
-			case TypeDateTime:
-			case TypeData:
-			case TypeStructData:
-			case TypeArray:
-			case TypePairs:
-				validType = true;
+			case DKVariant::TypeUndefined:
+				var.SetValueType(DKVariant::TypeUndefined);
 				break;
-			}
-			if (validType)
-			{
-				if (type == TypeUndefined)
-				{
-					SetValueType(TypeUndefined);
-				}
-				else if (type == TypeInteger)
+			case DKVariant::TypeInteger:
 				{
 					uint64_t v;
-					if (stream->Read(&v, sizeof(v)) != sizeof(v))
-					{
-						errorDesc = L"Failed to read from stream.";
-						goto FAILED;
-					}
-					this->SetValueType(TypeInteger).Integer() = byteorder(v);
+					if (!Read(v))
+						return false;
+					var.SetValueType(DKVariant::TypeInteger).Integer() = v;
 				}
-				else if (type == TypeFloat)
+				break;
+			case DKVariant::TypeFloat:
 				{
 					uint64_t v;
-					if (stream->Read(&v, sizeof(v)) != sizeof(v))
-					{
-						errorDesc = L"Failed to read from stream.";
-						goto FAILED;
-					}
-					v = byteorder(v);
-					this->SetValueType(TypeFloat).Float() = *reinterpret_cast<VFloat*>(&v);
-				}
-				else if (type == TypeVector2)
-				{
-					uint32_t v[2];
-					if (stream->Read(v, sizeof(v)) != sizeof(v))
-					{
-						errorDesc = L"Failed to read from stream.";
-						goto FAILED;
-					}
-					VVector2 val;
-					for (int i = 0; i < 2; ++i)
-					{
-						v[i] = byteorder(v[i]);
-						val.val[i] = *reinterpret_cast<float*>(&v[i]);
-					}
-					this->SetValueType(TypeVector2).Vector2() = val;
-				}
-				else if (type == TypeVector3)
-				{
-					uint32_t v[3];
-					if (stream->Read(v, sizeof(v)) != sizeof(v))
-					{
-						errorDesc = L"Failed to read from stream.";
-						goto FAILED;
-					}
-					VVector3 val;
-					for (int i = 0; i < 3; ++i)
-					{
-						v[i] = byteorder(v[i]);
-						val.val[i] = *reinterpret_cast<float*>(&v[i]);
-					}
-					this->SetValueType(TypeVector3).Vector3() = val;
-				}
-				else if (type == TypeVector4)
-				{
-					uint32_t v[4];
-					if (stream->Read(v, sizeof(v)) != sizeof(v))
-					{
-						errorDesc = L"Failed to read from stream.";
-						goto FAILED;
-					}
-					VVector4 val;
-					for (int i = 0; i < 4; ++i)
-					{
-						v[i] = byteorder(v[i]);
-						val.val[i] = *reinterpret_cast<float*>(&v[i]);
-					}
-					this->SetValueType(TypeVector4).Vector4() = val;
-				}
-				else if (type == TypeMatrix2)
-				{
-					uint32_t v[4];
-					if (stream->Read(v, sizeof(v)) != sizeof(v))
-					{
-						errorDesc = L"Failed to read from stream.";
-						goto FAILED;
-					}
-					VMatrix2 val;
-					for (int i = 0; i < 4; ++i)
-					{
-						v[i] = byteorder(v[i]);
-						val.val[i] = *reinterpret_cast<float*>(&v[i]);
-					}
-					this->SetValueType(TypeMatrix2).Matrix2() = val;
-				}
-				else if (type == TypeMatrix3)
-				{
-					uint32_t v[9];
-					if (stream->Read(v, sizeof(v)) != sizeof(v))
-					{
-						errorDesc = L"Failed to read from stream.";
-						goto FAILED;
-					}
-					VMatrix3 val;
-					for (int i = 0; i < 9; ++i)
-					{
-						v[i] = byteorder(v[i]);
-						val.val[i] = *reinterpret_cast<float*>(&v[i]);
-					}
-					this->SetValueType(TypeMatrix3).Matrix3() = val;
+					if (!Read(v))
+						return false;
+					memcpy(&var.SetValueType(DKVariant::TypeFloat).Float(), &v, sizeof(v));
 				}
-				else if (type == TypeMatrix4)
-				{
-					uint32_t v[16];
-					if (stream->Read(v, sizeof(v)) != sizeof(v))
-					{
-						errorDesc = L"Failed to read from stream.";
-						goto FAILED;
-					}
-					VMatrix4 val;
-					for (int i = 0; i < 16; ++i)
-					{
-						v[i] = byteorder(v[i]);
-						val.val[i] = *reinterpret_cast<float*>(&v[i]);
-					}
-					this->SetValueType(TypeMatrix4).Matrix4() = val;
-				}
-				else if (type == TypeQuaternion)
-				{
-					uint32_t v[4];
-					if (stream->Read(v, sizeof(v)) != sizeof(v))
-					{
-						errorDesc = L"Failed to read from stream.";
-						goto FAILED;
-					}
-					VQuaternion val;
-					for (int i = 0; i < 4; ++i)
-					{
-						v[i] = byteorder(v[i]);
-						val.val[i] = *reinterpret_cast<float*>(&v[i]);
-					}
-					this->SetValueType(TypeQuaternion).Quaternion() = val;
-				}
-				else if (type == TypeRationalNumber)
+				break;
+			case DKVariant::TypeVector2:
+				if (!ReadArray(reinterpret_cast<uint32_t*>(var.SetValueType(DKVariant::TypeVector2).Vector2().val), 2))
+					return false;
+				break;
+			case DKVariant::TypeVector3:
+				if (!ReadArray(reinterpret_cast<uint32_t*>(var.SetValueType(DKVariant::TypeVector3).Vector3().val), 3))
+					return false;
+				break;
+			case DKVariant::TypeVector4:
+				if (!ReadArray(reinterpret_cast<uint32_t*>(var.SetValueType(DKVariant::TypeVector4).Vector4().val), 4))
+					return false;
+				break;
+			case DKVariant::TypeMatrix2:
+				if (!ReadArray(reinterpret_cast<uint32_t*>(var.SetValueType(DKVariant::TypeMatrix2).Matrix2().val), 4))
+					return false;
+				break;
+			case DKVariant::TypeMatrix3:
+				if (!ReadArray(reinterpret_cast<uint32_t*>(var.SetValueType(DKVariant::TypeMatrix3).Matrix3().val), 9))
+					return false;
+				break;
+			case DKVariant::TypeMatrix4:
+				if (!ReadArray(reinterpret_cast<uint32_t*>(var.SetValueType(DKVariant::TypeMatrix4).Matrix4().val), 16))
+					return false;
+				break;
+			case DKVariant::TypeQuaternion:
+				if (!ReadArray(reinterpret_cast<uint32_t*>(var.SetValueType(DKVariant::TypeQuaternion).Quaternion().val), 4))
+					return false;
+				break;
+			case DKVariant::TypeRationalNumber:
 				{
-					struct
-					{
-						int64_t n, d;
-					} r = { 0LL, 0LL };
-
-					if (stream->Read(&r, sizeof(r)) != sizeof(r))
-					{
-						errorDesc = L"Failed to read from stream.";
-						goto FAILED;
-					}
-
-					r.n = byteorder(static_cast<uint64_t>(r.n));
-					r.d = byteorder(static_cast<uint64_t>(r.d));
-
-					this->SetValueType(TypeRationalNumber).RationalNumber() = VRationalNumber(r.n, r.d);
+					uint64_t n, d;
+					if (!Read(n) || !Read(d))
+						return false;
+					var.SetValueType(DKVariant::TypeRationalNumber).RationalNumber() = DKVariant::VRationalNumber(int64_t(n), int64_t(d));
 				}
-				else if (type == TypeString)
+				break;
+			case DKVariant::TypeString:
 				{
-					uint64_t v;
-					if (stream->Read(&v, sizeof(v)) != sizeof(v))
-					{
-						errorDesc = L"Failed to read from stream.";
-						goto FAILED;
-					}
-					uint64_t len = byteorder(v);
+					uint64_t len;
+					if (!Read(len))
+						return false;
 					DKString str = L"";
 					if (len > 0)
 					{
+						if (input.RemainLength() < len)
+						{
+							errorDesc = L"Invalid stream length.";
+							return false;
+						}
 						void* p = DKMalloc(len);
-						if (stream->Read(p, len) != len)
+						if (p == NULL)
+						{
+							errorDesc = L"Out of memory.";
+							return false;
+						}
+						if (!input.ReadBytes(p, len))
 						{
 							DKFree(p);
 							errorDesc = L"Failed to read from stream.";
-							goto FAILED;
+							return false;
 						}
 						str.SetValue((const DKUniChar8*)p, len);
 						DKFree(p);
 					}
-					this->SetValueType(TypeString).String() = static_cast<DKString&&>(str);
+					var.SetValueType(DKVariant::TypeString).String() = static_cast<DKString&&>(str);
 				}
-				else if (type == TypeDateTime)
+				break;
+			case DKVariant::TypeDateTime:
 				{
-					struct
-					{
-						uint64_t s;
-						uint32_t ms;
-					} dt = { 0LL, 0 };
-
-					if (stream->Read(&dt, sizeof(dt)) != sizeof(dt))
-					{
-						errorDesc = L"Failed to read from stream.";
-						goto FAILED;
-					}
-
-					dt.s = byteorder(dt.s);
-					dt.ms = byteorder(dt.ms);
-
-					this->SetValueType(TypeDateTime).DateTime() = DKDateTime(dt.s, dt.ms);
+					uint64_t s;
+					uint32_t ms;
+					if (!Read(s) || !Read(ms))
+						return false;
+					var.SetValueType(DKVariant::TypeDateTime).DateTime() = DKDateTime(s, ms);
 				}
-				else if (type == TypeData)
+				break;
+			case DKVariant::TypeData:
 				{
-					uint64_t v;
-					if (stream->Read(&v, sizeof(v)) != sizeof(v))
-					{
-						errorDesc = L"Failed to read from stream.";
-						goto FAILED;
-					}
-					uint64_t len = byteorder(v);
+					uint64_t len;
+					if (!Read(len))
+						return false;
 					if (len > 0)
 					{
-						if (stream->RemainLength() >= len)
+						if (input.RemainLength() < len)
 						{
-							DKBuffer val;
-							val.SetContents(0, len);
-							void* p = val.MutableContents();
-							if (stream->Read(p, len) != len)
-							{
-								errorDesc = L"Failed to read from stream.";
-								goto FAILED;
-							}
-							this->SetData(val);
+							errorDesc = L"Invalid stream length.";
+							return false;
 						}
-						else
+						DKObject<DKData> val = ReadVariantPayload(input, len);
+						if (val == NULL)
 						{
-							errorDesc = L"Invalid stream length.";
-							goto FAILED;
+							errorDesc = L"Failed to read from stream.";
+							return false;
 						}
+						var.SetData(val);
 					}
 					else
-						this->SetData(0);
+						var.SetData(0);
 				}
-				else if (type == TypeStructData)
+				break;
+			case DKVariant::TypeStructData:
 				{
-					struct
-					{
-						uint64_t elementSize;
-						uint64_t numLayouts;
-						uint64_t dataLength;
-					} stInfo = { 0, 0, 0 };
-
-					if (stream->Read(&stInfo, sizeof(stInfo)) != sizeof(stInfo))
-					{
-						errorDesc = L"Failed to read from stream.";
-						goto FAILED;
-					}
-					stInfo.elementSize = byteorder(stInfo.elementSize);
-					stInfo.numLayouts = byteorder(stInfo.numLayouts);
-					stInfo.dataLength = byteorder(stInfo.dataLength);
+					uint64_t elementSize, numLayouts, dataLength;
+					if (!Read(elementSize) || !Read(numLayouts) || !Read(dataLength))
+						return false;
 
 					VStructuredData stData;
-					stData.elementSize = stInfo.elementSize;
-					if (stInfo.numLayouts > 0)
+					stData.elementSize = elementSize;
+					if (numLayouts > 0)
 					{
-						if (stream->RemainLength() >= stInfo.numLayouts)
+						if (input.RemainLength() < numLayouts)
 						{
-							stData.layout.Resize(stInfo.numLayouts);
-							if (stream->Read(stData.layout, stInfo.numLayouts) != stInfo.numLayouts)
-							{
-								errorDesc = L"Failed to read from stream.";
-								goto FAILED;
-							}
-							if (!ValidateStructElementLayout(stData))
-							{
-								errorDesc = L"Failed to read from stream.";
-								goto FAILED;
-							}
+							errorDesc = L"Invalid stream length.";
+							return false;
 						}
-						else
+						stData.layout.Resize(numLayouts);
+						if (!input.ReadBytes((StructElem*)stData.layout, numLayouts) ||
+							!ValidateStructElementLayout(stData))
 						{
-							errorDesc = L"Invalid stream length.";
-							goto FAILED;
+							errorDesc = L"Failed to read from stream.";
+							return false;
 						}
 					}
-					if (stInfo.dataLength > 0)
+					if (dataLength > 0)
 					{
-						if (stream->RemainLength() >= stInfo.dataLength)
+						if (input.RemainLength() < dataLength)
 						{
-							stData.data = DKOBJECT_NEW DKBuffer(0, stInfo.dataLength);
-							void* p = stData.data->MutableContents();
-							if (stream->Read(p, stInfo.dataLength) != stInfo.dataLength)
-							{
-								errorDesc = L"Failed to read from stream.";
-								goto FAILED;
-							}
+							errorDesc = L"Invalid stream length.";
+							return false;
 						}
+						// swapping byte order needs writable copy.
+						if (byteOrder == DKRuntimeByteOrder())
+							stData.data = ReadVariantPayload(input, dataLength);
 						else
 						{
-							errorDesc = L"Invalid stream length.";
-							goto FAILED;
+							stData.data = DKOBJECT_NEW DKBuffer(0, dataLength);
+							if (!input.ReadBytes(stData.data->MutableContents(), dataLength))
+								stData.data = NULL;
+						}
+						if (stData.data == NULL)
+						{
+							errorDesc = L"Failed to read from stream.";
+							return false;
 						}
 					}
-					if (ConvertStructuredDataByteOrder(stData, littleEndian ? DKByteOrder::LittleEndian : DKByteOrder::BigEndian))
-					{
-						this->SetValueType(TypeStructData).StructuredData() = static_cast<VStructuredData&&>(stData);
-					}
-					else
+					if (!ConvertStructuredDataByteOrder(stData, byteOrder))
 					{
 						errorDesc = L"Converting byte order failed.";
-						goto FAILED;
+						return false;
 					}
+					var.SetValueType(DKVariant::TypeStructData).StructuredData() = static_cast<VStructuredData&&>(stData);
 				}
-				else if (type == TypeArray)
+				break;
+			case DKVariant::TypeArray:
 				{
-					uint64_t v;
-					if (stream->Read(&v, sizeof(v)) != sizeof(v))
-					{
-						errorDesc = L"Failed to read from stream.";
-						goto FAILED;
-					}
-					uint64_t len = byteorder(v);
-					VArray val;
+					uint64_t len;
+					if (!Read(len))
+						return false;
+					DKVariant::VArray val;
 					if (len > 0)
 					{
-						val.Reserve(len);
+						// each element has header at least.
+						val.Reserve((size_t)Min(len, uint64_t(input.RemainLength() / headerLen)));
 						for (uint64_t i = 0; i < len; ++i)
 						{
-							DKVariant v;
-							if (v.ImportStream(stream) == false)
+							// restore element in place.
+							size_t index = val.Add(DKVariant());
+							if (!ImportVariant(val.Value(index), input, errorDesc))
 							{
 								errorDesc = L"Failed to restore array element from stream.";
-								goto FAILED;
+								return false;
 							}
-							val.Add(v);
 						}
 					}
-					this->SetValueType(TypeArray).Array() = static_cast<VArray&&>(val);
+					var.SetValueType(DKVariant::TypeArray).Array() = static_cast<DKVariant::VArray&&>(val);
 				}
-				else if (type == TypePairs)
+				break;
+			case DKVariant::TypePairs:
 				{
-					uint64_t v;
-					if (stream->Read(&v, sizeof(v)) != sizeof(v))
-					{
-						errorDesc = L"Failed to read from stream.";
-						goto FAILED;
-					}
-					uint64_t len = byteorder(v);
-					VPairs val;
+					uint64_t len;
+					if (!Read(len))
+						return false;
+					DKVariant::VPairs val;
 					for (uint64_t i = 0; i < len; ++i)
 					{
 						uint64_t keyLen;
-						if (stream->Read(&keyLen, sizeof(keyLen)) != sizeof(keyLen))
-						{
-							errorDesc = L"Failed to read from stream.";
-							goto FAILED;
-						}
+						if (!Read(keyLen))
+							return false;
 						DKString key = L"";
 						if (keyLen > 0)
 						{
+							if (input.RemainLength() < keyLen)
+							{
+								errorDesc = L"Invalid stream length.";
+								return false;
+							}
 							void* p = DKMalloc(keyLen);
-							if (stream->Read(p, keyLen) != keyLen)
+							if (p == NULL)
+							{
+								errorDesc = L"Out of memory.";
+								return false;
+							}
+							if (!input.ReadBytes(p, keyLen))
 							{
 								DKFree(p);
 								errorDesc = L"Failed to read from stream.";
-								goto FAILED;
+								return false;
 							}
 							key.SetValue((const DKUniChar8*)p, keyLen);
 							DKFree(p);
 						}
-						DKVariant variant;
-						if (variant.ImportStream(stream) == false)
+						// restore value in place.
+						if (!ImportVariant(val.Value(key), input, errorDesc))
 						{
 							errorDesc = L"Failed to restore map element from stream.";
-							goto FAILED;
+							return false;
 						}
-						val.Update(key, variant);
 					}
-					this->SetValueType(TypePairs).Pairs() = static_cast<VPairs&&>(val);
+					var.SetValueType(DKVariant::TypePairs).Pairs() = static_cast<DKVariant::VPairs&&>(val);
 				}
-				else
-				{
-					errorDesc = DKString::Format("Unknown Type: 0x%x.", valueType);
-					goto FAILED;
-				}
-				return true;
-			}
-			else
-			{
-				errorDesc = DKString::Format("Unknown Type: 0x%x.", type);
-				goto FAILED;
+				break;
 			}
+			return true;
 		}
-		else
+	}
+}
+
+bool DKVariant::ExportStream(DKStream* stream, DKByteOrder byteOrder) const
+{
+	DKString errorDesc = L"Unknown error";
+
+	if (stream == NULL || stream->IsWritable() == false)
+	{
+		errorDesc = L"Invalid stream.";
+	}
+	else
+	{
+		if (byteOrder == DKByteOrder::Unknown)
+			byteOrder = DKRuntimeByteOrder();
+
+		VariantStreamWriter output(stream, byteOrder);
+		if (ExportVariant(*this, output, errorDesc))
 		{
-			errorDesc = DKString::Format("Wrong binary version: 0x%x.", static_cast<unsigned int>(v));
-			goto FAILED;
+			if (output.Flush())
+				return true;
+			errorDesc = L"Failed to write to stream.";
 		}
 	}
+	DKLog("DKVariant Error: %ls\n", (const wchar_t*)errorDesc);
+	return false;
+}
+
+bool DKVariant::ImportStream(DKStream* stream)
+{
+	DKString errorDesc = L"Unknown error";
+
+	if (stream == NULL || stream->IsReadable() == false)
+	{
+		errorDesc = L"Invalid stream.";
+	}
 	else
 	{
-		errorDesc = L"Format is not DKVariant";
-		goto FAILED;
+		// decode into temporary, keep this unchanged on failure.
+		DKVariant var;
+		VariantStreamReader input(stream);
+		bool result = ImportVariant(var, input, errorDesc);
+		input.Finish();
+		if (result)
+		{
+			*this = static_cast<DKVariant&&>(var);
+			return true;
+		}
 	}
+	DKLog("DKVariant Error: %ls\n", (const wchar_t*)errorDesc);
+	return false;
+}
+
+bool DKVariant::ImportData(DKData* data)
+{
+	DKString errorDesc = L"Unknown error";
 
-FAILED:
+	if (data == NULL || data->IsReadable() == false)
+	{
+		errorDesc = L"Invalid data.";
+	}
+	else if (data->IsTransient() || data->IsWritable())
+	{
+		// data cannot be referenced after import,
+		// writable data can be modified by owner.
+		DKDataStream stream(data);
+		return ImportStream(&stream);
+	}
+	else
+	{
+		DKVariant var;
+		VariantStreamReader input(data);
+		if (ImportVariant(var, input, errorDesc))
+		{
+			*this = static_cast<DKVariant&&>(var);
+			return true;
+		}
+	}
 	DKLog("DKVariant Error: %ls\n", (const wchar_t*)errorDesc);
 	return false;
 }
-#pragma pack(pop)
 
 DKVariant& DKVariant::operator = (const DKVariant& v)
 {
@@ -138,6 +138,11 @@ namespace DKFramework
 
 		bool ExportStream(DKStream* stream, DKByteOrder byteOrder = DKByteOrder::Unknown) const; ///< generate binary data
 		bool ImportStream(DKStream* stream); ///< import from binary data
+		/// import from binary data without copy. values of TypeData, TypeStructData
+		/// refer to given data (hold reference) if byte order matches.
+		/// writable or transient data is copied, like ImportStream.
+		/// @note payload of TypeStructData may not be aligned.
+		bool ImportData(DKData* data);
 
 		DKVariant& SetInteger(const VInteger& v);
 		DKVariant& SetFloat(const VFloat& v);
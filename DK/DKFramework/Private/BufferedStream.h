@@ -0,0 +1,380 @@
+//
+//  File: BufferedStream.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2022 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <type_traits>
+#include "../../DKFoundation.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// BufferedStream.h
+// Buffered binary writer and reader shared by DKVariant binary format and
+// DKSerializer compact format. fixed size values are converted to byte order
+// of stream. (floating point values are swapped as integer of same size)
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFramework
+{
+	namespace Private
+	{
+		template <typename U, typename T> FORCEINLINE T SwitchByteOrderAs(T v)
+		{
+			static_assert(sizeof(U) == sizeof(T), "Invalid type size");
+			U u;
+			memcpy(&u, &v, sizeof(T));
+			u = DKSwitchIntegralByteOrder(u);
+			memcpy(&v, &u, sizeof(T));
+			return v;
+		}
+		template <typename T> FORCEINLINE T SwitchByteOrder(T v, DKNumber<1>) { return v; }
+		template <typename T> FORCEINLINE T SwitchByteOrder(T v, DKNumber<2>) { return SwitchByteOrderAs<uint16_t>(v); }
+		template <typename T> FORCEINLINE T SwitchByteOrder(T v, DKNumber<4>) { return SwitchByteOrderAs<uint32_t>(v); }
+		template <typename T> FORCEINLINE T SwitchByteOrder(T v, DKNumber<8>) { return SwitchByteOrderAs<uint64_t>(v); }
+		/// swap byte order of integer or floating point value.
+		template <typename T> FORCEINLINE T SwitchByteOrder(T v)
+		{
+			static_assert(std::is_arithmetic<T>::value, "Argument must be arithmetic type.");
+			return SwitchByteOrder(v, DKNumber<sizeof(T)>());
+		}
+
+		/// buffered output stream.
+		/// values are collected into buffer and written to stream at once,
+		/// writes to stream directly if buffer could not be allocated.
+		class BufferedStreamWriter
+		{
+		public:
+			enum { BufferSize = 0x10000 };
+
+			BufferedStreamWriter(DKStream* s, DKByteOrder bo)
+				: byteOrder(bo)
+				, swap(bo != DKRuntimeByteOrder())
+				, stream(s)
+				, buffer(reinterpret_cast<uint8_t*>(DKMalloc(BufferSize)))
+				, length(0)
+				, bytesWritten(0)
+				, failed(false)
+			{
+			}
+			~BufferedStreamWriter()
+			{
+				if (buffer)
+					DKFree(buffer);
+			}
+			template <typename T> void Write(T v)
+			{
+				if (swap)
+					v = SwitchByteOrder(v);
+				WriteBytes(&v, sizeof(T));
+			}
+			template <typename T> void WriteArray(const T* p, size_t count)
+			{
+				if (swap)
+				{
+					for (size_t i = 0; i < count; ++i)
+						Write(p[i]);
+				}
+				else
+					WriteBytes(p, sizeof(T) * count);
+			}
+			void WriteByte(uint8_t v)
+			{
+				if (buffer && length < BufferSize)
+					buffer[length++] = v;
+				else
+					WriteBytes(&v, 1);
+			}
+			void WriteBytes(const void* p, size_t n)
+			{
+				if (buffer == NULL || length + n > BufferSize)
+				{
+					Flush();
+					if (buffer == NULL || n >= BufferSize)
+					{
+						if (!failed)
+						{
+							if (stream->Write(p, n) == n)
+								bytesWritten += n;
+							else
+								failed = true;
+						}
+						return;
+					}
+				}
+				memcpy(&buffer[length], p, n);
+				length += n;
+			}
+			/// returns n bytes of buffer to be filled by caller.
+			/// returns NULL if buffer is not available or smaller than n.
+			uint8_t* Allocate(size_t n)
+			{
+				if (buffer == NULL || n > BufferSize)
+					return NULL;
+				if (length + n > BufferSize)
+					Flush();
+				uint8_t* p = &buffer[length];
+				length += n;
+				return p;
+			}
+			bool Flush()
+			{
+				if (length > 0 && !failed)
+				{
+					if (stream->Write(buffer, length) == length)
+						bytesWritten += length;
+					else
+						failed = true;
+				}
+				length = 0;
+				return !failed;
+			}
+			bool Failed() const				{ return failed; }
+			size_t BytesWritten() const		{ return bytesWritten; }
+
+			const DKByteOrder byteOrder;
+			const bool swap;
+
+		private:
+			DKStream* stream;
+			uint8_t* buffer;
+			size_t length;
+			size_t bytesWritten;
+			bool failed;
+
+			BufferedStreamWriter(const BufferedStreamWriter&) = delete;
+			BufferedStreamWriter& operator = (const BufferedStreamWriter&) = delete;
+		};
+
+		/// buffered input stream.
+		/// reads ahead from seekable stream only, unused data is returned
+		/// to stream by Finish(). (stream position is end of last read)
+		/// with memory or source data, reads from it directly and
+		/// payloads of source data can be referenced without copy. (ReadView)
+		class BufferedStreamReader
+		{
+		public:
+			enum { BufferSize = 0x10000 };
+
+			BufferedStreamReader(DKStream* s)
+				: stream(s)
+				, data(NULL)
+				, storage(NULL)
+				, capacity(0)
+				, pos(0)
+				, end(0)
+				, swap(false)
+				, failed(false)
+			{
+			}
+			BufferedStreamReader(const void* p, size_t len)
+				: stream(NULL)
+				, data(reinterpret_cast<const uint8_t*>(p))
+				, storage(NULL)
+				, capacity(0)
+				, pos(0)
+				, end(p ? len : 0)
+				, swap(false)
+				, failed(false)
+			{
+			}
+			/// read from source data, holds reference of source.
+			BufferedStreamReader(DKData* src)
+				: stream(NULL)
+				, source(src)
+				, data(reinterpret_cast<const uint8_t*>(src->Contents()))
+				, storage(NULL)
+				, capacity(0)
+				, pos(0)
+				, end(data ? src->Length() : 0)
+				, swap(false)
+				, failed(false)
+			{
+			}
+			~BufferedStreamReader()
+			{
+				if (storage)
+					DKFree(storage);
+			}
+			/// byte order of fixed size values, default is runtime byte order.
+			void SetByteOrder(DKByteOrder bo)
+			{
+				swap = bo != DKRuntimeByteOrder();
+			}
+			/// returns pointer to n bytes and advance, valid until next read.
+			const uint8_t* Consume(size_t n)
+			{
+				if (Ensure(n))
+				{
+					const uint8_t* p = &data[pos];
+					pos += n;
+					return p;
+				}
+				return NULL;
+			}
+			bool ReadByte(uint8_t& v)
+			{
+				if (pos < end || Ensure(1))
+				{
+					v = data[pos++];
+					return true;
+				}
+				return false;
+			}
+			/// copy n bytes, large data read from stream directly.
+			bool ReadBytes(void* p, size_t n)
+			{
+				uint8_t* dst = reinterpret_cast<uint8_t*>(p);
+				size_t buffered = Min(n, end - pos);
+				if (buffered > 0)
+				{
+					memcpy(dst, &data[pos], buffered);
+					pos += buffered;
+					dst += buffered;
+					n -= buffered;
+				}
+				if (n == 0)
+					return true;
+				if (stream && n < BufferSize && stream->IsSeekable())
+				{
+					const uint8_t* src = Consume(n);
+					if (src == NULL)
+						return false;
+					memcpy(dst, src, n);
+					return true;
+				}
+				if (stream == NULL || failed || stream->Read(dst, n) != n)
+					return Fail();
+				return true;
+			}
+			template <typename T> bool Read(T& v)
+			{
+				const uint8_t* p = Consume(sizeof(T));
+				if (p)
+				{
+					memcpy(&v, p, sizeof(T));
+					if (swap)
+						v = SwitchByteOrder(v);
+					return true;
+				}
+				return false;
+			}
+			template <typename T> bool ReadArray(T* p, size_t count)
+			{
+				for (size_t i = 0; i < count; ++i)
+				{
+					if (!Read(p[i]))
+						return false;
+				}
+				return true;
+			}
+			bool Skip(size_t n)
+			{
+				while (n > 0)
+				{
+					size_t s = Min(n, size_t(BufferSize));
+					if (Consume(s) == NULL)
+						return false;
+					n -= s;
+				}
+				return true;
+			}
+			/// read-only view of source data, holds reference of source.
+			/// returns NULL if reader has no source data.
+			DKObject<DKData> ReadView(size_t n)
+			{
+				if (source && n <= end - pos)
+				{
+					DKObject<DKData> src = source;
+					DKObject<DKOperation> cleanup = DKFunction([src]() {})->Invocation().SafeCast<DKOperation>();
+					DKObject<DKData> view = DKData::StaticData((const void*)&data[pos], n, cleanup);
+					pos += n;
+					return view;
+				}
+				return NULL;
+			}
+			/// remaining bytes can be read. (unknown for non-seekable stream)
+			uint64_t RemainLength() const
+			{
+				if (stream)
+				{
+					if (stream->IsSeekable())
+						return (end - pos) + stream->RemainLength();
+					return (uint64_t)-1;
+				}
+				return end - pos;
+			}
+			/// put back unused bytes to stream.
+			void Finish()
+			{
+				if (stream && end > pos && stream->IsSeekable())
+					stream->SetCurrentPosition(stream->CurrentPosition() - (end - pos));
+				if (stream)
+					pos = end;
+			}
+			bool Fail()
+			{
+				failed = true;
+				return false;
+			}
+			bool Failed() const		{ return failed; }
+
+		private:
+			// make n bytes available in buffer.
+			bool Ensure(size_t n)
+			{
+				if (end - pos >= n)
+					return true;
+				if (stream == NULL || failed)
+					return Fail();
+
+				size_t remains = end - pos;
+				if (n > capacity)
+				{
+					size_t size = Max(n, size_t(BufferSize));
+					uint8_t* p = reinterpret_cast<uint8_t*>(DKMalloc(size));
+					if (p == NULL)
+						return Fail();
+					if (remains > 0)
+						memcpy(p, &data[pos], remains);
+					if (storage)
+						DKFree(storage);
+					storage = p;
+					capacity = size;
+				}
+				else if (remains > 0)
+				{
+					memmove(storage, &data[pos], remains);
+				}
+				data = storage;
+				pos = 0;
+				end = remains;
+
+				// read ahead from seekable stream only.
+				size_t request = n - remains;
+				if (stream->IsSeekable())
+					request = Max(request, (size_t)Min(uint64_t(capacity - remains), uint64_t(stream->RemainLength())));
+				size_t numRead = stream->Read(&storage[end], request);
+				if (numRead != (size_t)-1)
+					end += Min(numRead, request);
+				if (end - pos < n)
+					return Fail();
+				return true;
+			}
+
+			DKStream* stream;
+			DKObject<DKData> source;
+			const uint8_t* data;
+			uint8_t* storage;
+			size_t capacity;
+			size_t pos;
+			size_t end;
+			bool swap;
+			bool failed;
+
+			BufferedStreamReader(const BufferedStreamReader&) = delete;
+			BufferedStreamReader& operator = (const BufferedStreamReader&) = delete;
+		};
+	}
+}
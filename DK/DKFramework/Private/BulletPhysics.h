@@ -10,6 +10,8 @@
 #include "../../Libs/BulletPhysics/src/BulletCollision/CollisionShapes/btConvexPolyhedron.h"
 
 #include "../../Libs/BulletPhysics/src/BulletSoftBody/btSoftRigidDynamicsWorld.h"
+#include "../../Libs/BulletPhysics/src/BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h"
+#include "../../Libs/BulletPhysics/src/BulletDynamics/Dynamics/btSimulationIslandManagerMt.h"
 
 #include "../../Libs/BulletPhysics/src/BulletCollision/NarrowPhaseCollision/btGjkPairDetector.h"
 #include "../../Libs/BulletPhysics/src/BulletCollision/NarrowPhaseCollision/btPointCollector.h"
@@ -0,0 +1,76 @@
+//
+//  File: ParallelScheduler.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2022 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include "../../DKFoundation.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// ParallelScheduler.h
+// fork/join helper for DKOperationQueue, shared by scene, dynamics and bvh.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFramework
+{
+	namespace Private
+	{
+		// parallel-for with threads of DKOperationQueue.
+		// calling thread takes batches too, so that loop is not stalled by
+		// operations which are not started yet. (they are cancelled at end)
+		// this can be called from operation of same queue, nested loop will
+		// be finished by calling thread if no other thread is available.
+		struct ParallelScheduler
+		{
+			DKOperationQueue* queue;
+			size_t maxThreads;	// including calling thread.
+
+			ParallelScheduler() : queue(NULL), maxThreads(1) {}
+			ParallelScheduler(DKOperationQueue* q)
+				: queue(q), maxThreads(q ? q->MaxConcurrentOperations() : 1) {}
+
+			bool IsParallel() const { return queue && maxThreads > 1; }
+
+			template <typename Body> void ParallelFor(size_t count, size_t grain, Body&& body)
+			{
+				grain = Max(grain, size_t(1));
+				size_t numTasks = Min(maxThreads, (count + grain - 1) / grain);
+				if (queue == NULL || numTasks < 2)
+				{
+					if (count > 0)
+						body(size_t(0), count);
+					return;
+				}
+
+				const size_t numBatches = (count + grain - 1) / grain;
+				DKAtomicNumber32 nextBatch = 0;
+				auto work = [&]()
+				{
+					for (;;)
+					{
+						size_t batch = static_cast<size_t>(nextBatch.Increment()) - 1;
+						if (batch >= numBatches)
+							break;
+						size_t begin = batch * grain;
+						body(begin, Min(begin + grain, count));
+					}
+				};
+
+				DKArray<DKObject<DKOperationQueue::OperationSync>> tasks;
+				tasks.Reserve(numTasks - 1);
+				for (size_t i = 1; i < numTasks; ++i)
+					tasks.Add(queue->ProcessAsync(DKFunction([&work]() {work();})->Invocation()));
+
+				work();
+
+				for (DKOperationQueue::OperationSync* sync : tasks)
+				{
+					if (!sync->Cancel())
+						sync->Sync();
+				}
+			}
+		};
+	}
+}